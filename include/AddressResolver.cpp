@@ -0,0 +1,105 @@
+/**
+ * @file AddressResolver.cpp
+ * @brief Implementation of the AddressResolver class, which turns server names into socket addresses.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "AddressResolver.h"
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+/**
+ * @brief Cached addresses of one server.
+ */
+struct Entry {
+    std::vector<AddressResolver::Address> addresses; /**< The addresses, preferred first. */
+    std::chrono::steady_clock::time_point expires;   /**< When the entry must be resolved again. */
+};
+
+std::mutex cacheMutex;                        /**< Guards `cache`. */
+std::unordered_map<std::string, Entry> cache; /**< Entries by `host:port`. */
+
+/**
+ * @brief Returns the cache key of a server.
+ */
+std::string key(const std::string& host, int port) {
+    return host + ":" + std::to_string(port);
+}
+
+} // namespace
+
+/**
+ * @brief The lookup itself runs without the lock, so a slow DNS server delays only the threads
+ * that need the same uncached name; when two of them race, the later answer replaces the earlier.
+ */
+std::vector<AddressResolver::Address> AddressResolver::resolve(const std::string& host, int port) {
+    const std::string name = key(host, port);
+    const auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto found = cache.find(name);
+        if (found != cache.end() && found->second.expires > now) {
+            return found->second.addresses;
+        }
+    }
+
+    if (port < 0 || port > 65535) {
+        throw std::runtime_error("Invalid server address");
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+    addrinfo* list = nullptr;
+    const int status = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &list);
+    if (status != 0) {
+        throw std::runtime_error("Invalid server address: " + host + " (" + gai_strerror(status) + ")");
+    }
+    Entry entry;
+    for (const addrinfo* info = list; info != nullptr; info = info->ai_next) {
+        if ((info->ai_family != AF_INET && info->ai_family != AF_INET6) ||
+            info->ai_addrlen > sizeof(sockaddr_storage)) {
+            continue;
+        }
+        Address address{};
+        std::memcpy(&address.storage, info->ai_addr, info->ai_addrlen);
+        address.length = info->ai_addrlen;
+        entry.addresses.push_back(address);
+    }
+    freeaddrinfo(list);
+    if (entry.addresses.empty()) {
+        throw std::runtime_error("Invalid server address: " + host);
+    }
+
+    entry.expires = now + TTL;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache[name] = entry;
+    return entry.addresses;
+}
+
+void AddressResolver::forget(const std::string& host, int port) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache.erase(key(host, port));
+}
+
+std::string AddressResolver::format(const Address& address) {
+    char text[INET6_ADDRSTRLEN] = "";
+    if (address.family() == AF_INET6) {
+        const sockaddr_in6* v6 = reinterpret_cast<const sockaddr_in6*>(&address.storage);
+        inet_ntop(AF_INET6, &v6->sin6_addr, text, sizeof(text));
+        return "[" + std::string(text) + "]:" + std::to_string(ntohs(v6->sin6_port));
+    }
+    const sockaddr_in* v4 = reinterpret_cast<const sockaddr_in*>(&address.storage);
+    inet_ntop(AF_INET, &v4->sin_addr, text, sizeof(text));
+    return std::string(text) + ":" + std::to_string(ntohs(v4->sin_port));
+}
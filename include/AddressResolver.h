@@ -0,0 +1,84 @@
+/**
+ * @file AddressResolver.h
+ * @brief Header file for the AddressResolver class, which turns server names into socket addresses.
+ * 
+ * This file defines the `AddressResolver` class. A server may be given as a host name, an IPv4
+ * address or an IPv6 address; every connection needs its socket addresses, and reconnects and
+ * pooled sessions ask for the same ones again and again, so the answers are cached.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef ADDRESS_RESOLVER_H
+#define ADDRESS_RESOLVER_H
+
+#include <sys/socket.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * @class AddressResolver
+ * @brief Resolves host names and numeric addresses with `getaddrinfo` and caches the results.
+ * 
+ * The cache is shared by all threads of the process. `getaddrinfo` does not report the lifetime
+ * of the DNS records, so an entry is kept for `TTL`; a caller that could not reach any of the
+ * addresses calls `forget`, so the next attempt asks the resolver again. Failed lookups are not
+ * cached.
+ */
+class AddressResolver {
+public:
+    /**
+     * @brief One socket address of a server.
+     */
+    struct Address {
+        sockaddr_storage storage; /**< The address, `sockaddr_in` or `sockaddr_in6`. */
+        socklen_t length;         /**< The size of the address in `storage`. */
+
+        /**
+         * @brief Returns the address family.
+         * 
+         * @return `AF_INET` or `AF_INET6`.
+         */
+        int family() const { return storage.ss_family; }
+
+        /**
+         * @brief Returns the address as a `sockaddr` for the socket calls.
+         * 
+         * @return A pointer to `storage`.
+         */
+        const sockaddr* get() const { return reinterpret_cast<const sockaddr*>(&storage); }
+    };
+
+    /// How long a resolved name is reused
+    static constexpr std::chrono::seconds TTL{60};
+
+    /**
+     * @brief Returns the socket addresses of a server, in the order the resolver prefers them.
+     * 
+     * @param host A host name, an IPv4 address or an IPv6 address (without brackets).
+     * @param port The port of the server.
+     * @return At least one address.
+     * @throws std::runtime_error If the name cannot be resolved.
+     */
+    static std::vector<Address> resolve(const std::string& host, int port);
+
+    /**
+     * @brief Drops the cached addresses of a server.
+     * 
+     * @param host The host as given to `resolve`.
+     * @param port The port as given to `resolve`.
+     */
+    static void forget(const std::string& host, int port);
+
+    /**
+     * @brief Formats an address for messages: `a.b.c.d:port` or `[v6]:port`.
+     * 
+     * @param address The address.
+     * @return The formatted address.
+     */
+    static std::string format(const Address& address);
+};
+
+#endif // ADDRESS_RESOLVER_H
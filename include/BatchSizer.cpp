@@ -0,0 +1,47 @@
+/**
+ * @file BatchSizer.cpp
+ * @brief Implementation of the BatchSizer class, which chooses how many vectors go into one batch frame.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "BatchSizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+BatchSizer::BatchSizer(uint64_t roundTripNs) : rtt(static_cast<double>(roundTripNs)), cost(0), measured(false) {}
+
+/**
+ * @brief With the round trip at most `OVERHEAD` of the frame, the vectors take the rest:
+ * `count * cost >= rtt * (1 - OVERHEAD) / OVERHEAD`. A server whose work per vector is too small
+ * to measure gets the largest frames.
+ */
+size_t BatchSizer::next(size_t vectorBytes) const {
+    const size_t byBytes = std::max<size_t>(1, MAX_BYTES / std::max<size_t>(vectorBytes, 1));
+    size_t count = MAX_VECTORS;
+    if (!measured) {
+        count = INITIAL_VECTORS;
+    } else if (cost > 0) {
+        const double wanted = std::ceil(rtt * (1 - OVERHEAD) / OVERHEAD / cost);
+        count = wanted < static_cast<double>(MAX_VECTORS) ? static_cast<size_t>(wanted) : MAX_VECTORS;
+    }
+    return std::max<size_t>(1, std::min(count, byBytes));
+}
+
+void BatchSizer::record(size_t vectors, uint64_t latencyNs) {
+    const double latency = static_cast<double>(latencyNs);
+    rtt = std::min(rtt, latency);
+    const double sample = (latency - rtt) / static_cast<double>(std::max<size_t>(vectors, 1));
+    cost = measured ? cost + ALPHA * (sample - cost) : sample;
+    measured = true;
+}
+
+double BatchSizer::roundTrip() const {
+    return rtt;
+}
+
+double BatchSizer::perVector() const {
+    return cost;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file BatchSizer.h
+ * @brief Header file for the BatchSizer class, which chooses how many vectors go into one batch frame.
+ * 
+ * This file defines the `BatchSizer` class used by `VectorSession` once the server has accepted
+ * batch frames. It keeps a model of the frame latency, a fixed round trip plus a cost per vector,
+ * and sizes frames so that the round trip is a small share of each frame.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef BATCH_SIZER_H
+#define BATCH_SIZER_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @class BatchSizer
+ * @brief Adapts the number of vectors per frame to the round-trip time and the vector size.
+ * 
+ * The round trip starts as the latency of the negotiation exchange, in which the server does no
+ * work, and only ever decreases with faster frames. The cost per vector is the moving average of
+ * what a frame took beyond the round trip, divided by its vectors. A frame then carries enough
+ * vectors for the round trip to be at most `OVERHEAD` of its latency, limited by `MAX_VECTORS` and
+ * by `MAX_BYTES` of payload, so large vectors travel in fewer per frame. Until the first frame is
+ * measured, `INITIAL_VECTORS` are sent.
+ */
+class BatchSizer {
+public:
+    /// Vectors in the first frame
+    static constexpr size_t INITIAL_VECTORS = 16;
+
+    /// Largest number of vectors in one frame
+    static constexpr size_t MAX_VECTORS = 4096;
+
+    /// Largest payload of one frame in bytes
+    static constexpr size_t MAX_BYTES = 1 << 20;
+
+    /// Share of a frame's latency the round trip may take
+    static constexpr double OVERHEAD = 0.1;
+
+    /// Weight of a new sample in the moving average of the cost per vector
+    static constexpr double ALPHA = 0.2;
+
+    /**
+     * @brief Creates a sizer for a connection.
+     * 
+     * @param roundTripNs The measured round trip of an empty exchange in nanoseconds.
+     */
+    explicit BatchSizer(uint64_t roundTripNs);
+
+    /**
+     * @brief Returns the number of vectors for the next frame.
+     * 
+     * @param vectorBytes The average encoded size of the vectors to send.
+     * @return The number of vectors, between 1 and `MAX_VECTORS`.
+     */
+    size_t next(size_t vectorBytes) const;
+
+    /**
+     * @brief Adds the latency of a completed frame to the model.
+     * 
+     * @param vectors The number of vectors in the frame.
+     * @param latencyNs The time from sending the frame to receiving its reply.
+     */
+    void record(size_t vectors, uint64_t latencyNs);
+
+    /**
+     * @brief Returns the estimated round trip.
+     * 
+     * @return The round trip in nanoseconds.
+     */
+    double roundTrip() const;
+
+    /**
+     * @brief Returns the estimated cost of one vector.
+     * 
+     * @return The cost in nanoseconds, 0 before the first frame.
+     */
+    double perVector() const;
+
+private:
+    double rtt;      /**< Estimated round trip in nanoseconds. */
+    double cost;     /**< Moving average cost per vector in nanoseconds. */
+    bool measured;   /**< Whether a frame has been recorded. */
+};
+
+#endif // BATCH_SIZER_H
@@ -0,0 +1,102 @@
+/**
+ * @file BufferPool.h
+ * @brief Header file for the BufferPool class template, which recycles buffers instead of freeing them.
+ * 
+ * This file defines the `BufferPool` class template. Buffers that are filled, consumed and then
+ * filled again (read chunks, batches of parsed vectors) are returned to a pool instead of being
+ * destroyed, so once every buffer has grown to its working size the loop that uses them no longer
+ * touches the heap.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <mutex>
+
+/**
+ * @class BufferPool
+ * @brief A thread-safe free list of reusable buffers.
+ * 
+ * `T` is any container with `clear()` that keeps its capacity when cleared, such as `std::vector`.
+ * A released buffer is cleared but keeps its storage, so the next `acquire` hands out memory that
+ * is already allocated. At most `maxIdle` buffers are kept; the list itself is allocated up front,
+ * so releasing never allocates.
+ * 
+ * @tparam T The buffer type.
+ */
+template <typename T>
+class BufferPool {
+public:
+    /**
+     * @brief Creates an empty pool.
+     * 
+     * @param maxIdle The number of released buffers kept for reuse; further ones are destroyed.
+     */
+    explicit BufferPool(size_t maxIdle = 16) : maxIdle(maxIdle) {
+        idle.reserve(maxIdle);
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /**
+     * @brief Takes a buffer out of the pool.
+     * 
+     * @return An empty buffer, with the storage of a previously released one if available.
+     */
+    T acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (idle.empty()) {
+            return T();
+        }
+        T buffer = std::move(idle.back());
+        idle.pop_back();
+        return buffer;
+    }
+
+    /**
+     * @brief Returns a buffer to the pool.
+     * 
+     * @param buffer The buffer; it is cleared and keeps its capacity.
+     */
+    void release(T&& buffer) {
+        buffer.clear();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (idle.size() < maxIdle) {
+            idle.push_back(std::move(buffer));
+        }
+    }
+
+    /**
+     * @brief Returns the number of buffers waiting to be reused.
+     * 
+     * @return The number of idle buffers.
+     */
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return idle.size();
+    }
+
+    /**
+     * @brief Returns the process-wide pool for buffers of type `T`.
+     * 
+     * @return The shared pool.
+     */
+    static BufferPool& shared() {
+        static BufferPool pool;
+        return pool;
+    }
+
+private:
+    mutable std::mutex mutex; /**< Guards `idle`. */
+    std::vector<T> idle;      /**< Released buffers, most recent last. */
+    size_t maxIdle;           /**< Maximum number of idle buffers. */
+};
+
+#endif // BUFFER_POOL_H
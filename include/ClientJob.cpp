@@ -0,0 +1,224 @@
+/**
+ * @file ClientJob.cpp
+ * @brief Implementation of the ClientJob class, which runs the job of the client over a connection.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "ClientJob.h"
+#include "SHA256Library.h"
+#include "Stats.h"
+#include "VectorDeduplicator.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <cctype>
+#include <cstdint>
+
+void ClientJob::authenticate(Communicator& comm, const std::string& password) {
+    Stats::Timer timer(Stats::Phase::Auth);
+    std::string username = "user";
+    comm.sendMessage(username);
+
+    std::string salt(16, '\0');
+    comm.receiveMessage(salt.data(), 16);
+
+    std::string combined = salt + password;
+
+    std::string calculatedHash = SHA256Library::hash(combined);
+
+    for (char& c : calculatedHash) {
+        c = std::toupper(static_cast<unsigned char>(c));
+    }
+
+    comm.sendMessage(calculatedHash);
+
+    char response[2];
+    comm.receiveMessage(response, sizeof(response));
+    if (std::string(response, 2) != "OK") {
+        Stats::add(Stats::Counter::AuthFailures);
+        throw std::runtime_error("Authentication failed");
+    }
+}
+
+void ClientJob::authenticateSpare(Communicator& comm, const std::string& password,
+                                  const VectorSession::Extensions& accepted) {
+    authenticate(comm, password);
+    VectorSession session(comm);
+    if ((accepted.batching && !session.negotiateBatching()) ||
+        (accepted.compression && !session.negotiateCompression()) ||
+        (accepted.sparse && !session.negotiateSparse())) {
+        throw std::runtime_error("The server refused an extension on a spare connection");
+    }
+}
+
+std::unique_ptr<VectorSession> ClientJob::negotiate(std::unique_ptr<Communicator>& comm, const Reconnect& reconnect,
+                                                    VectorSession::Extensions wanted, LatencyHistogram* latency) {
+    while (true) {
+        auto session = std::make_unique<VectorSession>(*comm, latency);
+        const char* refused = nullptr;
+        if (wanted.batching && !session->negotiateBatching()) {
+            refused = "Warning: the server does not accept batch frames, sending vectors one by one";
+            wanted.batching = false;
+        } else if (wanted.compression && !session->negotiateCompression()) {
+            refused = "Warning: the server does not accept compressed payloads, sending them as they are";
+            wanted.compression = false;
+        } else if (wanted.sparse && !session->negotiateSparse()) {
+            refused = "Warning: the server does not accept sparse payloads, sending vectors dense";
+            wanted.sparse = false;
+        }
+        if (!refused) {
+            return session;
+        }
+        // The server took the probe for a vector count, so the connection is out of step
+        std::cerr << refused << std::endl;
+        session.reset();
+        comm = reconnect();
+    }
+}
+
+template <typename T>
+std::vector<size_t> ClientJob::plan(const typename BasicInputLoader<T>::Batch& vectors, ResultCache* cache,
+                                    bool report, std::vector<T>& results, std::vector<ResultCache::Key>& keys,
+                                    std::vector<size_t>& origin) {
+    size_t distinct;
+    {
+        Stats::Timer dedupTimer(Stats::Phase::Dedup);
+        distinct = VectorDeduplicator::find(vectors, origin);
+    }
+    Stats::add(Stats::Counter::Duplicates, vectors.size() - distinct);
+    if (report) {
+        std::cout << "Deduplication: " << vectors.size() << " vectors, " << distinct << " unique, ratio "
+                  << std::fixed << std::setprecision(2)
+                  << (distinct ? static_cast<double>(vectors.size()) / distinct : 1.0)
+                  << std::defaultfloat << std::endl;
+    }
+
+    std::vector<size_t> firsts;
+    firsts.reserve(distinct);
+    for (size_t i = 0; i < vectors.size(); ++i) {
+        if (origin[i] == i) {
+            firsts.push_back(i);
+        }
+    }
+    if (!cache) {
+        return firsts;
+    }
+
+    // The keys are hashed together, several vectors per pass of the multi-buffer SHA-256 kernel
+    Stats::Timer cacheTimer(Stats::Phase::Cache);
+    std::vector<const void*> data(firsts.size());
+    std::vector<size_t> sizes(firsts.size());
+    for (size_t k = 0; k < firsts.size(); ++k) {
+        data[k] = vectors[firsts[k]].data();
+        sizes[k] = vectors[firsts[k]].size() * sizeof(T);
+    }
+    std::vector<ResultCache::Key> firstKeys(firsts.size());
+    cache->makeKeys(data.data(), sizes.data(), firsts.size(), firstKeys.data());
+
+    std::vector<size_t> pending;
+    pending.reserve(distinct);
+    keys.resize(vectors.size());
+    for (size_t k = 0; k < firsts.size(); ++k) {
+        const size_t i = firsts[k];
+        keys[i] = firstKeys[k];
+        if (!cache->lookup(keys[i], results[i])) {
+            pending.push_back(i);
+        }
+    }
+    return pending;
+}
+
+template <typename T>
+void ClientJob::fanOut(std::vector<T>& results, const std::vector<size_t>& origin) {
+    for (size_t i = 0; i < origin.size(); ++i) {
+        results[i] = results[origin[i]];
+    }
+}
+
+template <typename T>
+std::vector<T> ClientJob::process(VectorSession& session, BasicInputLoader<T>& input, ResultCache* cache, bool dedup,
+                                  std::ostream* echo) {
+    if (!cache && !dedup) {
+        const size_t numVectors = input.count();
+        session.announce(numVectors);
+
+        std::vector<T> results;
+        results.reserve(numVectors);
+        typename BasicInputLoader<T>::Batch batch;
+        while (input.nextBatch(batch)) {
+            const size_t first = results.size();
+            results.resize(first + batch.size());
+            session.exchange(batch, results.data() + first);
+            for (size_t i = first; echo && i < results.size(); ++i) {
+                *echo << "Received result: " << results[i] << std::endl;
+            }
+        }
+        if (results.size() != numVectors) {
+            throw std::runtime_error("Input file changed while it was being read");
+        }
+        return results;
+    }
+
+    const typename BasicInputLoader<T>::Batch vectors = input.readAll();
+    std::vector<T> results(vectors.size());
+    std::vector<ResultCache::Key> keys;
+    std::vector<size_t> origin;
+    const std::vector<size_t> pending = plan(vectors, cache, dedup, results, keys, origin);
+
+    session.announce(pending.size());
+
+    if (session.batching()) {
+        // Frames need the vectors back to back, so the misses are gathered first
+        typename BasicInputLoader<T>::Batch misses;
+        for (size_t index : pending) {
+            misses.append(vectors[index].data(), vectors[index].size());
+        }
+        std::vector<T> sent(pending.size());
+        session.exchange(misses, sent.data());
+        for (size_t k = 0; k < pending.size(); ++k) {
+            results[pending[k]] = sent[k];
+        }
+    }
+    for (size_t index : pending) {
+        if (!session.batching()) {
+            results[index] = session.exchange(vectors[index].data(), vectors[index].size(), vectors.nonzeros(index));
+        }
+        if (echo) {
+            *echo << "Received result: " << results[index] << std::endl;
+        }
+        if (cache) {
+            cache->insert(keys[index], results[index]);
+        }
+    }
+
+    fanOut(results, origin);
+    return results;
+}
+
+template std::vector<size_t> ClientJob::plan(const BasicInputLoader<float>::Batch&, ResultCache*, bool,
+                                             std::vector<float>&, std::vector<ResultCache::Key>&,
+                                             std::vector<size_t>&);
+template std::vector<size_t> ClientJob::plan(const BasicInputLoader<double>::Batch&, ResultCache*, bool,
+                                             std::vector<double>&, std::vector<ResultCache::Key>&,
+                                             std::vector<size_t>&);
+template std::vector<size_t> ClientJob::plan(const BasicInputLoader<int32_t>::Batch&, ResultCache*, bool,
+                                             std::vector<int32_t>&, std::vector<ResultCache::Key>&,
+                                             std::vector<size_t>&);
+template std::vector<size_t> ClientJob::plan(const BasicInputLoader<int64_t>::Batch&, ResultCache*, bool,
+                                             std::vector<int64_t>&, std::vector<ResultCache::Key>&,
+                                             std::vector<size_t>&);
+template void ClientJob::fanOut(std::vector<float>&, const std::vector<size_t>&);
+template void ClientJob::fanOut(std::vector<double>&, const std::vector<size_t>&);
+template void ClientJob::fanOut(std::vector<int32_t>&, const std::vector<size_t>&);
+template void ClientJob::fanOut(std::vector<int64_t>&, const std::vector<size_t>&);
+template std::vector<float> ClientJob::process(VectorSession&, BasicInputLoader<float>&, ResultCache*, bool,
+                                               std::ostream*);
+template std::vector<double> ClientJob::process(VectorSession&, BasicInputLoader<double>&, ResultCache*, bool,
+                                                std::ostream*);
+template std::vector<int32_t> ClientJob::process(VectorSession&, BasicInputLoader<int32_t>&, ResultCache*, bool,
+                                                 std::ostream*);
+template std::vector<int64_t> ClientJob::process(VectorSession&, BasicInputLoader<int64_t>&, ResultCache*, bool,
+                                                 std::ostream*);
@@ -0,0 +1,152 @@
+/**
+ * @file ClientJob.h
+ * @brief Header file for the ClientJob class, which runs the job of the client over a connection.
+ * 
+ * This file defines the `ClientJob` class: authentication with the server, negotiation of the
+ * protocol extensions and the exchange of all vectors of a job. The client runs its jobs with it,
+ * and the integration tests drive the same code against `LoopbackServer`.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef CLIENT_JOB_H
+#define CLIENT_JOB_H
+
+#include "Communicator.h"
+#include "InputLoader.h"
+#include "LatencyHistogram.h"
+#include "ResultCache.h"
+#include "VectorSession.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @class ClientJob
+ * @brief The steps of a job on the client side, from the handshake to the last result.
+ * 
+ * After connecting, the client sends the login `user`, receives a 16-character salt, and sends
+ * the uppercase hex SHA256 of the salt followed by the password; the server answers `OK`. The
+ * client may then send the probes of the protocol extensions, and announces the number of vectors
+ * of the job, which the server answers one by one (or frame by frame). The connection carries this
+ * one job only.
+ * 
+ * The job steps are static member templates over the element type, instantiated for `float`,
+ * `double`, `int32_t` and `int64_t`.
+ */
+class ClientJob {
+public:
+    /// Source of new authenticated connections, used when the server refused an extension
+    using Reconnect = std::function<std::unique_ptr<Communicator>()>;
+
+    /**
+     * @brief Authenticates the client with the server.
+     * 
+     * Sends the username, receives the salt, combines it with the password, computes the SHA256
+     * hash of the combination and sends it back. If the server responds with anything other than
+     * "OK", authentication fails.
+     * 
+     * @param comm The connected session.
+     * @param password The password to be hashed and sent.
+     * @throws std::runtime_error If authentication fails.
+     */
+    static void authenticate(Communicator& comm, const std::string& password);
+
+    /**
+     * @brief Authenticates a spare connection and asks the server for exactly the extensions of a job.
+     * 
+     * A hedged vector and the rest of its job move to the spare connection with the payloads the
+     * job's session encodes, so the spare has to carry the same extensions; a refusal makes it
+     * unusable.
+     * 
+     * @param comm The freshly connected spare.
+     * @param password The password to authenticate with.
+     * @param accepted The extensions the job's session accepted.
+     * @throws std::runtime_error If authentication fails or the server refuses an extension.
+     */
+    static void authenticateSpare(Communicator& comm, const std::string& password,
+                                  const VectorSession::Extensions& accepted);
+
+    /**
+     * @brief Asks the server for the wanted extensions, connecting again after every refusal.
+     * 
+     * Batch frames, compressed and sparse payloads are asked for in this order. A server that
+     * refuses one has taken the probe for a vector count, so the connection is replaced by one
+     * from `reconnect` and asked only for what has not been refused yet; every refusal is reported
+     * on the standard error stream.
+     * 
+     * @param comm The authenticated connection; replaced after a refusal.
+     * @param reconnect Returns a new authenticated connection to the same server.
+     * @param wanted The extensions to ask for.
+     * @param latency Latency histogram of the server, or `nullptr`.
+     * @return The session on `comm`, using the extensions the server accepted.
+     * @throws std::runtime_error If sending fails or no new connection can be made.
+     */
+    static std::unique_ptr<VectorSession> negotiate(std::unique_ptr<Communicator>& comm, const Reconnect& reconnect,
+                                                    VectorSession::Extensions wanted, LatencyHistogram* latency);
+
+    /**
+     * @brief Chooses the vectors of a job that have to be sent to the server.
+     * 
+     * Repeated vectors are found with `VectorDeduplicator`, so only the first occurrence of every
+     * vector is considered further. With a result cache, these are looked up and the hits are
+     * filled into the results. With `report`, the number of vectors, the number of distinct ones
+     * and their ratio are printed.
+     * 
+     * @tparam T The element type of the vectors and results.
+     * @param vectors The whole input.
+     * @param cache An optional result cache, or `nullptr`.
+     * @param report Whether to print the deduplication ratio.
+     * @param results The results, one per vector; receives the cache hits.
+     * @param keys Receives the cache key of every first occurrence, by vector index; empty without a cache.
+     * @param origin Receives, for every vector, the index of its first occurrence, as used by `fanOut`.
+     * @return The indices of the vectors to send, in input order.
+     */
+    template <typename T>
+    static std::vector<size_t> plan(const typename BasicInputLoader<T>::Batch& vectors, ResultCache* cache,
+                                    bool report, std::vector<T>& results, std::vector<ResultCache::Key>& keys,
+                                    std::vector<size_t>& origin);
+
+    /**
+     * @brief Copies the result of every first occurrence to the repetitions of its vector.
+     * 
+     * @tparam T The element type of the results.
+     * @param results The results, complete for the first occurrences.
+     * @param origin The index of the first occurrence of every vector, as filled by `plan`.
+     */
+    template <typename T>
+    static void fanOut(std::vector<T>& results, const std::vector<size_t>& origin);
+
+    /**
+     * @brief Sends the vectors to the server and collects one result per vector.
+     * 
+     * Without a cache, vectors are streamed to the server batch by batch as the input loader
+     * parses them, so the first vector goes out as soon as the line count and the first batch are
+     * ready.
+     * 
+     * When a result cache is given or `--dedup` is set, the whole input is needed up front and the
+     * vectors to send are chosen by `plan`; their results are then stored in the cache. The number
+     * of vectors announced to the server is the number of vectors actually sent.
+     * 
+     * @tparam T The element type of the vectors and results.
+     * @param session The vector exchange on a connection authenticated with the server, set up for
+     *                hedging or the extensions as requested.
+     * @param input The loader parsing the input file.
+     * @param cache An optional result cache, or `nullptr`.
+     * @param dedup Whether to send repeated vectors once even without a cache.
+     * @param echo Receives a `Received result:` line per result sent, or `nullptr`.
+     * @return The results in the order of the input vectors.
+     * @throws std::runtime_error If reading the input, sending or receiving fails, or the job has
+     *                            more vectors to send than `VectorSession::MAX_COUNT`.
+     */
+    template <typename T>
+    static std::vector<T> process(VectorSession& session, BasicInputLoader<T>& input, ResultCache* cache, bool dedup,
+                                  std::ostream* echo);
+};
+
+#endif // CLIENT_JOB_H
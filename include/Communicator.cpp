@@ -12,6 +12,42 @@
  */
 
 #include "Communicator.h"
+#include "AddressResolver.h"
+#include "IoUring.h"
+#include "ShmRing.h"
+#include "Stats.h"
+
+#include <netinet/tcp.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <sched.h>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#ifndef TCP_FASTOPEN_CONNECT
+#define TCP_FASTOPEN_CONNECT 30
+#endif
+
+namespace {
+
+/**
+ * @brief The backend new connections start with, set by `Communicator::setDefaultBackend`.
+ */
+Communicator::Backend defaultBackend = Communicator::Backend::Socket;
+
+/**
+ * @brief The operation timeout new connections start with, set by `Communicator::setDefaultTimeout`.
+ */
+std::chrono::milliseconds defaultTimeout(0);
+
+/**
+ * @brief Whether new TCP connections use Fast Open, set by `Communicator::setFastOpen`.
+ */
+bool fastOpen = false;
+
+} // namespace
 
 /**
  * @class Communicator
@@ -21,15 +57,35 @@
  * sending messages, and receiving messages.
  */
 Communicator::Communicator(const std::string& serverAddress, int serverPort)
-    : socketFd(-1), serverAddress(serverAddress), serverPort(serverPort) {}
+    : socketFd(-1), serverAddress(serverAddress), serverPort(serverPort), operationTimeout(defaultTimeout),
+      fastOpened(false) {}
+
+Communicator::Communicator(int connectedFd)
+    : socketFd(connectedFd), serverPort(0), operationTimeout(defaultTimeout), fastOpened(false) {
+    useBackend(defaultBackend);
+}
 
 /**
  * @brief Destructor that closes the socket if it is open.
  * 
  * This destructor ensures that the socket is closed when the `Communicator` object is destroyed.
  * If the socket was successfully created (i.e., `socketFd` is not -1), it will be closed.
+ * The io_uring instance and the shared-memory rings go first, so no request is left referring to
+ * a closed descriptor and the server learns from the rings that the client is gone.
+ * 
+ * Whether the server accepted the data of a Fast Open SYN is known only once the handshake is
+ * over, so such connections are counted here.
  */
 Communicator::~Communicator() {
+    ring.reset();
+    shm.reset();
+    if (fastOpened) {
+        tcp_info info{};
+        socklen_t length = sizeof(info);
+        if (getsockopt(socketFd, IPPROTO_TCP, TCP_INFO, &info, &length) == 0 && (info.tcpi_options & TCPI_OPT_SYN_DATA)) {
+            Stats::add(Stats::Counter::FastOpens, 1);
+        }
+    }
     if (socketFd != -1) {
         close(socketFd);
     }
@@ -43,24 +99,179 @@ Communicator::~Communicator() {
  * construction of the `Communicator` object. If any of these steps fail, an exception will 
  * be thrown.
  * 
+ * Nagle's algorithm is disabled: every request is written with a single call, so holding back
+ * a small segment until the previous one is acknowledged only adds a delayed-ACK round trip.
+ * 
+ * The server address is resolved by `AddressResolver`, so it may be a host name, an IPv4 or an IPv6
+ * address. With Fast Open enabled, `connect` returns at once and the handshake starts with the
+ * first send, which carries the login inside the SYN once the kernel holds a Fast Open cookie of
+ * the server; without a cookie, or if the server does not support Fast Open, the kernel falls
+ * back to a regular handshake. An unreachable server then shows up as a failed first send or receive.
+ * 
+ * A server on the same host can be reached without the TCP stack: `unix:<path>` connects to a
+ * Unix-domain socket, and `shm:<path>` additionally hands the server a shared memory segment
+ * over that socket and exchanges all further data through it.
+ * 
  * @throws std::runtime_error If the socket cannot be created, the server address is invalid, 
  *                             or the connection to the server fails.
  */
 void Communicator::connectToServer() {
-    socketFd = socket(AF_INET, SOCK_STREAM, 0);
+    const bool sharedMemory = serverAddress.rfind("shm:", 0) == 0;
+    if (sharedMemory || serverAddress.rfind("unix:", 0) == 0) {
+        const std::string path = serverAddress.substr(serverAddress.find(':') + 1);
+        sockaddr_un serverAddr{};
+        if (path.empty() || path.size() >= sizeof(serverAddr.sun_path)) {
+            throw std::runtime_error("Invalid server address");
+        }
+        serverAddr.sun_family = AF_UNIX;
+        std::strcpy(serverAddr.sun_path, path.c_str());
+
+        socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (socketFd == -1) {
+            throw std::runtime_error("Failed to create socket");
+        }
+        if (connect(socketFd, reinterpret_cast<sockaddr*>(&serverAddr), sizeof(serverAddr)) == -1) {
+            throw std::runtime_error("Failed to connect to server");
+        }
+        if (sharedMemory) {
+            shm = std::make_unique<ShmRing>(socketFd, false);
+            shm->setTimeout(operationTimeout);
+        } else {
+            useBackend(defaultBackend);
+        }
+        return;
+    }
+
+    // Every address of the server is tried in the order the resolver prefers them
+    for (const AddressResolver::Address& address : AddressResolver::resolve(serverAddress, serverPort)) {
+        const int fd = socket(address.family(), SOCK_STREAM, 0);
+        if (fd == -1) {
+            if (errno == EAFNOSUPPORT) {
+                continue;
+            }
+            throw std::runtime_error("Failed to create socket");
+        }
+        int enable = 1;
+        const bool deferred = fastOpen &&
+            setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &enable, sizeof(enable)) == 0;
+        if (connect(fd, address.get(), address.length) == 0) {
+            socketFd = fd;
+            fastOpened = deferred;
+            break;
+        }
+        close(fd);
+    }
     if (socketFd == -1) {
-        throw std::runtime_error("Failed to create socket");
+        // The name may point elsewhere by now
+        AddressResolver::forget(serverAddress, serverPort);
+        throw std::runtime_error("Failed to connect to server");
     }
 
-    sockaddr_in serverAddr{};
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(serverPort);
-    if (inet_pton(AF_INET, serverAddress.c_str(), &serverAddr.sin_addr) <= 0) {
-        throw std::runtime_error("Invalid server address");
+    int noDelay = 1;
+    setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    useBackend(defaultBackend);
+}
+
+/**
+ * @brief Creates or drops the io_uring instance of the connection.
+ * 
+ * A ring that cannot be set up (an old kernel, `io_uring_disabled`, a seccomp filter, a memory
+ * lock limit) is not an error: the connection simply keeps using the socket calls.
+ * 
+ * The SQPOLL thread busy-polls on a CPU of its own; with a single CPU it would compete with the
+ * client and a co-located server for it, so a plain ring is used instead.
+ */
+Communicator::Backend Communicator::useBackend(Backend backend) {
+    ring.reset();
+    if (shm) {
+        return Backend::Socket;
     }
+    cpu_set_t cpus;
+    if (backend == Backend::IoUringSqpoll && sched_getaffinity(0, sizeof(cpus), &cpus) == 0 && CPU_COUNT(&cpus) < 2) {
+        backend = Backend::IoUring;
+    }
+    if (backend != Backend::Socket && socketFd != -1 && IoUring::available()) {
+        try {
+            ring = std::make_unique<IoUring>(socketFd, backend == Backend::IoUringSqpoll);
+            ring->setTimeout(operationTimeout);
+            return backend;
+        } catch (const std::runtime_error&) {
+        }
+    }
+    return Backend::Socket;
+}
 
-    if (connect(socketFd, reinterpret_cast<sockaddr*>(&serverAddr), sizeof(serverAddr)) == -1) {
-        throw std::runtime_error("Failed to connect to server");
+Communicator::Backend Communicator::backend() const {
+    if (!ring) {
+        return Backend::Socket;
+    }
+    return ring->polled() ? Backend::IoUringSqpoll : Backend::IoUring;
+}
+
+void Communicator::setDefaultBackend(Backend backend) {
+    defaultBackend = backend;
+}
+
+void Communicator::setFastOpen(bool enabled) {
+    fastOpen = enabled;
+}
+
+Communicator::Backend Communicator::parseBackend(const std::string& name) {
+    if (name == "socket") {
+        return Backend::Socket;
+    }
+    if (name == "io_uring") {
+        return Backend::IoUring;
+    }
+    if (name == "io_uring-sqpoll") {
+        return Backend::IoUringSqpoll;
+    }
+    throw std::runtime_error("Unknown I/O backend: " + name);
+}
+
+void Communicator::setTimeout(std::chrono::milliseconds timeout) {
+    operationTimeout = timeout;
+    if (ring) {
+        ring->setTimeout(timeout);
+    }
+    if (shm) {
+        shm->setTimeout(timeout);
+    }
+}
+
+std::chrono::milliseconds Communicator::timeout() const {
+    return operationTimeout;
+}
+
+void Communicator::setDefaultTimeout(std::chrono::milliseconds timeout) {
+    defaultTimeout = timeout;
+}
+
+/**
+ * @brief `ppoll` takes the remaining time with nanosecond resolution; readiness includes errors
+ * and hang-ups, which the following call then reports.
+ */
+void Communicator::awaitSocket(short events, std::chrono::steady_clock::time_point deadline) const {
+    if (operationTimeout.count() == 0) {
+        return;
+    }
+    pollfd entry{socketFd, events, 0};
+    while (true) {
+        const auto remaining = deadline - std::chrono::steady_clock::now();
+        if (remaining <= std::chrono::steady_clock::duration::zero()) {
+            Stats::add(Stats::Counter::Timeouts);
+            throw std::runtime_error("Timed out waiting for the server");
+        }
+        const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count();
+        const timespec wait{static_cast<time_t>(nanoseconds / 1000000000), static_cast<long>(nanoseconds % 1000000000)};
+        const int ready = ppoll(&entry, 1, &wait, nullptr);
+        if (ready > 0) {
+            return;
+        }
+        if (ready == -1 && errno != EINTR) {
+            throw std::runtime_error("Failed to wait for the server");
+        }
     }
 }
 
@@ -82,7 +293,8 @@ void Communicator::sendMessage(const std::string& message) {
  * @brief Sends raw data to the server.
  * 
  * This method sends the provided data to the server. The data is sent using the `send` 
- * system call. The size of the data is specified by the `size` parameter.
+ * system call. The size of the data is specified by the `size` parameter. A connection closed 
+ * by the server is reported as an error rather than by a SIGPIPE signal.
  * 
  * @param data The raw data to send to the server.
  * @param size The size of the data to send.
@@ -90,8 +302,60 @@ void Communicator::sendMessage(const std::string& message) {
  * @throws std::runtime_error If the data cannot be sent to the server.
  */
 void Communicator::sendMessage(const char* data, size_t size) {
-    if (send(socketFd, data, size, 0) == -1) {
-        throw std::runtime_error("Failed to send data");
+    sendMessage(data, size, nullptr, 0);
+}
+
+/**
+ * @brief Sends a header and a payload with one `sendmsg` call.
+ * 
+ * Both parts are gathered straight from the caller's memory. A partial send (possible for large
+ * payloads when the socket buffer fills up) continues with the remaining bytes; a signal
+ * interrupting the call before anything was sent restarts it.
+ * 
+ * With an operation timeout the socket is written without blocking, and a full socket buffer is
+ * waited out in `ppoll` until the deadline of the whole send.
+ */
+void Communicator::sendMessage(const char* header, size_t headerSize, const char* data, size_t size) {
+    Stats::Timer timer(Stats::Phase::Send);
+    iovec parts[2] = {{const_cast<char*>(header), headerSize}, {const_cast<char*>(data), size}};
+    if (ring) {
+        ring->exchange(parts, size > 0 ? 2 : 1, nullptr, 0);
+        return;
+    }
+    if (shm) {
+        shm->send(parts, size > 0 ? 2 : 1);
+        return;
+    }
+    iovec* part = parts;
+    size_t count = size > 0 ? 2 : 1;
+    const auto deadline = std::chrono::steady_clock::now() + operationTimeout;
+    const int flags = operationTimeout.count() > 0 ? MSG_NOSIGNAL | MSG_DONTWAIT : MSG_NOSIGNAL;
+    while (count > 0) {
+        msghdr message{};
+        message.msg_iov = part;
+        message.msg_iovlen = count;
+        ssize_t sent = sendmsg(socketFd, &message, flags);
+        if (sent == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                awaitSocket(POLLOUT, deadline);
+                continue;
+            }
+            throw std::runtime_error("Failed to send data");
+        }
+        Stats::add(Stats::Counter::SendCalls);
+        Stats::add(Stats::Counter::BytesSent, sent);
+        while (count > 0 && static_cast<size_t>(sent) >= part->iov_len) {
+            sent -= part->iov_len;
+            ++part;
+            --count;
+        }
+        if (count > 0) {
+            part->iov_base = static_cast<char*>(part->iov_base) + sent;
+            part->iov_len -= sent;
+        }
     }
 }
 
@@ -109,11 +373,23 @@ void Communicator::sendMessage(const char* data, size_t size) {
  * @throws std::runtime_error If the data cannot be received or if the reception fails.
  */
 std::string Communicator::receiveMessage(size_t bufferSize) {
+    Stats::Timer timer(Stats::Phase::Wait);
     std::string buffer(bufferSize, '\0');
+    if (ring) {
+        buffer.resize(ring->receive(buffer.data(), bufferSize));
+        return buffer;
+    }
+    if (shm) {
+        buffer.resize(shm->receive(buffer.data(), bufferSize, std::min<size_t>(bufferSize, 1)));
+        return buffer;
+    }
+    awaitSocket(POLLIN, std::chrono::steady_clock::now() + operationTimeout);
     ssize_t bytesRead = recv(socketFd, buffer.data(), bufferSize, 0);
     if (bytesRead == -1) {
         throw std::runtime_error("Failed to receive data");
     }
+    Stats::add(Stats::Counter::RecvCalls);
+    Stats::add(Stats::Counter::BytesReceived, bytesRead);
     buffer.resize(bytesRead);
     return buffer;
 }
@@ -122,8 +398,12 @@ std::string Communicator::receiveMessage(size_t bufferSize) {
  * @brief Receives a fixed amount of data from the server into a buffer.
  * 
  * This method receives exactly the specified amount of data from the server and stores it in 
- * the provided buffer. If the number of bytes received does not match the expected size, 
- * an exception is thrown.
+ * the provided buffer. A stream socket may deliver the data in several pieces, so it keeps
+ * receiving until the buffer is full; if the connection is closed or fails first, an exception
+ * is thrown.
+ * 
+ * With an operation timeout, every `recv` first waits in `ppoll` for the time left until the
+ * deadline of the whole receive, so a server that stops answering cannot block the client forever.
  * 
  * @param buffer The buffer to store the received data.
  * @param size The exact size of the data to receive.
@@ -131,9 +411,88 @@ std::string Communicator::receiveMessage(size_t bufferSize) {
  * @throws std::runtime_error If the expected amount of data is not received.
  */
 void Communicator::receiveMessage(char* buffer, size_t size) {
-    ssize_t bytesRead = recv(socketFd, buffer, size, 0);
-    if (bytesRead != static_cast<ssize_t>(size)) {
-        throw std::runtime_error("Failed to receive the expected amount of data");
+    Stats::Timer timer(Stats::Phase::Wait);
+    if (ring) {
+        ring->exchange(nullptr, 0, buffer, size);
+        return;
+    }
+    if (shm) {
+        shm->receive(buffer, size, size);
+        return;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + operationTimeout;
+    while (size > 0) {
+        awaitSocket(POLLIN, deadline);
+        ssize_t bytesRead = recv(socketFd, buffer, size, 0);
+        if (bytesRead == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead <= 0) {
+            throw std::runtime_error("Failed to receive the expected amount of data");
+        }
+        Stats::add(Stats::Counter::RecvCalls);
+        Stats::add(Stats::Counter::BytesReceived, bytesRead);
+        buffer += bytesRead;
+        size -= static_cast<size_t>(bytesRead);
+    }
+}
+
+/**
+ * @brief Data already handed over to the io_uring or shared-memory transport but not yet read
+ * counts as available.
+ */
+bool Communicator::waitReadable(std::chrono::microseconds wait) {
+    if (ring) {
+        return ring->readable(wait);
+    }
+    if (shm) {
+        return shm->readable(wait);
     }
+    const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(wait).count();
+    const timespec timeout{static_cast<time_t>(nanoseconds / 1000000000), static_cast<long>(nanoseconds % 1000000000)};
+    pollfd entry{socketFd, POLLIN, 0};
+    int ready;
+    do {
+        ready = ppoll(&entry, 1, &timeout, nullptr);
+    } while (ready == -1 && errno == EINTR);
+    return ready != 0;
 }
 
+/**
+ * @brief Exchanges a request and its reply.
+ * 
+ * The io_uring path is timed as waiting: the send is only queued, and the call returns once the
+ * reply has arrived.
+ */
+void Communicator::exchange(const char* header, size_t headerSize, const char* data, size_t size,
+                            char* reply, size_t replySize) {
+    if (!ring) {
+        sendMessage(header, headerSize, data, size);
+        receiveMessage(reply, replySize);
+        return;
+    }
+    Stats::Timer timer(Stats::Phase::Wait);
+    iovec parts[2] = {{const_cast<char*>(header), headerSize}, {const_cast<char*>(data), size}};
+    ring->exchange(parts, size > 0 ? 2 : 1, reply, replySize);
+}
+
+/**
+ * @brief Checks the connection with a non-blocking peek.
+ * 
+ * `recv` returning 0 means the server closed the connection, and would-block means it is open
+ * with nothing pending, which is the only healthy state between exchanges.
+ */
+bool Communicator::isAlive() const {
+    if (socketFd == -1) {
+        return false;
+    }
+    if (ring) {
+        return ring->idle();
+    }
+    if (shm) {
+        return shm->idle();
+    }
+    char byte;
+    ssize_t result = recv(socketFd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return result == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
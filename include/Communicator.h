@@ -20,8 +20,13 @@
 #include <arpa/inet.h>
 #include <stdexcept>
 #include <unistd.h>
+#include <chrono>
+#include <memory>
 #include <string>
 
+class IoUring;
+class ShmRing;
+
 /**
  * @class Communicator
  * @brief A class for managing communication with a server over a TCP socket.
@@ -34,10 +39,35 @@
  * over that connection.
  */
 class Communicator {
+public:
+    /**
+     * @brief The system interface used to move data over the socket.
+     */
+    enum class Backend {
+        Socket,       /**< Plain `sendmsg` and `recv` calls. */
+        IoUring,      /**< An io_uring instance with a multishot receive into provided buffers. */
+        IoUringSqpoll /**< Like `IoUring`, with a kernel thread polling the submission queue. */
+    };
+
 private:
     int socketFd; /**< Socket file descriptor used for communication. */
     std::string serverAddress; /**< Server address in string format. */
     int serverPort; /**< Server port number. */
+    std::unique_ptr<IoUring> ring; /**< The io_uring transport, or `nullptr` with the socket backend. */
+    std::unique_ptr<ShmRing> shm; /**< The shared-memory transport of `shm:` addresses, or `nullptr`. */
+    std::chrono::milliseconds operationTimeout; /**< Limit of every blocking send or receive, 0 for none. */
+    bool fastOpened; /**< Set if the connection was opened with TCP Fast Open. */
+
+    /**
+     * @brief Waits until the socket is ready for an operation.
+     * 
+     * Returns at once when no timeout is set.
+     * 
+     * @param events The `poll` events awaited.
+     * @param deadline The end of the operation.
+     * @throws std::runtime_error If the deadline passes first.
+     */
+    void awaitSocket(short events, std::chrono::steady_clock::time_point deadline) const;
     
 public:
     /**
@@ -51,6 +81,16 @@ public:
      */
     Communicator(const std::string& serverAddress, int serverPort);
 
+    /**
+     * @brief Constructs a Communicator object around an already connected socket.
+     * 
+     * The object takes ownership of the descriptor and closes it on destruction. This is used
+     * with socket pairs in benchmarks and tests, where no server address is involved.
+     * 
+     * @param connectedFd A connected stream socket.
+     */
+    explicit Communicator(int connectedFd);
+
     /**
      * @brief Destructor that closes the socket if it is open.
      * 
@@ -66,11 +106,85 @@ public:
      * connect to the specified server. If any error occurs during these operations, 
      * a `std::runtime_error` is thrown.
      * 
+     * The server address may be a host name, an IPv4 or an IPv6 address; every address it resolves
+     * to is tried in turn. It may also be `unix:<path>` for a Unix-domain socket or `shm:<path>`
+     * for shared-memory rings set up over that socket; the port is then unused.
+     * 
      * @throws std::runtime_error If the socket cannot be created, the server address is invalid, 
      *                             or the connection to the server fails.
      */
     void connectToServer();
 
+    /**
+     * @brief Switches the connection to another backend.
+     * 
+     * If an io_uring backend is requested but the kernel does not provide io_uring (or forbids
+     * it), the connection falls back to the socket backend. Must be called between exchanges.
+     * Connections over shared memory do not use the socket and always report `Socket`.
+     * 
+     * @param backend The requested backend.
+     * @return The backend actually in use.
+     */
+    Backend useBackend(Backend backend);
+
+    /**
+     * @brief Returns the backend in use.
+     * 
+     * @return The backend.
+     */
+    Backend backend() const;
+
+    /**
+     * @brief Sets the backend that new connections start with.
+     * 
+     * @param backend The backend; `Socket` unless changed.
+     */
+    static void setDefaultBackend(Backend backend);
+
+    /**
+     * @brief Enables TCP Fast Open for new connections.
+     * 
+     * The first data sent, the login, then travels in the SYN, saving a round trip on every
+     * connection after the first one to the same server. Kernels without client-side Fast Open
+     * silently use a regular handshake.
+     * 
+     * @param enabled `true` to use Fast Open; off unless changed.
+     */
+    static void setFastOpen(bool enabled);
+
+    /**
+     * @brief Parses a backend name: `socket`, `io_uring` or `io_uring-sqpoll`.
+     * 
+     * @param name The backend name.
+     * @return The backend.
+     * @throws std::runtime_error If the name is unknown.
+     */
+    static Backend parseBackend(const std::string& name);
+
+    /**
+     * @brief Limits how long every send and receive on the connection may block.
+     * 
+     * An operation that exceeds the limit throws, and the connection is out of step from then on:
+     * it must be discarded.
+     * 
+     * @param timeout The limit per operation; 0 waits forever.
+     */
+    void setTimeout(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Returns the limit set by `setTimeout`.
+     * 
+     * @return The limit per operation, 0 if operations wait forever.
+     */
+    std::chrono::milliseconds timeout() const;
+
+    /**
+     * @brief Sets the operation timeout that new connections start with.
+     * 
+     * @param timeout The limit per operation; 0, the initial value, waits forever.
+     */
+    static void setDefaultTimeout(std::chrono::milliseconds timeout);
+
     /**
      * @brief Sends a message to the server as a string.
      * 
@@ -96,6 +210,39 @@ public:
      */
     void sendMessage(const char* data, size_t size);
 
+    /**
+     * @brief Sends a header followed by a payload as a single write.
+     * 
+     * Writing both parts at once keeps a small header from leaving in a segment of its own, which
+     * would otherwise be delayed until the server acknowledges it. Nothing is copied or allocated.
+     * 
+     * @param header The header bytes.
+     * @param headerSize The size of the header.
+     * @param data The payload bytes.
+     * @param size The size of the payload; may be 0.
+     * 
+     * @throws std::runtime_error If the data cannot be sent to the server.
+     */
+    void sendMessage(const char* header, size_t headerSize, const char* data, size_t size);
+
+    /**
+     * @brief Sends a header and a payload, then receives a reply of a fixed size.
+     * 
+     * With the socket backend this is `sendMessage` followed by `receiveMessage`; the io_uring
+     * backends submit the send and wait for the reply with a single system call.
+     * 
+     * @param header The header bytes.
+     * @param headerSize The size of the header.
+     * @param data The payload bytes.
+     * @param size The size of the payload; may be 0.
+     * @param reply The buffer to store the reply.
+     * @param replySize The exact size of the reply.
+     * 
+     * @throws std::runtime_error If the data cannot be sent or the reply is not received.
+     */
+    void exchange(const char* header, size_t headerSize, const char* data, size_t size,
+                  char* reply, size_t replySize);
+
     /**
      * @brief Receives a message from the server with the specified buffer size.
      * 
@@ -125,6 +272,27 @@ public:
      * @throws std::runtime_error If the expected amount of data is not received.
      */
     void receiveMessage(char* buffer, size_t size);
+
+    /**
+     * @brief Waits until data from the server is available, without reading it.
+     * 
+     * A connection that was closed or failed also counts as readable, so that the following
+     * receive reports the error.
+     * 
+     * @param wait How long to wait; 0 only checks.
+     * @return `true` if a receive would not block.
+     */
+    bool waitReadable(std::chrono::microseconds wait);
+
+    /**
+     * @brief Checks without blocking whether the connection is still usable.
+     * 
+     * A connection is considered dead if it was never opened, the server has closed it, or the
+     * server has sent data nobody asked for (which means the exchange is out of step).
+     * 
+     * @return `true` if the connection is open and idle.
+     */
+    bool isAlive() const;
 };
 
 #endif // COMMUNICATOR_H
@@ -0,0 +1,56 @@
+/**
+ * @file CpuFeatures.cpp
+ * @brief Implementation of the CpuFeatures struct, the instruction set extensions the kernels can use.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "CpuFeatures.h"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define CPU_FEATURES_X86 1
+#endif
+
+namespace {
+
+/**
+ * @brief Queries CPUID (and XGETBV for the register state).
+ * 
+ * @return The detected features.
+ */
+CpuFeatures detectCpu() {
+    CpuFeatures features;
+#ifdef CPU_FEATURES_X86
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return features;
+    }
+    features.sse2 = (edx & bit_SSE2) != 0;
+    const bool ssse3 = (ecx & bit_SSSE3) != 0;
+    const bool sse41 = (ecx & bit_SSE4_1) != 0;
+    uint32_t xcr0Low = 0;
+    if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+        uint32_t xcr0High;
+        __asm__ volatile("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    }
+
+    if (__get_cpuid_max(0, nullptr) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        features.shaNi = (ebx & bit_SHA) && ssse3 && sse41;
+        features.avx2 = (ebx & bit_AVX2) && (xcr0Low & 0x6) == 0x6;
+        features.avx512 = (ebx & bit_AVX512F) && (ebx & bit_AVX512DQ) && (xcr0Low & 0xE6) == 0xE6;
+    }
+#endif
+    return features;
+}
+
+} // namespace
+
+const CpuFeatures& CpuFeatures::detected() {
+    static const CpuFeatures features = detectCpu();
+    return features;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file CpuFeatures.h
+ * @brief Header file for the CpuFeatures struct, the instruction set extensions the kernels can use.
+ * 
+ * This file defines the `CpuFeatures` struct. The SHA-256 kernels of `SHA256Library` and the
+ * reduction kernels of `ReductionEngine` are chosen at run time from the features it reports.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+/**
+ * @struct CpuFeatures
+ * @brief The CPUID flags relevant to the accelerated kernels.
+ * 
+ * An extension that needs wider registers is reported only if the operating system saves them on
+ * a context switch (checked with XGETBV), since its instructions fault otherwise. On other
+ * architectures than x86 every flag is false.
+ */
+struct CpuFeatures {
+    bool sse2 = false;   /**< SSE2 is available. */
+    bool shaNi = false;  /**< SHA extensions plus the SSSE3/SSE4.1 they are used with. */
+    bool avx2 = false;   /**< AVX2 with YMM state enabled by the operating system. */
+    bool avx512 = false; /**< AVX-512F and DQ with ZMM state enabled by the operating system. */
+
+    /**
+     * @brief Returns the features of the CPU the program runs on.
+     * 
+     * CPUID is queried on the first call only.
+     * 
+     * @return The detected features.
+     */
+    static const CpuFeatures& detected();
+};
+
+#endif // CPU_FEATURES_H
@@ -0,0 +1,282 @@
+/**
+ * @file InputLoader.cpp
+ * @brief Implementation of the BasicInputLoader class template, which parses the input file in the background.
+ * 
+ * The file is read twice: a line count with a large read buffer, which makes the number of vectors
+ * known almost immediately and records where every batch starts, followed by the actual parsing,
+ * one pool task per batch. Consumers block on a condition variable until the data they ask for is
+ * ready.
+ * 
+ * Both passes read through buffers taken from the shared byte buffer pool, and numbers are
+ * converted in place with `std::from_chars`, so parsing allocates nothing beyond the growth of
+ * the recycled batches.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "InputLoader.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <type_traits>
+#include <unistd.h>
+#include <fcntl.h>
+
+/**
+ * @brief Constructs the loader and queues the counting task.
+ */
+template <typename T>
+BasicInputLoader<T>::BasicInputLoader(const std::string& filename, ThreadPool& pool)
+    : filename(filename), pool(pool), fd(-1), scheduled(0), consumed(0), active(1),
+      batches(MAX_QUEUED_BATCHES + 2), lineCount(0), counted(false), cancelled(false) {
+    ready.fill(false);
+    pool.post([this] { countTask(); });
+}
+
+/**
+ * @brief Stops scheduling batches and waits for the queued and running tasks.
+ * 
+ * At most `MAX_QUEUED_BATCHES` parsing tasks can be outstanding, so the wait is short even when
+ * the caller stops reading early.
+ */
+template <typename T>
+BasicInputLoader<T>::~BasicInputLoader() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cancelled = true;
+        changed.wait(lock, [this] { return active == 0; });
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+}
+
+/**
+ * @brief Counts the lines of the file.
+ * 
+ * A file of N newline characters has N lines, plus one if the last line is not terminated.
+ * 
+ * @throws std::runtime_error If the file cannot be read.
+ */
+template <typename T>
+size_t BasicInputLoader<T>::countLines(std::vector<uint64_t>& batchStarts) const {
+    Stats::Timer timer(Stats::Phase::Count);
+    std::vector<char> chunk = BufferPool<std::vector<char>>::shared().acquire();
+    chunk.resize(READ_CHUNK);
+    batchStarts.assign(1, 0);
+    size_t lines = 0;
+    uint64_t offset = 0;
+    char last = '\n';
+    ssize_t size;
+    while ((size = read(fd, chunk.data(), chunk.size())) > 0) {
+        const char* position = chunk.data();
+        const char* end = chunk.data() + size;
+        while (const char* newline = static_cast<const char*>(std::memchr(position, '\n', end - position))) {
+            if (++lines % BATCH_SIZE == 0) {
+                batchStarts.push_back(offset + (newline + 1 - chunk.data()));
+            }
+            position = newline + 1;
+        }
+        last = chunk[size - 1];
+        offset += size;
+        Stats::add(Stats::Counter::FileReads);
+        Stats::add(Stats::Counter::InputBytes, size);
+    }
+    BufferPool<std::vector<char>>::shared().release(std::move(chunk));
+    if (size == -1) {
+        throw std::runtime_error("Failed to read input file: " + filename);
+    }
+    if (last != '\n') {
+        ++lines;
+    }
+    if (batchStarts.back() != offset) {
+        batchStarts.push_back(offset);
+    }
+    return lines;
+}
+
+/**
+ * @brief Parses the numbers of one line.
+ * 
+ * Reading stops at the first token that is not a number, exactly as extracting doubles from a
+ * string stream did: a token must start with a digit or a decimal point (after an optional sign),
+ * so `inf`, `nan` and hexadecimal prefixes end the line, as does an exponent without digits or a
+ * value outside the range of `T`. For integer types `std::from_chars` stops at a decimal point or
+ * an exponent, and such a token ends the line as well.
+ */
+template <typename T>
+void BasicInputLoader<T>::parseLine(const char* begin, const char* end, Batch& batch) {
+    const char* position = begin;
+    while (true) {
+        while (position < end && (*position == ' ' || (*position >= '\t' && *position <= '\r'))) {
+            ++position;
+        }
+        if (position == end) {
+            break;
+        }
+        const char* digits = position + (*position == '+' || *position == '-' ? 1 : 0);
+        if (digits == end || !((*digits >= '0' && *digits <= '9') || *digits == '.')) {
+            break;
+        }
+        T value;
+        auto parsed = std::from_chars(*position == '+' ? digits : position, end, value);
+        if (parsed.ec != std::errc() ||
+            (parsed.ptr < end && (*parsed.ptr == 'e' || *parsed.ptr == 'E' ||
+                                  (std::is_integral<T>::value && *parsed.ptr == '.')))) {
+            break;
+        }
+        batch.add(value);
+        position = parsed.ptr;
+    }
+    batch.endVector();
+}
+
+template <typename T>
+void BasicInputLoader<T>::schedule() {
+    while (!cancelled && !error && counted && scheduled + 1 < starts.size() &&
+           scheduled < consumed + MAX_QUEUED_BATCHES) {
+        const size_t index = scheduled++;
+        ++active;
+        pool.post([this, index] { parseTask(index); });
+    }
+}
+
+/**
+ * @brief Opens and counts the file, publishes the count and schedules the first batches.
+ * 
+ * The condition variable is notified before the lock is released: once `active` drops to zero
+ * the destructor may destroy the loader.
+ */
+template <typename T>
+void BasicInputLoader<T>::countTask() {
+    std::exception_ptr failure;
+    std::vector<uint64_t> batchStarts;
+    size_t lines = 0;
+    try {
+        fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            throw std::runtime_error("Failed to open input file: " + filename);
+        }
+        lines = countLines(batchStarts);
+    } catch (...) {
+        failure = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (failure) {
+        error = failure;
+    } else {
+        starts = std::move(batchStarts);
+        lineCount = lines;
+        counted = true;
+        schedule();
+    }
+    --active;
+    changed.notify_all();
+}
+
+/**
+ * @brief Reads the bytes of one batch with `pread` and parses them line by line.
+ * 
+ * Batches start right after a newline, so every batch holds whole lines. If the file shrank
+ * since it was counted, the batch ends where the file now ends.
+ */
+template <typename T>
+void BasicInputLoader<T>::parseTask(size_t index) {
+    std::exception_ptr failure;
+    Batch batch = batches.acquire();
+    try {
+        Stats::Timer timer(Stats::Phase::Parse);
+        std::vector<char> chunk = BufferPool<std::vector<char>>::shared().acquire();
+        chunk.resize(starts[index + 1] - starts[index]);
+        size_t filled = 0;
+        while (filled < chunk.size()) {
+            ssize_t size = pread(fd, chunk.data() + filled, chunk.size() - filled, starts[index] + filled);
+            if (size == -1) {
+                BufferPool<std::vector<char>>::shared().release(std::move(chunk));
+                throw std::runtime_error("Failed to read input file: " + filename);
+            }
+            if (size == 0) {
+                break;
+            }
+            filled += static_cast<size_t>(size);
+        }
+
+        const char* position = chunk.data();
+        const char* end = chunk.data() + filled;
+        while (position < end) {
+            const char* newline = static_cast<const char*>(std::memchr(position, '\n', end - position));
+            parseLine(position, newline ? newline : end, batch);
+            position = newline ? newline + 1 : end;
+        }
+        BufferPool<std::vector<char>>::shared().release(std::move(chunk));
+    } catch (...) {
+        failure = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (failure) {
+        if (!error) {
+            error = failure;
+        }
+    } else {
+        slots[index % MAX_QUEUED_BATCHES] = std::move(batch);
+        ready[index % MAX_QUEUED_BATCHES] = true;
+    }
+    --active;
+    changed.notify_all();
+}
+
+template <typename T>
+size_t BasicInputLoader<T>::count() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return counted || error; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return lineCount;
+}
+
+/**
+ * @brief Takes the next batch in file order; batches parsed before an error are still delivered.
+ */
+template <typename T>
+bool BasicInputLoader<T>::nextBatch(Batch& batch) {
+    std::unique_lock<std::mutex> lock(mutex);
+    const size_t slot = consumed % MAX_QUEUED_BATCHES;
+    changed.wait(lock, [this, slot] { return error || (counted && (consumed + 1 >= starts.size() || ready[slot])); });
+    if (counted && consumed + 1 < starts.size() && ready[slot]) {
+        batches.release(std::move(batch));
+        batch = std::move(slots[slot]);
+        ready[slot] = false;
+        ++consumed;
+        schedule();
+        return true;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return false;
+}
+
+template <typename T>
+typename BasicInputLoader<T>::Batch BasicInputLoader<T>::readAll() {
+    Batch all;
+    Batch batch;
+    while (nextBatch(batch)) {
+        if (all.empty()) {
+            std::swap(all, batch);
+        } else {
+            all.append(batch);
+        }
+    }
+    return all;
+}
+
+template class BasicInputLoader<float>;
+template class BasicInputLoader<double>;
+template class BasicInputLoader<int32_t>;
+template class BasicInputLoader<int64_t>;
@@ -0,0 +1,171 @@
+/**
+ * @file InputLoader.h
+ * @brief Header file for the BasicInputLoader class, which parses the input file in the background.
+ * 
+ * This file defines the `BasicInputLoader` class template. It starts reading the input file as soon as it is
+ * constructed, so parsing overlaps with connecting to and authenticating with the server, and
+ * hands the parsed vectors to the caller in batches.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef INPUT_LOADER_H
+#define INPUT_LOADER_H
+
+#include "VectorBatch.h"
+#include "BufferPool.h"
+#include "ThreadPool.h"
+
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+#include <mutex>
+
+/**
+ * @class BasicInputLoader
+ * @brief Parses an input file of whitespace-separated numbers on the shared thread pool.
+ * 
+ * Every line of the file becomes one vector. The protocol announces the number of vectors before
+ * the first one is sent, so a first task counts the lines (a fast scan that does not parse
+ * numbers) and publishes the count, noting where every batch of `BATCH_SIZE` lines starts. Each
+ * batch is then parsed by a task of its own, so batches are parsed in parallel when the pool has
+ * several workers; at most `MAX_QUEUED_BATCHES` batches are parsed ahead of the consumer. The
+ * caller can therefore start sending as soon as the count and the first batch are available
+ * instead of waiting for the whole file to be parsed.
+ * 
+ * Batches are recycled: `nextBatch` hands the caller's previous batch back to the loader, which
+ * refills it instead of allocating a new one. Together with the fixed set of batch slots and the
+ * pooled read buffers this keeps the steady state of the consumer loop free of heap allocations.
+ * 
+ * Errors raised by the tasks (for example, a missing file) are rethrown to the caller from
+ * `count`, `nextBatch` or `readAll`.
+ * 
+ * The template is instantiated (in InputLoader.cpp) for the element types the client can send:
+ * `float`, `double`, `int32_t` and `int64_t`.
+ * 
+ * @tparam T The element type the numbers are parsed into.
+ */
+template <typename T>
+class BasicInputLoader {
+public:
+    /// A batch of parsed vectors
+    using Batch = BasicVectorBatch<T>;
+
+    /// Number of lines parsed into one batch
+    static constexpr size_t BATCH_SIZE = 4096;
+
+    /// Maximum number of parsed batches waiting to be consumed
+    static constexpr size_t MAX_QUEUED_BATCHES = 8;
+
+    /// Size of the buffer the file is counted through
+    static constexpr size_t READ_CHUNK = 1 << 16;
+
+    /**
+     * @brief Constructs the loader and immediately starts reading the file.
+     * 
+     * @param filename The path to the input file.
+     * @param pool The pool running the counting and parsing tasks.
+     */
+    explicit BasicInputLoader(const std::string& filename, ThreadPool& pool = ThreadPool::shared());
+
+    /**
+     * @brief Destructor that stops scheduling batches and waits for the running tasks to finish.
+     */
+    ~BasicInputLoader();
+
+    BasicInputLoader(const BasicInputLoader&) = delete;
+    BasicInputLoader& operator=(const BasicInputLoader&) = delete;
+
+    /**
+     * @brief Returns the number of vectors in the file, waiting for the line count if necessary.
+     * 
+     * @return The number of lines (vectors) in the file.
+     * @throws std::runtime_error If the file cannot be opened or read.
+     */
+    size_t count();
+
+    /**
+     * @brief Retrieves the next batch of parsed vectors, waiting for it if necessary.
+     * 
+     * @param batch Receives the vectors of the next batch; its previous contents are replaced and
+     *              its storage is reused for a later batch.
+     * @return `true` if a batch was retrieved, `false` once all batches have been consumed.
+     * @throws std::runtime_error If the file cannot be opened or read.
+     */
+    bool nextBatch(Batch& batch);
+
+    /**
+     * @brief Retrieves all remaining vectors at once.
+     * 
+     * @return The remaining vectors in file order.
+     * @throws std::runtime_error If the file cannot be opened or read.
+     */
+    Batch readAll();
+
+private:
+    std::string filename;           /**< The input file being parsed. */
+    ThreadPool& pool;               /**< Runs the counting and parsing tasks. */
+    int fd;                         /**< The input file, open while tasks read it. */
+    std::mutex mutex;               /**< Protects all members below. */
+    std::condition_variable changed; /**< Signalled whenever the state below changes. */
+    std::vector<uint64_t> starts;   /**< File offset of every batch, followed by the end of the file. */
+    std::array<Batch, MAX_QUEUED_BATCHES> slots; /**< Batch `i` is parsed into slot `i % MAX_QUEUED_BATCHES`. */
+    std::array<bool, MAX_QUEUED_BATCHES> ready;  /**< Whether a slot holds a parsed batch. */
+    size_t scheduled;               /**< Number of batches handed to the pool so far. */
+    size_t consumed;                /**< Number of batches taken by the caller so far. */
+    size_t active;                  /**< Number of tasks queued or running. */
+    BufferPool<Batch> batches;      /**< Consumed batches waiting to be refilled. */
+    size_t lineCount;               /**< Number of lines, valid once `counted` is set. */
+    bool counted;                   /**< Whether `lineCount` and `starts` are known. */
+    bool cancelled;                 /**< Set by the destructor to stop scheduling batches. */
+    std::exception_ptr error;       /**< Exception raised by a task, if any. */
+
+    /**
+     * @brief Task that counts the lines and schedules the first batches.
+     */
+    void countTask();
+
+    /**
+     * @brief Task that parses one batch into its slot.
+     * 
+     * @param index The batch number.
+     */
+    void parseTask(size_t index);
+
+    /**
+     * @brief Hands batches to the pool until `MAX_QUEUED_BATCHES` are ahead of the caller.
+     * 
+     * Must be called with `mutex` held.
+     */
+    void schedule();
+
+    /**
+     * @brief Counts the lines of the file the way `std::getline` would split it.
+     * 
+     * @param batchStarts Receives the offset of every `BATCH_SIZE`-th line and the file size.
+     * @return The number of lines.
+     */
+    size_t countLines(std::vector<uint64_t>& batchStarts) const;
+
+    /**
+     * @brief Parses one line into a vector of the batch.
+     * 
+     * Integer element types accept only integer tokens, so a value with a fraction or an exponent,
+     * or one outside the range of `T`, ends the line instead of being rounded.
+     * 
+     * @param begin The first character of the line.
+     * @param end The end of the line, without the newline.
+     * @param batch The batch receiving the vector.
+     */
+    static void parseLine(const char* begin, const char* end, Batch& batch);
+};
+
+/// The loader of the original protocol, which sends doubles
+using InputLoader = BasicInputLoader<double>;
+
+#endif // INPUT_LOADER_H
@@ -0,0 +1,470 @@
+/**
+ * @file IoUring.cpp
+ * @brief Implementation of the IoUring class, an io_uring based transport for one connected socket.
+ * 
+ * The rings are shared with the kernel: values the kernel writes (submission head, completion
+ * tail, flags) are read with acquire loads, and values we publish (submission tail, completion
+ * head, provided buffer tail) are written with release stores after the entries they cover.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "IoUring.h"
+#include "Stats.h"
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <poll.h>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <thread>
+
+namespace {
+
+/// Completion tag of sends
+constexpr uint64_t SEND_TAG = 1;
+
+/// Completion tag of receives
+constexpr uint64_t RECEIVE_TAG = 2;
+
+/// Completion tag of cancellations
+constexpr uint64_t CANCEL_TAG = 3;
+
+/**
+ * @brief Calls `io_uring_setup`.
+ */
+int setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+/**
+ * @brief Calls `io_uring_register`.
+ */
+int registerWith(int ringFd, unsigned opcode, const void* argument, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, ringFd, opcode, argument, count));
+}
+
+} // namespace
+
+/**
+ * @brief Probes once by creating and closing a small ring; kernels built without io_uring, or
+ * with it disabled by sysctl or a seccomp filter, fail the probe.
+ */
+bool IoUring::available() {
+    static const bool supported = [] {
+        io_uring_params params{};
+        int fd = setup(2, &params);
+        if (fd < 0) {
+            return false;
+        }
+        close(fd);
+        return (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    }();
+    return supported;
+}
+
+IoUring::IoUring(int socketFd, bool sqpoll)
+    : ringFd(-1), socketFd(socketFd), sqpoll(sqpoll), timeout(0), fixedFile(false), providedBuffers(false),
+      multishot(true), ringMemory(MAP_FAILED), ringSize(0), entryMemory(MAP_FAILED), entrySize(0),
+      bufferRing(MAP_FAILED), buffers(nullptr), bufferTail(0), receivedHead(0), receivedCount(0),
+      receiveArmed(false), sendPending(false), sendResult(0), closed(false), receiveError(0) {
+    io_uring_params params{};
+    if (sqpoll) {
+        params.flags = IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = 100;
+    }
+    ringFd = setup(ENTRIES, &params);
+    if (ringFd < 0) {
+        throw std::runtime_error("Failed to set up io_uring");
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        release();
+        throw std::runtime_error("io_uring is too old");
+    }
+
+    ringSize = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    ringMemory = mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    entrySize = params.sq_entries * sizeof(io_uring_sqe);
+    entryMemory = mmap(nullptr, entrySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    buffers = new char[BUFFER_COUNT * BUFFER_SIZE];
+    bufferRing = mmap(nullptr, BUFFER_COUNT * sizeof(io_uring_buf), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ringMemory == MAP_FAILED || entryMemory == MAP_FAILED || bufferRing == MAP_FAILED) {
+        release();
+        throw std::runtime_error("Failed to map io_uring");
+    }
+
+    char* ring = static_cast<char*>(ringMemory);
+    sqHead = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    sqFlags = reinterpret_cast<unsigned*>(ring + params.sq_off.flags);
+    sqArray = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    sqMask = *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    cqHead = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+
+    fixedFile = registerWith(ringFd, IORING_REGISTER_FILES, &socketFd, 1) == 0;
+
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<uint64_t>(bufferRing);
+    registration.ring_entries = BUFFER_COUNT;
+    registration.bgid = 0;
+    providedBuffers = registerWith(ringFd, IORING_REGISTER_PBUF_RING, &registration, 1) == 0;
+    if (providedBuffers) {
+        for (uint16_t bid = 0; bid < BUFFER_COUNT; ++bid) {
+            recycle(bid);
+        }
+    }
+
+    armReceive();
+    enter(0);
+}
+
+IoUring::~IoUring() {
+    release();
+}
+
+/**
+ * @brief Closing the ring descriptor cancels the armed receive; the kernel drops its references
+ * to the buffers before the memory is unmapped.
+ */
+void IoUring::release() {
+    if (ringFd >= 0) {
+        close(ringFd);
+        ringFd = -1;
+    }
+    if (ringMemory != MAP_FAILED) {
+        munmap(ringMemory, ringSize);
+        ringMemory = MAP_FAILED;
+    }
+    if (entryMemory != MAP_FAILED) {
+        munmap(entryMemory, entrySize);
+        entryMemory = MAP_FAILED;
+    }
+    if (bufferRing != MAP_FAILED) {
+        munmap(bufferRing, BUFFER_COUNT * sizeof(io_uring_buf));
+        bufferRing = MAP_FAILED;
+    }
+    delete[] buffers;
+    buffers = nullptr;
+}
+
+io_uring_sqe* IoUring::nextEntry() {
+    while (*sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) > sqMask) {
+        enter(0);
+    }
+    const unsigned index = *sqTail & sqMask;
+    io_uring_sqe* entry = static_cast<io_uring_sqe*>(entryMemory) + index;
+    std::memset(entry, 0, sizeof(*entry));
+    sqArray[index] = index;
+    if (fixedFile) {
+        entry->fd = 0;
+        entry->flags = IOSQE_FIXED_FILE;
+    } else {
+        entry->fd = socketFd;
+    }
+    return entry;
+}
+
+void IoUring::publish() {
+    __atomic_store_n(sqTail, *sqTail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief The slots are addressed as a plain array: under C++, the flexible array member of
+ * `io_uring_buf_ring` in the kernel header is laid out after an empty struct, one slot too far.
+ */
+void IoUring::recycle(uint16_t bid) {
+    io_uring_buf_ring* ring = static_cast<io_uring_buf_ring*>(bufferRing);
+    io_uring_buf& slot = static_cast<io_uring_buf*>(bufferRing)[bufferTail & (BUFFER_COUNT - 1)];
+    slot.addr = reinterpret_cast<uint64_t>(buffers + static_cast<size_t>(bid) * BUFFER_SIZE);
+    slot.len = BUFFER_SIZE;
+    slot.bid = bid;
+    ++bufferTail;
+    __atomic_store_n(&ring->tail, bufferTail, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Arms a multishot receive into the provided buffers, or a single receive into the first
+ * buffer when provided buffers are unavailable; the single buffer is not reused while it still
+ * holds unread data.
+ */
+void IoUring::armReceive() {
+    if (receiveArmed || closed || receiveError != 0 || (!providedBuffers && receivedCount > 0)) {
+        return;
+    }
+    io_uring_sqe* entry = nextEntry();
+    entry->opcode = IORING_OP_RECV;
+    entry->user_data = RECEIVE_TAG;
+    if (providedBuffers) {
+        entry->flags |= IOSQE_BUFFER_SELECT;
+        entry->buf_group = 0;
+        if (multishot) {
+            entry->ioprio = IORING_RECV_MULTISHOT;
+        }
+    } else {
+        entry->addr = reinterpret_cast<uint64_t>(buffers);
+        entry->len = BUFFER_SIZE;
+    }
+    publish();
+    receiveArmed = true;
+}
+
+/**
+ * @brief With SQPOLL, submission needs a system call only to wake the polling thread, and
+ * completions are polled for `SPIN_LIMIT` rounds before waiting in the kernel.
+ */
+void IoUring::enter(unsigned wanted) {
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    if (sqpoll) {
+        for (unsigned spin = 0; spin < SPIN_LIMIT; ++spin) {
+            if (__atomic_load_n(sqFlags, __ATOMIC_ACQUIRE) & IORING_SQ_NEED_WAKEUP) {
+                break;
+            }
+            if (__atomic_load_n(cqTail, __ATOMIC_ACQUIRE) - *cqHead >= wanted) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        if (__atomic_load_n(sqFlags, __ATOMIC_ACQUIRE) & IORING_SQ_NEED_WAKEUP) {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+    }
+    while (true) {
+        unsigned toSubmit = sqpoll ? 0 : *sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+        if (syscall(__NR_io_uring_enter, ringFd, toSubmit, wanted, flags, nullptr, 0) >= 0) {
+            return;
+        }
+        if (errno != EINTR) {
+            throw std::runtime_error("io_uring_enter failed");
+        }
+    }
+}
+
+/**
+ * @brief The ring descriptor polls readable while the completion queue holds entries. The send is
+ * cancelled on timeout because the kernel still refers to the caller's data and to the message
+ * header on the stack of `transfer`; its completion is awaited before the exception leaves.
+ */
+void IoUring::await(unsigned wanted, std::chrono::steady_clock::time_point deadline) {
+    if (timeout.count() == 0) {
+        enter(wanted);
+        return;
+    }
+    enter(0);
+    if (waitCompletion(deadline - std::chrono::steady_clock::now())) {
+        return;
+    }
+    if (sendPending) {
+        io_uring_sqe* entry = nextEntry();
+        entry->opcode = IORING_OP_ASYNC_CANCEL;
+        entry->fd = -1;
+        entry->flags = 0;
+        entry->addr = SEND_TAG;
+        entry->user_data = CANCEL_TAG;
+        publish();
+        while (sendPending) {
+            enter(1);
+            reap();
+        }
+    }
+    Stats::add(Stats::Counter::Timeouts);
+    throw std::runtime_error("Timed out waiting for the server");
+}
+
+bool IoUring::waitCompletion(std::chrono::nanoseconds wait) {
+    pollfd entry{ringFd, POLLIN, 0};
+    while (__atomic_load_n(cqTail, __ATOMIC_ACQUIRE) == *cqHead) {
+        const auto nanoseconds = std::max<int64_t>(wait.count(), 0);
+        const timespec remaining{static_cast<time_t>(nanoseconds / 1000000000), static_cast<long>(nanoseconds % 1000000000)};
+        const auto start = std::chrono::steady_clock::now();
+        const int ready = ppoll(&entry, 1, &remaining, nullptr);
+        if (ready == 0) {
+            return __atomic_load_n(cqTail, __ATOMIC_ACQUIRE) != *cqHead;
+        }
+        if (ready == -1 && errno != EINTR) {
+            throw std::runtime_error("Failed to wait for io_uring completions");
+        }
+        wait -= std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    }
+    return true;
+}
+
+/**
+ * @brief A receive completion without `IORING_CQE_F_MORE` means the receive has to be armed
+ * again; `-EINVAL` on a multishot receive means the kernel does not support it.
+ */
+unsigned IoUring::reap() {
+    unsigned head = *cqHead;
+    const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    unsigned processed = 0;
+    for (; head != tail; ++head, ++processed) {
+        const io_uring_cqe& completion = cqes[head & cqMask];
+        if (completion.user_data == SEND_TAG) {
+            sendPending = false;
+            sendResult = completion.res;
+        } else if (completion.user_data == RECEIVE_TAG) {
+            if (completion.res > 0) {
+                Received& piece = received[(receivedHead + receivedCount) % BUFFER_COUNT];
+                piece.bid = providedBuffers ? static_cast<uint16_t>(completion.flags >> IORING_CQE_BUFFER_SHIFT) : 0;
+                piece.offset = 0;
+                piece.length = static_cast<uint32_t>(completion.res);
+                ++receivedCount;
+                Stats::add(Stats::Counter::RecvCalls);
+                Stats::add(Stats::Counter::BytesReceived, completion.res);
+            } else if (completion.res == 0) {
+                closed = true;
+            } else if (completion.res == -EINVAL && multishot) {
+                multishot = false;
+            } else if (completion.res != -ENOBUFS && completion.res != -EINTR && completion.res != -EAGAIN) {
+                receiveError = -completion.res;
+            }
+            if (!(completion.flags & IORING_CQE_F_MORE)) {
+                receiveArmed = false;
+            }
+        }
+    }
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    return processed;
+}
+
+/**
+ * @brief Queues the send, then alternates between copying received data to the caller and one
+ * `io_uring_enter` that submits and waits for every completion still expected (the send and the
+ * next piece of the reply). A partial send is continued with the rest of the data.
+ */
+size_t IoUring::transfer(const iovec* parts, size_t count, char* reply, size_t replySize, size_t minimum) {
+    if (count > MAX_PARTS) {
+        throw std::runtime_error("Too many pieces in one send");
+    }
+    iovec remaining[MAX_PARTS];
+    size_t first = 0;
+    size_t toSend = 0;
+    for (size_t i = 0; i < count; ++i) {
+        remaining[i] = parts[i];
+        toSend += parts[i].iov_len;
+    }
+    msghdr message{};
+    auto queueSend = [&] {
+        message.msg_iov = remaining + first;
+        message.msg_iovlen = count - first;
+        io_uring_sqe* entry = nextEntry();
+        entry->opcode = IORING_OP_SENDMSG;
+        entry->addr = reinterpret_cast<uint64_t>(&message);
+        entry->len = 1;
+        entry->msg_flags = MSG_NOSIGNAL;
+        entry->user_data = SEND_TAG;
+        publish();
+        sendPending = true;
+        Stats::add(Stats::Counter::SendCalls);
+    };
+    bool sending = toSend > 0;
+    if (sending) {
+        queueSend();
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    size_t filled = 0;
+    while (true) {
+        if (sending && !sendPending) {
+            if (sendResult <= 0) {
+                throw std::runtime_error("Failed to send data");
+            }
+            Stats::add(Stats::Counter::BytesSent, sendResult);
+            size_t sent = static_cast<size_t>(sendResult);
+            toSend -= sent;
+            while (first < count && sent >= remaining[first].iov_len) {
+                sent -= remaining[first].iov_len;
+                ++first;
+            }
+            if (first < count) {
+                remaining[first].iov_base = static_cast<char*>(remaining[first].iov_base) + sent;
+                remaining[first].iov_len -= sent;
+            }
+            sending = toSend > 0;
+            if (sending) {
+                queueSend();
+            }
+        }
+
+        while (filled < replySize && receivedCount > 0) {
+            Received& piece = received[receivedHead];
+            const char* data = buffers + static_cast<size_t>(piece.bid) * BUFFER_SIZE + piece.offset;
+            const size_t size = std::min<size_t>(piece.length, replySize - filled);
+            std::memcpy(reply + filled, data, size);
+            filled += size;
+            piece.offset += size;
+            piece.length -= size;
+            if (piece.length == 0) {
+                if (providedBuffers) {
+                    recycle(piece.bid);
+                }
+                receivedHead = (receivedHead + 1) % BUFFER_COUNT;
+                --receivedCount;
+            }
+        }
+
+        bool receiving = filled < minimum;
+        if (!sending && !receiving) {
+            return filled;
+        }
+        if (receiving && receivedCount == 0) {
+            if (closed || receiveError != 0) {
+                // The send still refers to `message`, so it has to complete before throwing
+                if (!sending) {
+                    throw std::runtime_error("Failed to receive the expected amount of data");
+                }
+                receiving = false;
+            } else {
+                armReceive();
+            }
+        }
+        await((sending ? 1 : 0) + (receiving ? 1 : 0), deadline);
+        reap();
+    }
+}
+
+void IoUring::exchange(const iovec* parts, size_t count, char* reply, size_t replySize) {
+    transfer(parts, count, reply, replySize, replySize);
+}
+
+size_t IoUring::receive(char* buffer, size_t size) {
+    return transfer(nullptr, 0, buffer, size, std::min<size_t>(size, 1));
+}
+
+bool IoUring::readable(std::chrono::microseconds wait) {
+    enter(0);
+    reap();
+    armReceive();
+    if (receivedCount == 0 && !closed && receiveError == 0) {
+        enter(0);
+        if (waitCompletion(wait)) {
+            reap();
+        }
+    }
+    return receivedCount > 0 || closed || receiveError != 0;
+}
+
+void IoUring::setTimeout(std::chrono::milliseconds timeout) {
+    this->timeout = timeout;
+}
+
+bool IoUring::idle() {
+    enter(0);
+    reap();
+    armReceive();
+    return !closed && receiveError == 0 && receivedCount == 0;
+}
+
+bool IoUring::polled() const {
+    return sqpoll;
+}
@@ -0,0 +1,256 @@
+/**
+ * @file IoUring.h
+ * @brief Header file for the IoUring class, an io_uring based transport for one connected socket.
+ * 
+ * This file defines the `IoUring` class used by `Communicator` when the io_uring backend is
+ * selected. It talks to the kernel through the raw `io_uring_setup`, `io_uring_enter` and
+ * `io_uring_register` system calls, so no extra library is needed.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#include <sys/uio.h>
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+
+/**
+ * @class IoUring
+ * @brief Sends and receives on a connected socket through an io_uring instance.
+ * 
+ * The socket is registered with the ring, and a multishot receive is kept armed on it: the kernel
+ * places incoming data into a registered ring of provided buffers and posts a completion for every
+ * piece, so no receive request has to be submitted per message. A request/reply exchange queues
+ * the send and waits for both completions with one `io_uring_enter` call, instead of the separate
+ * send and receive system calls of the socket backend.
+ * 
+ * With `SQPOLL`, a kernel thread picks up submissions, and replies are first awaited by polling
+ * the completion queue, so a busy connection can run without any system call at all.
+ * 
+ * Kernels without multishot receive or provided buffer rings are handled by re-arming a single
+ * receive whenever the previous one completes.
+ */
+class IoUring {
+public:
+    /// Number of submission queue entries
+    static constexpr unsigned ENTRIES = 8;
+
+    /// Number of provided receive buffers; a power of two
+    static constexpr unsigned BUFFER_COUNT = 16;
+
+    /// Size of one provided receive buffer
+    static constexpr unsigned BUFFER_SIZE = 4096;
+
+    /// Number of completion queue polls before an SQPOLL ring falls back to waiting in the kernel
+    static constexpr unsigned SPIN_LIMIT = 2000;
+
+    /**
+     * @brief Checks whether the kernel supports io_uring and allows the process to use it.
+     * 
+     * @return `true` if a ring can be created.
+     */
+    static bool available();
+
+    /**
+     * @brief Creates a ring for a connected socket and arms the receive.
+     * 
+     * @param socketFd The connected socket; it stays owned by the caller.
+     * @param sqpoll Whether submissions are picked up by a kernel polling thread.
+     * @throws std::runtime_error If the ring cannot be created.
+     */
+    IoUring(int socketFd, bool sqpoll);
+
+    /**
+     * @brief Cancels the outstanding receive and releases the ring.
+     */
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    /**
+     * @brief Sends data and then receives an exact number of bytes.
+     * 
+     * Either side may be empty: without a reply the call returns once the data is sent, and
+     * without data it only receives.
+     * 
+     * @param parts The pieces of the data to send.
+     * @param count The number of pieces.
+     * @param reply Receives the reply.
+     * @param replySize The exact size of the reply.
+     * @throws std::runtime_error If sending or receiving fails or the connection is closed.
+     */
+    void exchange(const iovec* parts, size_t count, char* reply, size_t replySize);
+
+    /**
+     * @brief Receives whatever data is available, waiting for at least one byte.
+     * 
+     * @param buffer Receives the data.
+     * @param size The size of the buffer.
+     * @return The number of bytes received.
+     * @throws std::runtime_error If receiving fails or the connection is closed.
+     */
+    size_t receive(char* buffer, size_t size);
+
+    /**
+     * @brief Checks without blocking whether the connection is open and has no unread data.
+     * 
+     * @return `true` if the connection is open and idle.
+     */
+    bool idle();
+
+    /**
+     * @brief Waits until received data is available, without consuming it.
+     * 
+     * @param wait How long to wait; 0 only checks.
+     * @return `true` if data has arrived or the connection was closed or failed.
+     */
+    bool readable(std::chrono::microseconds wait);
+
+    /**
+     * @brief Limits how long `exchange` and `receive` may block.
+     * 
+     * @param timeout The limit per call; 0 waits forever.
+     */
+    void setTimeout(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Returns whether the submission queue is polled by a kernel thread.
+     * 
+     * @return `true` for an SQPOLL ring.
+     */
+    bool polled() const;
+
+private:
+    /// Largest number of pieces a send may consist of
+    static constexpr size_t MAX_PARTS = 4;
+
+    /**
+     * @brief Sends data and receives until at least `minimum` bytes of the reply have arrived.
+     * 
+     * @param parts The pieces of the data to send.
+     * @param count The number of pieces, at most `MAX_PARTS`.
+     * @param reply Receives the reply.
+     * @param replySize The size of the reply buffer.
+     * @param minimum The number of reply bytes to wait for.
+     * @return The number of reply bytes received.
+     * @throws std::runtime_error If sending or receiving fails or the connection is closed.
+     */
+    size_t transfer(const iovec* parts, size_t count, char* reply, size_t replySize, size_t minimum);
+
+    /**
+     * @brief Returns the next free submission queue entry, zeroed.
+     * 
+     * The entry is handed to the kernel by `publish` once it is filled in.
+     * 
+     * @return The entry.
+     */
+    struct io_uring_sqe* nextEntry();
+
+    /**
+     * @brief Makes the entry returned by `nextEntry` visible to the kernel.
+     */
+    void publish();
+
+    /**
+     * @brief Unmaps the rings and closes the ring descriptor.
+     */
+    void release();
+
+    /**
+     * @brief Queues the receive if it is not armed.
+     */
+    void armReceive();
+
+    /**
+     * @brief Submits the queued entries and waits for completions.
+     * 
+     * @param wanted The number of completions to wait for; 0 only submits and flushes.
+     */
+    void enter(unsigned wanted);
+
+    /**
+     * @brief Submits the queued entries and waits for completions until a deadline.
+     * 
+     * Without a timeout this is `enter(wanted)`. Otherwise it waits for at least one completion,
+     * and when the deadline passes first, the outstanding send is cancelled before throwing.
+     * 
+     * @param wanted The number of completions expected.
+     * @param deadline The end of the call.
+     * @throws std::runtime_error If the deadline passes.
+     */
+    void await(unsigned wanted, std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Waits until the completion queue is not empty.
+     * 
+     * @param wait How long to wait.
+     * @return `false` if the time ran out.
+     */
+    bool waitCompletion(std::chrono::nanoseconds wait);
+
+    /**
+     * @brief Processes all posted completions.
+     * 
+     * @return The number of completions processed.
+     */
+    unsigned reap();
+
+    /**
+     * @brief Hands a consumed receive buffer back to the kernel.
+     * 
+     * @param bid The buffer id.
+     */
+    void recycle(uint16_t bid);
+
+    int ringFd;             /**< The io_uring instance. */
+    int socketFd;           /**< The connected socket. */
+    bool sqpoll;            /**< Whether a kernel thread polls the submission queue. */
+    std::chrono::milliseconds timeout; /**< Limit of every call, 0 for none. */
+    bool fixedFile;         /**< Whether the socket is registered as fixed file 0. */
+    bool providedBuffers;   /**< Whether receives use the provided buffer ring. */
+    bool multishot;         /**< Whether multishot receive is supported. */
+
+    void* ringMemory;       /**< Mapped submission and completion rings. */
+    size_t ringSize;        /**< Size of `ringMemory`. */
+    void* entryMemory;      /**< Mapped submission queue entries. */
+    size_t entrySize;       /**< Size of `entryMemory`. */
+    unsigned* sqHead;       /**< Submission queue head, advanced by the kernel. */
+    unsigned* sqTail;       /**< Submission queue tail, advanced by us. */
+    unsigned* sqFlags;      /**< Submission queue flags (`IORING_SQ_NEED_WAKEUP`). */
+    unsigned* sqArray;      /**< Submission queue index array. */
+    unsigned sqMask;        /**< Submission queue index mask. */
+    unsigned* cqHead;       /**< Completion queue head, advanced by us. */
+    unsigned* cqTail;       /**< Completion queue tail, advanced by the kernel. */
+    unsigned cqMask;        /**< Completion queue index mask. */
+    struct io_uring_cqe* cqes; /**< Completion queue entries. */
+
+    void* bufferRing;       /**< Provided buffer ring shared with the kernel. */
+    char* buffers;          /**< Storage of the receive buffers. */
+    uint16_t bufferTail;    /**< Tail of the provided buffer ring. */
+
+    /**
+     * @struct Received
+     * @brief A piece of received data not yet handed to the caller.
+     */
+    struct Received {
+        uint16_t bid;       /**< The buffer holding the data. */
+        uint32_t offset;    /**< First unread byte within the buffer. */
+        uint32_t length;    /**< Number of unread bytes. */
+    };
+    Received received[BUFFER_COUNT]; /**< Received pieces in arrival order, as a ring. */
+    unsigned receivedHead;  /**< Index of the oldest piece. */
+    unsigned receivedCount; /**< Number of pieces. */
+
+    bool receiveArmed;      /**< Whether a receive is outstanding. */
+    bool sendPending;       /**< Whether a send is outstanding. */
+    int sendResult;         /**< Result of the last completed send. */
+    bool closed;            /**< Whether the peer closed the connection. */
+    int receiveError;       /**< Error of the last failed receive, or 0. */
+};
+
+#endif // IO_URING_H
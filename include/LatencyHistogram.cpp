@@ -0,0 +1,199 @@
+/**
+ * @file LatencyHistogram.cpp
+ * @brief Implementation of the LatencyHistogram class, a fixed-size log-linear histogram of latencies.
+ * 
+ * Bucket `b * HALF_SUB_BUCKETS + s` covers the values whose most significant bit is at position
+ * `b + SUB_BUCKET_BITS - 1` and whose top `SUB_BUCKET_BITS` bits equal `s`; the first
+ * 2^`SUB_BUCKET_BITS` buckets hold the small values exactly.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "LatencyHistogram.h"
+
+#include <iomanip>
+#include <limits>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+size_t LatencyHistogram::indexOf(uint64_t value) {
+    const uint64_t maxValue = (uint64_t(1) << MAX_VALUE_BITS) - 1;
+    if (value > maxValue) {
+        value = maxValue;
+    }
+    if (value < (uint64_t(1) << SUB_BUCKET_BITS)) {
+        return static_cast<size_t>(value);
+    }
+    const unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(value));
+    const unsigned shift = msb - SUB_BUCKET_BITS + 1;
+    return shift * HALF_SUB_BUCKETS + static_cast<size_t>(value >> shift);
+}
+
+uint64_t LatencyHistogram::lowestValueAt(size_t index) {
+    if (index < (size_t(1) << SUB_BUCKET_BITS)) {
+        return index;
+    }
+    const size_t shift = index / HALF_SUB_BUCKETS - 1;
+    return static_cast<uint64_t>(index - shift * HALF_SUB_BUCKETS) << shift;
+}
+
+uint64_t LatencyHistogram::highestValueAt(size_t index) {
+    if (index < (size_t(1) << SUB_BUCKET_BITS)) {
+        return index;
+    }
+    const size_t shift = index / HALF_SUB_BUCKETS - 1;
+    return lowestValueAt(index) + (uint64_t(1) << shift) - 1;
+}
+
+/**
+ * @brief Records a value with relaxed atomic increments; min/max use compare-and-swap loops.
+ */
+void LatencyHistogram::record(uint64_t value) {
+    counts[indexOf(value)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t current = minimum.load(std::memory_order_relaxed);
+    while (value < current && !minimum.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+    current = maximum.load(std::memory_order_relaxed);
+    while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        uint64_t value = other.counts[i].load(std::memory_order_relaxed);
+        if (value != 0) {
+            counts[i].fetch_add(value, std::memory_order_relaxed);
+        }
+    }
+    total.fetch_add(other.total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    uint64_t otherMin = other.minimum.load(std::memory_order_relaxed);
+    uint64_t current = minimum.load(std::memory_order_relaxed);
+    while (otherMin < current && !minimum.compare_exchange_weak(current, otherMin, std::memory_order_relaxed)) {
+    }
+    uint64_t otherMax = other.maximum.load(std::memory_order_relaxed);
+    current = maximum.load(std::memory_order_relaxed);
+    while (otherMax > current && !maximum.compare_exchange_weak(current, otherMax, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : counts) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    minimum.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    maximum.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const {
+    return total.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::min() const {
+    return count() == 0 ? 0 : minimum.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::max() const {
+    return maximum.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const {
+    uint64_t n = count();
+    return n == 0 ? 0.0 : static_cast<double>(sum.load(std::memory_order_relaxed)) / static_cast<double>(n);
+}
+
+uint64_t LatencyHistogram::valueAtPercentile(double percentile) const {
+    const uint64_t n = count();
+    if (n == 0) {
+        return 0;
+    }
+    if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+    uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(n)));
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += counts[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            uint64_t value = highestValueAt(i);
+            return value < max() ? value : max();
+        }
+    }
+    return max();
+}
+
+/**
+ * @brief Prints percentiles at exponentially closer steps towards 100%, five per halving,
+ * followed by the summary lines of the HdrHistogram text format.
+ */
+void LatencyHistogram::writePercentiles(std::ostream& out, double unitScale) const {
+    const uint64_t n = count();
+    out << std::setw(12) << "Value" << " " << std::setw(14) << "Percentile" << " "
+        << std::setw(10) << "TotalCount" << " " << "1/(1-Percentile)\n\n";
+    out << std::fixed;
+
+    auto line = [&](double percentile) {
+        uint64_t value = valueAtPercentile(percentile);
+        uint64_t below = 0;
+        for (size_t i = 0; i <= indexOf(value); ++i) {
+            below += counts[i].load(std::memory_order_relaxed);
+        }
+        out << std::setw(12) << std::setprecision(3) << static_cast<double>(value) / unitScale << " "
+            << std::setw(14) << std::setprecision(12) << percentile / 100.0 << " "
+            << std::setw(10) << below << " ";
+        if (percentile < 100.0) {
+            out << std::setw(14) << std::setprecision(2) << 1.0 / (1.0 - percentile / 100.0) << "\n";
+        } else {
+            out << std::setw(14) << "inf" << "\n";
+        }
+        return below;
+    };
+
+    if (n > 0) {
+        const int ticksPerHalf = 5;
+        bool complete = false;
+        for (int half = 0; half < 40 && !complete; ++half) {
+            const double from = 100.0 * (1.0 - std::ldexp(1.0, -half));
+            const double width = 100.0 * std::ldexp(1.0, -half - 1);
+            for (int tick = 0; tick < ticksPerHalf && !complete; ++tick) {
+                complete = line(from + width * tick / ticksPerHalf) >= n;
+            }
+        }
+        line(100.0);
+    }
+
+    double variance = 0.0;
+    if (n > 0) {
+        const double average = mean();
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            uint64_t bucketCount = counts[i].load(std::memory_order_relaxed);
+            if (bucketCount != 0) {
+                double middle = (static_cast<double>(lowestValueAt(i)) + static_cast<double>(highestValueAt(i))) / 2.0;
+                variance += static_cast<double>(bucketCount) * (middle - average) * (middle - average);
+            }
+        }
+        variance /= static_cast<double>(n);
+    }
+
+    out << std::setprecision(3)
+        << "#[Mean    = " << std::setw(12) << mean() / unitScale
+        << ", StdDeviation   = " << std::setw(12) << std::sqrt(variance) / unitScale << "]\n"
+        << "#[Max     = " << std::setw(12) << static_cast<double>(max()) / unitScale
+        << ", Total count    = " << std::setw(12) << n << "]\n"
+        << "#[Buckets = " << std::setw(12) << BUCKETS
+        << ", SubBuckets     = " << std::setw(12) << (size_t(1) << SUB_BUCKET_BITS) << "]\n";
+}
@@ -0,0 +1,137 @@
+/**
+ * @file LatencyHistogram.h
+ * @brief Header file for the LatencyHistogram class, a fixed-size log-linear histogram of latencies.
+ * 
+ * This file defines the `LatencyHistogram` class, modelled on HdrHistogram. It records values
+ * (nanoseconds) into buckets whose width grows with the magnitude of the value, so the relative
+ * error is bounded (below 1%) over the whole range from one nanosecond to several hours while the
+ * memory footprint stays fixed.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <atomic>
+
+/**
+ * @class LatencyHistogram
+ * @brief A lock-free, mergeable HdrHistogram-style latency recorder.
+ * 
+ * Values below 2^`SUB_BUCKET_BITS` are counted exactly. Every further power of two is split into
+ * 2^(`SUB_BUCKET_BITS` - 1) equal sub-buckets. All counters are atomics updated with relaxed
+ * increments, so any number of threads may record into the same histogram without locks, and
+ * histograms recorded separately (per thread or per connection) can be merged afterwards.
+ */
+class LatencyHistogram {
+public:
+    /// Number of bits of precision kept for every value
+    static constexpr unsigned SUB_BUCKET_BITS = 7;
+
+    /// Values are tracked up to 2^MAX_VALUE_BITS - 1 nanoseconds (about 4.9 hours); larger ones are clamped
+    static constexpr unsigned MAX_VALUE_BITS = 44;
+
+    /// Number of sub-buckets in the upper half of every power of two
+    static constexpr size_t HALF_SUB_BUCKETS = size_t(1) << (SUB_BUCKET_BITS - 1);
+
+    /// Total number of buckets
+    static constexpr size_t BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 2) * HALF_SUB_BUCKETS;
+
+    /**
+     * @brief Constructs an empty histogram.
+     */
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    /**
+     * @brief Records one value.
+     * 
+     * @param value The value to record, usually a duration in nanoseconds.
+     */
+    void record(uint64_t value);
+
+    /**
+     * @brief Adds all values recorded in another histogram to this one.
+     * 
+     * @param other The histogram to merge in.
+     */
+    void merge(const LatencyHistogram& other);
+
+    /**
+     * @brief Removes all recorded values.
+     */
+    void reset();
+
+    /// Number of recorded values
+    uint64_t count() const;
+
+    /// Smallest recorded value, or 0 if empty
+    uint64_t min() const;
+
+    /// Largest recorded value, or 0 if empty
+    uint64_t max() const;
+
+    /// Arithmetic mean of the recorded values, or 0 if empty
+    double mean() const;
+
+    /**
+     * @brief Returns the value below which the given share of recorded values lies.
+     * 
+     * The result is the highest value equivalent to the bucket containing the percentile, limited
+     * to the largest recorded value, as in HdrHistogram.
+     * 
+     * @param percentile Percentile between 0 and 100.
+     * @return The value at the percentile, or 0 if the histogram is empty.
+     */
+    uint64_t valueAtPercentile(double percentile) const;
+
+    /**
+     * @brief Writes the percentile distribution in the HdrHistogram text format.
+     * 
+     * The output can be loaded into the usual HdrHistogram plotting tools to compare runs.
+     * 
+     * @param out The stream to write to.
+     * @param unitScale Divisor applied to values (1000 prints nanoseconds as microseconds).
+     */
+    void writePercentiles(std::ostream& out, double unitScale = 1000.0) const;
+
+    /**
+     * @brief Returns the bucket index a value is counted in.
+     * 
+     * @param value The value to classify.
+     * @return The bucket index, below `BUCKETS`.
+     */
+    static size_t indexOf(uint64_t value);
+
+    /**
+     * @brief Returns the smallest value counted in a bucket.
+     * 
+     * @param index The bucket index.
+     * @return The lower bound of the bucket.
+     */
+    static uint64_t lowestValueAt(size_t index);
+
+    /**
+     * @brief Returns the largest value counted in a bucket.
+     * 
+     * @param index The bucket index.
+     * @return The upper bound of the bucket.
+     */
+    static uint64_t highestValueAt(size_t index);
+
+private:
+    std::atomic<uint64_t> counts[BUCKETS]; /**< Number of values per bucket. */
+    std::atomic<uint64_t> total;           /**< Number of values recorded. */
+    std::atomic<uint64_t> sum;             /**< Sum of the values recorded, for the mean. */
+    std::atomic<uint64_t> minimum;         /**< Smallest value recorded, UINT64_MAX if empty. */
+    std::atomic<uint64_t> maximum;         /**< Largest value recorded. */
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,103 @@
+/**
+ * @file LoadBalancer.cpp
+ * @brief Implementation of the LoadBalancer class, which routes work across several equivalent servers.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "LoadBalancer.h"
+
+#include <algorithm>
+
+LoadBalancer::LoadBalancer(size_t endpoints) : endpoints(std::max<size_t>(endpoints, 1)) {}
+
+/**
+ * @brief An endpoint without measurements is scored with the mean latency of the measured ones
+ * (or 1 if there are none), so idle unknown servers win over loaded ones and unknown servers are
+ * spread by their load. Ties go to the lower index, the order of the servers on the command line.
+ */
+size_t LoadBalancer::acquire(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    double measured = 0;
+    size_t measuredCount = 0;
+    for (const Endpoint& endpoint : endpoints) {
+        if (endpoint.ewma > 0) {
+            measured += endpoint.ewma;
+            ++measuredCount;
+        }
+    }
+    const double unknown = measuredCount > 0 ? measured / static_cast<double>(measuredCount) : 1;
+
+    size_t best = endpoints.size();
+    double bestScore = 0;
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        const Endpoint& endpoint = endpoints[i];
+        if (endpoint.ejectedUntil > now) {
+            continue;
+        }
+        double score = (endpoint.ewma > 0 ? endpoint.ewma : unknown) * static_cast<double>(endpoint.active + 1);
+        if (best == endpoints.size() || score < bestScore) {
+            best = i;
+            bestScore = score;
+        }
+    }
+    if (best == endpoints.size()) {
+        best = 0;
+        for (size_t i = 1; i < endpoints.size(); ++i) {
+            if (endpoints[i].ejectedUntil < endpoints[best].ejectedUntil) {
+                best = i;
+            }
+        }
+    }
+    ++endpoints[best].active;
+    return best;
+}
+
+void LoadBalancer::record(size_t endpoint, uint64_t latencyNs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Endpoint& state = endpoints[endpoint];
+    const double sample = static_cast<double>(latencyNs);
+    state.ewma = state.ewma == 0 ? sample : state.ewma + ALPHA * (sample - state.ewma);
+}
+
+void LoadBalancer::release(size_t endpoint, bool failed, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Endpoint& state = endpoints[endpoint];
+    --state.active;
+    if (!failed) {
+        state.streak = 0;
+        return;
+    }
+    ++state.failed;
+    ++state.streak;
+    std::chrono::milliseconds ejection = MIN_EJECTION;
+    for (size_t i = 1; i < state.streak && ejection < MAX_EJECTION; ++i) {
+        ejection *= 2;
+    }
+    state.ejectedUntil = now + std::min(ejection, MAX_EJECTION);
+}
+
+size_t LoadBalancer::size() const {
+    return endpoints.size();
+}
+
+double LoadBalancer::latency(size_t endpoint) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return endpoints[endpoint].ewma;
+}
+
+size_t LoadBalancer::inFlight(size_t endpoint) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return endpoints[endpoint].active;
+}
+
+size_t LoadBalancer::failures(size_t endpoint) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return endpoints[endpoint].failed;
+}
+
+bool LoadBalancer::ejected(size_t endpoint, Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return endpoints[endpoint].ejectedUntil > now;
+}
@@ -0,0 +1,142 @@
+/**
+ * @file LoadBalancer.h
+ * @brief Header file for the LoadBalancer class, which routes work across several equivalent servers.
+ * 
+ * This file defines the `LoadBalancer` class. It only keeps the routing state of the endpoints
+ * (observed latency, work in progress, failures); connecting to them is left to the caller, which
+ * keeps one `SessionPool` per endpoint.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef LOAD_BALANCER_H
+#define LOAD_BALANCER_H
+
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <mutex>
+
+/**
+ * @class LoadBalancer
+ * @brief Chooses the endpoint for the next piece of work by observed latency and current load.
+ * 
+ * Every endpoint keeps an exponentially weighted moving average (EWMA) of its per-vector latency
+ * and the number of pieces of work currently running on it. `acquire` picks the endpoint with the
+ * lowest expected wait, the EWMA multiplied by one plus the work in progress, so a slow server
+ * receives work only when the fast ones are busy enough to be worse. An endpoint without
+ * measurements is assumed to be average, so every idle server gets tried early.
+ * 
+ * An endpoint whose work fails is ejected: it receives no work until its ejection ends, and the
+ * ejection time doubles with every consecutive failure up to `MAX_EJECTION`. A success resets it.
+ * When every endpoint is ejected, the one whose ejection ends first is used anyway.
+ * 
+ * All methods are thread-safe.
+ */
+class LoadBalancer {
+public:
+    /// Clock used for ejection deadlines
+    using Clock = std::chrono::steady_clock;
+
+    /// Weight of a new latency sample in the moving average
+    static constexpr double ALPHA = 0.2;
+
+    /// Ejection time after the first failure
+    static constexpr std::chrono::milliseconds MIN_EJECTION{1000};
+
+    /// Longest ejection time
+    static constexpr std::chrono::milliseconds MAX_EJECTION{30000};
+
+    /**
+     * @brief Creates the routing state for a number of endpoints.
+     * 
+     * @param endpoints The number of endpoints; at least one.
+     */
+    explicit LoadBalancer(size_t endpoints);
+
+    /**
+     * @brief Chooses an endpoint and counts a piece of work as running on it.
+     * 
+     * Every call must be matched by a call to `release`.
+     * 
+     * @param now The current time.
+     * @return The index of the chosen endpoint.
+     */
+    size_t acquire(Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Adds a latency sample of an endpoint to its moving average.
+     * 
+     * @param endpoint The endpoint index.
+     * @param latencyNs The latency of one vector in nanoseconds.
+     */
+    void record(size_t endpoint, uint64_t latencyNs);
+
+    /**
+     * @brief Ends a piece of work started with `acquire`.
+     * 
+     * @param endpoint The endpoint index.
+     * @param failed Whether the work failed; the endpoint is then ejected.
+     * @param now The current time.
+     */
+    void release(size_t endpoint, bool failed, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Returns the number of endpoints.
+     * 
+     * @return The number of endpoints.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns the moving average latency of an endpoint.
+     * 
+     * @param endpoint The endpoint index.
+     * @return The average in nanoseconds, 0 before the first sample.
+     */
+    double latency(size_t endpoint) const;
+
+    /**
+     * @brief Returns the number of pieces of work running on an endpoint.
+     * 
+     * @param endpoint The endpoint index.
+     * @return The work in progress.
+     */
+    size_t inFlight(size_t endpoint) const;
+
+    /**
+     * @brief Returns how many pieces of work failed on an endpoint.
+     * 
+     * @param endpoint The endpoint index.
+     * @return The number of failures so far.
+     */
+    size_t failures(size_t endpoint) const;
+
+    /**
+     * @brief Checks whether an endpoint is ejected.
+     * 
+     * @param endpoint The endpoint index.
+     * @param now The current time.
+     * @return `true` if the endpoint receives no work until its ejection ends.
+     */
+    bool ejected(size_t endpoint, Clock::time_point now = Clock::now()) const;
+
+private:
+    /**
+     * @struct Endpoint
+     * @brief Routing state of one endpoint.
+     */
+    struct Endpoint {
+        double ewma = 0;                      /**< Moving average latency in nanoseconds, 0 if unknown. */
+        size_t active = 0;                    /**< Pieces of work in progress. */
+        size_t failed = 0;                    /**< Total number of failures. */
+        size_t streak = 0;                    /**< Consecutive failures. */
+        Clock::time_point ejectedUntil{};     /**< End of the current ejection. */
+    };
+
+    mutable std::mutex mutex;         /**< Guards `endpoints`. */
+    std::vector<Endpoint> endpoints;  /**< State of every endpoint. */
+};
+
+#endif // LOAD_BALANCER_H
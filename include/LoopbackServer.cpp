@@ -0,0 +1,308 @@
+/**
+ * @file LoopbackServer.cpp
+ * @brief Implementation of the LoopbackServer class, a stand-in for the vector server on the local host.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "LoopbackServer.h"
+#include "BatchSizer.h"
+#include "SHA256Library.h"
+#include "ShmRing.h"
+#include "VectorSession.h"
+#include "XorCodec.h"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
+#include <cstring>
+#include <random>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Number of Unix-domain sockets created so far, part of their paths.
+ */
+std::atomic<unsigned> socketsCreated(0);
+
+} // namespace
+
+LoopbackServer::LoopbackServer(Transport transport) : LoopbackServer(transport, false, "") {}
+
+LoopbackServer::LoopbackServer(Transport transport, const std::string& password)
+    : LoopbackServer(transport, true, password) {}
+
+LoopbackServer::LoopbackServer(Transport transport, bool handshake, const std::string& password)
+    : transport(transport), listenFd(-1), clientFd(-1), listenPort(0), handshake(handshake), password(password),
+      stallAfter(0) {
+    if (transport == Transport::Pair) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1) {
+            throw std::runtime_error("Failed to create the loopback socket pair");
+        }
+        listenFd = fds[0];
+        clientFd = fds[1];
+        worker = std::thread(&LoopbackServer::serve, this);
+        return;
+    }
+    if (transport == Transport::Tcp) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        socklen_t length = sizeof(address);
+        if (listenFd == -1 || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 ||
+            getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length) == -1) {
+            throw std::runtime_error("Failed to bind the loopback server");
+        }
+        listenPort = ntohs(address.sin_port);
+    } else {
+        path = "/tmp/loopback-" + std::to_string(getpid()) + "-" + std::to_string(socketsCreated++) + ".sock";
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path, path.c_str());
+        unlink(path.c_str());
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd == -1 || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1) {
+            throw std::runtime_error("Failed to bind the loopback server");
+        }
+    }
+    if (listen(listenFd, 1) == -1) {
+        throw std::runtime_error("Failed to listen on the loopback server");
+    }
+    worker = std::thread(&LoopbackServer::serve, this);
+}
+
+LoopbackServer::~LoopbackServer() {
+    worker.join();
+    if (transport != Transport::Pair) {
+        close(listenFd);
+    }
+    if (!path.empty()) {
+        unlink(path.c_str());
+    }
+}
+
+std::string LoopbackServer::address() const {
+    switch (transport) {
+        case Transport::Tcp: return "127.0.0.1";
+        case Transport::Unix: return "unix:" + path;
+        case Transport::Shm: return "shm:" + path;
+        default: return "";
+    }
+}
+
+/**
+ * @brief Values are summed in order with doubles, so a client adding them the same way gets
+ * exactly the same results. With a handshake, the connection is closed after the announced
+ * vectors, so a client that sends more than it announced sees the server go away.
+ */
+void LoopbackServer::serve() {
+    int fd = transport == Transport::Pair ? listenFd : accept(listenFd, nullptr, nullptr);
+    if (fd == -1) {
+        return;
+    }
+    try {
+        std::unique_ptr<ShmRing> ring;
+        if (transport == Transport::Shm) {
+            ring = std::make_unique<ShmRing>(fd, true);
+        }
+        auto readExactly = [&](void* into, size_t size) {
+            char* out = static_cast<char*>(into);
+            if (ring) {
+                ring->receive(out, size, size);
+                return;
+            }
+            while (size > 0) {
+                ssize_t got = recv(fd, out, size, 0);
+                if (got <= 0) {
+                    throw std::runtime_error("Client disconnected");
+                }
+                out += got;
+                size -= static_cast<size_t>(got);
+            }
+        };
+        auto writeAll = [&](const void* data, size_t size) {
+            if (ring) {
+                iovec part{const_cast<void*>(data), size};
+                ring->send(&part, 1);
+                return true;
+            }
+            return send(fd, data, size, MSG_NOSIGNAL) == static_cast<ssize_t>(size);
+        };
+        if (handshake) {
+            // The login is not checked; it arrives in one piece as the client waits for the salt
+            char login[1024];
+            const ssize_t got = ring ? static_cast<ssize_t>(ring->receive(login, sizeof(login), 1))
+                                     : recv(fd, login, sizeof(login), 0);
+            if (got <= 0) {
+                throw std::runtime_error("Client disconnected");
+            }
+            static const char digits[] = "0123456789ABCDEF";
+            std::random_device random;
+            std::string salt(16, '0');
+            for (char& c : salt) {
+                c = digits[random() % 16];
+            }
+            std::string expected = SHA256Library::hash(salt + password);
+            for (char& c : expected) {
+                c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            }
+            std::string hash(expected.size(), '\0');
+            if (!writeAll(salt.data(), salt.size())) {
+                throw std::runtime_error("Client disconnected");
+            }
+            readExactly(&hash[0], hash.size());
+            const bool accepted = hash == expected;
+            if (!writeAll(accepted ? "OK" : "ER", 2) || !accepted) {
+                throw std::runtime_error("Authentication failed");
+            }
+        }
+        std::vector<double> values(BatchSizer::MAX_BYTES / sizeof(double));
+        std::vector<uint32_t> ends(BatchSizer::MAX_VECTORS);
+        std::vector<double> results(BatchSizer::MAX_VECTORS);
+        std::vector<double> decoded;
+        std::vector<uint8_t> packed;
+        std::vector<uint32_t> positions;
+        bool framed = false;
+        bool compressed = false;
+        bool sparse = false;
+        bool counted = !handshake;
+        uint32_t remaining = 0;
+        uint64_t answered = 0;
+        const uint32_t flags = VectorSession::COMPRESSED | VectorSession::SPARSE;
+        // Reads `count` values into `values`, decoding them when `word` carries the compression or sparse bit
+        auto readValues = [&](uint32_t word) {
+            if (((word & VectorSession::SPARSE) && !sparse) || ((word & VectorSession::COMPRESSED) && !compressed)) {
+                // Like the real server, which would take the flags for part of the size
+                throw std::runtime_error("Payload flag that was not negotiated");
+            }
+            const size_t count = word & ~flags;
+            values.resize(std::max(values.size(), count));
+            if (word & VectorSession::SPARSE) {
+                uint32_t nonzeros;
+                readExactly(&nonzeros, sizeof(nonzeros));
+                positions.resize(nonzeros);
+                decoded.resize(nonzeros);
+                readExactly(positions.data(), nonzeros * sizeof(uint32_t));
+                readExactly(decoded.data(), nonzeros * sizeof(double));
+                std::fill(values.begin(), values.begin() + count, 0.0);
+                for (uint32_t i = 0; i < nonzeros; ++i) {
+                    if (positions[i] >= count) {
+                        throw std::runtime_error("Malformed sparse payload");
+                    }
+                    values[positions[i]] = decoded[i];
+                }
+                return count;
+            }
+            if (!(word & VectorSession::COMPRESSED)) {
+                readExactly(values.data(), count * sizeof(double));
+                return count;
+            }
+            uint32_t packedSize;
+            readExactly(&packedSize, sizeof(packedSize));
+            packed.resize(packedSize);
+            readExactly(packed.data(), packedSize);
+            XorCodec::decode(packed.data(), packedSize, values.data(), count, sizeof(double));
+            return count;
+        };
+        auto sum = [&values](size_t begin, size_t end) {
+            double total = 0;
+            for (size_t i = begin; i < end; ++i) {
+                total += values[i];
+            }
+            return total;
+        };
+        // Leaves the rest unanswered once `stall` says so, reading it until the client disconnects
+        auto stalled = [&]() {
+            const uint32_t after = stallAfter;
+            if (after == 0 || answered < after) {
+                return false;
+            }
+            char discard[4096];
+            while (ring ? ring->receive(discard, sizeof(discard), 1) > 0 : recv(fd, discard, sizeof(discard), 0) > 0) {
+            }
+            return true;
+        };
+        while (true) {
+            uint32_t size;
+            readExactly(&size, sizeof(size));
+            if (!framed && size == VectorSession::BATCH_PROBE) {
+                framed = true;
+                if (!writeAll(&VectorSession::BATCH_ACK, sizeof(VectorSession::BATCH_ACK))) {
+                    break;
+                }
+                continue;
+            }
+            if (!compressed && size == VectorSession::COMPRESSION_PROBE) {
+                compressed = true;
+                if (!writeAll(&VectorSession::COMPRESSION_ACK, sizeof(VectorSession::COMPRESSION_ACK))) {
+                    break;
+                }
+                continue;
+            }
+            if (!sparse && size == VectorSession::SPARSE_PROBE) {
+                sparse = true;
+                if (!writeAll(&VectorSession::SPARSE_ACK, sizeof(VectorSession::SPARSE_ACK))) {
+                    break;
+                }
+                continue;
+            }
+            if (!counted) {
+                // The first word after the probes announces the job
+                counted = true;
+                remaining = size;
+                if (remaining == 0) {
+                    break;
+                }
+                continue;
+            }
+            if (framed) {
+                // `size` is the number of vectors; the total number of values and the end offsets follow
+                if (handshake && size > remaining) {
+                    throw std::runtime_error("Batch frame beyond the announced vectors");
+                }
+                uint32_t total;
+                readExactly(&total, sizeof(total));
+                ends.resize(std::max<size_t>(ends.size(), size));
+                results.resize(std::max<size_t>(results.size(), size));
+                readExactly(ends.data(), size * sizeof(uint32_t));
+                const size_t count = readValues(total);
+                for (uint32_t i = 0; i < size; ++i) {
+                    const size_t begin = i == 0 ? 0 : ends[i - 1];
+                    if (begin > ends[i] || ends[i] > count) {
+                        throw std::runtime_error("Malformed batch frame");
+                    }
+                    results[i] = sum(begin, ends[i]);
+                }
+                if (stalled() || !writeAll(results.data(), size * sizeof(double))) {
+                    break;
+                }
+                answered += size;
+                if (handshake && (remaining -= size) == 0) {
+                    break;
+                }
+                continue;
+            }
+            const double result = sum(0, readValues(size));
+            if (stalled() || !writeAll(&result, sizeof(result))) {
+                break;
+            }
+            ++answered;
+            if (handshake && --remaining == 0) {
+                break;
+            }
+        }
+    } catch (const std::runtime_error&) {
+    }
+    close(fd);
+}
@@ -0,0 +1,133 @@
+/**
+ * @file LoopbackServer.h
+ * @brief Header file for the LoopbackServer class, a stand-in for the vector server on the local host.
+ * 
+ * This file defines the `LoopbackServer` class. The microbenchmarks and the integration tests run
+ * the real `Communicator` and `VectorSession` against it instead of a real server; it is not part
+ * of the client itself.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef LOOPBACK_SERVER_H
+#define LOOPBACK_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+/**
+ * @class LoopbackServer
+ * @brief A stand-in for the vector server on the local host, serving a single connection.
+ * 
+ * It reads vectors (32-bit size and the values) and answers each with the sum of its values as a
+ * double, like the server does after authentication, over TCP loopback, a Unix-domain socket,
+ * shared memory rings handed over on a Unix-domain socket, or a socket pair. It also accepts the
+ * batch frame, compression and sparse probes, then answers whole frames, decodes compressed
+ * payloads and expands sparse ones; a compressed or sparse payload on a connection that has not
+ * sent the matching probe ends the connection.
+ * 
+ * Given a password, it serves a whole job like the real server: the login, salt, hash and `OK`
+ * handshake of `ClientJob::authenticate`, the probes, the vector count, and exactly that many
+ * vectors, after which it closes the connection. Without one, the vectors start right away and
+ * never end, so the microbenchmarks can time the exchange alone.
+ */
+class LoopbackServer {
+public:
+    /**
+     * @brief How the client reaches the server.
+     */
+    enum class Transport {
+        Tcp,  /**< TCP over the loopback interface. */
+        Unix, /**< A Unix-domain stream socket. */
+        Shm,  /**< Shared memory rings set up over a Unix-domain socket. */
+        Pair  /**< A connected Unix-domain socket pair; no address is needed. */
+    };
+
+    /**
+     * @brief Starts listening and serves the first connection on a background thread, without a handshake.
+     * 
+     * @param transport The transport to offer.
+     * @throws std::runtime_error If the listening socket or the socket pair cannot be set up.
+     */
+    explicit LoopbackServer(Transport transport);
+
+    /**
+     * @brief Starts listening and serves one job on the first connection, after authenticating the client.
+     * 
+     * @param transport The transport to offer.
+     * @param password The password the client has to authenticate with.
+     * @throws std::runtime_error If the listening socket or the socket pair cannot be set up.
+     */
+    LoopbackServer(Transport transport, const std::string& password);
+
+    /**
+     * @brief Waits for the client to disconnect and removes the socket.
+     */
+    ~LoopbackServer();
+
+    LoopbackServer(const LoopbackServer&) = delete;
+    LoopbackServer& operator=(const LoopbackServer&) = delete;
+
+    /**
+     * @brief Returns the address to pass to `Communicator`.
+     * 
+     * @return `127.0.0.1`, `unix:<path>` or `shm:<path>`; empty for a socket pair.
+     */
+    std::string address() const;
+
+    /**
+     * @brief Returns the TCP port.
+     * 
+     * @return The port, or 0 for the other transports.
+     */
+    int port() const { return listenPort; }
+
+    /**
+     * @brief Returns the client end of a socket pair, to be passed to `Communicator(int)`.
+     * 
+     * The `Communicator` takes ownership and closes it; the server stops when it does.
+     * 
+     * @return The descriptor, or -1 for the other transports.
+     */
+    int clientSocket() const { return clientFd; }
+
+    /**
+     * @brief Makes the server stop answering after a number of vectors, like a stalled server.
+     * 
+     * The vectors that follow are read and left unanswered until the client disconnects. A frame
+     * is answered as a whole as long as the limit had not been reached before it.
+     * 
+     * @param vectors The number of vectors answered before the stall; 0, the initial value, never stalls.
+     */
+    void stall(uint32_t vectors) { stallAfter = vectors; }
+
+private:
+    /**
+     * @brief Sets up the transport and starts serving.
+     * 
+     * @param transport The transport to offer.
+     * @param handshake Whether the client authenticates and announces its job.
+     * @param password The password of the handshake.
+     */
+    LoopbackServer(Transport transport, bool handshake, const std::string& password);
+
+    /**
+     * @brief Accepts one connection and answers vectors until the client disconnects or the job ends.
+     */
+    void serve();
+
+    Transport transport;  /**< The offered transport. */
+    int listenFd;         /**< The listening socket, or the server end of a socket pair. */
+    int clientFd;         /**< The client end of a socket pair, -1 for the other transports. */
+    int listenPort;       /**< The TCP port, 0 for the other transports. */
+    std::string path;     /**< Path of the Unix-domain socket, empty for TCP and socket pairs. */
+    bool handshake;       /**< Whether the client authenticates and announces its job. */
+    std::string password; /**< The password of the handshake. */
+    std::atomic<uint32_t> stallAfter; /**< Vectors answered before the server stalls, 0 for never. */
+    std::thread worker;   /**< The serving thread. */
+};
+
+#endif // LOOPBACK_SERVER_H
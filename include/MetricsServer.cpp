@@ -0,0 +1,158 @@
+/**
+ * @file MetricsServer.cpp
+ * @brief Implementation of the MetricsServer class, which serves live metrics to Prometheus.
+ * 
+ * The request itself is not parsed: any request on any path receives the metrics page, which is
+ * all Prometheus needs, and the connection is closed after the response.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "MetricsServer.h"
+#include "Stats.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sstream>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+/**
+ * @brief Returns the current monotonic time in nanoseconds.
+ * 
+ * @return Nanoseconds since an arbitrary fixed point.
+ */
+uint64_t monotonicNow() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
+MetricsServer::MetricsServer(const std::string& endpoint)
+    : listenFd(-1), stopping(false), lastScrape(monotonicNow()), lastVectors(Stats::total(Stats::Counter::Vectors)) {
+    if (endpoint.rfind("unix:", 0) == 0) {
+        socketPath = endpoint.substr(5);
+        sockaddr_un address{};
+        if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Invalid metrics socket path: " + socketPath);
+        }
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path, socketPath.c_str());
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd == -1) {
+            throw std::runtime_error("Failed to create metrics socket");
+        }
+        unlink(socketPath.c_str());
+        if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1) {
+            close(listenFd);
+            throw std::runtime_error("Failed to bind metrics socket: " + socketPath);
+        }
+    } else {
+        std::string host = "127.0.0.1";
+        std::string port = endpoint;
+        size_t colon = endpoint.find_last_of(':');
+        if (colon != std::string::npos) {
+            host = endpoint.substr(0, colon);
+            port = endpoint.substr(colon + 1);
+        }
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(std::stoi(port)));
+        if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) <= 0) {
+            throw std::runtime_error("Invalid metrics address: " + host);
+        }
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd == -1) {
+            throw std::runtime_error("Failed to create metrics socket");
+        }
+        int reuse = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1) {
+            close(listenFd);
+            throw std::runtime_error("Failed to bind metrics endpoint: " + endpoint);
+        }
+    }
+
+    if (listen(listenFd, 16) == -1) {
+        close(listenFd);
+        throw std::runtime_error("Failed to listen on metrics endpoint: " + endpoint);
+    }
+    worker = std::thread(&MetricsServer::run, this);
+}
+
+MetricsServer::~MetricsServer() {
+    stopping.store(true);
+    if (worker.joinable()) {
+        worker.join();
+    }
+    close(listenFd);
+    if (!socketPath.empty()) {
+        unlink(socketPath.c_str());
+    }
+}
+
+std::string MetricsServer::render() {
+    std::ostringstream page;
+    Stats::writePrometheus(page);
+
+    uint64_t now = monotonicNow();
+    uint64_t vectors = Stats::total(Stats::Counter::Vectors);
+    double elapsed = static_cast<double>(now - lastScrape) / 1e9;
+    double rate = elapsed > 0 ? static_cast<double>(vectors - lastVectors) / elapsed : 0.0;
+    lastScrape = now;
+    lastVectors = vectors;
+
+    page << "# HELP client_results_per_second Results received per second since the previous scrape.\n"
+         << "# TYPE client_results_per_second gauge\n"
+         << "client_results_per_second " << rate << "\n";
+    return page.str();
+}
+
+/**
+ * @brief Polls the listening socket with a short timeout so that a stop request is noticed
+ * quickly, and answers each accepted connection with the current page.
+ */
+void MetricsServer::run() {
+    while (!stopping.load()) {
+        pollfd descriptor{listenFd, POLLIN, 0};
+        if (poll(&descriptor, 1, 200) <= 0) {
+            continue;
+        }
+        int clientFd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (clientFd == -1) {
+            continue;
+        }
+
+        // Read the request headers, but do not wait long for a client that sends nothing.
+        char request[2048];
+        pollfd incoming{clientFd, POLLIN, 0};
+        if (poll(&incoming, 1, 1000) > 0) {
+            ssize_t received = recv(clientFd, request, sizeof(request), 0);
+            (void)received;
+        }
+
+        std::string body = render();
+        std::string response = "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                               "Connection: close\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t result = send(clientFd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (result <= 0) {
+                break;
+            }
+            sent += static_cast<size_t>(result);
+        }
+        close(clientFd);
+    }
+}
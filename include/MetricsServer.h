@@ -0,0 +1,68 @@
+/**
+ * @file MetricsServer.h
+ * @brief Header file for the MetricsServer class, which serves live metrics to Prometheus.
+ * 
+ * This file defines the `MetricsServer` class. While the client runs, it answers every HTTP
+ * request on a local TCP port or Unix socket with the current counters, gauges and latency
+ * quantiles collected by `Stats`, in the Prometheus text exposition format.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <atomic>
+
+/**
+ * @class MetricsServer
+ * @brief A minimal HTTP server exposing `Stats` in the Prometheus text format.
+ * 
+ * The server runs on its own thread and handles one scrape at a time. It only reads the merged
+ * per-thread counters, so the threads doing the actual work never wait for it. Besides the values
+ * kept by `Stats`, every scrape reports the rate of results per second since the previous scrape.
+ */
+class MetricsServer {
+public:
+    /**
+     * @brief Binds the endpoint and starts serving.
+     * 
+     * @param endpoint A TCP port (bound to 127.0.0.1), `host:port`, or `unix:<path>` for a Unix socket.
+     * @throws std::runtime_error If the endpoint is invalid or cannot be bound.
+     */
+    explicit MetricsServer(const std::string& endpoint);
+
+    /**
+     * @brief Stops serving and closes the endpoint (removing the Unix socket file, if any).
+     */
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    /**
+     * @brief Returns the page served to a scrape.
+     * 
+     * @return The HTTP response body in the Prometheus text exposition format.
+     */
+    std::string render();
+
+private:
+    /**
+     * @brief Body of the serving thread.
+     */
+    void run();
+
+    int listenFd;                /**< The listening socket. */
+    std::string socketPath;      /**< Path of the Unix socket, empty for TCP. */
+    std::atomic<bool> stopping;  /**< Set by the destructor. */
+    uint64_t lastScrape;         /**< Time of the previous scrape in nanoseconds. */
+    uint64_t lastVectors;        /**< Vectors exchanged at the previous scrape. */
+    std::thread worker;          /**< The serving thread. */
+};
+
+#endif // METRICS_SERVER_H
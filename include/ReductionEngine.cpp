@@ -0,0 +1,425 @@
+/**
+ * @file ReductionEngine.cpp
+ * @brief Reduction kernels and runtime CPU dispatch for the ReductionEngine class.
+ * 
+ * This file contains the sequential scalar loop (the reference implementation) and the AVX2 and
+ * AVX-512 kernels. The vector kernels are one template each, instantiated with a small traits
+ * class per element type that wraps the intrinsics of that type; the kernel carries the target
+ * attribute, so the rest of the program is compiled for the baseline instruction set.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "ReductionEngine.h"
+#include "CpuFeatures.h"
+
+#include <stdexcept>
+#include <type_traits>
+#include <limits>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define REDUCTION_X86 1
+#endif
+
+namespace {
+
+/**
+ * @brief The type integers are accumulated in, so that overflow wraps around instead of being undefined.
+ */
+template <typename T>
+struct Accumulator {
+    using Type = T;
+};
+template <>
+struct Accumulator<int32_t> {
+    using Type = uint32_t;
+};
+template <>
+struct Accumulator<int64_t> {
+    using Type = uint64_t;
+};
+
+/**
+ * @brief Adds up values, or their squares, one after another.
+ * 
+ * @param total The sum so far.
+ * @param values The values.
+ * @param count The number of values.
+ * @return The new sum.
+ */
+template <typename T, bool SQUARE>
+typename Accumulator<T>::Type accumulate(typename Accumulator<T>::Type total, const T* values, size_t count) {
+    using Wide = typename Accumulator<T>::Type;
+    for (size_t i = 0; i < count; ++i) {
+        const Wide value = static_cast<Wide>(values[i]);
+        total += SQUARE ? value * value : value;
+    }
+    return total;
+}
+
+/**
+ * @brief The scalar kernel: a sequential loop, as a straightforward server computes it.
+ */
+template <typename T, bool SQUARE>
+T reduceScalar(const T* values, size_t count) {
+    return static_cast<T>(accumulate<T, SQUARE>(0, values, count));
+}
+
+/// Signature of a kernel
+template <typename T>
+using ReduceFn = T (*)(const T* values, size_t count);
+
+#ifdef REDUCTION_X86
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define AVX512_TARGET __attribute__((target("avx512f,avx512dq")))
+
+/// AVX2 lanes of doubles
+struct Avx2Double {
+    using Value = double;
+    using Register = __m256d;
+    static constexpr size_t LANES = 4;
+    static constexpr bool MULTIPLIES = true;
+    AVX2_TARGET static Register zero() { return _mm256_setzero_pd(); }
+    AVX2_TARGET static Register load(const double* p) { return _mm256_loadu_pd(p); }
+    AVX2_TARGET static void store(double* p, Register r) { _mm256_storeu_pd(p, r); }
+    AVX2_TARGET static Register add(Register a, Register b) { return _mm256_add_pd(a, b); }
+    AVX2_TARGET static Register mul(Register a, Register b) { return _mm256_mul_pd(a, b); }
+};
+
+/// AVX2 lanes of floats
+struct Avx2Float {
+    using Value = float;
+    using Register = __m256;
+    static constexpr size_t LANES = 8;
+    static constexpr bool MULTIPLIES = true;
+    AVX2_TARGET static Register zero() { return _mm256_setzero_ps(); }
+    AVX2_TARGET static Register load(const float* p) { return _mm256_loadu_ps(p); }
+    AVX2_TARGET static void store(float* p, Register r) { _mm256_storeu_ps(p, r); }
+    AVX2_TARGET static Register add(Register a, Register b) { return _mm256_add_ps(a, b); }
+    AVX2_TARGET static Register mul(Register a, Register b) { return _mm256_mul_ps(a, b); }
+};
+
+/// AVX2 lanes of 32-bit integers
+struct Avx2Int32 {
+    using Value = int32_t;
+    using Register = __m256i;
+    static constexpr size_t LANES = 8;
+    static constexpr bool MULTIPLIES = true;
+    AVX2_TARGET static Register zero() { return _mm256_setzero_si256(); }
+    AVX2_TARGET static Register load(const int32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    AVX2_TARGET static void store(int32_t* p, Register r) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), r); }
+    AVX2_TARGET static Register add(Register a, Register b) { return _mm256_add_epi32(a, b); }
+    AVX2_TARGET static Register mul(Register a, Register b) { return _mm256_mullo_epi32(a, b); }
+};
+
+/// AVX2 lanes of 64-bit integers; AVX2 has no 64-bit multiplication, so squares use the scalar kernel
+struct Avx2Int64 {
+    using Value = int64_t;
+    using Register = __m256i;
+    static constexpr size_t LANES = 4;
+    static constexpr bool MULTIPLIES = false;
+    AVX2_TARGET static Register zero() { return _mm256_setzero_si256(); }
+    AVX2_TARGET static Register load(const int64_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    AVX2_TARGET static void store(int64_t* p, Register r) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), r); }
+    AVX2_TARGET static Register add(Register a, Register b) { return _mm256_add_epi64(a, b); }
+};
+
+/// AVX-512 lanes of doubles
+struct Avx512Double {
+    using Value = double;
+    using Register = __m512d;
+    static constexpr size_t LANES = 8;
+    static constexpr bool MULTIPLIES = true;
+    AVX512_TARGET static Register zero() { return _mm512_setzero_pd(); }
+    AVX512_TARGET static Register load(const double* p) { return _mm512_loadu_pd(p); }
+    AVX512_TARGET static void store(double* p, Register r) { _mm512_storeu_pd(p, r); }
+    AVX512_TARGET static Register add(Register a, Register b) { return _mm512_add_pd(a, b); }
+    AVX512_TARGET static Register mul(Register a, Register b) { return _mm512_mul_pd(a, b); }
+};
+
+/// AVX-512 lanes of floats
+struct Avx512Float {
+    using Value = float;
+    using Register = __m512;
+    static constexpr size_t LANES = 16;
+    static constexpr bool MULTIPLIES = true;
+    AVX512_TARGET static Register zero() { return _mm512_setzero_ps(); }
+    AVX512_TARGET static Register load(const float* p) { return _mm512_loadu_ps(p); }
+    AVX512_TARGET static void store(float* p, Register r) { _mm512_storeu_ps(p, r); }
+    AVX512_TARGET static Register add(Register a, Register b) { return _mm512_add_ps(a, b); }
+    AVX512_TARGET static Register mul(Register a, Register b) { return _mm512_mul_ps(a, b); }
+};
+
+/// AVX-512 lanes of 32-bit integers
+struct Avx512Int32 {
+    using Value = int32_t;
+    using Register = __m512i;
+    static constexpr size_t LANES = 16;
+    static constexpr bool MULTIPLIES = true;
+    AVX512_TARGET static Register zero() { return _mm512_setzero_si512(); }
+    AVX512_TARGET static Register load(const int32_t* p) { return _mm512_loadu_si512(p); }
+    AVX512_TARGET static void store(int32_t* p, Register r) { _mm512_storeu_si512(p, r); }
+    AVX512_TARGET static Register add(Register a, Register b) { return _mm512_add_epi32(a, b); }
+    AVX512_TARGET static Register mul(Register a, Register b) { return _mm512_mullo_epi32(a, b); }
+};
+
+/// AVX-512 lanes of 64-bit integers
+struct Avx512Int64 {
+    using Value = int64_t;
+    using Register = __m512i;
+    static constexpr size_t LANES = 8;
+    static constexpr bool MULTIPLIES = true;
+    AVX512_TARGET static Register zero() { return _mm512_setzero_si512(); }
+    AVX512_TARGET static Register load(const int64_t* p) { return _mm512_loadu_si512(p); }
+    AVX512_TARGET static void store(int64_t* p, Register r) { _mm512_storeu_si512(p, r); }
+    AVX512_TARGET static Register add(Register a, Register b) { return _mm512_add_epi64(a, b); }
+    AVX512_TARGET static Register mul(Register a, Register b) { return _mm512_mullo_epi64(a, b); }
+};
+
+/**
+ * @brief Adds the lanes of the accumulator and the values left over after the last full register.
+ */
+template <typename T, bool SQUARE>
+T finish(const T* lanes, size_t laneCount, const T* rest, size_t restCount) {
+    using Wide = typename Accumulator<T>::Type;
+    Wide total = 0;
+    for (size_t i = 0; i < laneCount; ++i) {
+        total += static_cast<Wide>(lanes[i]);
+    }
+    return static_cast<T>(accumulate<T, SQUARE>(total, rest, restCount));
+}
+
+/**
+ * @brief The AVX2 kernel: four independent accumulators hide the latency of the additions.
+ */
+template <typename Lanes, bool SQUARE>
+AVX2_TARGET typename Lanes::Value reduceAvx2(const typename Lanes::Value* values, size_t count) {
+    using T = typename Lanes::Value;
+    constexpr size_t L = Lanes::LANES;
+    if constexpr (SQUARE && !Lanes::MULTIPLIES) {
+        return reduceScalar<T, true>(values, count);
+    } else {
+        typename Lanes::Register sums[4] = {Lanes::zero(), Lanes::zero(), Lanes::zero(), Lanes::zero()};
+        size_t i = 0;
+        for (; i + 4 * L <= count; i += 4 * L) {
+            for (size_t k = 0; k < 4; ++k) {
+                typename Lanes::Register v = Lanes::load(values + i + k * L);
+                if constexpr (SQUARE) {
+                    v = Lanes::mul(v, v);
+                }
+                sums[k] = Lanes::add(sums[k], v);
+            }
+        }
+        for (; i + L <= count; i += L) {
+            typename Lanes::Register v = Lanes::load(values + i);
+            if constexpr (SQUARE) {
+                v = Lanes::mul(v, v);
+            }
+            sums[0] = Lanes::add(sums[0], v);
+        }
+        T lanes[L];
+        Lanes::store(lanes, Lanes::add(Lanes::add(sums[0], sums[1]), Lanes::add(sums[2], sums[3])));
+        return finish<T, SQUARE>(lanes, L, values + i, count - i);
+    }
+}
+
+/**
+ * @brief The AVX-512 kernel, the same loop as `reduceAvx2` on registers twice as wide.
+ */
+template <typename Lanes, bool SQUARE>
+AVX512_TARGET typename Lanes::Value reduceAvx512(const typename Lanes::Value* values, size_t count) {
+    using T = typename Lanes::Value;
+    constexpr size_t L = Lanes::LANES;
+    typename Lanes::Register sums[4] = {Lanes::zero(), Lanes::zero(), Lanes::zero(), Lanes::zero()};
+    size_t i = 0;
+    for (; i + 4 * L <= count; i += 4 * L) {
+        for (size_t k = 0; k < 4; ++k) {
+            typename Lanes::Register v = Lanes::load(values + i + k * L);
+            if constexpr (SQUARE) {
+                v = Lanes::mul(v, v);
+            }
+            sums[k] = Lanes::add(sums[k], v);
+        }
+    }
+    for (; i + L <= count; i += L) {
+        typename Lanes::Register v = Lanes::load(values + i);
+        if constexpr (SQUARE) {
+            v = Lanes::mul(v, v);
+        }
+        sums[0] = Lanes::add(sums[0], v);
+    }
+    T lanes[L];
+    Lanes::store(lanes, Lanes::add(Lanes::add(sums[0], sums[1]), Lanes::add(sums[2], sums[3])));
+    return finish<T, SQUARE>(lanes, L, values + i, count - i);
+}
+
+/**
+ * @brief The register traits of every element type.
+ */
+template <typename T>
+struct Registers;
+template <>
+struct Registers<double> {
+    using Avx2 = Avx2Double;
+    using Avx512 = Avx512Double;
+};
+template <>
+struct Registers<float> {
+    using Avx2 = Avx2Float;
+    using Avx512 = Avx512Float;
+};
+template <>
+struct Registers<int32_t> {
+    using Avx2 = Avx2Int32;
+    using Avx512 = Avx512Int32;
+};
+template <>
+struct Registers<int64_t> {
+    using Avx2 = Avx2Int64;
+    using Avx512 = Avx512Int64;
+};
+
+#endif // REDUCTION_X86
+
+/**
+ * @brief Returns the kernel adding up values or their squares.
+ * 
+ * @param kernel The kernel, supported by the CPU.
+ * @param square Whether the squares are added.
+ * @return The kernel function.
+ */
+template <typename T>
+ReduceFn<T> select(ReductionEngine::Kernel kernel, bool square) {
+    switch (kernel) {
+#ifdef REDUCTION_X86
+        case ReductionEngine::Kernel::Avx512:
+            return square ? reduceAvx512<typename Registers<T>::Avx512, true>
+                          : reduceAvx512<typename Registers<T>::Avx512, false>;
+        case ReductionEngine::Kernel::Avx2:
+            return square ? reduceAvx2<typename Registers<T>::Avx2, true>
+                          : reduceAvx2<typename Registers<T>::Avx2, false>;
+#endif
+        default:
+            return square ? reduceScalar<T, true> : reduceScalar<T, false>;
+    }
+}
+
+} // namespace
+
+ReductionEngine::Operation ReductionEngine::parseOperation(const std::string& name) {
+    if (name == "sum") {
+        return Operation::Sum;
+    }
+    if (name == "sumsq") {
+        return Operation::SumOfSquares;
+    }
+    if (name == "mean") {
+        return Operation::Mean;
+    }
+    throw std::runtime_error("Unknown reduction operation: " + name);
+}
+
+bool ReductionEngine::kernelSupported(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Scalar:
+            return true;
+        case Kernel::Avx2:
+            return CpuFeatures::detected().avx2;
+        case Kernel::Avx512:
+            return CpuFeatures::detected().avx512;
+    }
+    return false;
+}
+
+const char* ReductionEngine::kernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Scalar:
+            return "scalar";
+        case Kernel::Avx2:
+            return "avx2";
+        case Kernel::Avx512:
+            return "avx512";
+    }
+    return "unknown";
+}
+
+ReductionEngine::Kernel ReductionEngine::bestKernel() {
+    if (kernelSupported(Kernel::Avx512)) {
+        return Kernel::Avx512;
+    }
+    if (kernelSupported(Kernel::Avx2)) {
+        return Kernel::Avx2;
+    }
+    return Kernel::Scalar;
+}
+
+ReductionEngine::ReductionEngine(Operation operation, Kernel kernel) : operation(operation), kernelInUse(kernel) {
+    if (!kernelSupported(kernel)) {
+        throw std::runtime_error(std::string("Reduction kernel not supported by this CPU: ") + kernelName(kernel));
+    }
+}
+
+template <typename T>
+T ReductionEngine::reduce(const T* values, size_t count) const {
+    const T total = select<T>(kernelInUse, operation == Operation::SumOfSquares)(values, count);
+    if (operation != Operation::Mean) {
+        return total;
+    }
+    return count == 0 ? T(0) : static_cast<T>(total / static_cast<T>(count));
+}
+
+template <typename T>
+void ReductionEngine::reduce(const BasicVectorBatch<T>& batch, T* results) const {
+    const ReduceFn<T> kernelFn = select<T>(kernelInUse, operation == Operation::SumOfSquares);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const typename BasicVectorBatch<T>::View vec = batch[i];
+        const T total = kernelFn(vec.data(), vec.size());
+        if (operation != Operation::Mean) {
+            results[i] = total;
+        } else {
+            results[i] = vec.size() == 0 ? T(0) : static_cast<T>(total / static_cast<T>(vec.size()));
+        }
+    }
+}
+
+/**
+ * @brief Both results carry at most `count` roundoffs of the terms, in whatever order they were
+ * added, hence twice the bound of one of them.
+ */
+template <typename T>
+bool ReductionEngine::agrees(const T* values, size_t count, T local, T remote) const {
+    if constexpr (std::is_integral<T>::value) {
+        return local == remote;
+    } else {
+        if (local == remote || (std::isnan(local) && std::isnan(remote))) {
+            return true;
+        }
+        double scale = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const double value = static_cast<double>(values[i]);
+            scale += operation == Operation::SumOfSquares ? value * value : std::fabs(value);
+        }
+        if (operation == Operation::Mean && count > 0) {
+            scale /= static_cast<double>(count);
+        }
+        const double bound = 2.0 * static_cast<double>(count + 1) * std::numeric_limits<T>::epsilon() * scale;
+        return std::fabs(static_cast<double>(local) - static_cast<double>(remote)) <= bound;
+    }
+}
+
+template float ReductionEngine::reduce(const float*, size_t) const;
+template double ReductionEngine::reduce(const double*, size_t) const;
+template int32_t ReductionEngine::reduce(const int32_t*, size_t) const;
+template int64_t ReductionEngine::reduce(const int64_t*, size_t) const;
+template void ReductionEngine::reduce(const BasicVectorBatch<float>&, float*) const;
+template void ReductionEngine::reduce(const BasicVectorBatch<double>&, double*) const;
+template void ReductionEngine::reduce(const BasicVectorBatch<int32_t>&, int32_t*) const;
+template void ReductionEngine::reduce(const BasicVectorBatch<int64_t>&, int64_t*) const;
+template bool ReductionEngine::agrees(const float*, size_t, float, float) const;
+template bool ReductionEngine::agrees(const double*, size_t, double, double) const;
+template bool ReductionEngine::agrees(const int32_t*, size_t, int32_t, int32_t) const;
+template bool ReductionEngine::agrees(const int64_t*, size_t, int64_t, int64_t) const;
@@ -0,0 +1,145 @@
+/**
+ * @file ReductionEngine.h
+ * @brief Header file for the ReductionEngine class, which computes the server's result locally.
+ * 
+ * This file defines the `ReductionEngine` class. It reduces a vector to one value the way the
+ * server does, so a job can be computed without a network (`--offline`) and a sample of the
+ * server's results can be checked against local ones (`--verify-sample`).
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef REDUCTION_ENGINE_H
+#define REDUCTION_ENGINE_H
+
+#include "VectorBatch.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/**
+ * @class ReductionEngine
+ * @brief Reduces vectors with AVX-512, AVX2 or scalar kernels, chosen through CPUID.
+ * 
+ * The vector kernels keep several accumulators of full register width and add them up at the
+ * end. Integers wrap around on overflow in every kernel, so all kernels agree exactly on them.
+ * Floating-point values are added in a different order than by a sequential loop, so the results
+ * of different kernels, and those of the server, may differ in the last bits; `agrees` accepts
+ * differences within the error bound of the summation.
+ */
+class ReductionEngine {
+public:
+    /**
+     * @brief The per-vector operation of the server.
+     */
+    enum class Operation {
+        Sum,          /**< Sum of the values. */
+        SumOfSquares, /**< Sum of the squared values. */
+        Mean          /**< Sum of the values divided by their number; 0 for an empty vector. */
+    };
+
+    /**
+     * @brief Available reduction kernels.
+     */
+    enum class Kernel {
+        Scalar, /**< Portable sequential loop. */
+        Avx2,   /**< 256-bit AVX2 registers. */
+        Avx512  /**< 512-bit AVX-512F/DQ registers. */
+    };
+
+    /**
+     * @brief Parses the operation given on the command line.
+     * 
+     * @param name `sum`, `sumsq` or `mean`.
+     * @return The operation.
+     * @throws std::runtime_error If the name is unknown.
+     */
+    static Operation parseOperation(const std::string& name);
+
+    /**
+     * @brief Checks whether a kernel can run on the current CPU.
+     * 
+     * @param kernel The kernel to check.
+     * @return `true` if the CPU (and operating system) support the kernel.
+     */
+    static bool kernelSupported(Kernel kernel);
+
+    /**
+     * @brief Returns a short human-readable name of a kernel.
+     * 
+     * @param kernel The kernel to describe.
+     * @return "scalar", "avx2" or "avx512".
+     */
+    static const char* kernelName(Kernel kernel);
+
+    /**
+     * @brief Returns the fastest kernel supported by the current CPU.
+     * 
+     * @return The kernel.
+     */
+    static Kernel bestKernel();
+
+    /**
+     * @brief Creates an engine for one operation.
+     * 
+     * @param operation The operation of the server.
+     * @param kernel The kernel to use.
+     * @throws std::runtime_error If the kernel is not supported by the current CPU.
+     */
+    explicit ReductionEngine(Operation operation, Kernel kernel = bestKernel());
+
+    /**
+     * @brief Returns the kernel in use.
+     * 
+     * @return The kernel.
+     */
+    Kernel kernel() const { return kernelInUse; }
+
+    /**
+     * @brief Reduces one vector.
+     * 
+     * Instantiated for the element types `float`, `double`, `int32_t` and `int64_t`.
+     * 
+     * @tparam T The element type.
+     * @param values The values.
+     * @param count The number of values.
+     * @return The result of the operation.
+     */
+    template <typename T>
+    T reduce(const T* values, size_t count) const;
+
+    /**
+     * @brief Reduces every vector of a batch.
+     * 
+     * @tparam T The element type.
+     * @param batch The vectors.
+     * @param results Receives one result per vector.
+     */
+    template <typename T>
+    void reduce(const BasicVectorBatch<T>& batch, T* results) const;
+
+    /**
+     * @brief Checks whether a result computed elsewhere agrees with the local one.
+     * 
+     * Integers must be equal. Floating-point results may differ by twice the error bound of
+     * recursive summation, `count` units of roundoff times the sum of the absolute terms; equal
+     * infinities and two NaNs agree.
+     * 
+     * @tparam T The element type.
+     * @param values The values of the vector.
+     * @param count The number of values.
+     * @param local The result of `reduce`.
+     * @param remote The result to check.
+     * @return `true` if the results agree.
+     */
+    template <typename T>
+    bool agrees(const T* values, size_t count, T local, T remote) const;
+
+private:
+    Operation operation; /**< The operation. */
+    Kernel kernelInUse;  /**< The kernel. */
+};
+
+#endif // REDUCTION_ENGINE_H
@@ -0,0 +1,290 @@
+/**
+ * @file ResultCache.cpp
+ * @brief Implementation of the ResultCache class, a persistent content-addressed cache of server results.
+ * 
+ * The cache file starts with a 64-byte header followed by a power-of-two array of 32-byte slots.
+ * Every slot stores a key, the raw bits of the result and a last-use stamp taken from a
+ * monotonically increasing clock kept in the header, which drives least-recently-used eviction
+ * inside a key's probe window.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "ResultCache.h"
+#include "SHA256Library.h"
+
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+/// Magic bytes identifying a cache file
+const char CACHE_MAGIC[8] = {'V', 'C', 'A', 'C', 'H', 'E', '0', '1'};
+
+/// Version of the on-disk layout
+constexpr uint32_t CACHE_VERSION = 1;
+
+/// Number of keys `makeKeys` assembles and hashes in one pass
+constexpr size_t KEY_GROUP = 64;
+
+} // namespace
+
+/**
+ * @struct ResultCache::Header
+ * @brief On-disk header of a cache file.
+ */
+struct ResultCache::Header {
+    char magic[8];        /**< `CACHE_MAGIC`. */
+    uint32_t version;     /**< `CACHE_VERSION`. */
+    uint32_t entrySize;   /**< `sizeof(Entry)`, guards against layout changes. */
+    uint64_t capacity;    /**< Number of slots. */
+    uint64_t count;       /**< Number of occupied slots. */
+    uint64_t clock;       /**< Stamp source for least-recently-used eviction. */
+    uint8_t reserved[24]; /**< Padding to 64 bytes. */
+};
+
+/**
+ * @struct ResultCache::Entry
+ * @brief One slot of the on-disk hash table.
+ */
+struct ResultCache::Entry {
+    uint8_t key[KEY_SIZE]; /**< Key of the stored vector. */
+    uint64_t value;        /**< Raw bits of the cached result. */
+    uint32_t stamp;        /**< Low 32 bits of the clock at last use. */
+    uint32_t used;         /**< Non-zero if the slot is occupied. */
+};
+
+static_assert(sizeof(ResultCache::Key) == ResultCache::KEY_SIZE, "unexpected key padding");
+
+/**
+ * @brief Opens (or creates) and maps a cache file.
+ * 
+ * The file is locked exclusively for the lifetime of the object so that two clients never
+ * update the same table concurrently.
+ */
+ResultCache::ResultCache(const std::string& filename, const std::string& serverIdentity, size_t capacity)
+    : fd(-1), mapping(nullptr), mappingSize(0), header(nullptr), entries(nullptr),
+      hitCount(0), missCount(0), evictionCount(0) {
+    static_assert(sizeof(Header) == 64, "cache header must be 64 bytes");
+    static_assert(sizeof(Entry) == 32, "cache entry must be 32 bytes");
+
+    size_t slots = PROBE_WINDOW;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+
+    SHA256Library::Context ctx;
+    SHA256Library::init(ctx);
+    SHA256Library::update(ctx, serverIdentity.data(), serverIdentity.size());
+    SHA256Library::final(ctx, identityDigest);
+
+    fd = open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open cache file: " + filename);
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) == -1) {
+        close(fd);
+        throw std::runtime_error("Cache file is in use by another client: " + filename);
+    }
+
+    mappingSize = sizeof(Header) + slots * sizeof(Entry);
+
+    struct stat info{};
+    fstat(fd, &info);
+    bool reuse = false;
+    Header existing{};
+    if (static_cast<size_t>(info.st_size) >= sizeof(Header) &&
+        pread(fd, &existing, sizeof(existing), 0) == static_cast<ssize_t>(sizeof(existing)) &&
+        std::memcmp(existing.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 && existing.version == CACHE_VERSION &&
+        existing.entrySize == sizeof(Entry)) {
+        reuse = existing.capacity == slots && static_cast<size_t>(info.st_size) == mappingSize;
+        if (!reuse && existing.count > 0) {
+            // The slot of a key depends on the capacity, so the entries cannot be carried over
+            std::cerr << "Warning: cache file " << filename << " was created with capacity " << existing.capacity
+                      << " instead of " << slots << "; " << existing.count << " cached results discarded" << std::endl;
+        }
+    }
+
+    if (!reuse && (ftruncate(fd, 0) == -1 || ftruncate(fd, static_cast<off_t>(mappingSize)) == -1)) {
+        close(fd);
+        throw std::runtime_error("Failed to resize cache file: " + filename);
+    }
+
+    mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Failed to map cache file: " + filename);
+    }
+    header = static_cast<Header*>(mapping);
+    entries = reinterpret_cast<Entry*>(static_cast<char*>(mapping) + sizeof(Header));
+
+    if (!reuse) {
+        std::memcpy(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header->version = CACHE_VERSION;
+        header->entrySize = sizeof(Entry);
+        header->capacity = slots;
+        header->count = 0;
+        header->clock = 1;
+    }
+}
+
+/**
+ * @brief Flushes the mapping to disk, unmaps it and releases the lock.
+ */
+ResultCache::~ResultCache() {
+    if (mapping != nullptr) {
+        msync(mapping, mappingSize, MS_ASYNC);
+        munmap(mapping, mappingSize);
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+}
+
+/**
+ * @brief Hashes the server identity digest, the vector length and the vector bytes.
+ */
+ResultCache::Key ResultCache::makeKey(const void* data, size_t size) const {
+    SHA256Library::Context ctx;
+    SHA256Library::init(ctx);
+    SHA256Library::update(ctx, identityDigest, sizeof(identityDigest));
+    uint64_t length = size;
+    SHA256Library::update(ctx, &length, sizeof(length));
+    SHA256Library::update(ctx, data, size);
+
+    uint8_t digest[SHA256Library::DIGEST_SIZE];
+    SHA256Library::final(ctx, digest);
+
+    Key key;
+    std::memcpy(key.bytes, digest, KEY_SIZE);
+    return key;
+}
+
+/**
+ * @brief `hashMany` takes every message in one piece, so the identity digest and the length that
+ * `makeKey` feeds in before the vector are copied in front of it; a group of vectors is assembled
+ * in one buffer that is reused for the next group.
+ */
+void ResultCache::makeKeys(const void* const data[], const size_t sizes[], size_t count, Key keys[]) const {
+    std::vector<uint8_t> messages;
+    size_t offsets[KEY_GROUP];
+    const void* starts[KEY_GROUP];
+    size_t lengths[KEY_GROUP];
+    uint8_t digests[KEY_GROUP][SHA256Library::DIGEST_SIZE];
+    for (size_t first = 0; first < count; first += KEY_GROUP) {
+        const size_t group = std::min(KEY_GROUP, count - first);
+        messages.clear();
+        for (size_t i = 0; i < group; ++i) {
+            const uint64_t length = sizes[first + i];
+            const uint8_t* bytes = static_cast<const uint8_t*>(data[first + i]);
+            offsets[i] = messages.size();
+            lengths[i] = sizeof(identityDigest) + sizeof(length) + sizes[first + i];
+            messages.insert(messages.end(), identityDigest, identityDigest + sizeof(identityDigest));
+            messages.insert(messages.end(), reinterpret_cast<const uint8_t*>(&length),
+                            reinterpret_cast<const uint8_t*>(&length) + sizeof(length));
+            messages.insert(messages.end(), bytes, bytes + sizes[first + i]);
+        }
+        for (size_t i = 0; i < group; ++i) {
+            starts[i] = messages.data() + offsets[i];
+        }
+        SHA256Library::hashMany(starts, lengths, group, digests);
+        for (size_t i = 0; i < group; ++i) {
+            std::memcpy(keys[first + i].bytes, digests[i], KEY_SIZE);
+        }
+    }
+}
+
+size_t ResultCache::homeSlot(const Key& key) const {
+    uint64_t bits;
+    std::memcpy(&bits, key.bytes, sizeof(bits));
+    return static_cast<size_t>(bits & (header->capacity - 1));
+}
+
+/**
+ * @brief Searches the probe window of the key and refreshes the stamp on a hit.
+ */
+template <typename T>
+bool ResultCache::lookup(const Key& key, T& result) {
+    static_assert(sizeof(T) <= sizeof(Entry::value), "result does not fit into a cache entry");
+    const size_t mask = header->capacity - 1;
+    const size_t home = homeSlot(key);
+    for (size_t i = 0; i < PROBE_WINDOW; ++i) {
+        Entry& entry = entries[(home + i) & mask];
+        if (entry.used && std::memcmp(entry.key, key.bytes, KEY_SIZE) == 0) {
+            entry.stamp = static_cast<uint32_t>(header->clock++);
+            std::memcpy(&result, &entry.value, sizeof(result));
+            ++hitCount;
+            return true;
+        }
+    }
+    ++missCount;
+    return false;
+}
+
+/**
+ * @brief Updates an existing entry, fills a free slot or evicts the least recently used one.
+ * Results narrower than the slot are stored in its low bytes, the rest of the slot is zeroed.
+ */
+template <typename T>
+void ResultCache::insert(const Key& key, T result) {
+    static_assert(sizeof(T) <= sizeof(Entry::value), "result does not fit into a cache entry");
+    const size_t mask = header->capacity - 1;
+    const size_t home = homeSlot(key);
+    const uint32_t now = static_cast<uint32_t>(header->clock++);
+
+    Entry* target = nullptr;
+    Entry* oldest = nullptr;
+    for (size_t i = 0; i < PROBE_WINDOW; ++i) {
+        Entry& entry = entries[(home + i) & mask];
+        if (entry.used && std::memcmp(entry.key, key.bytes, KEY_SIZE) == 0) {
+            target = &entry;
+            break;
+        }
+        if (!entry.used) {
+            if (target == nullptr) {
+                target = &entry;
+            }
+            continue;
+        }
+        if (oldest == nullptr || static_cast<uint32_t>(now - entry.stamp) > static_cast<uint32_t>(now - oldest->stamp)) {
+            oldest = &entry;
+        }
+    }
+
+    if (target == nullptr) {
+        target = oldest;
+        ++evictionCount;
+    } else if (!target->used) {
+        ++header->count;
+    }
+
+    std::memcpy(target->key, key.bytes, KEY_SIZE);
+    target->value = 0;
+    std::memcpy(&target->value, &result, sizeof(result));
+    target->stamp = now;
+    target->used = 1;
+}
+
+template bool ResultCache::lookup(const Key&, float&);
+template bool ResultCache::lookup(const Key&, double&);
+template bool ResultCache::lookup(const Key&, int32_t&);
+template bool ResultCache::lookup(const Key&, int64_t&);
+template void ResultCache::insert(const Key&, float);
+template void ResultCache::insert(const Key&, double);
+template void ResultCache::insert(const Key&, int32_t);
+template void ResultCache::insert(const Key&, int64_t);
+
+uint64_t ResultCache::size() const {
+    return header->count;
+}
+
+uint64_t ResultCache::capacity() const {
+    return header->capacity;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file ResultCache.h
+ * @brief Header file for the ResultCache class, a persistent content-addressed cache of server results.
+ * 
+ * This file defines the `ResultCache` class, which remembers the result the server returned for
+ * a vector so that identical vectors sent again (within one input file or in later runs) can be
+ * answered locally instead of going over the network.
+ * 
+ * The cache is a fixed-size open-addressing hash table stored in a single file and accessed
+ * through `mmap`, so opening a cache costs no parsing and its size on disk is bounded.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+/**
+ * @class ResultCache
+ * @brief A size-bounded, memory-mapped hash table from vector contents to server results.
+ * 
+ * Entries are keyed by the SHA-256 hash of the server identity and the raw vector bytes.
+ * Each key may live in one of a small window of slots after its home slot; when the window
+ * is full, the least recently used entry of the window is evicted. The class keeps hit, miss
+ * and eviction counters for the current run.
+ */
+class ResultCache {
+public:
+    /// Size of a cache key in bytes (a truncated SHA-256 digest)
+    static constexpr size_t KEY_SIZE = 16;
+
+    /// Number of slots probed for every key
+    static constexpr size_t PROBE_WINDOW = 16;
+
+    /**
+     * @struct Key
+     * @brief Content address of one vector for one server.
+     */
+    struct Key {
+        uint8_t bytes[KEY_SIZE]; /**< Truncated SHA-256 digest. */
+
+        /// Compares two keys byte by byte
+        bool operator==(const Key& other) const {
+            return std::memcmp(bytes, other.bytes, KEY_SIZE) == 0;
+        }
+    };
+
+    /**
+     * @struct KeyHash
+     * @brief Hash functor so keys can be used in unordered containers.
+     */
+    struct KeyHash {
+        /// Returns the first machine word of the (already uniformly distributed) key
+        size_t operator()(const Key& key) const {
+            size_t value;
+            std::memcpy(&value, key.bytes, sizeof(value));
+            return value;
+        }
+    };
+
+    /**
+     * @brief Opens (or creates) a cache file.
+     * 
+     * If the file does not exist, is not a cache file or was created with a different capacity,
+     * it is (re)initialised as an empty table; results lost that way are reported on the standard
+     * error stream.
+     * 
+     * @param filename The path to the cache file.
+     * @param serverIdentity A string identifying the server (and its configuration) whose results
+     *                       are stored; entries of different servers never match.
+     * @param capacity Maximum number of entries; rounded up to a power of two of at least
+     *                 `PROBE_WINDOW`, which is the capacity the file then has.
+     * 
+     * @throws std::runtime_error If the file cannot be opened, locked, resized or mapped.
+     */
+    ResultCache(const std::string& filename, const std::string& serverIdentity, size_t capacity);
+
+    /**
+     * @brief Destructor that flushes and unmaps the cache file.
+     */
+    ~ResultCache();
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    /**
+     * @brief Computes the cache key of a vector.
+     * 
+     * @param data Pointer to the raw vector bytes as they are sent to the server.
+     * @param size Number of bytes.
+     * @return The content address of the vector for this cache's server.
+     */
+    Key makeKey(const void* data, size_t size) const;
+
+    /**
+     * @brief Computes the cache keys of many vectors at once.
+     * 
+     * The keys are the ones `makeKey` returns, but the vectors are hashed several at a time with
+     * `SHA256Library::hashMany`, which is considerably faster for the short messages vectors make.
+     * 
+     * @param data Pointers to the raw vector bytes as they are sent to the server.
+     * @param sizes Numbers of bytes of the vectors.
+     * @param count Number of vectors.
+     * @param keys Receives one key per vector.
+     */
+    void makeKeys(const void* const data[], const size_t sizes[], size_t count, Key keys[]) const;
+
+    /**
+     * @brief Looks up a previously stored result.
+     * 
+     * Instantiated for the element types `float`, `double`, `int32_t` and `int64_t`. The type is
+     * not recorded in the entry, so the server identity must name it.
+     * 
+     * @param key The key returned by `makeKey`.
+     * @param result Receives the cached result on a hit.
+     * @return `true` on a hit, `false` on a miss.
+     */
+    template <typename T>
+    bool lookup(const Key& key, T& result);
+
+    /**
+     * @brief Stores (or refreshes) the result for a key, evicting an old entry if necessary.
+     * 
+     * @param key The key returned by `makeKey`.
+     * @param result The result received from the server.
+     */
+    template <typename T>
+    void insert(const Key& key, T result);
+
+    /// Number of successful lookups in this run
+    uint64_t hits() const { return hitCount; }
+
+    /// Number of failed lookups in this run
+    uint64_t misses() const { return missCount; }
+
+    /// Number of entries replaced to make room in this run
+    uint64_t evictions() const { return evictionCount; }
+
+    /// Number of entries currently stored in the file
+    uint64_t size() const;
+
+    /// Maximum number of entries the file can hold
+    uint64_t capacity() const;
+
+private:
+    struct Header;
+    struct Entry;
+
+    int fd;                    /**< Descriptor of the cache file. */
+    void* mapping;             /**< Start of the mapped file. */
+    size_t mappingSize;        /**< Length of the mapping in bytes. */
+    Header* header;            /**< Table header at the start of the mapping. */
+    Entry* entries;            /**< Slot array following the header. */
+    uint8_t identityDigest[32]; /**< SHA-256 of the server identity, mixed into every key. */
+    uint64_t hitCount;         /**< Hits in this run. */
+    uint64_t missCount;        /**< Misses in this run. */
+    uint64_t evictionCount;    /**< Evictions in this run. */
+
+    /**
+     * @brief Returns the first slot probed for a key.
+     * 
+     * @param key The key to place.
+     * @return The home slot index.
+     */
+    size_t homeSlot(const Key& key) const;
+};
+
+#endif // RESULT_CACHE_H
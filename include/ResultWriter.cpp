@@ -0,0 +1,79 @@
+/**
+ * @file ResultWriter.cpp
+ * @brief Implementation of the ResultWriter class, which writes the results received from the server.
+ * 
+ * The count and the results are written with `writev` straight from the caller's vector: the
+ * results are already laid out exactly as the file stores them, so no stream buffer is needed.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "ResultWriter.h"
+#include "Stats.h"
+
+#include <sys/uio.h>
+#include <stdexcept>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstdint>
+#include <cerrno>
+#include <cstdio>
+
+template <typename T>
+void ResultWriter::write(const std::string& outputFile, const std::vector<T>& results) {
+    Stats::Timer timer(Stats::Phase::Write);
+    int fd = open(outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open output file: " + outputFile);
+    }
+
+    uint32_t numResults = results.size();
+    iovec parts[2] = {{&numResults, sizeof(numResults)},
+                      {const_cast<T*>(results.data()), results.size() * sizeof(T)}};
+    iovec* part = parts;
+    int count = 2;
+    while (count > 0) {
+        ssize_t written = writev(fd, part, count);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            throw std::runtime_error("Failed to write output file: " + outputFile);
+        }
+        while (count > 0 && static_cast<size_t>(written) >= part->iov_len) {
+            written -= part->iov_len;
+            ++part;
+            --count;
+        }
+        if (count > 0) {
+            part->iov_base = static_cast<char*>(part->iov_base) + written;
+            part->iov_len -= written;
+        }
+    }
+    if (close(fd) == -1) {
+        throw std::runtime_error("Failed to write output file: " + outputFile);
+    }
+    Stats::add(Stats::Counter::OutputBytes, sizeof(numResults) + results.size() * sizeof(T));
+}
+
+template <typename T>
+void ResultWriter::writeAtomically(const std::string& outputFile, const std::vector<T>& results) {
+    size_t slash = outputFile.find_last_of('/');
+    std::string temporary = outputFile.substr(0, slash + 1) + "." + outputFile.substr(slash + 1) + ".tmp";
+    write(temporary, results);
+    if (std::rename(temporary.c_str(), outputFile.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Failed to move output file into place: " + outputFile);
+    }
+}
+
+template void ResultWriter::write(const std::string&, const std::vector<float>&);
+template void ResultWriter::write(const std::string&, const std::vector<double>&);
+template void ResultWriter::write(const std::string&, const std::vector<int32_t>&);
+template void ResultWriter::write(const std::string&, const std::vector<int64_t>&);
+template void ResultWriter::writeAtomically(const std::string&, const std::vector<float>&);
+template void ResultWriter::writeAtomically(const std::string&, const std::vector<double>&);
+template void ResultWriter::writeAtomically(const std::string&, const std::vector<int32_t>&);
+template void ResultWriter::writeAtomically(const std::string&, const std::vector<int64_t>&);
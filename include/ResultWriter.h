@@ -0,0 +1,52 @@
+/**
+ * @file ResultWriter.h
+ * @brief Header file for the ResultWriter class, which writes the results received from the server.
+ * 
+ * This file defines the `ResultWriter` class. The output file is binary: the number of results as
+ * a 32-bit unsigned integer followed by every result in the element type of the job (a double
+ * unless another type was chosen), in native byte order.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @class ResultWriter
+ * @brief Writes result files, either directly or atomically through a temporary file.
+ * 
+ * Both methods are instantiated for the element types `float`, `double`, `int32_t` and `int64_t`.
+ */
+class ResultWriter {
+public:
+    /**
+     * @brief Writes the results of processing to an output file.
+     * 
+     * The number of results is written first, followed by each result value.
+     * 
+     * @param outputFile The path to the output file.
+     * @param results A vector containing the results to be written to the file.
+     * @throws std::runtime_error If the file cannot be opened or written.
+     */
+    template <typename T>
+    static void write(const std::string& outputFile, const std::vector<T>& results);
+
+    /**
+     * @brief Writes the results under a temporary name and renames the file into place.
+     * 
+     * Readers of the output directory see either no file or the complete file, never a partial one.
+     * 
+     * @param outputFile The final path of the output file.
+     * @param results The results to write.
+     * @throws std::runtime_error If the file cannot be written or renamed.
+     */
+    template <typename T>
+    static void writeAtomically(const std::string& outputFile, const std::vector<T>& results);
+};
+
+#endif // RESULT_WRITER_H
@@ -0,0 +1,555 @@
+/**
+ * @file SHA256Library.cpp
+ * @brief SHA-256 compression kernels and runtime CPU dispatch for the SHA256Library class.
+ * 
+ * This file contains the portable scalar compression loop (the reference implementation),
+ * a single-buffer kernel built on the Intel SHA extensions and SSE2/AVX2 multi-buffer kernels
+ * that hash four or eight independent messages at once. The fastest kernel supported by the
+ * CPU is selected through CPUID the first time a hash is computed.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "SHA256Library.h"
+#include "CpuFeatures.h"
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SHA256_X86 1
+#endif
+
+namespace {
+
+/// Predefined round constants
+alignas(32) constexpr uint32_t k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/// SHA-256 initial hash values
+constexpr uint32_t initialState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/**
+ * @brief Rotates the bits of a 32-bit value to the right.
+ * 
+ * @param value The 32-bit value to be rotated.
+ * @param bits The number of bits to rotate.
+ * @return The value after rotating the bits to the right.
+ */
+inline uint32_t rotateRight(uint32_t value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+/**
+ * @brief Reads a big-endian 32-bit word.
+ * 
+ * @param p Pointer to four bytes.
+ * @return The decoded word.
+ */
+inline uint32_t loadBigEndian(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+/// Signature of a single-buffer compression kernel
+using CompressFn = void (*)(uint32_t h[8], const uint8_t* data, size_t blocks);
+
+/**
+ * @brief Signature of a multi-buffer compression kernel.
+ * 
+ * `state` is transposed: `state[word * 8 + lane]`. Every lane compresses exactly one block.
+ */
+using CompressLanesFn = void (*)(uint32_t state[64], const uint8_t* const blocks[8]);
+
+#ifdef SHA256_X86
+
+/**
+ * @brief Compresses blocks with the Intel SHA extensions.
+ * 
+ * Each loop iteration performs four rounds with two `sha256rnds2` instructions while the
+ * message schedule for later rounds is computed with `sha256msg1`/`sha256msg2`.
+ * 
+ * @param h The eight chaining values to update.
+ * @param data Pointer to the first block.
+ * @param blocks Number of complete blocks at `data`.
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+void compressShaNi(uint32_t h[8], const uint8_t* data, size_t blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&h[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&h[4]));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);              // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);        // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);      // CDGH
+
+    for (size_t block = 0; block < blocks; ++block, data += 64) {
+        __m128i abefSave = state0;
+        __m128i cdghSave = state1;
+        __m128i msg[4];
+
+#pragma GCC unroll 16
+        for (int group = 0; group < 16; ++group) {
+            __m128i& current = msg[group & 3];
+            if (group < 4) {
+                current = _mm_shuffle_epi8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + group * 16)), byteSwap);
+            }
+
+            __m128i rounds = _mm_add_epi32(current, _mm_load_si128(reinterpret_cast<const __m128i*>(&k[group * 4])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, rounds);
+
+            if (group >= 3 && group <= 14) {
+                __m128i& next = msg[(group + 1) & 3];
+                next = _mm_add_epi32(next, _mm_alignr_epi8(current, msg[(group + 3) & 3], 4));
+                next = _mm_sha256msg2_epu32(next, current);
+            }
+
+            rounds = _mm_shuffle_epi32(rounds, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, rounds);
+
+            if (group >= 1 && group <= 12) {
+                __m128i& previous = msg[(group + 3) & 3];
+                previous = _mm_sha256msg1_epu32(previous, current);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);           // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);        // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);     // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);        // ABEF
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&h[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&h[4]), state1);
+}
+
+/// Rotates every 32-bit lane of a 256-bit vector right
+#define SHA256_ROR8(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+
+/**
+ * @brief Compresses one block in each of eight lanes with AVX2.
+ * 
+ * @param state Transposed chaining values, `state[word * 8 + lane]`.
+ * @param blocks One 64-byte block per lane.
+ */
+__attribute__((target("avx2")))
+void compressAvx2x8(uint32_t state[64], const uint8_t* const blocks[8]) {
+    __m256i w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = _mm256_setr_epi32(
+            static_cast<int>(loadBigEndian(blocks[0] + i * 4)), static_cast<int>(loadBigEndian(blocks[1] + i * 4)),
+            static_cast<int>(loadBigEndian(blocks[2] + i * 4)), static_cast<int>(loadBigEndian(blocks[3] + i * 4)),
+            static_cast<int>(loadBigEndian(blocks[4] + i * 4)), static_cast<int>(loadBigEndian(blocks[5] + i * 4)),
+            static_cast<int>(loadBigEndian(blocks[6] + i * 4)), static_cast<int>(loadBigEndian(blocks[7] + i * 4)));
+    }
+    for (int i = 16; i < 64; ++i) {
+        __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(SHA256_ROR8(w[i - 15], 7), SHA256_ROR8(w[i - 15], 18)),
+                                      _mm256_srli_epi32(w[i - 15], 3));
+        __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(SHA256_ROR8(w[i - 2], 17), SHA256_ROR8(w[i - 2], 19)),
+                                      _mm256_srli_epi32(w[i - 2], 10));
+        w[i] = _mm256_add_epi32(_mm256_add_epi32(w[i - 16], s0), _mm256_add_epi32(w[i - 7], s1));
+    }
+
+    __m256i v[8];
+    for (int j = 0; j < 8; ++j) {
+        v[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&state[j * 8]));
+    }
+    __m256i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+
+    for (int i = 0; i < 64; ++i) {
+        __m256i S1 = _mm256_xor_si256(_mm256_xor_si256(SHA256_ROR8(e, 6), SHA256_ROR8(e, 11)), SHA256_ROR8(e, 25));
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i temp1 = _mm256_add_epi32(_mm256_add_epi32(h, S1),
+                                         _mm256_add_epi32(_mm256_add_epi32(ch, _mm256_set1_epi32(static_cast<int>(k[i]))), w[i]));
+        __m256i S0 = _mm256_xor_si256(_mm256_xor_si256(SHA256_ROR8(a, 2), SHA256_ROR8(a, 13)), SHA256_ROR8(a, 22));
+        __m256i maj = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(a, c)),
+                                       _mm256_and_si256(b, c));
+        __m256i temp2 = _mm256_add_epi32(S0, maj);
+
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi32(d, temp1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi32(temp1, temp2);
+    }
+
+    __m256i result[8] = {a, b, c, d, e, f, g, h};
+    for (int j = 0; j < 8; ++j) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&state[j * 8]), _mm256_add_epi32(v[j], result[j]));
+    }
+}
+
+#undef SHA256_ROR8
+
+/// Rotates every 32-bit lane of a 128-bit vector right
+#define SHA256_ROR4(x, n) _mm_or_si128(_mm_srli_epi32((x), (n)), _mm_slli_epi32((x), 32 - (n)))
+
+/**
+ * @brief Compresses one block in each of the first four lanes with SSE2.
+ * 
+ * @param state Transposed chaining values, `state[word * 8 + lane]`; lanes 4-7 are untouched.
+ * @param blocks One 64-byte block per lane (only the first four are read).
+ */
+void compressSse2x4(uint32_t state[64], const uint8_t* const blocks[8]) {
+    __m128i w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = _mm_setr_epi32(
+            static_cast<int>(loadBigEndian(blocks[0] + i * 4)), static_cast<int>(loadBigEndian(blocks[1] + i * 4)),
+            static_cast<int>(loadBigEndian(blocks[2] + i * 4)), static_cast<int>(loadBigEndian(blocks[3] + i * 4)));
+    }
+    for (int i = 16; i < 64; ++i) {
+        __m128i s0 = _mm_xor_si128(_mm_xor_si128(SHA256_ROR4(w[i - 15], 7), SHA256_ROR4(w[i - 15], 18)),
+                                   _mm_srli_epi32(w[i - 15], 3));
+        __m128i s1 = _mm_xor_si128(_mm_xor_si128(SHA256_ROR4(w[i - 2], 17), SHA256_ROR4(w[i - 2], 19)),
+                                   _mm_srli_epi32(w[i - 2], 10));
+        w[i] = _mm_add_epi32(_mm_add_epi32(w[i - 16], s0), _mm_add_epi32(w[i - 7], s1));
+    }
+
+    __m128i v[8];
+    for (int j = 0; j < 8; ++j) {
+        v[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[j * 8]));
+    }
+    __m128i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+
+    for (int i = 0; i < 64; ++i) {
+        __m128i S1 = _mm_xor_si128(_mm_xor_si128(SHA256_ROR4(e, 6), SHA256_ROR4(e, 11)), SHA256_ROR4(e, 25));
+        __m128i ch = _mm_xor_si128(_mm_and_si128(e, f), _mm_andnot_si128(e, g));
+        __m128i temp1 = _mm_add_epi32(_mm_add_epi32(h, S1),
+                                      _mm_add_epi32(_mm_add_epi32(ch, _mm_set1_epi32(static_cast<int>(k[i]))), w[i]));
+        __m128i S0 = _mm_xor_si128(_mm_xor_si128(SHA256_ROR4(a, 2), SHA256_ROR4(a, 13)), SHA256_ROR4(a, 22));
+        __m128i maj = _mm_xor_si128(_mm_xor_si128(_mm_and_si128(a, b), _mm_and_si128(a, c)), _mm_and_si128(b, c));
+        __m128i temp2 = _mm_add_epi32(S0, maj);
+
+        h = g;
+        g = f;
+        f = e;
+        e = _mm_add_epi32(d, temp1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm_add_epi32(temp1, temp2);
+    }
+
+    __m128i result[8] = {a, b, c, d, e, f, g, h};
+    for (int j = 0; j < 8; ++j) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[j * 8]), _mm_add_epi32(v[j], result[j]));
+    }
+}
+
+#undef SHA256_ROR4
+
+#endif // SHA256_X86
+
+/**
+ * @brief Returns the compression function for a single-buffer kernel.
+ * 
+ * @param kernel Either `Scalar` or `ShaNi`.
+ * @return The matching function pointer.
+ */
+CompressFn singleFunction(SHA256Library::Kernel kernel) {
+#ifdef SHA256_X86
+    if (kernel == SHA256Library::Kernel::ShaNi) {
+        return &compressShaNi;
+    }
+#endif
+    (void)kernel;
+    return &SHA256Library::compressScalar;
+}
+
+/**
+ * @brief Returns the lane compression function for a multi-buffer kernel.
+ * 
+ * @param kernel Either `Sse2x4` or `Avx2x8`.
+ * @return The matching function pointer, or `nullptr` for single-buffer kernels.
+ */
+CompressLanesFn lanesFunction(SHA256Library::Kernel kernel) {
+#ifdef SHA256_X86
+    if (kernel == SHA256Library::Kernel::Avx2x8) {
+        return &compressAvx2x8;
+    }
+    if (kernel == SHA256Library::Kernel::Sse2x4) {
+        return &compressSse2x4;
+    }
+#endif
+    (void)kernel;
+    return nullptr;
+}
+
+/**
+ * @struct Dispatch
+ * @brief The kernels currently in use, chosen through CPUID on first access.
+ */
+struct Dispatch {
+    std::atomic<SHA256Library::Kernel> single; /**< Kernel used by `compress`. */
+    std::atomic<SHA256Library::Kernel> multi;  /**< Kernel used by `hashMany`. */
+
+    Dispatch() {
+        single = SHA256Library::kernelSupported(SHA256Library::Kernel::ShaNi)
+                     ? SHA256Library::Kernel::ShaNi : SHA256Library::Kernel::Scalar;
+        if (SHA256Library::kernelSupported(SHA256Library::Kernel::Avx2x8)) {
+            multi = SHA256Library::Kernel::Avx2x8;
+        } else if (SHA256Library::kernelSupported(SHA256Library::Kernel::Sse2x4)) {
+            multi = SHA256Library::Kernel::Sse2x4;
+        } else {
+            multi = SHA256Library::Kernel::Scalar;
+        }
+    }
+};
+
+/**
+ * @brief Returns the process-wide dispatch table.
+ * 
+ * @return The lazily initialised dispatch state.
+ */
+Dispatch& dispatch() {
+    static Dispatch instance;
+    return instance;
+}
+
+} // namespace
+
+bool SHA256Library::kernelSupported(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Scalar:
+            return true;
+        case Kernel::ShaNi:
+            return CpuFeatures::detected().shaNi;
+        case Kernel::Sse2x4:
+            return CpuFeatures::detected().sse2;
+        case Kernel::Avx2x8:
+            return CpuFeatures::detected().avx2;
+    }
+    return false;
+}
+
+const char* SHA256Library::kernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Scalar:
+            return "scalar";
+        case Kernel::ShaNi:
+            return "sha-ni";
+        case Kernel::Sse2x4:
+            return "sse2x4";
+        case Kernel::Avx2x8:
+            return "avx2x8";
+    }
+    return "unknown";
+}
+
+size_t SHA256Library::kernelLanes(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Sse2x4:
+            return 4;
+        case Kernel::Avx2x8:
+            return 8;
+        default:
+            return 1;
+    }
+}
+
+SHA256Library::Kernel SHA256Library::kernel() {
+    return dispatch().single.load(std::memory_order_relaxed);
+}
+
+SHA256Library::Kernel SHA256Library::multiBufferKernel() {
+    return dispatch().multi.load(std::memory_order_relaxed);
+}
+
+void SHA256Library::useKernel(Kernel kernel) {
+    if (!kernelSupported(kernel)) {
+        throw std::runtime_error(std::string("SHA256 kernel not supported by this CPU: ") + kernelName(kernel));
+    }
+    switch (kernel) {
+        case Kernel::Scalar:
+            dispatch().single = Kernel::Scalar;
+            dispatch().multi = Kernel::Scalar;
+            break;
+        case Kernel::ShaNi:
+            dispatch().single = kernel;
+            break;
+        case Kernel::Sse2x4:
+        case Kernel::Avx2x8:
+            dispatch().multi = kernel;
+            break;
+    }
+}
+
+/**
+ * @brief Compresses consecutive 64-byte blocks with the portable scalar loop.
+ * 
+ * This is the original implementation of the class and serves as the reference the
+ * accelerated kernels are verified against.
+ */
+void SHA256Library::compressScalar(uint32_t h[8], const uint8_t* data, size_t blocks) {
+    for (size_t chunk = 0; chunk < blocks; ++chunk, data += BLOCK_SIZE) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = loadBigEndian(data + i * 4);
+        }
+
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+        uint32_t e = h[4], f = h[5], g = h[6], h_var = h[7];
+
+        for (int i = 0; i < 64; ++i) {
+            uint32_t S1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t temp1 = h_var + S1 + ch + k[i] + w[i];
+            uint32_t S0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t temp2 = S0 + maj;
+
+            h_var = g;
+            g = f;
+            f = e;
+            e = d + temp1;
+            d = c;
+            c = b;
+            b = a;
+            a = temp1 + temp2;
+        }
+
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        h[5] += f;
+        h[6] += g;
+        h[7] += h_var;
+    }
+}
+
+void SHA256Library::compress(uint32_t h[8], const uint8_t* data, size_t blocks) {
+    singleFunction(kernel())(h, data, blocks);
+}
+
+/**
+ * @brief Hashes messages in groups of four or eight lanes.
+ * 
+ * Every lane walks through its own message block by block. Whole blocks are read in place;
+ * the final one or two padded blocks of each message are assembled in a small per-lane tail
+ * buffer. Lanes whose message is already finished compress a dummy block, and their digest
+ * is extracted as soon as their last block has been processed.
+ */
+void SHA256Library::hashMany(const void* const data[], const size_t sizes[], size_t count,
+                             uint8_t digests[][DIGEST_SIZE]) {
+    const Kernel multi = multiBufferKernel();
+    const size_t lanes = kernelLanes(multi);
+    const CompressLanesFn compressLanes = lanesFunction(multi);
+
+    if (lanes == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            Context ctx;
+            init(ctx);
+            update(ctx, data[i], sizes[i]);
+            final(ctx, digests[i]);
+        }
+        return;
+    }
+
+    static const uint8_t dummyBlock[BLOCK_SIZE] = {};
+
+    for (size_t first = 0; first < count; first += lanes) {
+        const size_t active = (count - first < lanes) ? count - first : lanes;
+
+        uint32_t state[64];
+        uint8_t tail[8][2 * BLOCK_SIZE];
+        size_t fullBlocks[8] = {};
+        size_t totalBlocks[8] = {};
+        size_t maxBlocks = 0;
+
+        for (size_t lane = 0; lane < 8; ++lane) {
+            for (int j = 0; j < 8; ++j) {
+                state[j * 8 + lane] = initialState[j];
+            }
+            if (lane >= active) {
+                continue;
+            }
+
+            const uint8_t* bytes = static_cast<const uint8_t*>(data[first + lane]);
+            const size_t size = sizes[first + lane];
+            const size_t rest = size % BLOCK_SIZE;
+            fullBlocks[lane] = size / BLOCK_SIZE;
+            const size_t tailBlocks = (rest + 9 > BLOCK_SIZE) ? 2 : 1;
+            totalBlocks[lane] = fullBlocks[lane] + tailBlocks;
+
+            std::memset(tail[lane], 0, sizeof(tail[lane]));
+            if (rest > 0) {
+                std::memcpy(tail[lane], bytes + fullBlocks[lane] * BLOCK_SIZE, rest);
+            }
+            tail[lane][rest] = 0x80;
+            uint64_t bitLength = static_cast<uint64_t>(size) * 8;
+            uint8_t* lengthField = tail[lane] + tailBlocks * BLOCK_SIZE - 8;
+            for (int i = 0; i < 8; ++i) {
+                lengthField[i] = static_cast<uint8_t>(bitLength >> (56 - i * 8));
+            }
+
+            if (totalBlocks[lane] > maxBlocks) {
+                maxBlocks = totalBlocks[lane];
+            }
+        }
+
+        for (size_t step = 0; step < maxBlocks; ++step) {
+            const uint8_t* blocks[8];
+            for (size_t lane = 0; lane < 8; ++lane) {
+                if (lane >= active || step >= totalBlocks[lane]) {
+                    blocks[lane] = dummyBlock;
+                } else if (step < fullBlocks[lane]) {
+                    blocks[lane] = static_cast<const uint8_t*>(data[first + lane]) + step * BLOCK_SIZE;
+                } else {
+                    blocks[lane] = tail[lane] + (step - fullBlocks[lane]) * BLOCK_SIZE;
+                }
+            }
+
+            compressLanes(state, blocks);
+
+            for (size_t lane = 0; lane < active; ++lane) {
+                if (step + 1 != totalBlocks[lane]) {
+                    continue;
+                }
+                uint8_t* digest = digests[first + lane];
+                for (int j = 0; j < 8; ++j) {
+                    uint32_t word = state[j * 8 + lane];
+                    digest[j * 4] = static_cast<uint8_t>(word >> 24);
+                    digest[j * 4 + 1] = static_cast<uint8_t>(word >> 16);
+                    digest[j * 4 + 2] = static_cast<uint8_t>(word >> 8);
+                    digest[j * 4 + 3] = static_cast<uint8_t>(word);
+                }
+            }
+        }
+    }
+}
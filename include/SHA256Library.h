@@ -6,17 +6,25 @@
  * SHA-256 hash of a given input string. The class implements the entire SHA-256 algorithm, 
  * including padding and the iterative computation of the hash.
  * 
+ * Besides the one-shot `hash` method, the class exposes an incremental `init`/`update`/`final`
+ * interface that processes the input in 64-byte blocks directly from the caller's memory,
+ * so arbitrarily large payloads and files can be hashed without any heap allocation.
+ * The block compression itself lives in SHA256Library.cpp and is dispatched at runtime to
+ * SHA-NI, AVX2 or the scalar reference kernel depending on the CPU.
+ * 
  * @author Romanov D.E.
  * @date 2024-12-19
  */
 #ifndef SHA256_LIBRARY_H
 #define SHA256_LIBRARY_H
 
-#include <string>
-#include <vector>
-#include <sstream>
-#include <iomanip>
+#include <stdexcept>
+#include <fstream>
+#include <cstdint>
 #include <cstring>
+#include <cstddef>
+#include <string>
+
 /**
  * @class SHA256Library
  * @brief A class to compute SHA-256 hash for an input string.
@@ -27,126 +35,309 @@
  */
 class SHA256Library {
 public:
+    /// Size of one SHA-256 message block in bytes
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    /// Size of a SHA-256 digest in bytes
+    static constexpr size_t DIGEST_SIZE = 32;
+
+    /// Length of a digest encoded as hexadecimal text
+    static constexpr size_t HEX_SIZE = DIGEST_SIZE * 2;
+
     /**
-     * @brief Computes the SHA-256 hash of a given input string.
+     * @struct Context
+     * @brief Running state of an incremental SHA-256 computation.
      * 
-     * This method applies the SHA-256 algorithm to the input string, including necessary 
-     * padding and iterative calculations, and returns the resulting hash as a hexadecimal string.
+     * The context holds the eight chaining values, the number of bytes hashed so far and
+     * a single partial block. It has a fixed size and can live on the stack.
+     */
+    struct Context {
+        uint32_t state[8];          /**< Current chaining values. */
+        uint64_t length;            /**< Total number of bytes passed to `update`. */
+        uint8_t buffer[BLOCK_SIZE]; /**< Bytes of the current, not yet complete block. */
+        size_t bufferSize;          /**< Number of valid bytes in `buffer`. */
+    };
+
+    /**
+     * @brief Resets a context to the SHA-256 initial hash values.
      * 
-     * @param input The string to be hashed.
-     * @return A string representing the SHA-256 hash of the input, in hexadecimal format.
+     * @param ctx The context to initialise.
      */
-    static std::string hash(const std::string& input) {
-        // Initial hash values
-        uint32_t h[8] = {
+    static void init(Context& ctx) {
+        static constexpr uint32_t initial[8] = {
             0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
             0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
         };
+        std::memcpy(ctx.state, initial, sizeof(initial));
+        ctx.length = 0;
+        ctx.bufferSize = 0;
+    }
 
-        // Predefined round constants
-        uint32_t k[64] = {
-            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
-            0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
-            0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
-            0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
-            0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
-            0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
-            0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
-            0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
-            0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-        };
+    /**
+     * @brief Feeds more input into a running computation.
+     * 
+     * Complete 64-byte blocks are compressed straight from `data`; only the trailing partial
+     * block is copied into the context.
+     * 
+     * @param ctx The context previously prepared with `init`.
+     * @param data Pointer to the bytes to hash.
+     * @param size Number of bytes to hash.
+     */
+    static void update(Context& ctx, const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        ctx.length += size;
 
-        // Padding
-        std::vector<uint8_t> padded;
-        padded.insert(padded.end(), input.begin(), input.end());
-        padded.push_back(0x80);
+        if (ctx.bufferSize > 0) {
+            size_t take = BLOCK_SIZE - ctx.bufferSize;
+            if (take > size) {
+                take = size;
+            }
+            std::memcpy(ctx.buffer + ctx.bufferSize, bytes, take);
+            ctx.bufferSize += take;
+            bytes += take;
+            size -= take;
+            if (ctx.bufferSize < BLOCK_SIZE) {
+                return;
+            }
+            compress(ctx.state, ctx.buffer, 1);
+            ctx.bufferSize = 0;
+        }
 
-        while ((padded.size() + 8) % 64 != 0) {
-            padded.push_back(0);
+        size_t blocks = size / BLOCK_SIZE;
+        if (blocks > 0) {
+            compress(ctx.state, bytes, blocks);
+            bytes += blocks * BLOCK_SIZE;
+            size -= blocks * BLOCK_SIZE;
         }
 
-        uint64_t bitLength = static_cast<uint64_t>(input.size()) * 8;
+        if (size > 0) {
+            std::memcpy(ctx.buffer, bytes, size);
+            ctx.bufferSize = size;
+        }
+    }
+
+    /**
+     * @brief Applies the final padding and writes the digest.
+     * 
+     * After this call the context must be re-initialised before it is used again.
+     * 
+     * @param ctx The context holding the running computation.
+     * @param digest Output buffer receiving the 32-byte big-endian digest.
+     */
+    static void final(Context& ctx, uint8_t digest[DIGEST_SIZE]) {
+        uint64_t bitLength = ctx.length * 8;
+
+        ctx.buffer[ctx.bufferSize++] = 0x80;
+        if (ctx.bufferSize > BLOCK_SIZE - 8) {
+            std::memset(ctx.buffer + ctx.bufferSize, 0, BLOCK_SIZE - ctx.bufferSize);
+            compress(ctx.state, ctx.buffer, 1);
+            ctx.bufferSize = 0;
+        }
+        std::memset(ctx.buffer + ctx.bufferSize, 0, BLOCK_SIZE - 8 - ctx.bufferSize);
         for (int i = 0; i < 8; ++i) {
-            padded.push_back((bitLength >> (56 - i * 8)) & 0xFF);
+            ctx.buffer[BLOCK_SIZE - 8 + i] = static_cast<uint8_t>(bitLength >> (56 - i * 8));
         }
+        compress(ctx.state, ctx.buffer, 1);
+        ctx.bufferSize = 0;
 
-        // Process chunks
-        for (size_t chunk = 0; chunk < padded.size() / 64; ++chunk) {
-            uint32_t w[64] = {0};
-            for (int i = 0; i < 16; ++i) {
-                w[i] = (padded[chunk * 64 + i * 4] << 24) |
-                       (padded[chunk * 64 + i * 4 + 1] << 16) |
-                       (padded[chunk * 64 + i * 4 + 2] << 8) |
-                       (padded[chunk * 64 + i * 4 + 3]);
-            }
+        for (int i = 0; i < 8; ++i) {
+            digest[i * 4] = static_cast<uint8_t>(ctx.state[i] >> 24);
+            digest[i * 4 + 1] = static_cast<uint8_t>(ctx.state[i] >> 16);
+            digest[i * 4 + 2] = static_cast<uint8_t>(ctx.state[i] >> 8);
+            digest[i * 4 + 3] = static_cast<uint8_t>(ctx.state[i]);
+        }
+    }
 
-            for (int i = 16; i < 64; ++i) {
-                uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
-                uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
-                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
-            }
+    /**
+     * @brief Encodes a digest as hexadecimal text without allocating.
+     * 
+     * @param digest The 32-byte digest to encode.
+     * @param out Output buffer receiving exactly `HEX_SIZE` characters (not NUL-terminated).
+     * @param upperCase Whether to use upper-case letters for the digits A-F.
+     */
+    static void toHex(const uint8_t digest[DIGEST_SIZE], char out[HEX_SIZE], bool upperCase = false) {
+        static constexpr char lower[] = "0123456789abcdef";
+        static constexpr char upper[] = "0123456789ABCDEF";
+        const char* table = upperCase ? upper : lower;
+        for (size_t i = 0; i < DIGEST_SIZE; ++i) {
+            out[i * 2] = table[digest[i] >> 4];
+            out[i * 2 + 1] = table[digest[i] & 0x0F];
+        }
+    }
 
-            uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
-            uint32_t e = h[4], f = h[5], g = h[6], h_var = h[7];
-
-            for (int i = 0; i < 64; ++i) {
-                uint32_t S1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
-                uint32_t ch = (e & f) ^ (~e & g);
-                uint32_t temp1 = h_var + S1 + ch + k[i] + w[i];
-                uint32_t S0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
-                uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
-                uint32_t temp2 = S0 + maj;
-
-                h_var = g;
-                g = f;
-                f = e;
-                e = d + temp1;
-                d = c;
-                c = b;
-                b = a;
-                a = temp1 + temp2;
-            }
+    /**
+     * @brief Computes the SHA-256 hash of a given input string.
+     * 
+     * This method applies the SHA-256 algorithm to the input string, including necessary 
+     * padding and iterative calculations, and returns the resulting hash as a hexadecimal string.
+     * 
+     * @param input The string to be hashed.
+     * @return A string representing the SHA-256 hash of the input, in hexadecimal format.
+     */
+    static std::string hash(const std::string& input) {
+        return hash(input.data(), input.size());
+    }
 
-            h[0] += a;
-            h[1] += b;
-            h[2] += c;
-            h[3] += d;
-            h[4] += e;
-            h[5] += f;
-            h[6] += g;
-            h[7] += h_var;
+    /**
+     * @brief Computes the SHA-256 hash of a raw memory region.
+     * 
+     * @param data Pointer to the bytes to hash.
+     * @param size Number of bytes to hash.
+     * @return A string representing the SHA-256 hash of the data, in hexadecimal format.
+     */
+    static std::string hash(const void* data, size_t size) {
+        Context ctx;
+        init(ctx);
+        update(ctx, data, size);
+
+        uint8_t digest[DIGEST_SIZE];
+        final(ctx, digest);
+
+        std::string result(HEX_SIZE, '\0');
+        toHex(digest, result.data());
+        return result;
+    }
+
+    /**
+     * @brief Computes the SHA-256 hash of the contents of a file.
+     * 
+     * The file is streamed through a fixed-size stack buffer, so memory use does not depend
+     * on the file size.
+     * 
+     * @param filename The path to the file to hash.
+     * @return A string representing the SHA-256 hash of the file, in hexadecimal format.
+     * @throws std::runtime_error If the file cannot be opened or read.
+     */
+    static std::string hashFile(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Failed to open file for hashing: " + filename);
         }
 
-        std::ostringstream result;
-        for (int i = 0; i < 8; ++i) {
-            result << std::hex << std::setw(8) << std::setfill('0') << h[i];
+        Context ctx;
+        init(ctx);
+
+        char chunk[64 * 1024];
+        while (file) {
+            file.read(chunk, sizeof(chunk));
+            update(ctx, chunk, static_cast<size_t>(file.gcount()));
+        }
+        if (file.bad()) {
+            throw std::runtime_error("Failed to read file for hashing: " + filename);
         }
 
-        return result.str();
+        uint8_t digest[DIGEST_SIZE];
+        final(ctx, digest);
+
+        std::string result(HEX_SIZE, '\0');
+        toHex(digest, result.data());
+        return result;
     }
 
+    /**
+     * @brief Available SHA-256 compression kernels.
+     * 
+     * `Scalar` is the portable reference implementation. `ShaNi` uses the x86 SHA extensions
+     * for single messages, while `Sse2x4` and `Avx2x8` hash four or eight independent messages
+     * at once, one per SIMD lane.
+     */
+    enum class Kernel {
+        Scalar, /**< Portable C++ reference implementation. */
+        ShaNi,  /**< Intel SHA extensions, one message at a time. */
+        Sse2x4, /**< SSE2 multi-buffer, four messages at a time. */
+        Avx2x8  /**< AVX2 multi-buffer, eight messages at a time. */
+    };
+
+    /**
+     * @brief Checks whether a kernel can run on the current CPU.
+     * 
+     * @param kernel The kernel to check.
+     * @return `true` if the CPU (and operating system) support the kernel.
+     */
+    static bool kernelSupported(Kernel kernel);
+
+    /**
+     * @brief Returns a short human-readable name of a kernel.
+     * 
+     * @param kernel The kernel to describe.
+     * @return A static string such as "sha-ni" or "avx2x8".
+     */
+    static const char* kernelName(Kernel kernel);
+
+    /**
+     * @brief Returns the number of messages a kernel hashes in parallel.
+     * 
+     * @param kernel The kernel to describe.
+     * @return 1 for single-buffer kernels, 4 or 8 for multi-buffer kernels.
+     */
+    static size_t kernelLanes(Kernel kernel);
+
+    /**
+     * @brief Returns the kernel currently used by `update`, `final` and `hash`.
+     * 
+     * On first use the fastest supported single-buffer kernel is selected through CPUID.
+     * 
+     * @return The active single-buffer kernel.
+     */
+    static Kernel kernel();
+
+    /**
+     * @brief Returns the kernel currently used by `hashMany`.
+     * 
+     * @return The active multi-buffer kernel.
+     */
+    static Kernel multiBufferKernel();
+
+    /**
+     * @brief Overrides the automatically selected kernel.
+     * 
+     * Single-buffer kernels replace the kernel used by `hash`, multi-buffer kernels the one
+     * used by `hashMany`, and `Scalar` resets both to the reference implementation. This is
+     * intended for tests and benchmarks.
+     * 
+     * @param kernel The kernel to use from now on.
+     * @throws std::runtime_error If the kernel is not supported by the current CPU.
+     */
+    static void useKernel(Kernel kernel);
+
+    /**
+     * @brief Compresses blocks with the portable reference implementation.
+     * 
+     * This is the original scalar compression loop. It is always available and is used to
+     * cross-check the accelerated kernels.
+     * 
+     * @param h The eight chaining values to update.
+     * @param data Pointer to the first 64-byte block.
+     * @param blocks Number of complete blocks at `data`.
+     */
+    static void compressScalar(uint32_t h[8], const uint8_t* data, size_t blocks);
+
+    /**
+     * @brief Computes the SHA-256 digests of several independent messages.
+     * 
+     * Messages are hashed in groups of four or eight with the active multi-buffer kernel,
+     * which is considerably faster than hashing them one after another when many short or
+     * medium-sized messages are processed together.
+     * 
+     * @param data Pointers to the messages.
+     * @param sizes Sizes of the messages in bytes.
+     * @param count Number of messages.
+     * @param digests Output array receiving one 32-byte digest per message.
+     */
+    static void hashMany(const void* const data[], const size_t sizes[], size_t count,
+                         uint8_t digests[][DIGEST_SIZE]);
+
 private:
     /**
-     * @brief Rotates the bits of a 32-bit value to the right.
+     * @brief Compresses consecutive 64-byte blocks into the chaining state.
      * 
-     * This helper function performs a bitwise rotation of a 32-bit value to the right 
-     * by the specified number of bits.
+     * Dispatches to the active single-buffer kernel.
      * 
-     * @param value The 32-bit value to be rotated.
-     * @param bits The number of bits to rotate.
-     * @return The value after rotating the bits to the right.
+     * @param h The eight chaining values to update.
+     * @param data Pointer to the first block.
+     * @param blocks Number of complete blocks at `data`.
      */
-    static uint32_t rotateRight(uint32_t value, int bits) {
-        return (value >> bits) | (value << (32 - bits));
-    }
+    static void compress(uint32_t h[8], const uint8_t* data, size_t blocks);
 };
 
 #endif // SHA256_LIBRARY_H
-
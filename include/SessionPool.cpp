@@ -0,0 +1,122 @@
+/**
+ * @file SessionPool.cpp
+ * @brief Implementation of the SessionPool class, which keeps authenticated connections ready for use.
+ * 
+ * Connections are opened and authenticated by the background thread outside the lock, so callers
+ * taking sessions never wait for a handshake that is already in progress for somebody else.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "SessionPool.h"
+#include "Trace.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <exception>
+
+SessionPool::SessionPool(const std::string& serverAddress, int serverPort, Authenticator authenticate, size_t size)
+    : serverAddress(serverAddress), serverPort(serverPort), authenticate(std::move(authenticate)),
+      size(std::max<size_t>(size, 1)), recovered(0), setup(0), stopping(false) {
+    worker = std::thread(&SessionPool::run, this);
+}
+
+SessionPool::~SessionPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+/**
+ * @brief Opens sessions while the pool is below its size; after a failure waits for the backoff
+ * delay, which doubles with every consecutive failure up to `MAX_BACKOFF`.
+ */
+void SessionPool::run() {
+    Trace::nameThread("sessions");
+    std::chrono::milliseconds backoff = MIN_BACKOFF;
+    bool failing = false;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (idle.size() >= size) {
+            changed.wait(lock, [this] { return stopping || idle.size() < size; });
+            continue;
+        }
+
+        lock.unlock();
+        std::unique_ptr<Communicator> session;
+        std::string failure;
+        const auto started = std::chrono::steady_clock::now();
+        try {
+            session = std::make_unique<Communicator>(serverAddress, serverPort);
+            {
+                Stats::Timer timer(Stats::Phase::Connect);
+                session->connectToServer();
+            }
+            authenticate(*session);
+        } catch (const std::exception& ex) {
+            session.reset();
+            failure = ex.what();
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - started;
+        lock.lock();
+
+        if (session) {
+            idle.push_back(std::move(session));
+            setup = elapsed;
+            error.clear();
+            if (failing) {
+                ++recovered;
+                Stats::add(Stats::Counter::Reconnects);
+                failing = false;
+            }
+            backoff = MIN_BACKOFF;
+            changed.notify_all();
+        } else {
+            error = failure;
+            failing = true;
+            changed.wait_for(lock, backoff, [this] { return stopping; });
+            backoff = std::min(backoff * 2, MAX_BACKOFF);
+        }
+    }
+}
+
+/**
+ * @brief Hands out the oldest ready session; sessions that died while idle are discarded and
+ * replaced by the background thread.
+ */
+std::unique_ptr<Communicator> SessionPool::acquire(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        if (!changed.wait_until(lock, deadline, [this] { return !idle.empty(); })) {
+            return nullptr;
+        }
+        std::unique_ptr<Communicator> session = std::move(idle.front());
+        idle.pop_front();
+        changed.notify_all();
+        if (session->isAlive()) {
+            return session;
+        }
+    }
+}
+
+std::string SessionPool::lastError() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return error;
+}
+
+size_t SessionPool::reconnects() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return recovered;
+}
+
+std::chrono::nanoseconds SessionPool::setupTime() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return setup;
+}
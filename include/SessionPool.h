@@ -0,0 +1,120 @@
+/**
+ * @file SessionPool.h
+ * @brief Header file for the SessionPool class, which keeps authenticated connections ready for use.
+ * 
+ * This file defines the `SessionPool` class. Connecting and authenticating take several round
+ * trips; a long-running client keeps a few sessions that have already completed both steps, so
+ * a new job can start sending vectors immediately.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef SESSION_POOL_H
+#define SESSION_POOL_H
+
+#include "Communicator.h"
+
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <string>
+#include <deque>
+#include <mutex>
+
+/**
+ * @class SessionPool
+ * @brief A pool of connected and authenticated `Communicator` sessions, refilled in the background.
+ * 
+ * The server accepts one job per connection (the number of vectors is announced up front), so a
+ * session taken from the pool is used for exactly one job and then closed. A background thread
+ * keeps the pool filled up to its size. When the server cannot be reached, for example while it is
+ * restarting, the thread keeps retrying with exponential backoff, and sessions that the server
+ * closed in the meantime are dropped instead of being handed out.
+ */
+class SessionPool {
+public:
+    /**
+     * @brief Function that authenticates a freshly connected session.
+     */
+    using Authenticator = std::function<void(Communicator&)>;
+
+    /// Delay before the first reconnection attempt after a failure
+    static constexpr std::chrono::milliseconds MIN_BACKOFF{100};
+
+    /// Longest delay between reconnection attempts
+    static constexpr std::chrono::milliseconds MAX_BACKOFF{5000};
+
+    /**
+     * @brief Creates the pool and starts filling it.
+     * 
+     * @param serverAddress The address of the server.
+     * @param serverPort The port of the server.
+     * @param authenticate Called on every new connection to authenticate it.
+     * @param size Number of sessions kept ready.
+     */
+    SessionPool(const std::string& serverAddress, int serverPort, Authenticator authenticate, size_t size);
+
+    /**
+     * @brief Stops the background thread and closes all idle sessions.
+     */
+    ~SessionPool();
+
+    SessionPool(const SessionPool&) = delete;
+    SessionPool& operator=(const SessionPool&) = delete;
+
+    /**
+     * @brief Takes a ready session out of the pool.
+     * 
+     * @param timeout How long to wait for a session if none is ready.
+     * @return An authenticated session, or `nullptr` if none became ready in time.
+     */
+    std::unique_ptr<Communicator> acquire(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Returns the error of the last failed connection attempt.
+     * 
+     * @return The error message, or an empty string if the last attempt succeeded.
+     */
+    std::string lastError() const;
+
+    /**
+     * @brief Returns how many times the pool reconnected after the server had been unreachable.
+     * 
+     * @return The number of recovered outages.
+     */
+    size_t reconnects() const;
+
+    /**
+     * @brief Returns how long the last new session took to connect and authenticate.
+     * 
+     * This is how long the pool needs to replace a session taken out of it.
+     * 
+     * @return The time, or 0 before the first session is ready.
+     */
+    std::chrono::nanoseconds setupTime() const;
+
+private:
+    /**
+     * @brief Body of the background thread that keeps the pool filled.
+     */
+    void run();
+
+    std::string serverAddress;  /**< Address of the server. */
+    int serverPort;             /**< Port of the server. */
+    Authenticator authenticate; /**< Authenticates new sessions. */
+    size_t size;                /**< Number of sessions kept ready. */
+
+    mutable std::mutex mutex;                       /**< Guards the fields below. */
+    std::condition_variable changed;                /**< Signals new sessions, demand or shutdown. */
+    std::deque<std::unique_ptr<Communicator>> idle; /**< Ready sessions, oldest first. */
+    std::string error;                              /**< Error of the last failed attempt. */
+    size_t recovered;                               /**< Number of recovered outages. */
+    std::chrono::nanoseconds setup;                 /**< Setup time of the last new session. */
+    bool stopping;                                  /**< Set by the destructor. */
+    std::thread worker;                             /**< The refilling thread. */
+};
+
+#endif // SESSION_POOL_H
@@ -0,0 +1,280 @@
+/**
+ * @file ShmRing.cpp
+ * @brief Implementation of the ShmRing class, a shared-memory transport between processes on one host.
+ * 
+ * Positions are free-running 64-bit byte counters: the producer only advances `tail`, the
+ * consumer only advances `head`, and `tail - head` is the number of unread bytes. Each ring also
+ * has a `sequence` word that is bumped after every change and serves as the futex both sides
+ * sleep on.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "ShmRing.h"
+#include "Stats.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <thread>
+#include <ctime>
+
+/**
+ * @struct ShmRing::Ring
+ * @brief One direction of the connection as laid out in the segment.
+ * 
+ * The producer's and the consumer's fields live on separate cache lines, so the two sides do not
+ * invalidate each other's lines on every update.
+ */
+struct ShmRing::Ring {
+    alignas(64) std::atomic<uint64_t> tail;       /**< Bytes written, advanced by the producer. */
+    alignas(64) std::atomic<uint64_t> head;       /**< Bytes read, advanced by the consumer. */
+    alignas(64) std::atomic<uint32_t> sequence;   /**< Futex word, bumped after every change. */
+    std::atomic<uint32_t> sleepers;               /**< Number of sides sleeping on `sequence`. */
+    std::atomic<uint32_t> closed;                 /**< Set when either side goes away. */
+    alignas(64) char data[CAPACITY];              /**< The ring storage. */
+};
+
+namespace {
+
+/// How long a sleeping side waits before it checks whether the peer is still alive
+constexpr long SLEEP_NS = 50 * 1000 * 1000;
+
+/// Byte sent by the server once it has mapped the segment
+constexpr char READY = 'R';
+
+/**
+ * @brief Returns the address of a ring's futex word as the system call expects it.
+ */
+uint32_t* futexWord(std::atomic<uint32_t>& word) {
+    return reinterpret_cast<uint32_t*>(&word);
+}
+
+} // namespace
+
+/**
+ * @brief The client creates the segment with `memfd_create` and passes it with `SCM_RIGHTS`; the
+ * server answers with one byte once it has mapped it, so no data is written before both sides
+ * share the rings. The first ring carries the client's requests, the second the replies.
+ */
+ShmRing::ShmRing(int socketFd, bool server) : socketFd(socketFd), memory(MAP_FAILED), timeout(0) {
+    const size_t size = 2 * sizeof(Ring);
+    int segmentFd = -1;
+    char byte = READY;
+    iovec part{&byte, 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message{};
+    message.msg_iov = &part;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    if (server) {
+        if (recvmsg(socketFd, &message, MSG_CMSG_CLOEXEC) != 1) {
+            throw std::runtime_error("Failed to receive the shared memory segment");
+        }
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        if (header == nullptr || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) {
+            throw std::runtime_error("Failed to receive the shared memory segment");
+        }
+        std::memcpy(&segmentFd, CMSG_DATA(header), sizeof(int));
+    } else {
+        segmentFd = memfd_create("client-rings", MFD_CLOEXEC);
+        if (segmentFd == -1 || ftruncate(segmentFd, size) == -1) {
+            if (segmentFd != -1) {
+                close(segmentFd);
+            }
+            throw std::runtime_error("Failed to create the shared memory segment");
+        }
+    }
+
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, segmentFd, 0);
+    if (memory == MAP_FAILED) {
+        close(segmentFd);
+        throw std::runtime_error("Failed to map the shared memory segment");
+    }
+    Ring* rings = static_cast<Ring*>(memory);
+    incoming = server ? &rings[0] : &rings[1];
+    outgoing = server ? &rings[1] : &rings[0];
+
+    bool shared;
+    if (server) {
+        shared = ::send(socketFd, &byte, 1, MSG_NOSIGNAL) == 1;
+    } else {
+        // A new memfd is zero-filled, which is the initial state of both rings
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(header), &segmentFd, sizeof(int));
+        shared = sendmsg(socketFd, &message, MSG_NOSIGNAL) == 1 && recv(socketFd, &byte, 1, 0) == 1 && byte == READY;
+    }
+    close(segmentFd);
+    if (!shared) {
+        munmap(memory, size);
+        throw std::runtime_error("The server did not accept the shared memory segment");
+    }
+}
+
+ShmRing::~ShmRing() {
+    for (Ring* ring : {incoming, outgoing}) {
+        ring->closed.store(1);
+        notify(*ring);
+    }
+    munmap(memory, 2 * sizeof(Ring));
+}
+
+void ShmRing::notify(Ring& ring) {
+    ring.sequence.fetch_add(1);
+    if (ring.sleepers.load() > 0) {
+        syscall(SYS_futex, futexWord(ring.sequence), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+}
+
+/**
+ * @brief The sleeper registers before it samples `sequence` and re-checks the condition, and the
+ * notifier bumps `sequence` before it looks for sleepers; with sequentially consistent atomics
+ * either the notifier sees the sleeper or the futex call sees the new sequence, so no wake-up is
+ * lost. Sleeping is bounded so that a peer that crashed without closing the rings is noticed
+ * through its socket, and so that the deadline is kept.
+ */
+template <typename Ready>
+bool ShmRing::wait(Ring& ring, Ready ready, std::chrono::steady_clock::time_point deadline) {
+    for (unsigned spin = 0; spin < SPIN_LIMIT; ++spin) {
+        if (ready()) {
+            return true;
+        }
+        std::this_thread::yield();
+    }
+    while (true) {
+        const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+            return ready();
+        }
+        const timespec timeout{0, std::min<long>(SLEEP_NS, remaining)};
+        ring.sleepers.fetch_add(1);
+        const uint32_t sequence = ring.sequence.load();
+        if (ready()) {
+            ring.sleepers.fetch_sub(1);
+            return true;
+        }
+        if (ring.closed.load()) {
+            ring.sleepers.fetch_sub(1);
+            return false;
+        }
+        long result = syscall(SYS_futex, futexWord(ring.sequence), FUTEX_WAIT, sequence, &timeout, nullptr, 0);
+        ring.sleepers.fetch_sub(1);
+        if (result == -1 && errno == ETIMEDOUT && peerGone()) {
+            return ready();
+        }
+    }
+}
+
+std::chrono::steady_clock::time_point ShmRing::deadline() const {
+    if (timeout.count() == 0) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    return std::chrono::steady_clock::now() + timeout;
+}
+
+void ShmRing::fail(std::chrono::steady_clock::time_point deadline, const char* message) const {
+    if (!peerGone() && std::chrono::steady_clock::now() >= deadline) {
+        Stats::add(Stats::Counter::Timeouts);
+        throw std::runtime_error("Timed out waiting for the server");
+    }
+    throw std::runtime_error(message);
+}
+
+bool ShmRing::peerGone() const {
+    if (incoming->closed.load() || outgoing->closed.load()) {
+        return true;
+    }
+    char byte;
+    return recv(socketFd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0;
+}
+
+void ShmRing::send(const iovec* parts, size_t count) {
+    Ring& ring = *outgoing;
+    if (ring.closed.load()) {
+        throw std::runtime_error("Failed to send data");
+    }
+    const auto until = deadline();
+    uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        const char* data = static_cast<const char*>(parts[i].iov_base);
+        size_t size = parts[i].iov_len;
+        while (size > 0) {
+            size_t space = CAPACITY - (tail - ring.head.load(std::memory_order_acquire));
+            if (space == 0) {
+                if (!wait(ring, [&] { return tail - ring.head.load(std::memory_order_acquire) < CAPACITY; }, until) ||
+                    ring.closed.load()) {
+                    fail(until, "Failed to send data");
+                }
+                continue;
+            }
+            const size_t offset = tail & (CAPACITY - 1);
+            const size_t chunk = std::min({size, space, CAPACITY - offset});
+            std::memcpy(ring.data + offset, data, chunk);
+            data += chunk;
+            size -= chunk;
+            tail += chunk;
+            ring.tail.store(tail, std::memory_order_release);
+            Stats::add(Stats::Counter::BytesSent, chunk);
+            notify(ring);
+        }
+    }
+}
+
+size_t ShmRing::receive(char* buffer, size_t size, size_t minimum) {
+    Ring& ring = *incoming;
+    const auto until = deadline();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    size_t filled = 0;
+    while (filled < size) {
+        const size_t available = ring.tail.load(std::memory_order_acquire) - head;
+        if (available == 0) {
+            if (filled >= minimum) {
+                break;
+            }
+            if (!wait(ring, [&] { return ring.tail.load(std::memory_order_acquire) != head; }, until)) {
+                fail(until, "Failed to receive the expected amount of data");
+            }
+            continue;
+        }
+        const size_t offset = head & (CAPACITY - 1);
+        const size_t chunk = std::min({size - filled, available, CAPACITY - offset});
+        std::memcpy(buffer + filled, ring.data + offset, chunk);
+        filled += chunk;
+        head += chunk;
+        ring.head.store(head, std::memory_order_release);
+        Stats::add(Stats::Counter::BytesReceived, chunk);
+        notify(ring);
+    }
+    return filled;
+}
+
+bool ShmRing::idle() {
+    return !peerGone() &&
+           incoming->tail.load(std::memory_order_acquire) == incoming->head.load(std::memory_order_relaxed);
+}
+
+bool ShmRing::readable(std::chrono::microseconds limit) {
+    Ring& ring = *incoming;
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+    return wait(ring, [&] { return ring.tail.load(std::memory_order_acquire) != head; },
+                std::chrono::steady_clock::now() + limit) || peerGone();
+}
+
+void ShmRing::setTimeout(std::chrono::milliseconds timeout) {
+    this->timeout = timeout;
+}
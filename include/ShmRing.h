@@ -0,0 +1,156 @@
+/**
+ * @file ShmRing.h
+ * @brief Header file for the ShmRing class, a shared-memory transport between processes on one host.
+ * 
+ * This file defines the `ShmRing` class used by `Communicator` for `shm:` addresses. The client
+ * and the server exchange the same byte stream as over a socket, but through two ring buffers in
+ * a shared memory segment, so a vector costs two memory copies instead of a trip through the
+ * network stack.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <sys/uio.h>
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+
+/**
+ * @class ShmRing
+ * @brief A pair of single-producer, single-consumer byte rings shared by a client and a server.
+ * 
+ * The connection starts on a Unix-domain socket: the client creates an anonymous memory segment
+ * and passes its descriptor over the socket, and the server maps it and acknowledges. From then
+ * on data flows only through the segment, one ring per direction; the socket stays open so
+ * either side notices when the other one exits.
+ * 
+ * A reader waiting for data, or a writer waiting for space, first polls the ring for
+ * `SPIN_LIMIT` rounds and then sleeps on a futex in the segment, which the other side wakes only
+ * when somebody is actually sleeping. A request/reply exchange with an idle peer therefore needs
+ * no system call on the fast path.
+ */
+class ShmRing {
+public:
+    /// Capacity of each ring in bytes; a power of two
+    static constexpr size_t CAPACITY = 1 << 18;
+
+    /// Number of polls before a waiting side goes to sleep
+    static constexpr unsigned SPIN_LIMIT = 200;
+
+    /**
+     * @brief Sets up the rings over a connected Unix-domain socket.
+     * 
+     * The client side creates and sends the segment, the server side receives and maps it.
+     * 
+     * @param socketFd The connected socket; it stays owned by the caller.
+     * @param server Whether this is the server side of the connection.
+     * @throws std::runtime_error If the segment cannot be created, passed or mapped.
+     */
+    ShmRing(int socketFd, bool server);
+
+    /**
+     * @brief Marks the connection closed, wakes the peer and unmaps the segment.
+     */
+    ~ShmRing();
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    /**
+     * @brief Writes data to the outgoing ring, waiting for space as needed.
+     * 
+     * @param parts The pieces of the data.
+     * @param count The number of pieces.
+     * @throws std::runtime_error If the peer has closed the connection.
+     */
+    void send(const iovec* parts, size_t count);
+
+    /**
+     * @brief Reads data from the incoming ring.
+     * 
+     * @param buffer Receives the data.
+     * @param size The size of the buffer.
+     * @param minimum The number of bytes to wait for.
+     * @return The number of bytes read, between `minimum` and `size`.
+     * @throws std::runtime_error If the peer closes the connection before `minimum` bytes arrive.
+     */
+    size_t receive(char* buffer, size_t size, size_t minimum);
+
+    /**
+     * @brief Checks without blocking whether the connection is open and has no unread data.
+     * 
+     * @return `true` if the connection is open and idle.
+     */
+    bool idle();
+
+    /**
+     * @brief Waits until the incoming ring holds data, without consuming it.
+     * 
+     * @param limit How long to wait; 0 only checks.
+     * @return `true` if data has arrived or the peer has gone away.
+     */
+    bool readable(std::chrono::microseconds limit);
+
+    /**
+     * @brief Limits how long `send` and `receive` may wait for the peer.
+     * 
+     * @param timeout The limit per call; 0 waits forever.
+     */
+    void setTimeout(std::chrono::milliseconds timeout);
+
+private:
+    struct Ring;
+
+    /**
+     * @brief Waits until `ready` holds for a ring.
+     * 
+     * @param ring The ring whose changes are awaited.
+     * @param ready The condition.
+     * @param deadline The latest time to wait until.
+     * @return `false` if the peer has gone away or the deadline has passed first.
+     */
+    template <typename Ready>
+    bool wait(Ring& ring, Ready ready, std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Returns the deadline of a call starting now.
+     * 
+     * @return The deadline, or the largest time point without a timeout.
+     */
+    std::chrono::steady_clock::time_point deadline() const;
+
+    /**
+     * @brief Throws the error of a wait that did not succeed.
+     * 
+     * @param deadline The deadline of the wait.
+     * @param message The error reported when the peer has gone away.
+     * @throws std::runtime_error Always.
+     */
+    [[noreturn]] void fail(std::chrono::steady_clock::time_point deadline, const char* message) const;
+
+    /**
+     * @brief Publishes a change of a ring and wakes the peer if it sleeps on it.
+     * 
+     * @param ring The changed ring.
+     */
+    void notify(Ring& ring);
+
+    /**
+     * @brief Checks whether the peer has closed the rings or its socket.
+     * 
+     * @return `true` if the peer is gone.
+     */
+    bool peerGone() const;
+
+    int socketFd;      /**< The Unix-domain socket of the connection. */
+    void* memory;      /**< The mapped segment. */
+    Ring* incoming;    /**< The ring this side reads. */
+    Ring* outgoing;    /**< The ring this side writes. */
+    std::chrono::milliseconds timeout; /**< Limit of every call, 0 for none. */
+};
+
+#endif // SHM_RING_H
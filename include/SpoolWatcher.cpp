@@ -0,0 +1,110 @@
+/**
+ * @file SpoolWatcher.cpp
+ * @brief Implementation of the SpoolWatcher class, which reports input files arriving in a directory.
+ * 
+ * The watch is registered before the directory is listed, so a file created between the two steps
+ * is seen at least once; duplicates are filtered out by the set of pending names.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "SpoolWatcher.h"
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <poll.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <cerrno>
+
+SpoolWatcher::SpoolWatcher(const std::string& directory) : directory(directory), inotifyFd(-1) {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd == -1) {
+        throw std::runtime_error("Failed to initialize inotify");
+    }
+    if (inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR) == -1) {
+        close(inotifyFd);
+        throw std::runtime_error("Failed to watch spool directory: " + directory);
+    }
+
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr) {
+        close(inotifyFd);
+        throw std::runtime_error("Failed to list spool directory: " + directory);
+    }
+    std::vector<std::string> existing;
+    while (dirent* entry = readdir(dir)) {
+        struct stat info;
+        std::string path = directory + "/" + entry->d_name;
+        if (stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+            existing.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+
+    std::sort(existing.begin(), existing.end());
+    for (const auto& name : existing) {
+        enqueue(name);
+    }
+}
+
+SpoolWatcher::~SpoolWatcher() {
+    if (inotifyFd != -1) {
+        close(inotifyFd);
+    }
+}
+
+void SpoolWatcher::enqueue(const std::string& name) {
+    if (name.empty() || name[0] == '.') {
+        return;
+    }
+    if (pending.insert(name).second) {
+        ready.push_back(name);
+    }
+}
+
+/**
+ * @brief Drains all queued inotify events before reporting the oldest ready file.
+ */
+bool SpoolWatcher::next(std::string& name, int timeoutMs) {
+    if (ready.empty()) {
+        pollfd descriptor{inotifyFd, POLLIN, 0};
+        int result = poll(&descriptor, 1, timeoutMs);
+        if (result == -1 && errno != EINTR) {
+            throw std::runtime_error("Failed to wait for spool directory events");
+        }
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        if (length == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                break;
+            }
+            throw std::runtime_error("Failed to read spool directory events");
+        }
+        for (char* position = buffer; position < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(position);
+            if (event->len > 0 && !(event->mask & IN_ISDIR)) {
+                enqueue(event->name);
+            }
+            position += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    if (ready.empty()) {
+        return false;
+    }
+    name = ready.front();
+    ready.pop_front();
+    return true;
+}
+
+void SpoolWatcher::done(const std::string& name) {
+    pending.erase(name);
+}
@@ -0,0 +1,80 @@
+/**
+ * @file SpoolWatcher.h
+ * @brief Header file for the SpoolWatcher class, which reports input files arriving in a directory.
+ * 
+ * This file defines the `SpoolWatcher` class used by the daemon mode. Producers drop input files
+ * into a spool directory; the watcher reports every complete file exactly once, in arrival order.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef SPOOL_WATCHER_H
+#define SPOOL_WATCHER_H
+
+#include <string>
+#include <deque>
+#include <set>
+
+/**
+ * @class SpoolWatcher
+ * @brief Watches a spool directory with inotify.
+ * 
+ * A file is reported once it has been closed after writing or moved into the directory, so
+ * producers may either write files in place or write them elsewhere (or under a hidden name) and
+ * rename them in. Hidden files (names starting with a dot) and subdirectories are ignored. Files
+ * already present when the watcher starts are reported first, in name order.
+ */
+class SpoolWatcher {
+public:
+    /**
+     * @brief Starts watching a directory.
+     * 
+     * @param directory The spool directory.
+     * @throws std::runtime_error If the directory cannot be watched or listed.
+     */
+    explicit SpoolWatcher(const std::string& directory);
+
+    /**
+     * @brief Stops watching and releases the inotify descriptor.
+     */
+    ~SpoolWatcher();
+
+    SpoolWatcher(const SpoolWatcher&) = delete;
+    SpoolWatcher& operator=(const SpoolWatcher&) = delete;
+
+    /**
+     * @brief Waits for the next file.
+     * 
+     * Returns early (with `false`) when the wait is interrupted by a signal, so callers can check
+     * for a shutdown request.
+     * 
+     * @param name Receives the file name, relative to the spool directory.
+     * @param timeoutMs How long to wait, in milliseconds.
+     * @return `true` if a file is ready, `false` on timeout or interruption.
+     * @throws std::runtime_error If reading the events fails.
+     */
+    bool next(std::string& name, int timeoutMs);
+
+    /**
+     * @brief Marks a file as handled, so that it is reported again if it reappears later.
+     * 
+     * @param name The file name returned by `next`.
+     */
+    void done(const std::string& name);
+
+private:
+    /**
+     * @brief Queues a file unless it is hidden or already queued.
+     * 
+     * @param name The file name.
+     */
+    void enqueue(const std::string& name);
+
+    std::string directory;       /**< The watched directory. */
+    int inotifyFd;               /**< The inotify instance. */
+    std::deque<std::string> ready; /**< Files waiting to be reported. */
+    std::set<std::string> pending; /**< Files reported or queued and not yet done. */
+};
+
+#endif // SPOOL_WATCHER_H
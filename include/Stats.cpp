@@ -0,0 +1,409 @@
+/**
+ * @file Stats.cpp
+ * @brief Implementation of the Stats class, which collects per-phase timings and counters of a run.
+ * 
+ * Each thread lazily registers a private block of counters the first time it records something.
+ * The blocks are owned by a global registry and outlive their threads, so values recorded by
+ * worker threads that have already finished are still included in the report.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "Stats.h"
+#include "LatencyHistogram.h"
+#include "Trace.h"
+
+#include <stdexcept>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <mutex>
+
+namespace {
+
+/// Names of the phases as they appear in the report
+const char* const PHASE_NAMES[] = {
+    "total", "config", "connect", "auth", "count", "parse", "dedup", "cache", "send", "wait", "compress", "reduce", "write"
+};
+
+/// Names of the counters as they appear in the report
+const char* const COUNTER_NAMES[] = {
+    "bytes_sent", "bytes_received", "send_calls", "recv_calls",
+    "input_bytes", "output_bytes", "file_reads", "vectors", "reconnects", "auth_failures",
+    "timeouts", "hedges", "hedge_wins", "compress_input_bytes", "compress_output_bytes",
+    "duplicates", "sparse_input_bytes", "sparse_output_bytes", "fast_opens"
+};
+
+/// Descriptions of the counters for the Prometheus exposition
+const char* const COUNTER_HELP[] = {
+    "Bytes passed to the socket.", "Bytes read from the socket.", "Number of send system calls.",
+    "Number of receive system calls.", "Bytes read from the input file.", "Bytes written to the output file.",
+    "Number of read operations on the input file.", "Vectors exchanged with the server.",
+    "Connections re-established after the server was unreachable.", "Authentication attempts rejected by the server.",
+    "Sends or receives abandoned after the operation timeout.", "Vectors sent a second time on a spare connection.",
+    "Hedged vectors answered first on the spare connection.", "Payload bytes passed to the compressor.",
+    "Bytes sent for those payloads, compressed or not.", "Vectors not sent because an equal vector of the same input was.",
+    "Dense bytes of the payloads sent as index/value pairs.", "Bytes sent for those payloads.",
+    "Connections whose first data the server accepted inside the SYN."
+};
+
+/// Names of the gauges as they appear in the Prometheus exposition
+const char* const GAUGE_NAMES[] = {
+    "in_flight"
+};
+
+/// Descriptions of the gauges for the Prometheus exposition
+const char* const GAUGE_HELP[] = {
+    "Vectors sent whose result has not been received yet."
+};
+
+static_assert(sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0]) == static_cast<size_t>(Stats::Phase::COUNT),
+              "every phase needs a name");
+static_assert(sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]) == static_cast<size_t>(Stats::Counter::COUNT),
+              "every counter needs a name");
+static_assert(sizeof(COUNTER_HELP) / sizeof(COUNTER_HELP[0]) == static_cast<size_t>(Stats::Counter::COUNT),
+              "every counter needs a description");
+static_assert(sizeof(GAUGE_NAMES) / sizeof(GAUGE_NAMES[0]) == static_cast<size_t>(Stats::Gauge::COUNT),
+              "every gauge needs a name");
+static_assert(sizeof(GAUGE_HELP) / sizeof(GAUGE_HELP[0]) == static_cast<size_t>(Stats::Gauge::COUNT),
+              "every gauge needs a description");
+
+/**
+ * @struct ThreadState
+ * @brief Counters owned by one thread.
+ * 
+ * Only the owning thread writes the atomics (with relaxed load/store pairs, which compile to
+ * plain memory accesses); other threads only read them when merging.
+ */
+struct ThreadState {
+    std::atomic<uint64_t> phaseTime[static_cast<size_t>(Stats::Phase::COUNT)] = {};  /**< Nanoseconds per phase. */
+    std::atomic<uint64_t> phaseCalls[static_cast<size_t>(Stats::Phase::COUNT)] = {}; /**< Measurements per phase. */
+    std::atomic<uint64_t> counters[static_cast<size_t>(Stats::Counter::COUNT)] = {}; /**< Counter values. */
+    std::atomic<int64_t> gauges[static_cast<size_t>(Stats::Gauge::COUNT)] = {};      /**< Gauge contributions. */
+    LatencyHistogram latency;        /**< Per-vector round trips in nanoseconds. */
+};
+
+/**
+ * @brief Adds to an atomic that only the calling thread writes.
+ * 
+ * @tparam T The integer type of the atomic.
+ * @param value The atomic to update.
+ * @param delta The amount to add.
+ */
+template <typename T>
+inline void bump(std::atomic<T>& value, T delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+/**
+ * @struct Registry
+ * @brief Owner of all per-thread counter blocks.
+ */
+struct Registry {
+    std::mutex mutex;                                  /**< Guards `threads`. */
+    std::vector<std::unique_ptr<ThreadState>> threads; /**< Blocks of every thread that recorded. */
+    std::vector<std::pair<std::string, std::unique_ptr<LatencyHistogram>>> connections; /**< Per-connection round trips. */
+};
+
+/**
+ * @brief Returns the process-wide registry.
+ * 
+ * @return The registry, created on first use and never destroyed.
+ */
+Registry& registry() {
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+/**
+ * @brief Returns the calling thread's counter block, registering it on first use.
+ * 
+ * @return The thread's block.
+ */
+ThreadState& local() {
+    thread_local ThreadState* state = nullptr;
+    if (state == nullptr) {
+        auto owned = std::make_unique<ThreadState>();
+        state = owned.get();
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        registry().threads.push_back(std::move(owned));
+    }
+    return *state;
+}
+
+/**
+ * @brief Writes the summary of a latency histogram as a JSON object.
+ * 
+ * @param out The stream to write to.
+ * @param latency The histogram to summarize.
+ * @param indent Indentation of the enclosing object.
+ */
+void writeLatencyJson(std::ostream& out, const LatencyHistogram& latency, const std::string& indent) {
+    out << "{\n"
+        << indent << "  \"count\": " << latency.count() << ",\n"
+        << indent << "  \"min\": " << latency.min() << ",\n"
+        << indent << "  \"mean\": " << static_cast<uint64_t>(latency.mean()) << ",\n"
+        << indent << "  \"p50\": " << latency.valueAtPercentile(50) << ",\n"
+        << indent << "  \"p90\": " << latency.valueAtPercentile(90) << ",\n"
+        << indent << "  \"p99\": " << latency.valueAtPercentile(99) << ",\n"
+        << indent << "  \"p99.9\": " << latency.valueAtPercentile(99.9) << ",\n"
+        << indent << "  \"p99.99\": " << latency.valueAtPercentile(99.99) << ",\n"
+        << indent << "  \"max\": " << latency.max() << "\n"
+        << indent << "}";
+}
+
+} // namespace
+
+std::atomic<bool> Stats::active(false);
+
+Stats::Timer::Timer(Phase phase) : phase(phase), active(Stats::enabled() || Trace::enabled()) {
+    if (active) {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+Stats::Timer::~Timer() {
+    if (active) {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        Stats::addTime(phase, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+}
+
+void Stats::enable() {
+    active.store(true, std::memory_order_relaxed);
+}
+
+uint64_t Stats::now() {
+    if (!enabled() && !Trace::enabled()) {
+        return 0;
+    }
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @brief Adds the duration to the phase totals and, when tracing, records it as a span that ends now.
+ */
+void Stats::addTime(Phase phase, uint64_t nanoseconds) {
+    if (enabled()) {
+        ThreadState& state = local();
+        bump(state.phaseTime[static_cast<size_t>(phase)], nanoseconds);
+        bump<uint64_t>(state.phaseCalls[static_cast<size_t>(phase)], 1);
+    }
+    if (Trace::enabled()) {
+        Trace::span(PHASE_NAMES[static_cast<size_t>(phase)], now() - nanoseconds, nanoseconds);
+    }
+}
+
+void Stats::add(Counter counter, uint64_t value) {
+    if (!enabled()) {
+        return;
+    }
+    bump(local().counters[static_cast<size_t>(counter)], value);
+}
+
+void Stats::adjust(Gauge gauge, int64_t delta) {
+    if (!enabled()) {
+        return;
+    }
+    bump(local().gauges[static_cast<size_t>(gauge)], delta);
+}
+
+void Stats::recordLatency(uint64_t nanoseconds, LatencyHistogram* connection) {
+    if (!enabled()) {
+        return;
+    }
+    local().latency.record(nanoseconds);
+    if (connection != nullptr) {
+        connection->record(nanoseconds);
+    }
+}
+
+LatencyHistogram& Stats::connectionLatency(const std::string& name) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    for (auto& connection : registry().connections) {
+        if (connection.first == name) {
+            return *connection.second;
+        }
+    }
+    registry().connections.emplace_back(name, std::make_unique<LatencyHistogram>());
+    return *registry().connections.back().second;
+}
+
+uint64_t Stats::total(Counter counter) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    uint64_t sum = 0;
+    for (const auto& state : registry().threads) {
+        sum += state->counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+uint64_t Stats::total(Phase phase) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    uint64_t sum = 0;
+    for (const auto& state : registry().threads) {
+        sum += state->phaseTime[static_cast<size_t>(phase)].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+int64_t Stats::total(Gauge gauge) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    int64_t sum = 0;
+    for (const auto& state : registry().threads) {
+        sum += state->gauges[static_cast<size_t>(gauge)].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+/**
+ * @brief Merges all threads and writes the report.
+ * 
+ * Durations are reported in nanoseconds. Phase durations are summed over threads, so phases
+ * that run concurrently (parsing and authentication, for example) may add up to more than the
+ * total wall time.
+ */
+void Stats::writeJson(const std::string& filename) {
+    const size_t phases = static_cast<size_t>(Phase::COUNT);
+    const size_t counters = static_cast<size_t>(Counter::COUNT);
+    uint64_t phaseTime[phases] = {};
+    uint64_t phaseCalls[phases] = {};
+    uint64_t counterValues[counters] = {};
+    LatencyHistogram latency;
+    size_t threadCount = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        threadCount = registry().threads.size();
+        for (const auto& state : registry().threads) {
+            for (size_t i = 0; i < phases; ++i) {
+                phaseTime[i] += state->phaseTime[i].load(std::memory_order_relaxed);
+                phaseCalls[i] += state->phaseCalls[i].load(std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < counters; ++i) {
+                counterValues[i] += state->counters[i].load(std::memory_order_relaxed);
+            }
+            latency.merge(state->latency);
+        }
+    }
+
+    std::ofstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Failed to open stats file: " + filename);
+    }
+
+    file << "{\n  \"threads\": " << threadCount << ",\n  \"phases\": {\n";
+    for (size_t i = 0; i < phases; ++i) {
+        file << "    \"" << PHASE_NAMES[i] << "\": {\"ns\": " << phaseTime[i]
+             << ", \"calls\": " << phaseCalls[i] << "}" << (i + 1 < phases ? ",\n" : "\n");
+    }
+    file << "  },\n  \"counters\": {\n";
+    for (size_t i = 0; i < counters; ++i) {
+        file << "    \"" << COUNTER_NAMES[i] << "\": " << counterValues[i] << (i + 1 < counters ? ",\n" : "\n");
+    }
+    file << "  },\n  \"latency_ns\": ";
+    writeLatencyJson(file, latency, "  ");
+    file << ",\n  \"connections\": [";
+    {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        const auto& connections = registry().connections;
+        for (size_t i = 0; i < connections.size(); ++i) {
+            file << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << connections[i].first << "\", \"latency_ns\": ";
+            writeLatencyJson(file, *connections[i].second, "    ");
+            file << "}";
+        }
+        file << (connections.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    }
+
+    if (!file) {
+        throw std::runtime_error("Failed to write stats file: " + filename);
+    }
+}
+
+/**
+ * @brief Writes the merged histogram first, then one section per connection, each headed by a
+ * comment line with its name.
+ */
+void Stats::writeHistogram(const std::string& filename) {
+    LatencyHistogram latency;
+    std::ofstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Failed to open histogram file: " + filename);
+    }
+
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    for (const auto& state : registry().threads) {
+        latency.merge(state->latency);
+    }
+    file << "# all connections, microseconds\n";
+    latency.writePercentiles(file);
+    for (const auto& connection : registry().connections) {
+        file << "\n# connection " << connection.first << ", microseconds\n";
+        connection.second->writePercentiles(file);
+    }
+
+    if (!file) {
+        throw std::runtime_error("Failed to write histogram file: " + filename);
+    }
+}
+
+/**
+ * @brief Merges all threads under the registry lock, which only blocks threads registering for the
+ * first time; recording threads keep writing their own counters meanwhile.
+ * 
+ * Counter and phase names get a `client_` prefix, latencies are exported as a summary in seconds.
+ */
+void Stats::writePrometheus(std::ostream& out) {
+    const size_t phases = static_cast<size_t>(Phase::COUNT);
+    const size_t counters = static_cast<size_t>(Counter::COUNT);
+    const size_t gauges = static_cast<size_t>(Gauge::COUNT);
+    uint64_t phaseTime[phases] = {};
+    uint64_t counterValues[counters] = {};
+    int64_t gaugeValues[gauges] = {};
+    LatencyHistogram latency;
+
+    {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        for (const auto& state : registry().threads) {
+            for (size_t i = 0; i < phases; ++i) {
+                phaseTime[i] += state->phaseTime[i].load(std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < counters; ++i) {
+                counterValues[i] += state->counters[i].load(std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < gauges; ++i) {
+                gaugeValues[i] += state->gauges[i].load(std::memory_order_relaxed);
+            }
+            latency.merge(state->latency);
+        }
+    }
+
+    for (size_t i = 0; i < counters; ++i) {
+        out << "# HELP client_" << COUNTER_NAMES[i] << "_total " << COUNTER_HELP[i] << "\n"
+            << "# TYPE client_" << COUNTER_NAMES[i] << "_total counter\n"
+            << "client_" << COUNTER_NAMES[i] << "_total " << counterValues[i] << "\n";
+    }
+    for (size_t i = 0; i < gauges; ++i) {
+        out << "# HELP client_" << GAUGE_NAMES[i] << " " << GAUGE_HELP[i] << "\n"
+            << "# TYPE client_" << GAUGE_NAMES[i] << " gauge\n"
+            << "client_" << GAUGE_NAMES[i] << " " << gaugeValues[i] << "\n";
+    }
+
+    out << "# HELP client_phase_seconds_total Time spent in each phase, summed over threads.\n"
+        << "# TYPE client_phase_seconds_total counter\n";
+    for (size_t i = 0; i < phases; ++i) {
+        out << "client_phase_seconds_total{phase=\"" << PHASE_NAMES[i] << "\"} "
+            << static_cast<double>(phaseTime[i]) / 1e9 << "\n";
+    }
+
+    out << "# HELP client_latency_seconds Round-trip time of one vector.\n"
+        << "# TYPE client_latency_seconds summary\n";
+    for (double quantile : {0.5, 0.9, 0.99, 0.999}) {
+        out << "client_latency_seconds{quantile=\"" << quantile << "\"} "
+            << static_cast<double>(latency.valueAtPercentile(quantile * 100.0)) / 1e9 << "\n";
+    }
+    out << "client_latency_seconds_sum " << latency.mean() * static_cast<double>(latency.count()) / 1e9 << "\n"
+        << "client_latency_seconds_count " << latency.count() << "\n";
+}
@@ -0,0 +1,238 @@
+/**
+ * @file Stats.h
+ * @brief Header file for the Stats class, which collects per-phase timings and counters of a run.
+ * 
+ * This file defines the `Stats` class. The client records how long each phase of a run takes
+ * (connecting, authenticating, parsing, sending, waiting for the server, writing the output),
+ * how many bytes and system calls it needed and how long every vector took to come back, and
+ * can write all of it as a JSON report at the end of the run.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+#include <string>
+#include <ostream>
+#include <chrono>
+#include <atomic>
+
+class LatencyHistogram;
+
+/**
+ * @class Stats
+ * @brief Low-overhead, thread-safe collection of timings and counters.
+ * 
+ * Every thread records into its own set of counters, so recording never takes a lock and never
+ * contends with other threads; the per-thread values are merged only when the report is written.
+ * Recording is disabled until `enable` is called, in which case every recording call reduces to
+ * a single check of a flag and no clock is read.
+ */
+class Stats {
+public:
+    /**
+     * @brief Phases of a client run whose duration is measured.
+     */
+    enum class Phase {
+        Total,   /**< The whole run, from start-up to exit. */
+        Config,  /**< Reading the configuration file. */
+        Connect, /**< Establishing the connection. */
+        Auth,    /**< The SHA256 authentication exchange. */
+        Count,   /**< Counting the lines of the input file. */
+        Parse,   /**< Parsing the input file. */
+        Dedup,   /**< Finding repeated vectors in the input. */
+        Cache,   /**< Looking vectors up in the result cache. */
+        Send,    /**< Time spent inside send calls. */
+        Wait,    /**< Time spent inside receive calls, waiting for the server. */
+        Compress, /**< Compressing vector payloads. */
+        Reduce,  /**< Computing results locally. */
+        Write,   /**< Writing the output file. */
+        COUNT    /**< Number of phases. */
+    };
+
+    /**
+     * @brief Quantities counted during a run.
+     */
+    enum class Counter {
+        BytesSent,     /**< Bytes passed to the socket. */
+        BytesReceived, /**< Bytes read from the socket. */
+        SendCalls,     /**< Number of send system calls. */
+        RecvCalls,     /**< Number of receive system calls. */
+        InputBytes,    /**< Bytes read from the input file. */
+        OutputBytes,   /**< Bytes written to the output file. */
+        FileReads,     /**< Number of read operations on the input file. */
+        Vectors,       /**< Vectors exchanged with the server. */
+        Reconnects,    /**< Connections re-established after the server was unreachable. */
+        AuthFailures,  /**< Authentication attempts rejected by the server. */
+        Timeouts,      /**< Sends or receives abandoned after the operation timeout. */
+        Hedges,        /**< Vectors sent a second time on a spare connection. */
+        HedgeWins,     /**< Hedged vectors answered first on the spare connection. */
+        CompressInputBytes,  /**< Payload bytes passed to the compressor. */
+        CompressOutputBytes, /**< Bytes sent for those payloads, compressed or not. */
+        Duplicates,    /**< Vectors not sent because an equal vector of the same input was. */
+        SparseInputBytes,  /**< Dense bytes of the payloads sent as index/value pairs. */
+        SparseOutputBytes, /**< Bytes sent for those payloads. */
+        FastOpens,     /**< Connections whose first data the server accepted inside the SYN. */
+        COUNT          /**< Number of counters. */
+    };
+
+    /**
+     * @brief Quantities that go up and down during a run.
+     */
+    enum class Gauge {
+        InFlight, /**< Vectors sent whose result has not been received yet. */
+        COUNT     /**< Number of gauges. */
+    };
+
+    /**
+     * @class Timer
+     * @brief Adds the lifetime of the object to a phase (and to the trace, when tracing is on).
+     */
+    class Timer {
+    public:
+        /**
+         * @brief Starts measuring a phase.
+         * 
+         * @param phase The phase the elapsed time is added to.
+         */
+        explicit Timer(Phase phase);
+
+        /**
+         * @brief Stops measuring and records the elapsed time.
+         */
+        ~Timer();
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+    private:
+        Phase phase;                                  /**< The measured phase. */
+        std::chrono::steady_clock::time_point start;  /**< Start time, unset when disabled. */
+        bool active;                                  /**< Whether stats were enabled at start. */
+    };
+
+    /**
+     * @brief Turns recording on for the rest of the process.
+     */
+    static void enable();
+
+    /**
+     * @brief Returns whether recording is on.
+     * 
+     * @return `true` if `enable` has been called.
+     */
+    static bool enabled() {
+        return active.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Returns the current monotonic time in nanoseconds, or 0 when neither stats nor tracing are on.
+     * 
+     * @return Nanoseconds since an arbitrary fixed point.
+     */
+    static uint64_t now();
+
+    /**
+     * @brief Adds a duration to a phase.
+     * 
+     * When tracing is on, the duration is also recorded as a span ending at the time of the call.
+     * 
+     * @param phase The phase to add to.
+     * @param nanoseconds The duration to add.
+     */
+    static void addTime(Phase phase, uint64_t nanoseconds);
+
+    /**
+     * @brief Increments a counter of the calling thread.
+     * 
+     * @param counter The counter to increment.
+     * @param value The amount to add.
+     */
+    static void add(Counter counter, uint64_t value = 1);
+
+    /**
+     * @brief Changes a gauge by the calling thread's contribution.
+     * 
+     * @param gauge The gauge to change.
+     * @param delta The signed amount to add.
+     */
+    static void adjust(Gauge gauge, int64_t delta);
+
+    /**
+     * @brief Records the round-trip latency of one vector.
+     * 
+     * The value goes into the calling thread's histogram and, if given, into the histogram of the
+     * connection the vector was sent over.
+     * 
+     * @param nanoseconds Time from sending the vector to receiving its result.
+     * @param connection Histogram of the connection, obtained from `connectionLatency`, or `nullptr`.
+     */
+    static void recordLatency(uint64_t nanoseconds, LatencyHistogram* connection = nullptr);
+
+    /**
+     * @brief Returns the latency histogram of a connection, creating it on first use.
+     * 
+     * The histogram lives until the end of the process, so it can be reported after the
+     * connection is closed.
+     * 
+     * @param name A name identifying the connection in the report.
+     * @return The connection's histogram.
+     */
+    static LatencyHistogram& connectionLatency(const std::string& name);
+
+    /**
+     * @brief Returns the merged total of a counter over all threads.
+     * 
+     * @param counter The counter to read.
+     * @return The sum of all per-thread values.
+     */
+    static uint64_t total(Counter counter);
+
+    /**
+     * @brief Returns the merged total time of a phase over all threads.
+     * 
+     * @param phase The phase to read.
+     * @return The total duration in nanoseconds.
+     */
+    static uint64_t total(Phase phase);
+
+    /**
+     * @brief Returns the current value of a gauge summed over all threads.
+     * 
+     * @param gauge The gauge to read.
+     * @return The sum of all per-thread contributions.
+     */
+    static int64_t total(Gauge gauge);
+
+    /**
+     * @brief Writes all merged timings, counters and latency percentiles as JSON.
+     * 
+     * @param filename The path to the report file.
+     * @throws std::runtime_error If the file cannot be written.
+     */
+    static void writeJson(const std::string& filename);
+
+    /**
+     * @brief Writes the latency percentile tables in the HdrHistogram text format.
+     * 
+     * @param filename The path to the output file.
+     * @throws std::runtime_error If the file cannot be written.
+     */
+    static void writeHistogram(const std::string& filename);
+
+    /**
+     * @brief Writes the current counters, gauges, phase times and latency quantiles in the
+     * Prometheus text exposition format.
+     * 
+     * @param out The stream to write to.
+     */
+    static void writePrometheus(std::ostream& out);
+
+private:
+    static std::atomic<bool> active; /**< Whether recording is on. */
+};
+
+#endif // STATS_H
@@ -0,0 +1,323 @@
+/**
+ * @file ThreadPool.cpp
+ * @brief Implementation of the ThreadPool class, a work-stealing task scheduler shared by the client.
+ * 
+ * Every worker queue has its own mutex, so workers pushing and popping their own tasks never
+ * contend with each other; only a steal touches another worker's lock. A separate counter of
+ * queued tasks lets idle workers sleep on a condition variable instead of spinning.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <algorithm>
+#include <stdexcept>
+#include <fstream>
+#include <cstdlib>
+
+namespace {
+
+/**
+ * @brief The pool the calling thread works for, or `nullptr` outside of pool workers.
+ */
+thread_local ThreadPool* currentPool = nullptr;
+
+/**
+ * @brief The worker index of the calling thread within `currentPool`.
+ */
+thread_local size_t currentWorker = 0;
+
+/**
+ * @brief Size and placement of the shared pool, set by `ThreadPool::configure`.
+ */
+struct SharedConfig {
+    size_t threads = 0;
+    ThreadPool::Placement placement = ThreadPool::Placement::None;
+} sharedConfig;
+
+/**
+ * @brief Returns the CPUs the process may run on.
+ * 
+ * @return The CPU numbers in ascending order; at least one.
+ */
+std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    if (cpus.empty()) {
+        cpus.push_back(0);
+    }
+    return cpus;
+}
+
+/**
+ * @brief Parses a sysfs CPU list such as `0-3,8-11`.
+ * 
+ * @param list The list.
+ * @return The CPU numbers.
+ */
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t position = 0;
+    while (position < list.size()) {
+        size_t comma = list.find(',', position);
+        std::string range = list.substr(position, comma == std::string::npos ? std::string::npos : comma - position);
+        size_t dash = range.find('-');
+        int first = std::atoi(range.c_str());
+        int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        position = comma + 1;
+    }
+    return cpus;
+}
+
+/**
+ * @struct Node
+ * @brief A NUMA node and the allowed CPUs on it.
+ */
+struct Node {
+    int id;                /**< The node number. */
+    std::vector<int> cpus; /**< Allowed CPUs of the node. */
+};
+
+/**
+ * @brief Reads the NUMA topology restricted to the allowed CPUs.
+ * 
+ * @return The nodes that have at least one allowed CPU, in node order; a single node 0 with all
+ *         allowed CPUs if the topology is not available.
+ */
+std::vector<Node> readTopology() {
+    const std::vector<int> allowed = allowedCpus();
+    std::vector<Node> nodes;
+    if (DIR* dir = opendir("/sys/devices/system/node")) {
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+                name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+            std::ifstream file("/sys/devices/system/node/" + name + "/cpulist");
+            std::string list;
+            std::getline(file, list);
+            Node node{std::atoi(name.c_str() + 4), {}};
+            for (int cpu : parseCpuList(list)) {
+                if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+                    node.cpus.push_back(cpu);
+                }
+            }
+            if (!node.cpus.empty()) {
+                nodes.push_back(std::move(node));
+            }
+        }
+        closedir(dir);
+    }
+    if (nodes.empty()) {
+        nodes.push_back(Node{0, allowed});
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const Node& a, const Node& b) { return a.id < b.id; });
+    return nodes;
+}
+
+} // namespace
+
+void ThreadPool::TaskRing::pushBack(Task&& task) {
+    if (count == slots.size()) {
+        std::vector<Task> grown(std::max<size_t>(8, slots.size() * 2));
+        for (size_t i = 0; i < count; ++i) {
+            grown[i] = std::move(slots[(head + i) & (slots.size() - 1)]);
+        }
+        slots.swap(grown);
+        head = 0;
+    }
+    slots[(head + count) & (slots.size() - 1)] = std::move(task);
+    ++count;
+}
+
+ThreadPool::Task ThreadPool::TaskRing::popFront() {
+    Task task = std::move(slots[head]);
+    head = (head + 1) & (slots.size() - 1);
+    --count;
+    return task;
+}
+
+ThreadPool::ThreadPool(size_t threads, Placement placement)
+    : nextWorker(0), stolen(0), queued(0), stopping(false) {
+    if (threads == 0) {
+        threads = allowedCpus().size();
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    place(placement);
+    for (size_t i = 0; i < threads; ++i) {
+        workers[i]->thread = std::thread(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+/**
+ * @brief Spreads the workers over the NUMA nodes round robin; within a node, `Cpu` placement
+ * assigns the node's CPUs in order.
+ * 
+ * Every worker steals from the workers of its own node first, starting with its right-hand
+ * neighbour, and only then from the other nodes.
+ */
+void ThreadPool::place(Placement placement) {
+    const std::vector<Node> nodes = placement == Placement::None ? std::vector<Node>{Node{0, {}}} : readTopology();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        const Node& node = nodes[i % nodes.size()];
+        workers[i]->node = node.id;
+        if (placement == Placement::Cpu) {
+            workers[i]->cpus = {node.cpus[(i / nodes.size()) % node.cpus.size()]};
+        } else if (placement == Placement::Numa) {
+            workers[i]->cpus = node.cpus;
+        }
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        std::vector<size_t>& victims = workers[i]->victims;
+        for (size_t step = 1; step < workers.size(); ++step) {
+            victims.push_back((i + step) % workers.size());
+        }
+        std::stable_partition(victims.begin(), victims.end(),
+                              [this, i](size_t other) { return workers[other]->node == workers[i]->node; });
+    }
+}
+
+void ThreadPool::run(size_t index) {
+    currentPool = this;
+    currentWorker = index;
+    Trace::nameThread("worker");
+    Worker& self = *workers[index];
+    if (!self.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : self.cpus) {
+            CPU_SET(cpu, &set);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    Task task;
+    while (true) {
+        if (take(index, task)) {
+            try {
+                task();
+            } catch (...) {
+            }
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return queued > 0 || stopping; });
+        if (queued == 0 && stopping) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Pops the oldest task of the worker's own queue, or else the oldest task of the first
+ * victim that has one.
+ */
+bool ThreadPool::take(size_t index, Task& task) {
+    Worker& self = *workers[index];
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(self.mutex);
+        if (!self.tasks.empty()) {
+            task = self.tasks.popFront();
+            found = true;
+        }
+    }
+    for (size_t i = 0; !found && i < self.victims.size(); ++i) {
+        Worker& victim = *workers[self.victims[i]];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.popFront();
+            stolen.fetch_add(1, std::memory_order_relaxed);
+            found = true;
+        }
+    }
+    if (found) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        --queued;
+    }
+    return found;
+}
+
+void ThreadPool::post(Task task) {
+    size_t index = currentPool == this ? currentWorker
+                                       : nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->tasks.pushBack(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        ++queued;
+    }
+    wake.notify_one();
+}
+
+size_t ThreadPool::size() const {
+    return workers.size();
+}
+
+int ThreadPool::nodeOf(size_t worker) const {
+    return workers[worker]->node;
+}
+
+uint64_t ThreadPool::steals() const {
+    return stolen.load(std::memory_order_relaxed);
+}
+
+ThreadPool::Placement ThreadPool::parsePlacement(const std::string& name) {
+    if (name == "none") {
+        return Placement::None;
+    }
+    if (name == "cpu") {
+        return Placement::Cpu;
+    }
+    if (name == "numa") {
+        return Placement::Numa;
+    }
+    throw std::runtime_error("Unknown thread placement: " + name);
+}
+
+void ThreadPool::configure(size_t threads, Placement placement) {
+    sharedConfig.threads = threads;
+    sharedConfig.placement = placement;
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(sharedConfig.threads, sharedConfig.placement);
+    return pool;
+}
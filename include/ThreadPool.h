@@ -0,0 +1,219 @@
+/**
+ * @file ThreadPool.h
+ * @brief Header file for the ThreadPool class, a work-stealing task scheduler shared by the client.
+ * 
+ * This file defines the `ThreadPool` class. Background work of the client (parsing the input,
+ * reading the credentials) is submitted as tasks to one process-wide pool instead of every stage
+ * starting its own threads, so the number of busy threads never exceeds the configured size.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+#include <string>
+#include <vector>
+#include <mutex>
+
+/**
+ * @class ThreadPool
+ * @brief A fixed set of worker threads, each with its own task queue, that steal work from each other.
+ * 
+ * A task submitted from a worker is queued on that worker, so follow-up work stays on the CPU
+ * (and the NUMA node) whose caches hold its data; a task submitted from any other thread is
+ * distributed round robin. An idle worker steals from the other queues, trying the workers of its
+ * own NUMA node before remote ones.
+ * 
+ * Queues are first in, first out for both the owner and the thieves. The client's stages are
+ * pipelines whose consumer waits for the oldest task (the next batch of the input, for example),
+ * so running the newest task first, as fork-join schedulers do, would only delay it.
+ * 
+ * Workers can be pinned: `Placement::Cpu` pins every worker to one CPU, `Placement::Numa` pins it
+ * to all CPUs of one NUMA node and lets the kernel balance within the node. In both modes the
+ * workers are spread over the nodes round robin. The topology is read from sysfs and restricted
+ * to the CPUs the process may run on; without NUMA information the machine is one node.
+ * 
+ * Tasks should not block for long: a task waiting for another task can hold up a worker that the
+ * other task needs.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief A unit of work.
+     */
+    using Task = std::function<void()>;
+
+    /**
+     * @brief How worker threads are bound to CPUs.
+     */
+    enum class Placement {
+        None, /**< Threads are not pinned. */
+        Cpu,  /**< Every worker is pinned to a single CPU. */
+        Numa  /**< Every worker is pinned to the CPUs of one NUMA node. */
+    };
+
+    /**
+     * @brief Starts the workers.
+     * 
+     * @param threads Number of workers; 0 means one per CPU the process may run on.
+     * @param placement How the workers are pinned.
+     */
+    explicit ThreadPool(size_t threads = 0, Placement placement = Placement::None);
+
+    /**
+     * @brief Runs all queued tasks to completion and joins the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Queues a task whose completion nobody waits for.
+     * 
+     * The task must not throw; an escaping exception is discarded.
+     * 
+     * @param task The task.
+     */
+    void post(Task task);
+
+    /**
+     * @brief Queues a task and returns a future for its result or exception.
+     * 
+     * @param function The callable to run.
+     * @return A future receiving the return value of `function`.
+     */
+    template <typename Function>
+    auto submit(Function function) -> std::future<decltype(function())> {
+        using Result = decltype(function());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+        std::future<Result> result = task->get_future();
+        post([task] { (*task)(); });
+        return result;
+    }
+
+    /**
+     * @brief Returns the number of workers.
+     * 
+     * @return The number of worker threads.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns the NUMA node a worker was placed on.
+     * 
+     * @param worker The worker index, less than `size()`.
+     * @return The node number; 0 when the workers are not pinned.
+     */
+    int nodeOf(size_t worker) const;
+
+    /**
+     * @brief Returns how many tasks were taken from another worker's queue.
+     * 
+     * @return The number of steals so far.
+     */
+    uint64_t steals() const;
+
+    /**
+     * @brief Parses a placement name: `none`, `cpu` or `numa`.
+     * 
+     * @param name The placement name.
+     * @return The placement.
+     * @throws std::runtime_error If the name is unknown.
+     */
+    static Placement parsePlacement(const std::string& name);
+
+    /**
+     * @brief Sets the size and placement of the shared pool.
+     * 
+     * Must be called before the first call to `shared`; later calls have no effect.
+     * 
+     * @param threads Number of workers; 0 means one per CPU.
+     * @param placement How the workers are pinned.
+     */
+    static void configure(size_t threads, Placement placement);
+
+    /**
+     * @brief Returns the process-wide pool, creating it on first use.
+     * 
+     * @return The shared pool.
+     */
+    static ThreadPool& shared();
+
+private:
+    /**
+     * @class TaskRing
+     * @brief A queue of tasks in a ring buffer that only ever grows.
+     * 
+     * Unlike `std::deque`, pushing and popping in a steady state never allocates.
+     */
+    class TaskRing {
+    public:
+        /// Returns whether the ring holds no tasks
+        bool empty() const { return count == 0; }
+        /// Appends a task at the back
+        void pushBack(Task&& task);
+        /// Removes and returns the task at the front
+        Task popFront();
+
+    private:
+        std::vector<Task> slots; /**< Ring storage; its size is a power of two or zero. */
+        size_t head = 0;         /**< Index of the front task. */
+        size_t count = 0;        /**< Number of queued tasks. */
+    };
+
+    /**
+     * @struct Worker
+     * @brief One worker thread with its queue and its place in the topology.
+     */
+    struct Worker {
+        std::mutex mutex;            /**< Guards `tasks`. */
+        TaskRing tasks;              /**< Tasks queued on this worker, oldest first. */
+        std::vector<int> cpus;       /**< CPUs the worker is pinned to, empty if not pinned. */
+        std::vector<size_t> victims; /**< Other workers in stealing order, same node first. */
+        int node = 0;                /**< NUMA node of the worker. */
+        std::thread thread;          /**< The worker thread. */
+    };
+
+    /**
+     * @brief Body of a worker thread.
+     * 
+     * @param index The worker index.
+     */
+    void run(size_t index);
+
+    /**
+     * @brief Takes a task from the worker's own queue or steals one.
+     * 
+     * @param index The worker index.
+     * @param task Receives the task.
+     * @return `true` if a task was found.
+     */
+    bool take(size_t index, Task& task);
+
+    /**
+     * @brief Assigns CPUs and nodes to the workers and computes their stealing order.
+     * 
+     * @param placement How the workers are pinned.
+     */
+    void place(Placement placement);
+
+    std::vector<std::unique_ptr<Worker>> workers; /**< The workers. */
+    std::atomic<size_t> nextWorker;               /**< Round-robin target for external submissions. */
+    std::atomic<uint64_t> stolen;                 /**< Number of steals. */
+    std::mutex sleepMutex;                        /**< Guards `queued` and `stopping` for sleeping. */
+    std::condition_variable wake;                 /**< Signalled when a task is queued or on shutdown. */
+    size_t queued;                                /**< Number of tasks queued on all workers. */
+    bool stopping;                                /**< Set by the destructor. */
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,181 @@
+/**
+ * @file Trace.cpp
+ * @brief Implementation of the Trace class, which records a timeline of spans for the Chrome trace viewer.
+ * 
+ * Like the counters of `Stats`, each thread's ring buffer is registered in a global registry the
+ * first time the thread records a span and is never freed, so spans of finished worker threads are
+ * still written out.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "Trace.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <mutex>
+
+namespace {
+
+/**
+ * @struct Event
+ * @brief One recorded span.
+ */
+struct Event {
+    const char* name;  /**< Span name. */
+    uint64_t start;    /**< Monotonic start time in nanoseconds. */
+    uint64_t duration; /**< Length in nanoseconds. */
+};
+
+/**
+ * @struct ThreadRing
+ * @brief Spans recorded by one thread.
+ * 
+ * Only the owning thread writes; `written` is published with release semantics after the slot is
+ * filled, so the writer of the report sees complete events up to that position.
+ */
+struct ThreadRing {
+    size_t id = 0;                         /**< Thread number shown in the viewer. */
+    std::atomic<const char*> name{nullptr}; /**< Thread name, if one was given. */
+    std::atomic<uint64_t> written{0};      /**< Total number of spans ever recorded. */
+    std::unique_ptr<Event[]> events{new Event[Trace::RING_SIZE]}; /**< The ring itself. */
+};
+
+/**
+ * @struct Registry
+ * @brief Owner of all per-thread rings.
+ */
+struct Registry {
+    std::mutex mutex;                                /**< Guards `threads`. */
+    std::vector<std::unique_ptr<ThreadRing>> threads; /**< Rings of every thread that recorded. */
+};
+
+/**
+ * @brief Returns the process-wide registry.
+ * 
+ * @return The registry, created on first use and never destroyed.
+ */
+Registry& registry() {
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+/**
+ * @brief Returns the calling thread's ring, registering it on first use.
+ * 
+ * @return The thread's ring.
+ */
+ThreadRing& local() {
+    thread_local ThreadRing* ring = nullptr;
+    if (ring == nullptr) {
+        auto owned = std::make_unique<ThreadRing>();
+        ring = owned.get();
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        owned->id = registry().threads.size() + 1;
+        registry().threads.push_back(std::move(owned));
+    }
+    return *ring;
+}
+
+/**
+ * @brief Writes a string as a JSON string literal.
+ * 
+ * @param out The stream to write to.
+ * @param text The string to quote.
+ */
+void writeQuoted(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\';
+        }
+        out << *c;
+    }
+    out << '"';
+}
+
+} // namespace
+
+std::atomic<bool> Trace::active(false);
+
+void Trace::enable() {
+    active.store(true, std::memory_order_relaxed);
+}
+
+void Trace::span(const char* name, uint64_t start, uint64_t duration) {
+    if (!enabled()) {
+        return;
+    }
+    ThreadRing& ring = local();
+    uint64_t position = ring.written.load(std::memory_order_relaxed);
+    ring.events[position % RING_SIZE] = Event{name, start, duration};
+    ring.written.store(position + 1, std::memory_order_release);
+}
+
+void Trace::nameThread(const char* name) {
+    if (!enabled()) {
+        return;
+    }
+    local().name.store(name, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Writes complete ("X") events with microsecond timestamps relative to the earliest span,
+ * preceded by a thread-name metadata ("M") event for every named thread.
+ */
+void Trace::writeJson(const std::string& filename) {
+    std::ofstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Failed to open trace file: " + filename);
+    }
+
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    uint64_t origin = UINT64_MAX;
+    for (const auto& ring : registry().threads) {
+        uint64_t written = ring->written.load(std::memory_order_acquire);
+        uint64_t first = written > RING_SIZE ? written - RING_SIZE : 0;
+        for (uint64_t i = first; i < written; ++i) {
+            origin = std::min(origin, ring->events[i % RING_SIZE].start);
+        }
+    }
+
+    file << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    bool firstEvent = true;
+    auto separator = [&]() -> std::ostream& {
+        file << (firstEvent ? "\n" : ",\n");
+        firstEvent = false;
+        return file;
+    };
+
+    file << std::fixed << std::setprecision(3);
+    for (const auto& ring : registry().threads) {
+        const char* name = ring->name.load(std::memory_order_relaxed);
+        if (name != nullptr) {
+            separator() << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": " << ring->id
+                        << ", \"args\": {\"name\": ";
+            writeQuoted(file, name);
+            file << "}}";
+        }
+
+        uint64_t written = ring->written.load(std::memory_order_acquire);
+        uint64_t first = written > RING_SIZE ? written - RING_SIZE : 0;
+        for (uint64_t i = first; i < written; ++i) {
+            const Event& event = ring->events[i % RING_SIZE];
+            separator() << "{\"ph\": \"X\", \"name\": ";
+            writeQuoted(file, event.name);
+            file << ", \"pid\": 1, \"tid\": " << ring->id
+                 << ", \"ts\": " << static_cast<double>(event.start - origin) / 1000.0
+                 << ", \"dur\": " << static_cast<double>(event.duration) / 1000.0 << "}";
+        }
+    }
+    file << "\n]}\n";
+
+    if (!file) {
+        throw std::runtime_error("Failed to write trace file: " + filename);
+    }
+}
@@ -0,0 +1,81 @@
+/**
+ * @file Trace.h
+ * @brief Header file for the Trace class, which records a timeline of spans for the Chrome trace viewer.
+ * 
+ * This file defines the `Trace` class. While `Stats` sums up how long each phase takes, `Trace`
+ * keeps every individual span (each send, each receive, each parsed batch) with its start time and
+ * thread, and writes them in the Chrome trace-event format, which can be opened in
+ * `chrome://tracing` or Perfetto to see where threads wait for each other.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <atomic>
+
+/**
+ * @class Trace
+ * @brief Low-overhead recorder of timed spans in per-thread ring buffers.
+ * 
+ * Every thread appends to its own fixed-size ring buffer without locks or allocation; once the
+ * buffer is full the oldest spans are overwritten, so tracing can be left on for long runs at a
+ * bounded memory cost. Span names must be string literals (or otherwise outlive the process), since
+ * only the pointer is stored.
+ */
+class Trace {
+public:
+    /// Number of spans kept per thread
+    static constexpr size_t RING_SIZE = size_t(1) << 16;
+
+    /**
+     * @brief Turns tracing on for the rest of the process.
+     */
+    static void enable();
+
+    /**
+     * @brief Returns whether tracing is on.
+     * 
+     * @return `true` if `enable` has been called.
+     */
+    static bool enabled() {
+        return active.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Records a completed span on the calling thread.
+     * 
+     * @param name The span name, a string with static storage duration.
+     * @param start Monotonic start time in nanoseconds.
+     * @param duration Length of the span in nanoseconds.
+     */
+    static void span(const char* name, uint64_t start, uint64_t duration);
+
+    /**
+     * @brief Names the calling thread in the timeline.
+     * 
+     * @param name The thread name, a string with static storage duration.
+     */
+    static void nameThread(const char* name);
+
+    /**
+     * @brief Writes the recorded spans of all threads as Chrome trace-event JSON.
+     * 
+     * Should be called once the traced work is finished; spans recorded while the file is being
+     * written may or may not be included.
+     * 
+     * @param filename The path to the trace file.
+     * @throws std::runtime_error If the file cannot be written.
+     */
+    static void writeJson(const std::string& filename);
+
+private:
+    static std::atomic<bool> active; /**< Whether tracing is on. */
+};
+
+#endif // TRACE_H
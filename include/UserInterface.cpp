@@ -20,12 +20,72 @@
  * the necessary parameters for the client application to function. It validates the input, handles errors, 
  * and prints the help message if requested.
  */
-UserInterface::UserInterface(int argc, char** argv) : serverPort(33333), configFile(".config/client.config") {
+UserInterface::UserInterface(int argc, char** argv)
+    : serverPort(33333), configFile(".config/client.config"), cacheSize(1 << 20), poolSize(2), threads(0),
+      threadPlacement("none"), ioBackend("socket"), timeoutMs(30000), hedgePercentile(0), fastOpen(false),
+      standby(0), batch(false),
+      compress(false), dedup(false), sparse(false), offline(false),
+      verifySample(0), operation("sum"), elementType("double") {
+    enum LongOption {
+        OPT_CACHE = 1000,
+        OPT_CACHE_SIZE,
+        OPT_STATS,
+        OPT_HISTOGRAM,
+        OPT_TRACE,
+        OPT_DAEMON,
+        OPT_POOL_SIZE,
+        OPT_METRICS,
+        OPT_GENERATE,
+        OPT_THREADS,
+        OPT_PIN_THREADS,
+        OPT_IO_BACKEND,
+        OPT_TIMEOUT,
+        OPT_HEDGE,
+        OPT_FAST_OPEN,
+        OPT_STANDBY,
+        OPT_BATCH,
+        OPT_COMPRESS,
+        OPT_DEDUP,
+        OPT_SPARSE,
+        OPT_OFFLINE,
+        OPT_VERIFY_SAMPLE,
+        OPT_OPERATION,
+        OPT_TYPE
+    };
+    static const option longOptions[] = {
+        {"cache", required_argument, nullptr, OPT_CACHE},
+        {"cache-size", required_argument, nullptr, OPT_CACHE_SIZE},
+        {"stats", required_argument, nullptr, OPT_STATS},
+        {"histogram", required_argument, nullptr, OPT_HISTOGRAM},
+        {"trace", required_argument, nullptr, OPT_TRACE},
+        {"daemon", required_argument, nullptr, OPT_DAEMON},
+        {"pool-size", required_argument, nullptr, OPT_POOL_SIZE},
+        {"metrics", required_argument, nullptr, OPT_METRICS},
+        {"generate", required_argument, nullptr, OPT_GENERATE},
+        {"threads", required_argument, nullptr, OPT_THREADS},
+        {"pin-threads", required_argument, nullptr, OPT_PIN_THREADS},
+        {"io-backend", required_argument, nullptr, OPT_IO_BACKEND},
+        {"timeout", required_argument, nullptr, OPT_TIMEOUT},
+        {"hedge", required_argument, nullptr, OPT_HEDGE},
+        {"fast-open", no_argument, nullptr, OPT_FAST_OPEN},
+        {"standby", required_argument, nullptr, OPT_STANDBY},
+        {"batch", no_argument, nullptr, OPT_BATCH},
+        {"compress", no_argument, nullptr, OPT_COMPRESS},
+        {"dedup", no_argument, nullptr, OPT_DEDUP},
+        {"sparse", no_argument, nullptr, OPT_SPARSE},
+        {"offline", no_argument, nullptr, OPT_OFFLINE},
+        {"verify-sample", required_argument, nullptr, OPT_VERIFY_SAMPLE},
+        {"operation", required_argument, nullptr, OPT_OPERATION},
+        {"type", required_argument, nullptr, OPT_TYPE},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    std::vector<std::string> addresses;
     int opt;
-    while ((opt = getopt(argc, argv, "a:p:i:o:c:h")) != -1) {
+    while ((opt = getopt_long(argc, argv, "a:p:i:o:c:h", longOptions, nullptr)) != -1) {
         switch (opt) {
             case 'a':
-                serverAddress = optarg;
+                addresses.push_back(optarg);
                 break;
             case 'p':
                 serverPort = std::stoi(optarg);
@@ -39,6 +99,91 @@ UserInterface::UserInterface(int argc, char** argv) : serverPort(33333), configF
             case 'c':
                 configFile = optarg;
                 break;
+            case OPT_CACHE:
+                cacheFile = optarg;
+                break;
+            case OPT_CACHE_SIZE:
+                cacheSize = std::stoul(optarg);
+                break;
+            case OPT_STATS:
+                statsFile = optarg;
+                break;
+            case OPT_HISTOGRAM:
+                histogramFile = optarg;
+                break;
+            case OPT_TRACE:
+                traceFile = optarg;
+                break;
+            case OPT_DAEMON:
+                spoolDir = optarg;
+                break;
+            case OPT_POOL_SIZE:
+                poolSize = std::stoul(optarg);
+                break;
+            case OPT_METRICS:
+                metricsEndpoint = optarg;
+                break;
+            case OPT_GENERATE:
+                generateSpec = optarg;
+                break;
+            case OPT_THREADS:
+                threads = std::stoul(optarg);
+                break;
+            case OPT_PIN_THREADS:
+                threadPlacement = optarg;
+                break;
+            case OPT_IO_BACKEND:
+                ioBackend = optarg;
+                break;
+            case OPT_TIMEOUT:
+                timeoutMs = std::stoul(optarg);
+                break;
+            case OPT_HEDGE:
+                hedgePercentile = std::stod(optarg);
+                if (hedgePercentile < 0 || hedgePercentile >= 100) {
+                    handleError("The hedging percentile must be between 0 and 100.");
+                }
+                break;
+            case OPT_FAST_OPEN:
+                fastOpen = true;
+                break;
+            case OPT_STANDBY:
+                standby = std::stoul(optarg);
+                break;
+            case OPT_BATCH:
+                batch = true;
+                break;
+            case OPT_COMPRESS:
+                compress = true;
+                break;
+            case OPT_DEDUP:
+                dedup = true;
+                break;
+            case OPT_SPARSE:
+                sparse = true;
+                break;
+            case OPT_OFFLINE:
+                offline = true;
+                break;
+            case OPT_VERIFY_SAMPLE:
+                verifySample = std::stod(optarg);
+                if (verifySample < 0 || verifySample > 1) {
+                    handleError("The verification sample rate must be between 0 and 1.");
+                }
+                break;
+            case OPT_OPERATION:
+                operation = optarg;
+                if (operation != "sum" && operation != "sumsq" && operation != "mean") {
+                    handleError("The operation must be sum, sumsq or mean.");
+                }
+                break;
+            case OPT_TYPE:
+                elementType = optarg;
+                if (elementType != "float" && elementType != "double" && elementType != "int32" &&
+                    elementType != "int64") {
+                    handleError("The element type must be float, double, int32 or int64.");
+                }
+                break;
             case 'h':
                 printHelp();
                 std::exit(0);
@@ -48,9 +193,58 @@ UserInterface::UserInterface(int argc, char** argv) : serverPort(33333), configF
         }
     }
 
-    if (serverAddress.empty() || inputFile.empty() || outputFile.empty()) {
+    for (const std::string& list : addresses) {
+        size_t position = 0;
+        while (position <= list.size()) {
+            size_t comma = list.find(',', position);
+            std::string address = list.substr(position, comma == std::string::npos ? std::string::npos : comma - position);
+            position = comma == std::string::npos ? list.size() + 1 : comma + 1;
+            if (address.empty()) {
+                continue;
+            }
+            Endpoint endpoint{address, serverPort};
+            size_t colon = address.find_last_of(':');
+            bool local = address.rfind("unix:", 0) == 0 || address.rfind("shm:", 0) == 0;
+            if (address.front() == '[') {
+                // An IPv6 address with a port is written in brackets: [::1]:33333
+                size_t bracket = address.find(']');
+                if (bracket == std::string::npos || (bracket + 1 < address.size() && address[bracket + 1] != ':')) {
+                    handleError("Invalid server address: " + address);
+                }
+                endpoint.address = address.substr(1, bracket - 1);
+                if (bracket + 1 < address.size()) {
+                    endpoint.port = std::stoi(address.substr(bracket + 2));
+                }
+            } else if (!local && colon != std::string::npos && address.find(':') == colon) {
+                endpoint.address = address.substr(0, colon);
+                endpoint.port = std::stoi(address.substr(colon + 1));
+            }
+            servers.push_back(endpoint);
+        }
+    }
+    if (!servers.empty()) {
+        serverAddress = servers.front().address;
+        serverPort = servers.front().port;
+    }
+
+    bool sourceGiven = !inputFile.empty() || !spoolDir.empty() || !generateSpec.empty();
+    bool outputNeeded = generateSpec.empty();
+    if (offline) {
+        if (inputFile.empty() || outputFile.empty()) {
+            handleError("Missing required parameters.");
+        }
+        if (!spoolDir.empty() || !generateSpec.empty()) {
+            handleError("Offline runs need an input file.");
+        }
+    } else if (serverAddress.empty() || !sourceGiven || (outputNeeded && outputFile.empty())) {
         handleError("Missing required parameters.");
     }
+    if (!generateSpec.empty() && elementType != "double") {
+        handleError("Synthetic vectors are generated as doubles only.");
+    }
+    if (!generateSpec.empty() && batch) {
+        handleError("Synthetic vectors are timed one by one, so --batch does not apply to --generate.");
+    }
 }
 
 /**
@@ -60,13 +254,51 @@ UserInterface::UserInterface(int argc, char** argv) : serverPort(33333), configF
  * command-line options and their descriptions.
  */
 void UserInterface::printHelp() {
-    std::cout << "Usage: client -a <server_address> -p <server_port> -i <input_file> -o <output_file> -c <config_file>\n";
+    std::cout << "Usage: client -a <server_address> -p <server_port> -i <input_file> -o <output_file> -c <config_file> [--cache <cache_file>]\n";
+    std::cout << "       client -a <server_address> -p <server_port> --daemon <spool_dir> -o <output_dir> -c <config_file>\n";
+    std::cout << "       client -a <server_address> -p <server_port> --generate <spec> [-o <output_file>] -c <config_file>\n";
+    std::cout << "       client --offline -i <input_file> -o <output_file> [--operation <op>]\n";
     std::cout << "Options:\n";
-    std::cout << "  -a address     Server address (required)\n";
+    std::cout << "  -a address     Server address: host name, IPv4 or IPv6 address, unix:path or shm:path\n";
+    std::cout << "                 (required); repeat the option or separate addresses by commas to balance a\n";
+    std::cout << "                 job across servers, an address may carry its own port as address:port or\n";
+    std::cout << "                 [IPv6 address]:port\n";
     std::cout << "  -p port        Server port (optional, default: 33333)\n";
     std::cout << "  -i input_file  Input file name (required)\n";
     std::cout << "  -o output_file Output file name (required)\n";
     std::cout << "  -c config_file Configuration file with LOGIN and PASSWORD (optional, default: .config/client.config)\n";
+    std::cout << "  --cache file   Reuse results of previously sent vectors from this cache file (optional)\n";
+    std::cout << "  --cache-size n Cached results, rounded up to a power of two; a cache file of another size\n";
+    std::cout << "                 is emptied (optional, default: 1048576)\n";
+    std::cout << "  --stats file   Write a JSON report of phase timings, counters and latencies (optional)\n";
+    std::cout << "  --histogram f  Write latency percentile tables in HdrHistogram text format (optional)\n";
+    std::cout << "  --trace file   Write a Chrome trace-event timeline of the run (optional)\n";
+    std::cout << "  --daemon dir   Keep running and process every input file dropped into dir (optional)\n";
+    std::cout << "  --pool-size n  Authenticated connections kept ready in daemon mode (optional, default: 2)\n";
+    std::cout << "  --metrics ep   Serve Prometheus metrics on a port, host:port or unix:path (optional)\n";
+    std::cout << "  --generate s   Send synthetic vectors instead of an input file, s = count=N,dim=D|MIN-MAX,\n";
+    std::cout << "                 dist=uniform|normal|constant,seed=S,rate=R (optional)\n";
+    std::cout << "  --threads n    Worker threads for background work, 0 = one per CPU (optional, default: 0)\n";
+    std::cout << "  --pin-threads m Pin worker threads: none, cpu or numa (optional, default: none)\n";
+    std::cout << "  --io-backend b Connection I/O: socket, io_uring or io_uring-sqpoll (optional, default: socket)\n";
+    std::cout << "  --timeout ms   Limit of every send or receive, 0 = none (optional, default: 30000)\n";
+    std::cout << "  --hedge p      Resend a vector on a spare connection once its result is later than the\n";
+    std::cout << "                 p-th latency percentile, 0 = off (optional, default: 0)\n";
+    std::cout << "  --fast-open    Open TCP connections with Fast Open, sending the login in the SYN (optional)\n";
+    std::cout << "  --standby n    Authenticated connections opened in the background for hedging\n";
+    std::cout << "                 (optional, default: 0)\n";
+    std::cout << "  --batch        Send many vectors per request if the server supports it (optional, not\n";
+    std::cout << "                 with --generate)\n";
+    std::cout << "  --compress     Compress vector payloads of 1 KiB or more if the server supports it (optional)\n";
+    std::cout << "  --dedup        Send repeated input vectors once and copy their result (optional)\n";
+    std::cout << "  --sparse       Send mostly-zero vectors as index/value pairs if the server supports it (optional)\n";
+    std::cout << "  --offline      Compute the results locally without a server (optional)\n";
+    std::cout << "  --verify-sample r Check this fraction of the server's results against local results\n";
+    std::cout << "                 (optional, default: 0)\n";
+    std::cout << "  --operation op Operation of the server for local results: sum, sumsq or mean\n";
+    std::cout << "                 (optional, default: sum)\n";
+    std::cout << "  --type t       Element type of vectors and results: float, double, int32 or int64; the\n";
+    std::cout << "                 server must use the same type (optional, default: double)\n";
     std::cout << "  -h             Display help\n";
 }
 
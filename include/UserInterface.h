@@ -18,6 +18,7 @@
 #include <getopt.h>
 #include <cstdlib>
 #include <string>
+#include <vector>
 
 /**
  * @class UserInterface
@@ -29,21 +30,105 @@
  */
 class UserInterface {
 public:
-    /// Server address provided by the user
+    /**
+     * @struct Endpoint
+     * @brief The address and port of one server.
+     */
+    struct Endpoint {
+        std::string address; /**< Server address. */
+        int port;            /**< Server port. */
+    };
+
+    /// Server address provided by the user (the first one if several were given)
     std::string serverAddress;
 
     /// Server port, default is 33333 if not provided by the user
     int serverPort;
 
+    /// All servers, in the order given; jobs are balanced across them when there are several
+    std::vector<Endpoint> servers;
+
     /// Input file name provided by the user
     std::string inputFile;
 
-    /// Output file name provided by the user
+    /// Output file name provided by the user (output directory in daemon mode)
     std::string outputFile;
 
     /// Configuration file for LOGIN and PASSWORD (optional)
     std::string configFile;
 
+    /// Result cache file, empty if caching is disabled (optional)
+    std::string cacheFile;
+
+    /// Maximum number of entries in the result cache
+    size_t cacheSize;
+
+    /// File receiving the JSON timing report, empty if no report is requested (optional)
+    std::string statsFile;
+
+    /// File receiving the latency percentile tables, empty if none are requested (optional)
+    std::string histogramFile;
+
+    /// File receiving the Chrome trace-event timeline, empty if tracing is off (optional)
+    std::string traceFile;
+
+    /// Spool directory watched in daemon mode, empty for a single run (optional)
+    std::string spoolDir;
+
+    /// Number of authenticated sessions kept ready in daemon mode
+    size_t poolSize;
+
+    /// Port, `host:port` or `unix:<path>` serving Prometheus metrics, empty if disabled (optional)
+    std::string metricsEndpoint;
+
+    /// Specification of synthetic vectors to send instead of an input file, empty if not used (optional)
+    std::string generateSpec;
+
+    /// Number of worker threads of the shared thread pool, 0 for one per CPU
+    size_t threads;
+
+    /// Pinning of the worker threads: `none`, `cpu` or `numa`
+    std::string threadPlacement;
+
+    /// System interface for the server connection: `socket`, `io_uring` or `io_uring-sqpoll`
+    std::string ioBackend;
+
+    /// Limit of every send or receive on a server connection in milliseconds, 0 for none
+    size_t timeoutMs;
+
+    /// Latency percentile after which a vector is sent again on a spare connection, 0 to disable
+    double hedgePercentile;
+
+    /// Whether to open TCP connections with Fast Open
+    bool fastOpen;
+
+    /// Authenticated connections opened in the background for reconnects and hedging
+    size_t standby;
+
+    /// Whether to ask the server for batch frames carrying many vectors each
+    bool batch;
+
+    /// Whether to ask the server for compressed payloads
+    bool compress;
+
+    /// Whether to send repeated vectors of the input only once
+    bool dedup;
+
+    /// Whether to ask the server for sparse payloads
+    bool sparse;
+
+    /// Whether to compute the results locally instead of asking a server
+    bool offline;
+
+    /// Fraction of the server's results checked against local results, 0 to disable
+    double verifySample;
+
+    /// Per-vector operation of the server, as computed locally: `sum`, `sumsq` or `mean`
+    std::string operation;
+
+    /// Element type of the vectors and results on the wire: `float`, `double`, `int32` or `int64`
+    std::string elementType;
+
     /**
      * @brief Constructor that parses the command-line arguments.
      * 
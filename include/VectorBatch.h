@@ -0,0 +1,220 @@
+/**
+ * @file VectorBatch.h
+ * @brief Header file for the BasicVectorBatch class, which stores many vectors in one flat arena.
+ * 
+ * This file defines the `BasicVectorBatch` class template used to hand parsed vectors from the
+ * input loader to the send loop. All values live in a single array and every vector is a view
+ * into it, so a batch costs two allocations regardless of the number of vectors, and none at all
+ * when it is reused. The element type is a template parameter; the original protocol sends doubles.
+ * The batch also counts the nonzero values of every vector as they are added, so the sender can
+ * choose the sparse encoding of a vector without looking at its values again.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef VECTOR_BATCH_H
+#define VECTOR_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class BasicVectorBatch
+ * @brief A sequence of variable-length vectors of `T` stored back to back.
+ * 
+ * Vectors are built value by value with `add` and `endVector`, or appended whole with `append`.
+ * `clear` forgets the vectors but keeps the storage, which is what makes recycled batches free.
+ * 
+ * @tparam T The element type of the vectors.
+ */
+template <typename T>
+class BasicVectorBatch {
+public:
+    /**
+     * @class View
+     * @brief A read-only view of one vector of the batch.
+     * 
+     * The view is invalidated when the batch is modified.
+     */
+    class View {
+    public:
+        /**
+         * @brief Creates a view of `size` values starting at `data`.
+         * 
+         * @param data The first value.
+         * @param size The number of values.
+         */
+        View(const T* data, size_t size) : first(data), length(size) {}
+
+        /// Returns a pointer to the first value
+        const T* data() const { return first; }
+        /// Returns the number of values
+        size_t size() const { return length; }
+        /// Returns whether the vector has no values
+        bool empty() const { return length == 0; }
+        /// Returns the value at `index`
+        T operator[](size_t index) const { return first[index]; }
+        /// Returns an iterator to the first value
+        const T* begin() const { return first; }
+        /// Returns an iterator past the last value
+        const T* end() const { return first + length; }
+
+    private:
+        const T* first; /**< The first value. */
+        size_t length;  /**< The number of values. */
+    };
+
+    /**
+     * @class Iterator
+     * @brief Forward iterator over the vectors of a batch, yielding views.
+     */
+    class Iterator {
+    public:
+        /**
+         * @brief Creates an iterator at vector `index` of `batch`.
+         * 
+         * @param batch The batch.
+         * @param index The vector index.
+         */
+        Iterator(const BasicVectorBatch* batch, size_t index) : batch(batch), index(index) {}
+
+        /// Returns the current vector
+        View operator*() const { return (*batch)[index]; }
+        /// Advances to the next vector
+        Iterator& operator++() { ++index; return *this; }
+        /// Compares the positions of two iterators over the same batch
+        bool operator==(const Iterator& other) const { return index == other.index; }
+        /// Compares the positions of two iterators over the same batch
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+
+    private:
+        const BasicVectorBatch* batch; /**< The iterated batch. */
+        size_t index;             /**< The current vector. */
+    };
+
+    /// Returns the number of vectors
+    size_t size() const { return ends.size(); }
+    /// Returns whether the batch has no vectors
+    bool empty() const { return ends.empty(); }
+    /// Returns the total number of values of all vectors
+    size_t valueCount() const { return values.size(); }
+
+    /**
+     * @brief Returns the number of values of vector `index` that are not zero.
+     * 
+     * Only positive zero counts as zero, since the sparse encoding restores omitted values as
+     * all-zero bits.
+     * 
+     * @param index The vector index, less than `size()`.
+     * @return The number of nonzero values.
+     */
+    size_t nonzeros(size_t index) const {
+        return nonzeroEnds[index] - (index == 0 ? 0 : nonzeroEnds[index - 1]);
+    }
+
+    /**
+     * @brief Checks whether a value is stored as all-zero bits.
+     * 
+     * @param value The value.
+     * @return `true` for 0 and +0.0, `false` for -0.0 and every other value.
+     */
+    static bool isZero(T value) {
+        if constexpr (std::is_floating_point<T>::value) {
+            typename std::conditional<sizeof(T) == sizeof(uint64_t), uint64_t, uint32_t>::type bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits == 0;
+        } else {
+            return value == 0;
+        }
+    }
+
+    /**
+     * @brief Returns a view of vector `index`.
+     * 
+     * @param index The vector index, less than `size()`.
+     * @return The view.
+     */
+    View operator[](size_t index) const {
+        size_t begin = index == 0 ? 0 : ends[index - 1];
+        return View(values.data() + begin, ends[index] - begin);
+    }
+
+    /// Returns an iterator to the first vector
+    Iterator begin() const { return Iterator(this, 0); }
+    /// Returns an iterator past the last vector
+    Iterator end() const { return Iterator(this, ends.size()); }
+
+    /**
+     * @brief Adds a value to the vector being built.
+     * 
+     * @param value The value.
+     */
+    void add(T value) {
+        values.push_back(value);
+        nonzeroCount += !isZero(value);
+    }
+
+    /**
+     * @brief Completes the vector being built from the values added since the previous one.
+     */
+    void endVector() {
+        ends.push_back(values.size());
+        nonzeroEnds.push_back(nonzeroCount);
+    }
+
+    /**
+     * @brief Appends a whole vector.
+     * 
+     * @param data The values.
+     * @param size The number of values.
+     */
+    void append(const T* data, size_t size) {
+        values.insert(values.end(), data, data + size);
+        for (size_t i = 0; i < size; ++i) {
+            nonzeroCount += !isZero(data[i]);
+        }
+        endVector();
+    }
+
+    /**
+     * @brief Appends all vectors of another batch.
+     * 
+     * @param other The batch to copy from.
+     */
+    void append(const BasicVectorBatch& other) {
+        const size_t offset = values.size();
+        values.insert(values.end(), other.values.begin(), other.values.end());
+        for (size_t end : other.ends) {
+            ends.push_back(offset + end);
+        }
+        for (size_t end : other.nonzeroEnds) {
+            nonzeroEnds.push_back(nonzeroCount + end);
+        }
+        nonzeroCount += other.nonzeroCount;
+    }
+
+    /**
+     * @brief Removes all vectors and keeps the storage for reuse.
+     */
+    void clear() {
+        values.clear();
+        ends.clear();
+        nonzeroEnds.clear();
+        nonzeroCount = 0;
+    }
+
+private:
+    std::vector<T> values;      /**< The values of all vectors, back to back. */
+    std::vector<size_t> ends;   /**< End offset of every vector in `values`. */
+    std::vector<size_t> nonzeroEnds; /**< Number of nonzero values up to the end of every vector. */
+    size_t nonzeroCount = 0;    /**< Number of nonzero values added so far. */
+};
+
+/// A batch of vectors of doubles, the element type of the original protocol
+using VectorBatch = BasicVectorBatch<double>;
+
+#endif // VECTOR_BATCH_H
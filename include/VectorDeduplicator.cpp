@@ -0,0 +1,98 @@
+/**
+ * @file VectorDeduplicator.cpp
+ * @brief Implementation of the VectorDeduplicator class, which finds repeated vectors in a job.
+ * 
+ * The hash reads eight bytes at a time and mixes every word with a multiplication and a rotation,
+ * which is several times faster than the SHA-256 the result cache needs for its persistent keys.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "VectorDeduplicator.h"
+
+#include <cstring>
+
+namespace {
+
+/// Multiplier of the word mixing (the 64-bit golden ratio)
+constexpr uint64_t GOLDEN = 0x9E3779B97F4A7C15ULL;
+
+/**
+ * @brief Scrambles all bits of a word (the finalizer of SplitMix64).
+ */
+uint64_t finalize(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+} // namespace
+
+uint64_t VectorDeduplicator::hash(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t state = static_cast<uint64_t>(size) * GOLDEN;
+    size_t offset = 0;
+    for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes + offset, sizeof(word));
+        state ^= word * 0xBF58476D1CE4E5B9ULL;
+        state = ((state << 31) | (state >> 33)) * GOLDEN;
+    }
+    if (offset < size) {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes + offset, size - offset);
+        state ^= word * 0xBF58476D1CE4E5B9ULL;
+        state = ((state << 31) | (state >> 33)) * GOLDEN;
+    }
+    return finalize(state);
+}
+
+/**
+ * @brief The table holds at least twice as many slots as vectors, so probe sequences stay short.
+ * A slot stores the hash and the index of a first occurrence; 0 marks an empty slot, so indices are
+ * stored plus one.
+ */
+template <typename T>
+size_t VectorDeduplicator::find(const BasicVectorBatch<T>& batch, std::vector<size_t>& first) {
+    struct Slot {
+        uint64_t hash;
+        size_t index;
+    };
+    size_t capacity = 16;
+    while (capacity < 2 * batch.size()) {
+        capacity <<= 1;
+    }
+    std::vector<Slot> slots(capacity, Slot{0, 0});
+    const size_t mask = capacity - 1;
+
+    first.resize(batch.size());
+    size_t distinct = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const typename BasicVectorBatch<T>::View vec = batch[i];
+        const size_t bytes = vec.size() * sizeof(T);
+        const uint64_t code = hash(vec.data(), bytes);
+        for (size_t slot = code & mask;; slot = (slot + 1) & mask) {
+            if (slots[slot].index == 0) {
+                slots[slot] = Slot{code, i + 1};
+                first[i] = i;
+                ++distinct;
+                break;
+            }
+            if (slots[slot].hash != code) {
+                continue;
+            }
+            const typename BasicVectorBatch<T>::View other = batch[slots[slot].index - 1];
+            if (other.size() == vec.size() && std::memcmp(other.data(), vec.data(), bytes) == 0) {
+                first[i] = slots[slot].index - 1;
+                break;
+            }
+        }
+    }
+    return distinct;
+}
+
+template size_t VectorDeduplicator::find(const BasicVectorBatch<float>&, std::vector<size_t>&);
+template size_t VectorDeduplicator::find(const BasicVectorBatch<double>&, std::vector<size_t>&);
+template size_t VectorDeduplicator::find(const BasicVectorBatch<int32_t>&, std::vector<size_t>&);
+template size_t VectorDeduplicator::find(const BasicVectorBatch<int64_t>&, std::vector<size_t>&);
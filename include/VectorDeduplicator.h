@@ -0,0 +1,57 @@
+/**
+ * @file VectorDeduplicator.h
+ * @brief Header file for the VectorDeduplicator class, which finds repeated vectors in a job.
+ * 
+ * This file defines the `VectorDeduplicator` class. Input files often repeat whole rows; with
+ * deduplication only the first occurrence of every vector is sent to the server and its result is
+ * copied to the repetitions.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef VECTOR_DEDUPLICATOR_H
+#define VECTOR_DEDUPLICATOR_H
+
+#include "VectorBatch.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class VectorDeduplicator
+ * @brief Maps every vector of a batch to the first vector with the same contents.
+ * 
+ * Vectors are hashed with a fast non-cryptographic 64-bit hash of their bytes and placed in an
+ * open-addressing table sized for the whole batch. Equal hashes are confirmed by comparing the
+ * sizes and the bytes, so a collision never merges two different vectors. Vectors are compared as
+ * raw bytes, as the server receives them: `0.0` and `-0.0` are different vectors.
+ */
+class VectorDeduplicator {
+public:
+    /**
+     * @brief Finds the first occurrence of every vector.
+     * 
+     * Instantiated for the element types `float`, `double`, `int32_t` and `int64_t`.
+     * 
+     * @tparam T The element type.
+     * @param batch The vectors of the job.
+     * @param first Receives, for every vector, the index of the first vector equal to it; the
+     *              index of the vector itself if it occurs for the first time.
+     * @return The number of distinct vectors.
+     */
+    template <typename T>
+    static size_t find(const BasicVectorBatch<T>& batch, std::vector<size_t>& first);
+
+    /**
+     * @brief Hashes a byte range.
+     * 
+     * @param data The bytes.
+     * @param size The number of bytes.
+     * @return A 64-bit hash of the bytes.
+     */
+    static uint64_t hash(const void* data, size_t size);
+};
+
+#endif // VECTOR_DEDUPLICATOR_H
@@ -0,0 +1,180 @@
+/**
+ * @file VectorGenerator.cpp
+ * @brief Implementation of the VectorGenerator class, which synthesizes input vectors for load testing.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "VectorGenerator.h"
+
+#include <stdexcept>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+/**
+ * @brief Advances a splitmix64 state and returns its output, used to seed xoshiro256**.
+ * 
+ * @param x The state.
+ * @return The next output.
+ */
+uint64_t splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Rotates a 64-bit value left.
+ * 
+ * @param x The value.
+ * @param k The number of bits.
+ * @return The rotated value.
+ */
+inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * @brief Parses an unsigned number that must make up the whole string.
+ * 
+ * @param key The key the value belongs to, for the error message.
+ * @param value The text to parse.
+ * @return The number.
+ * @throws std::runtime_error If the text is not a number.
+ */
+uint64_t parseNumber(const std::string& key, const std::string& value) {
+    size_t used = 0;
+    uint64_t number = 0;
+    try {
+        number = std::stoull(value, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != value.size()) {
+        throw std::runtime_error("Invalid value for " + key + ": " + value);
+    }
+    return number;
+}
+
+} // namespace
+
+VectorGenerator::Spec VectorGenerator::parse(const std::string& text) {
+    Spec spec;
+    std::istringstream items(text);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        size_t equals = item.find('=');
+        if (equals == std::string::npos) {
+            throw std::runtime_error("Expected key=value in generator spec: " + item);
+        }
+        std::string key = item.substr(0, equals);
+        std::string value = item.substr(equals + 1);
+
+        if (key == "count") {
+            spec.count = parseNumber(key, value);
+        } else if (key == "dim") {
+            size_t dash = value.find('-');
+            uint64_t low = parseNumber(key, value.substr(0, dash));
+            uint64_t high = dash == std::string::npos ? low : parseNumber(key, value.substr(dash + 1));
+            if (low == 0 || high < low || high > UINT32_MAX / sizeof(double)) {
+                throw std::runtime_error("Invalid dimension range: " + value);
+            }
+            spec.minDim = static_cast<uint32_t>(low);
+            spec.maxDim = static_cast<uint32_t>(high);
+        } else if (key == "dist") {
+            if (value == "uniform") {
+                spec.distribution = Distribution::Uniform;
+            } else if (value == "normal") {
+                spec.distribution = Distribution::Normal;
+            } else if (value == "constant") {
+                spec.distribution = Distribution::Constant;
+            } else {
+                throw std::runtime_error("Unknown distribution: " + value);
+            }
+        } else if (key == "seed") {
+            spec.seed = parseNumber(key, value);
+        } else if (key == "rate") {
+            spec.rate = static_cast<double>(parseNumber(key, value));
+        } else {
+            throw std::runtime_error("Unknown generator spec key: " + key);
+        }
+    }
+    if (spec.count > UINT32_MAX) {
+        throw std::runtime_error("At most 4294967295 vectors can be sent in one run");
+    }
+    return spec;
+}
+
+VectorGenerator::VectorGenerator(const Spec& spec) : spec(spec), spare(0), hasSpare(false) {
+    uint64_t seed = spec.seed;
+    for (auto& word : state) {
+        word = splitmix64(seed);
+    }
+}
+
+uint64_t VectorGenerator::nextBits() {
+    const uint64_t result = rotl(state[1] * 5, 7) * 9;
+    const uint64_t t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 45);
+    return result;
+}
+
+double VectorGenerator::nextUniform() {
+    return static_cast<double>(nextBits() >> 11) * 0x1.0p-53;
+}
+
+/**
+ * @brief Uses the Marsaglia polar method, which yields two values per accepted pair.
+ */
+double VectorGenerator::nextNormal() {
+    if (hasSpare) {
+        hasSpare = false;
+        return spare;
+    }
+    double u, v, s;
+    do {
+        u = 2.0 * nextUniform() - 1.0;
+        v = 2.0 * nextUniform() - 1.0;
+        s = u * u + v * v;
+    } while (s >= 1.0 || s == 0.0);
+    double factor = std::sqrt(-2.0 * std::log(s) / s);
+    spare = v * factor;
+    hasSpare = true;
+    return u * factor;
+}
+
+void VectorGenerator::next(std::vector<double>& vec) {
+    uint32_t dim = spec.minDim;
+    if (spec.maxDim > spec.minDim) {
+        dim += static_cast<uint32_t>(nextBits() % (uint64_t(spec.maxDim) - spec.minDim + 1));
+    }
+    vec.resize(dim);
+    switch (spec.distribution) {
+        case Distribution::Uniform:
+            for (auto& value : vec) {
+                value = nextUniform();
+            }
+            break;
+        case Distribution::Normal:
+            for (auto& value : vec) {
+                value = nextNormal();
+            }
+            break;
+        case Distribution::Constant:
+            std::fill(vec.begin(), vec.end(), 1.0);
+            break;
+    }
+}
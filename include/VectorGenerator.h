@@ -0,0 +1,106 @@
+/**
+ * @file VectorGenerator.h
+ * @brief Header file for the VectorGenerator class, which synthesizes input vectors for load testing.
+ * 
+ * This file defines the `VectorGenerator` class and its `Spec` description. Instead of reading an
+ * input file, the client can generate vectors in memory with a fast pseudo-random generator, so
+ * the load sent to the server is not limited by text parsing.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef VECTOR_GENERATOR_H
+#define VECTOR_GENERATOR_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @class VectorGenerator
+ * @brief Deterministic generator of vectors with fixed or random dimensions.
+ * 
+ * The generator is based on xoshiro256** seeded through splitmix64; the same specification always
+ * produces the same sequence of vectors.
+ */
+class VectorGenerator {
+public:
+    /**
+     * @brief Distributions of the generated values.
+     */
+    enum class Distribution {
+        Uniform,  /**< Uniform in [0, 1). */
+        Normal,   /**< Standard normal. */
+        Constant  /**< Every value is 1. */
+    };
+
+    /**
+     * @struct Spec
+     * @brief Parsed `--generate` specification.
+     */
+    struct Spec {
+        uint64_t count = 1000;                          /**< Number of vectors. */
+        uint32_t minDim = 16;                           /**< Smallest dimension. */
+        uint32_t maxDim = 16;                           /**< Largest dimension (equal to minDim for fixed). */
+        Distribution distribution = Distribution::Uniform; /**< Distribution of the values. */
+        uint64_t seed = 1;                              /**< Seed of the generator. */
+        double rate = 0;                                /**< Target vectors per second, 0 for as fast as possible. */
+    };
+
+    /**
+     * @brief Parses a specification such as `count=100000,dim=8-64,dist=normal,rate=5000`.
+     * 
+     * Recognized keys are `count`, `dim` (a number or `min-max`), `dist` (`uniform`, `normal` or
+     * `constant`), `seed` and `rate`. Keys that are not given keep their defaults.
+     * 
+     * @param text The specification.
+     * @return The parsed specification.
+     * @throws std::runtime_error If a key is unknown or a value is invalid.
+     */
+    static Spec parse(const std::string& text);
+
+    /**
+     * @brief Creates a generator for a specification.
+     * 
+     * @param spec The specification.
+     */
+    explicit VectorGenerator(const Spec& spec);
+
+    /**
+     * @brief Generates the next vector.
+     * 
+     * @param vec Receives the vector; its storage is reused between calls.
+     */
+    void next(std::vector<double>& vec);
+
+private:
+    /**
+     * @brief Returns the next 64 random bits.
+     * 
+     * @return A pseudo-random number.
+     */
+    uint64_t nextBits();
+
+    /**
+     * @brief Returns a uniformly distributed number in [0, 1).
+     * 
+     * @return A pseudo-random number.
+     */
+    double nextUniform();
+
+    /**
+     * @brief Returns a standard normally distributed number.
+     * 
+     * @return A pseudo-random number.
+     */
+    double nextNormal();
+
+    Spec spec;          /**< The specification. */
+    uint64_t state[4];  /**< State of xoshiro256**. */
+    double spare;       /**< Second value of the last polar transform. */
+    bool hasSpare;      /**< Whether `spare` is unused. */
+};
+
+#endif // VECTOR_GENERATOR_H
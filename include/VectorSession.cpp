@@ -0,0 +1,370 @@
+/**
+ * @file VectorSession.cpp
+ * @brief Implementation of the VectorSession class, which exchanges vectors with the server.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "VectorSession.h"
+#include "XorCodec.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <string>
+
+VectorSession::VectorSession(Communicator& comm, LatencyHistogram* latency)
+    : comm(&comm), latency(latency), hedgePercentile(0), remaining(0), batchRoundTrip(0), compression(false),
+      compressedFrom(0), compressedTo(0), compressNs(0), compressSkips(0), sparseAccepted(false), sparseCount(0),
+      sparseFrom(0), sparseTo(0) {}
+
+void VectorSession::hedge(double percentile, Spare spare) {
+    hedgePercentile = percentile;
+    this->spare = std::move(spare);
+    observed = std::make_unique<LatencyHistogram>();
+}
+
+bool VectorSession::negotiate(uint32_t probe, uint32_t ack) {
+    comm->sendMessage(reinterpret_cast<const char*>(&probe), sizeof(probe));
+    uint32_t answer = 0;
+    try {
+        if (!comm->waitReadable(NEGOTIATION_TIMEOUT)) {
+            return false;
+        }
+        comm->receiveMessage(reinterpret_cast<char*>(&answer), sizeof(answer));
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    return answer == ack;
+}
+
+/**
+ * @brief The probe exchange involves no work on the server, so its latency is the round trip the
+ * frame sizing starts from.
+ */
+bool VectorSession::negotiateBatching() {
+    const auto start = std::chrono::steady_clock::now();
+    if (!negotiate(BATCH_PROBE, BATCH_ACK)) {
+        return false;
+    }
+    batchRoundTrip = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    sizer = std::make_unique<BatchSizer>(batchRoundTrip);
+    // Sized for the largest frame up front, so a growing frame size does not allocate mid-job
+    frame.reserve(BatchSizer::MAX_VECTORS + 3);
+    return true;
+}
+
+bool VectorSession::batching() const {
+    return sizer != nullptr;
+}
+
+VectorSession::Extensions VectorSession::extensions() const {
+    Extensions accepted;
+    accepted.batching = batching();
+    accepted.roundTripNs = batchRoundTrip;
+    accepted.compression = compression;
+    accepted.sparse = sparseAccepted;
+    return accepted;
+}
+
+void VectorSession::resume(const Extensions& accepted) {
+    if (accepted.batching) {
+        batchRoundTrip = accepted.roundTripNs;
+        sizer = std::make_unique<BatchSizer>(batchRoundTrip);
+        frame.reserve(BatchSizer::MAX_VECTORS + 3);
+    }
+    compression = accepted.compression;
+    sparseAccepted = accepted.sparse;
+}
+
+bool VectorSession::negotiateCompression() {
+    compression = negotiate(COMPRESSION_PROBE, COMPRESSION_ACK);
+    return compression;
+}
+
+bool VectorSession::compressing() const {
+    return compression;
+}
+
+bool VectorSession::negotiateSparse() {
+    sparseAccepted = negotiate(SPARSE_PROBE, SPARSE_ACK);
+    return sparseAccepted;
+}
+
+bool VectorSession::sparse() const {
+    return sparseAccepted;
+}
+
+/**
+ * @brief Encoding costs CPU time on both sides, so payloads below the threshold, where the header
+ * and the round trip dominate anyway, are left alone, and so are the payloads following one that
+ * did not shrink.
+ */
+template <typename T>
+size_t VectorSession::compress(const T* values, size_t count) {
+    const size_t rawSize = count * sizeof(T);
+    if (!compression || rawSize < COMPRESSION_THRESHOLD || count > MAX_FLAGGED_SIZE) {
+        return 0;
+    }
+    if (compressSkips > 0) {
+        --compressSkips;
+        return 0;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    packed.resize(XorCodec::maxEncodedSize(count, sizeof(T)));
+    size_t packedSize = XorCodec::encode(values, count, sizeof(T), packed.data());
+    if (packedSize >= rawSize) {
+        packedSize = 0;
+        compressSkips = COMPRESSION_BACKOFF;
+    }
+    const uint64_t elapsed = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    compressNs += elapsed;
+    compressedFrom += rawSize;
+    compressedTo += packedSize > 0 ? packedSize : rawSize;
+    Stats::addTime(Stats::Phase::Compress, elapsed);
+    Stats::add(Stats::Counter::CompressInputBytes, rawSize);
+    Stats::add(Stats::Counter::CompressOutputBytes, packedSize > 0 ? packedSize : rawSize);
+    return packedSize;
+}
+
+/**
+ * @brief The decision needs only the nonzero count: N pairs and the count word against the dense values.
+ */
+template <typename T>
+size_t VectorSession::sparsify(const T* values, size_t count, size_t nonzeros) {
+    const size_t denseSize = count * sizeof(T);
+    const size_t pairsSize = nonzeros * (sizeof(uint32_t) + sizeof(T));
+    if (!sparseAccepted || pairsSize + sizeof(uint32_t) >= denseSize || count > MAX_FLAGGED_SIZE) {
+        return 0;
+    }
+    packed.resize(pairsSize);
+    uint8_t* positions = packed.data();
+    uint8_t* nonzero = packed.data() + nonzeros * sizeof(uint32_t);
+    for (size_t i = 0; i < count; ++i) {
+        if (!BasicVectorBatch<T>::isZero(values[i])) {
+            const uint32_t position = static_cast<uint32_t>(i);
+            std::memcpy(positions, &position, sizeof(position));
+            std::memcpy(nonzero, &values[i], sizeof(T));
+            positions += sizeof(position);
+            nonzero += sizeof(T);
+        }
+    }
+    ++sparseCount;
+    sparseFrom += denseSize;
+    sparseTo += pairsSize + sizeof(uint32_t);
+    Stats::add(Stats::Counter::SparseInputBytes, denseSize);
+    Stats::add(Stats::Counter::SparseOutputBytes, pairsSize + sizeof(uint32_t));
+    return pairsSize;
+}
+
+uint32_t VectorSession::sizeWord(size_t count) const {
+    const size_t limit = compression || sparseAccepted ? MAX_FLAGGED_SIZE : UINT32_MAX;
+    if (count > limit) {
+        throw std::runtime_error("Vector of " + std::to_string(count) + " values is too large to send");
+    }
+    return static_cast<uint32_t>(count);
+}
+
+void VectorSession::announce(size_t count) {
+    if (count > MAX_COUNT) {
+        throw std::runtime_error("Job of " + std::to_string(count) + " vectors is too large to announce");
+    }
+    const uint32_t word = static_cast<uint32_t>(count);
+    comm->sendMessage(reinterpret_cast<const char*>(&word), sizeof(word));
+    remaining = word;
+}
+
+/**
+ * @brief The nonzero values are counted only when sparse payloads are accepted.
+ */
+template <typename T>
+T VectorSession::exchange(const T* data, size_t size) {
+    size_t nonzeros = size;
+    if (sparseAccepted) {
+        nonzeros = 0;
+        for (size_t i = 0; i < size; ++i) {
+            nonzeros += !BasicVectorBatch<T>::isZero(data[i]);
+        }
+    }
+    return exchange(data, size, nonzeros);
+}
+
+/**
+ * @brief Exchanges one vector while it is counted in the in-flight gauge. Hedging starts once
+ * enough latencies have been observed for the percentile to mean something.
+ */
+template <typename T>
+T VectorSession::exchange(const T* data, size_t size, size_t nonzeros) {
+    const uint64_t sentAt = Stats::now();
+    const auto started = std::chrono::steady_clock::now();
+    uint32_t header[2] = {sizeWord(size), 0};
+    size_t headerSize = sizeof(header[0]);
+    const char* payload = reinterpret_cast<const char*>(data);
+    size_t payloadSize = size * sizeof(T);
+    if (const size_t pairsSize = sparsify(data, size, nonzeros)) {
+        header[0] |= SPARSE;
+        header[1] = static_cast<uint32_t>(nonzeros);
+        headerSize = sizeof(header);
+        payload = reinterpret_cast<const char*>(packed.data());
+        payloadSize = pairsSize;
+    } else if (const size_t packedSize = compress(data, size)) {
+        header[0] |= COMPRESSED;
+        header[1] = static_cast<uint32_t>(packedSize);
+        headerSize = sizeof(header);
+        payload = reinterpret_cast<const char*>(packed.data());
+        payloadSize = packedSize;
+    }
+    T result;
+    Stats::adjust(Stats::Gauge::InFlight, 1);
+    try {
+        if (observed && observed->count() >= HEDGE_MIN_SAMPLES) {
+            exchangeHedged(reinterpret_cast<const char*>(header), headerSize, payload, payloadSize,
+                           reinterpret_cast<char*>(&result), sizeof(result));
+        } else {
+            comm->exchange(reinterpret_cast<const char*>(header), headerSize, payload, payloadSize,
+                           reinterpret_cast<char*>(&result), sizeof(result));
+        }
+    } catch (...) {
+        Stats::adjust(Stats::Gauge::InFlight, -1);
+        throw;
+    }
+    Stats::adjust(Stats::Gauge::InFlight, -1);
+    if (observed) {
+        observed->record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count()));
+    }
+    if (remaining > 0) {
+        --remaining;
+    }
+    if (Stats::enabled()) {
+        Stats::recordLatency(Stats::now() - sentAt, latency);
+        Stats::add(Stats::Counter::Vectors);
+    }
+    return result;
+}
+
+/**
+ * @brief The spare connection gets its own job of the vectors still unanswered, starting with the
+ * late one. While both are outstanding the two connections are polled in turn, for no longer than
+ * the operation timeout of the job's connection; after that the final receive reports the timeout.
+ */
+void VectorSession::exchangeHedged(const char* header, size_t headerSize, const char* payload, size_t payloadSize,
+                                   char* result, size_t resultSize) {
+    comm->sendMessage(header, headerSize, payload, payloadSize);
+
+    const auto delay = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::nanoseconds(observed->valueAtPercentile(hedgePercentile)));
+    if (!comm->waitReadable(delay)) {
+        std::unique_ptr<Communicator> second = spare();
+        if (second) {
+            Stats::add(Stats::Counter::Hedges);
+            try {
+                second->sendMessage(reinterpret_cast<const char*>(&remaining), sizeof(remaining));
+                second->sendMessage(header, headerSize, payload, payloadSize);
+            } catch (const std::runtime_error&) {
+                second.reset();
+            }
+        }
+        if (second) {
+            const auto timeout = comm->timeout();
+            const auto until = timeout.count() > 0 ? std::chrono::steady_clock::now() + timeout
+                                                   : std::chrono::steady_clock::time_point::max();
+            while (!comm->waitReadable(HEDGE_SLICE) && std::chrono::steady_clock::now() < until) {
+                if (second->waitReadable(HEDGE_SLICE)) {
+                    Stats::add(Stats::Counter::HedgeWins);
+                    adopted = std::move(second);
+                    comm = adopted.get();
+                    break;
+                }
+            }
+        }
+    }
+
+    comm->receiveMessage(result, resultSize);
+}
+
+/**
+ * @brief A frame's values are contiguous in the batch, so they are sent straight from it behind
+ * the header and offsets (or encoded in one piece when compressed or sparse); the results are
+ * received straight into the caller's array. The latency histograms record one sample per frame.
+ */
+template <typename T>
+void VectorSession::exchange(const BasicVectorBatch<T>& batch, T* results) {
+    if (!sizer) {
+        for (size_t i = 0; i < batch.size(); ++i) {
+            results[i] = exchange(batch[i].data(), batch[i].size(), batch.nonzeros(i));
+        }
+        return;
+    }
+    if (batch.empty()) {
+        return;
+    }
+    const size_t vectorBytes = batch.valueCount() * sizeof(T) / batch.size() + sizeof(uint32_t);
+    for (size_t first = 0; first < batch.size();) {
+        const size_t count = std::min(sizer->next(vectorBytes), batch.size() - first);
+        const T* values = batch[first].data();
+        frame.resize(count + 2);
+        frame[0] = static_cast<uint32_t>(count);
+        size_t nonzeros = 0;
+        size_t end = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const typename BasicVectorBatch<T>::View vec = batch[first + i];
+            end = static_cast<size_t>(vec.data() + vec.size() - values);
+            frame[2 + i] = static_cast<uint32_t>(end);
+            nonzeros += batch.nonzeros(first + i);
+        }
+        // Every end offset is at most the value count, so checking that covers them all
+        frame[1] = sizeWord(end);
+        const char* payload = reinterpret_cast<const char*>(values);
+        size_t payloadSize = frame[1] * sizeof(T);
+        if (const size_t pairsSize = sparsify(values, frame[1], nonzeros)) {
+            frame[1] |= SPARSE;
+            frame.push_back(static_cast<uint32_t>(nonzeros));
+            payload = reinterpret_cast<const char*>(packed.data());
+            payloadSize = pairsSize;
+        } else if (const size_t packedSize = compress(values, frame[1])) {
+            frame[1] |= COMPRESSED;
+            frame.push_back(static_cast<uint32_t>(packedSize));
+            payload = reinterpret_cast<const char*>(packed.data());
+            payloadSize = packedSize;
+        }
+
+        const uint64_t sentAt = Stats::now();
+        const auto started = std::chrono::steady_clock::now();
+        Stats::adjust(Stats::Gauge::InFlight, static_cast<int64_t>(count));
+        try {
+            comm->exchange(reinterpret_cast<const char*>(frame.data()), frame.size() * sizeof(uint32_t),
+                           payload, payloadSize,
+                           reinterpret_cast<char*>(results + first), count * sizeof(T));
+        } catch (...) {
+            Stats::adjust(Stats::Gauge::InFlight, -static_cast<int64_t>(count));
+            throw;
+        }
+        Stats::adjust(Stats::Gauge::InFlight, -static_cast<int64_t>(count));
+        sizer->record(count, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count()));
+        remaining -= std::min<uint32_t>(remaining, static_cast<uint32_t>(count));
+        if (Stats::enabled()) {
+            Stats::recordLatency(Stats::now() - sentAt, latency);
+            Stats::add(Stats::Counter::Vectors, count);
+        }
+        first += count;
+    }
+}
+
+template float VectorSession::exchange(const float*, size_t);
+template double VectorSession::exchange(const double*, size_t);
+template int32_t VectorSession::exchange(const int32_t*, size_t);
+template int64_t VectorSession::exchange(const int64_t*, size_t);
+template float VectorSession::exchange(const float*, size_t, size_t);
+template double VectorSession::exchange(const double*, size_t, size_t);
+template int32_t VectorSession::exchange(const int32_t*, size_t, size_t);
+template int64_t VectorSession::exchange(const int64_t*, size_t, size_t);
+template void VectorSession::exchange(const BasicVectorBatch<float>&, float*);
+template void VectorSession::exchange(const BasicVectorBatch<double>&, double*);
+template void VectorSession::exchange(const BasicVectorBatch<int32_t>&, int32_t*);
+template void VectorSession::exchange(const BasicVectorBatch<int64_t>&, int64_t*);
@@ -0,0 +1,401 @@
+/**
+ * @file VectorSession.h
+ * @brief Header file for the VectorSession class, which exchanges vectors with the server.
+ * 
+ * This file defines the `VectorSession` class. After authentication the client announces the
+ * number of vectors and then, for every vector, sends its size and values and receives one result.
+ * Optionally, vectors whose result is late are hedged on a spare connection, and many vectors
+ * travel in one batch frame, large payloads travel compressed or mostly-zero payloads travel as
+ * index/value pairs when the server supports it.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef VECTOR_SESSION_H
+#define VECTOR_SESSION_H
+
+#include "Communicator.h"
+#include "LatencyHistogram.h"
+#include "VectorBatch.h"
+#include "BatchSizer.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @class VectorSession
+ * @brief The vector exchange of one job over an authenticated connection.
+ * 
+ * Each vector is sent with a single write (size and values gathered from the caller's memory) and
+ * its result is read into a local variable, so an exchange performs no heap allocations.
+ * 
+ * With hedging enabled, a result that has not arrived after the chosen percentile of the latencies
+ * observed so far is requested again: the job's remaining vectors are announced on a spare,
+ * authenticated connection and the late vector is sent there too. Whichever connection answers
+ * first carries the rest of the job, and the other one is abandoned, so one stalled connection
+ * delays the job by about one percentile latency instead of indefinitely.
+ * 
+ * Batch frames are an extension the server has to accept: before the vector count, the client
+ * sends `BATCH_PROBE`, which no real count can be, and a server supporting frames answers
+ * `BATCH_ACK`. After the count, every frame then carries K vectors as one block: K and the total
+ * number of values T, the end offset of every vector within the values (K 32-bit words), and the
+ * T values; the reply is K results. The frame size is chosen by a `BatchSizer`. Hedging applies
+ * to the exchange of single vectors only.
+ * 
+ * Compression is negotiated the same way, with `COMPRESSION_PROBE` and `COMPRESSION_ACK`. From
+ * then on, the values of a vector or frame of at least `COMPRESSION_THRESHOLD` bytes are encoded
+ * with `XorCodec` if that makes them smaller: the `COMPRESSED` bit is set in the vector size (or
+ * in T for a frame), the size of the encoding follows as one more 32-bit word, and the encoding
+ * replaces the values. Results always travel uncompressed. Data the codec cannot shrink, such as
+ * full-precision decimal fractions, goes out raw, and the next `COMPRESSION_BACKOFF` payloads are
+ * not even tried.
+ * 
+ * Sparse payloads are negotiated with `SPARSE_PROBE` and `SPARSE_ACK`. A vector (or frame) whose
+ * nonzero values take less space as pairs than the dense values is then sent with the `SPARSE`
+ * bit set in its size (or in T), the number of nonzero values N as one more 32-bit word, and N
+ * 32-bit positions followed by the N values instead of the dense values; every other value is
+ * zero. The choice is made per payload from the nonzero counts the batch keeps, and a payload sent
+ * sparse is not compressed.
+ * 
+ * Once compression or sparse payloads are accepted, the two top bits of a size are flags, so a
+ * vector (or frame) of more than `MAX_FLAGGED_SIZE` values cannot be sent at all; the exchange
+ * throws instead of sending a size the server would misread.
+ * 
+ * The exchanges are member templates over the element type of the vectors, which is also the type
+ * of the results; they are instantiated for `float`, `double`, `int32_t` and `int64_t`. The
+ * server has to be configured for the same type, since nothing on the wire says which one it is.
+ */
+class VectorSession {
+public:
+    /// Source of spare authenticated connections; returns `nullptr` if none is ready at once
+    using Spare = std::function<std::unique_ptr<Communicator>()>;
+
+    /// Number of latencies observed before the first vector is hedged
+    static constexpr uint64_t HEDGE_MIN_SAMPLES = 20;
+
+    /// How long each connection is polled in turn while a hedged vector is outstanding
+    static constexpr std::chrono::microseconds HEDGE_SLICE{200};
+
+    /// Word sent in place of the vector count to ask for batch frames
+    static constexpr uint32_t BATCH_PROBE = 0xFFFFFFFF;
+
+    /// Answer of a server that accepts batch frames ("BTCH" in little-endian byte order)
+    static constexpr uint32_t BATCH_ACK = 0x48435442;
+
+    /// How long the server has to answer a probe
+    static constexpr std::chrono::milliseconds NEGOTIATION_TIMEOUT{500};
+
+    /// Word sent in place of the vector count to ask for compressed payloads
+    static constexpr uint32_t COMPRESSION_PROBE = 0xFFFFFFFE;
+
+    /// Answer of a server that accepts compressed payloads ("XORC" in little-endian byte order)
+    static constexpr uint32_t COMPRESSION_ACK = 0x43524F58;
+
+    /// Bit of the vector size (or of a frame's value count) marking a compressed payload
+    static constexpr uint32_t COMPRESSED = 0x80000000;
+
+    /// Smallest payload in bytes that is compressed
+    static constexpr size_t COMPRESSION_THRESHOLD = 1024;
+
+    /// Payloads sent without trying to compress them after one whose encoding was not smaller
+    static constexpr unsigned COMPRESSION_BACKOFF = 16;
+
+    /// Word sent in place of the vector count to ask for sparse payloads
+    static constexpr uint32_t SPARSE_PROBE = 0xFFFFFFFD;
+
+    /// Answer of a server that accepts sparse payloads ("SPRS" in little-endian byte order)
+    static constexpr uint32_t SPARSE_ACK = 0x53525053;
+
+    /// Bit of the vector size (or of a frame's value count) marking a sparse payload
+    static constexpr uint32_t SPARSE = 0x40000000;
+
+    /// Largest vector size (or frame value count) below the flag bits, once either flag is accepted
+    static constexpr uint32_t MAX_FLAGGED_SIZE = SPARSE - 1;
+
+    /// Largest number of vectors a job can announce; the words above it are the probes
+    static constexpr uint32_t MAX_COUNT = SPARSE_PROBE - 1;
+
+    /**
+     * @brief The extensions a server accepted on a connection.
+     * 
+     * Lets a session continue with what an earlier session negotiated on the same connection,
+     * such as the one that authenticated it for a `SessionPool`.
+     */
+    struct Extensions {
+        bool batching = false;    /**< Whether batch frames were accepted. */
+        uint64_t roundTripNs = 0; /**< Round trip of the batch probe, where frame sizing starts. */
+        bool compression = false; /**< Whether compressed payloads were accepted. */
+        bool sparse = false;      /**< Whether sparse payloads were accepted. */
+
+        /**
+         * @brief Compares the accepted extensions, ignoring the round trip.
+         * 
+         * @param other The extensions to compare with.
+         * @return `true` if both accept the same extensions.
+         */
+        bool operator==(const Extensions& other) const {
+            return batching == other.batching && compression == other.compression && sparse == other.sparse;
+        }
+    };
+
+    /**
+     * @brief Creates a session on an authenticated connection.
+     * 
+     * @param comm The connection; it must outlive the session.
+     * @param latency Latency histogram of the connection, or `nullptr`.
+     */
+    explicit VectorSession(Communicator& comm, LatencyHistogram* latency = nullptr);
+
+    /**
+     * @brief Enables hedging of late results.
+     * 
+     * Must be called before `announce`.
+     * 
+     * @param percentile The latency percentile after which a vector is hedged, between 0 and 100.
+     * @param spare The source of spare connections.
+     */
+    void hedge(double percentile, Spare spare);
+
+    /**
+     * @brief Asks the server to accept batch frames.
+     * 
+     * Must be called before `announce`. When the server does not answer in time or answers
+     * anything else, it has taken the probe for a vector count, and the connection cannot be
+     * used any more: the caller has to connect again and exchange single vectors.
+     * 
+     * @return `true` if the server accepted batch frames.
+     */
+    bool negotiateBatching();
+
+    /**
+     * @brief Returns the extensions negotiated so far.
+     * 
+     * @return The accepted extensions.
+     */
+    Extensions extensions() const;
+
+    /**
+     * @brief Uses extensions negotiated earlier on the same connection instead of negotiating them.
+     * 
+     * Must be called before `announce`, on a session whose connection has not been used since.
+     * 
+     * @param accepted The extensions the server accepted on the connection.
+     */
+    void resume(const Extensions& accepted);
+
+    /**
+     * @brief Returns whether vectors are sent in batch frames.
+     * 
+     * @return `true` after a successful `negotiateBatching`.
+     */
+    bool batching() const;
+
+    /**
+     * @brief Asks the server to accept compressed payloads.
+     * 
+     * Must be called before `announce`; a refusal leaves the connection unusable, as with
+     * `negotiateBatching`.
+     * 
+     * @return `true` if the server accepted compressed payloads.
+     */
+    bool negotiateCompression();
+
+    /**
+     * @brief Returns whether large payloads are compressed.
+     * 
+     * @return `true` after a successful `negotiateCompression`.
+     */
+    bool compressing() const;
+
+    /**
+     * @brief Returns the number of payload bytes passed to the compressor so far.
+     * 
+     * @return The uncompressed size of every payload above the threshold.
+     */
+    uint64_t compressionInput() const { return compressedFrom; }
+
+    /**
+     * @brief Returns the number of bytes sent for the payloads passed to the compressor.
+     * 
+     * @return The size of the encodings, or of the raw values where encoding did not help.
+     */
+    uint64_t compressionOutput() const { return compressedTo; }
+
+    /**
+     * @brief Returns the time spent compressing.
+     * 
+     * @return The encoding time in nanoseconds.
+     */
+    uint64_t compressionTime() const { return compressNs; }
+
+    /**
+     * @brief Asks the server to accept sparse payloads.
+     * 
+     * Must be called before `announce`; a refusal leaves the connection unusable, as with
+     * `negotiateBatching`.
+     * 
+     * @return `true` if the server accepted sparse payloads.
+     */
+    bool negotiateSparse();
+
+    /**
+     * @brief Returns whether mostly-zero payloads are sent as index/value pairs.
+     * 
+     * @return `true` after a successful `negotiateSparse`.
+     */
+    bool sparse() const;
+
+    /**
+     * @brief Returns the number of payloads sent as index/value pairs so far.
+     * 
+     * @return The number of sparse vectors and frames.
+     */
+    uint64_t sparsePayloads() const { return sparseCount; }
+
+    /**
+     * @brief Returns the dense size of the payloads sent as index/value pairs.
+     * 
+     * @return The size of their values in bytes.
+     */
+    uint64_t sparseInput() const { return sparseFrom; }
+
+    /**
+     * @brief Returns the number of bytes sent for the payloads sent as index/value pairs.
+     * 
+     * @return The size of the pairs and of the count word in bytes.
+     */
+    uint64_t sparseOutput() const { return sparseTo; }
+
+    /**
+     * @brief Announces how many vectors follow.
+     * 
+     * @param count The number of vectors.
+     * @throws std::runtime_error If the count is above `MAX_COUNT`, which the 32-bit count word
+     *                            cannot carry, or sending fails.
+     */
+    void announce(size_t count);
+
+    /**
+     * @brief Sends one vector to the server and waits for its result.
+     * 
+     * @tparam T The element type.
+     * @param data The values of the vector.
+     * @param size The number of values.
+     * @return The result computed by the server.
+     * @throws std::runtime_error If the vector is too large, or sending or receiving fails.
+     */
+    template <typename T>
+    T exchange(const T* data, size_t size);
+
+    /**
+     * @brief Sends one vector whose nonzero values are already counted and waits for its result.
+     * 
+     * Saves `exchange` a pass over the values when sparse payloads are accepted.
+     * 
+     * @tparam T The element type.
+     * @param data The values of the vector.
+     * @param size The number of values.
+     * @param nonzeros The number of values that are not zero, as counted by `BasicVectorBatch`.
+     * @return The result computed by the server.
+     * @throws std::runtime_error If the vector is too large, or sending or receiving fails.
+     */
+    template <typename T>
+    T exchange(const T* data, size_t size, size_t nonzeros);
+
+    /**
+     * @brief Sends all vectors of a batch and stores their results.
+     * 
+     * With batch frames the vectors go out in frames sized by the `BatchSizer`; otherwise they
+     * are exchanged one by one.
+     * 
+     * @tparam T The element type.
+     * @param batch The vectors.
+     * @param results Receives one result per vector, in order.
+     * @throws std::runtime_error If a vector is too large, or sending or receiving fails.
+     */
+    template <typename T>
+    void exchange(const BasicVectorBatch<T>& batch, T* results);
+
+private:
+    /**
+     * @brief Sends a probe in place of the vector count and checks the server's answer.
+     * 
+     * @param probe The probe word.
+     * @param ack The answer of a server accepting the extension.
+     * @return `true` if the server answered `ack` in time.
+     */
+    bool negotiate(uint32_t probe, uint32_t ack);
+
+    /**
+     * @brief Encodes a payload into `packed` if it is large enough and the encoding is smaller.
+     * 
+     * @param values The values.
+     * @param count The number of values.
+     * @return The size of the encoding, or 0 if the values are to be sent as they are.
+     */
+    template <typename T>
+    size_t compress(const T* values, size_t count);
+
+    /**
+     * @brief Writes the positions and values of the nonzero values into `packed` if that is smaller.
+     * 
+     * @param values The values.
+     * @param count The number of values.
+     * @param nonzeros The number of values that are not zero.
+     * @return The size of the pairs, or 0 if the values are to be sent dense.
+     */
+    template <typename T>
+    size_t sparsify(const T* values, size_t count, size_t nonzeros);
+
+    /**
+     * @brief Returns the size word of a vector or the value count of a frame, without flags.
+     * 
+     * @param count The number of values.
+     * @return The count as a 32-bit word.
+     * @throws std::runtime_error If the count does not fit below the flag bits in use.
+     */
+    uint32_t sizeWord(size_t count) const;
+
+    /**
+     * @brief Sends a vector and waits for its result, hedging it once it is late.
+     * 
+     * @param header The header of the vector: its size and, if compressed or sparse, the encoded
+     *               size or the number of nonzero values.
+     * @param headerSize The size of the header in bytes.
+     * @param payload The values of the vector or their encoding.
+     * @param payloadSize The size of the payload in bytes.
+     * @param result Receives the result.
+     * @param resultSize The size of the result in bytes.
+     * @throws std::runtime_error If sending or receiving fails.
+     */
+    void exchangeHedged(const char* header, size_t headerSize, const char* payload, size_t payloadSize,
+                        char* result, size_t resultSize);
+
+    Communicator* comm;         /**< The connection carrying the job. */
+    LatencyHistogram* latency;  /**< Latency histogram of the connection, or `nullptr`. */
+    std::unique_ptr<Communicator> adopted; /**< A spare connection that took over the job, or `nullptr`. */
+    Spare spare;                /**< Source of spare connections, empty without hedging. */
+    double hedgePercentile;     /**< Percentile after which a vector is hedged. */
+    std::unique_ptr<LatencyHistogram> observed; /**< Latencies of this session, kept for hedging. */
+    uint32_t remaining;         /**< Vectors announced but not yet answered. */
+    std::unique_ptr<BatchSizer> sizer; /**< Frame sizing, `nullptr` without batch frames. */
+    uint64_t batchRoundTrip;    /**< Round trip of the batch probe in nanoseconds. */
+    std::vector<uint32_t> frame;       /**< Header and offsets of the frame being sent, reused. */
+    bool compression;           /**< Whether the server accepts compressed payloads. */
+    std::vector<uint8_t> packed; /**< Encoding of the payload being sent, reused. */
+    uint64_t compressedFrom;    /**< Payload bytes passed to the compressor. */
+    uint64_t compressedTo;      /**< Bytes sent for them. */
+    uint64_t compressNs;        /**< Time spent compressing in nanoseconds. */
+    unsigned compressSkips;     /**< Payloads still to be sent without trying to compress them. */
+    bool sparseAccepted;        /**< Whether the server accepts sparse payloads. */
+    uint64_t sparseCount;       /**< Payloads sent as index/value pairs. */
+    uint64_t sparseFrom;        /**< Dense bytes of those payloads. */
+    uint64_t sparseTo;          /**< Bytes sent for them. */
+};
+
+#endif // VECTOR_SESSION_H
@@ -0,0 +1,224 @@
+/**
+ * @file XorCodec.cpp
+ * @brief Implementation of the XorCodec class, which compresses vector payloads.
+ * 
+ * Bits are collected in a 64-bit accumulator and written out byte by byte, so neither direction
+ * touches memory more than once per byte. Fields wider than 32 bits are split in two, which keeps
+ * the accumulator from overflowing.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include "XorCodec.h"
+
+#include <stdexcept>
+#include <cstring>
+
+namespace {
+
+/**
+ * @class BitWriter
+ * @brief Appends bit fields to a byte buffer, most significant bit first.
+ */
+class BitWriter {
+public:
+    /**
+     * @brief Starts writing at `out`.
+     * 
+     * @param out The buffer, large enough for everything written.
+     */
+    explicit BitWriter(uint8_t* out) : start(out), position(out), buffer(0), pending(0) {}
+
+    /**
+     * @brief Writes the low `bits` bits of a value.
+     * 
+     * @param value The value.
+     * @param bits The number of bits, from 1 to 64.
+     */
+    void put(uint64_t value, unsigned bits) {
+        if (bits > 32) {
+            put(value >> 32, bits - 32);
+            value &= 0xFFFFFFFF;
+            bits = 32;
+        }
+        buffer = (buffer << bits) | (value & ((uint64_t(1) << bits) - 1));
+        pending += bits;
+        while (pending >= 8) {
+            pending -= 8;
+            *position++ = static_cast<uint8_t>(buffer >> pending);
+        }
+    }
+
+    /**
+     * @brief Writes the last partial byte, padded with zero bits.
+     * 
+     * @return The number of bytes written in total.
+     */
+    size_t finish() {
+        if (pending > 0) {
+            *position++ = static_cast<uint8_t>(buffer << (8 - pending));
+            pending = 0;
+        }
+        return static_cast<size_t>(position - start);
+    }
+
+private:
+    uint8_t* start;     /**< The beginning of the buffer. */
+    uint8_t* position;  /**< The next byte to write. */
+    uint64_t buffer;    /**< Bits not yet written, in the low `pending` bits. */
+    unsigned pending;   /**< Number of bits in `buffer`, less than 8 between calls. */
+};
+
+/**
+ * @class BitReader
+ * @brief Reads bit fields written by `BitWriter`.
+ */
+class BitReader {
+public:
+    /**
+     * @brief Starts reading a buffer.
+     * 
+     * @param data The buffer.
+     * @param size The size of the buffer in bytes.
+     */
+    BitReader(const uint8_t* data, size_t size) : position(data), end(data + size), buffer(0), available(0) {}
+
+    /**
+     * @brief Reads a field.
+     * 
+     * @param bits The width of the field, from 1 to 64.
+     * @return The field.
+     * @throws std::runtime_error If the buffer ends first.
+     */
+    uint64_t get(unsigned bits) {
+        if (bits > 32) {
+            const uint64_t high = get(bits - 32);
+            return (high << 32) | get(32);
+        }
+        while (available < bits) {
+            if (position == end) {
+                throw std::runtime_error("Malformed compressed payload");
+            }
+            buffer = (buffer << 8) | *position++;
+            available += 8;
+        }
+        available -= bits;
+        return (buffer >> available) & ((uint64_t(1) << bits) - 1);
+    }
+
+private:
+    const uint8_t* position; /**< The next byte to read. */
+    const uint8_t* end;      /**< The end of the buffer. */
+    uint64_t buffer;         /**< Bits read but not yet returned, in the low `available` bits. */
+    unsigned available;      /**< Number of bits in `buffer`. */
+};
+
+/**
+ * @brief Encodes words of one width.
+ */
+template <typename Word>
+size_t encodeWords(const void* values, size_t count, uint8_t* out) {
+    constexpr unsigned WIDTH = sizeof(Word) * 8;
+    const char* bytes = static_cast<const char*>(values);
+    BitWriter writer(out);
+    Word previous = 0;
+    unsigned windowLeading = WIDTH; // no window yet: nothing fits
+    unsigned windowTrailing = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Word value;
+        std::memcpy(&value, bytes + i * sizeof(Word), sizeof(Word));
+        const Word delta = value ^ previous;
+        previous = value;
+        if (i == 0) {
+            writer.put(value, WIDTH);
+            continue;
+        }
+        if (delta == 0) {
+            writer.put(0, 1);
+            continue;
+        }
+        const unsigned leading = static_cast<unsigned>(__builtin_clzll(delta)) - (64 - WIDTH);
+        const unsigned trailing = static_cast<unsigned>(__builtin_ctzll(delta));
+        if (leading >= windowLeading && trailing >= windowTrailing) {
+            writer.put(0b10, 2);
+            writer.put(delta >> windowTrailing, WIDTH - windowLeading - windowTrailing);
+            continue;
+        }
+        const unsigned length = WIDTH - leading - trailing;
+        writer.put(0b11, 2);
+        writer.put(leading, XorCodec::FIELD_BITS);
+        writer.put(length - 1, XorCodec::FIELD_BITS);
+        writer.put(delta >> trailing, length);
+        windowLeading = leading;
+        windowTrailing = trailing;
+    }
+    return writer.finish();
+}
+
+/**
+ * @brief Decodes words of one width.
+ */
+template <typename Word>
+void decodeWords(const uint8_t* data, size_t size, void* values, size_t count) {
+    constexpr unsigned WIDTH = sizeof(Word) * 8;
+    char* bytes = static_cast<char*>(values);
+    BitReader reader(data, size);
+    Word previous = 0;
+    unsigned windowLeading = WIDTH;
+    unsigned windowTrailing = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Word value;
+        if (i == 0) {
+            value = static_cast<Word>(reader.get(WIDTH));
+        } else if (reader.get(1) == 0) {
+            value = previous;
+        } else {
+            if (reader.get(1) == 1) {
+                const unsigned leading = static_cast<unsigned>(reader.get(XorCodec::FIELD_BITS));
+                const unsigned length = static_cast<unsigned>(reader.get(XorCodec::FIELD_BITS)) + 1;
+                if (leading + length > WIDTH) {
+                    throw std::runtime_error("Malformed compressed payload");
+                }
+                windowLeading = leading;
+                windowTrailing = WIDTH - leading - length;
+            } else if (windowLeading == WIDTH) {
+                throw std::runtime_error("Malformed compressed payload");
+            }
+            const Word delta = static_cast<Word>(reader.get(WIDTH - windowLeading - windowTrailing) << windowTrailing);
+            value = previous ^ delta;
+        }
+        std::memcpy(bytes + i * sizeof(Word), &value, sizeof(Word));
+        previous = value;
+    }
+}
+
+} // namespace
+
+/**
+ * @brief The worst case of a word is a new window of the full width: two control bits, two fields
+ * and the word itself.
+ */
+size_t XorCodec::maxEncodedSize(size_t count, size_t width) {
+    return (count * (width * 8 + 2 + 2 * FIELD_BITS) + 7) / 8;
+}
+
+size_t XorCodec::encode(const void* values, size_t count, size_t width, uint8_t* out) {
+    if (width == sizeof(uint64_t)) {
+        return encodeWords<uint64_t>(values, count, out);
+    }
+    if (width == sizeof(uint32_t)) {
+        return encodeWords<uint32_t>(values, count, out);
+    }
+    throw std::runtime_error("Unsupported value width for compression");
+}
+
+void XorCodec::decode(const uint8_t* data, size_t size, void* values, size_t count, size_t width) {
+    if (width == sizeof(uint64_t)) {
+        decodeWords<uint64_t>(data, size, values, count);
+    } else if (width == sizeof(uint32_t)) {
+        decodeWords<uint32_t>(data, size, values, count);
+    } else {
+        throw std::runtime_error("Unsupported value width for compression");
+    }
+}
@@ -0,0 +1,74 @@
+/**
+ * @file XorCodec.h
+ * @brief Header file for the XorCodec class, which compresses vector payloads.
+ * 
+ * This file defines the `XorCodec` class used by `VectorSession` once the server has accepted
+ * compressed payloads. It implements the XOR encoding of the Gorilla time series store, which
+ * needs no dictionary or entropy coder and works on the raw bits of the values, so it suits
+ * doubles and floats as well as integers.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#ifndef XOR_CODEC_H
+#define XOR_CODEC_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @class XorCodec
+ * @brief Encodes every value as the XOR with its predecessor, keeping only the bits that differ.
+ * 
+ * Values are treated as 32- or 64-bit words. The first word is stored as is. For every other word
+ * the XOR with the previous one is written as:
+ * - a single `0` bit if the words are equal;
+ * - `10` and the changed bits, if they fit into the window of changed bits of the previous
+ *   XOR (the same number of leading and trailing zeros or more);
+ * - `11`, the number of leading zeros and the length of the changed bits (`FIELD_BITS` each, the
+ *   length minus one) and the changed bits otherwise.
+ * 
+ * Bits are packed most significant first. Neighbouring values of real data usually share their
+ * sign, exponent and upper mantissa bits, and repeated values cost one bit.
+ */
+class XorCodec {
+public:
+    /// Width of the leading-zero and length fields in bits
+    static constexpr unsigned FIELD_BITS = 6;
+
+    /**
+     * @brief Returns an upper bound of the encoded size.
+     * 
+     * @param count The number of values.
+     * @param width The size of one value in bytes, 4 or 8.
+     * @return The largest number of bytes `encode` can write.
+     */
+    static size_t maxEncodedSize(size_t count, size_t width);
+
+    /**
+     * @brief Encodes values.
+     * 
+     * @param values The values.
+     * @param count The number of values.
+     * @param width The size of one value in bytes, 4 or 8.
+     * @param out Receives the encoding; at least `maxEncodedSize(count, width)` bytes.
+     * @return The number of bytes written.
+     * @throws std::runtime_error If the width is not supported.
+     */
+    static size_t encode(const void* values, size_t count, size_t width, uint8_t* out);
+
+    /**
+     * @brief Decodes values written by `encode`.
+     * 
+     * @param data The encoding.
+     * @param size The size of the encoding in bytes.
+     * @param values Receives the values.
+     * @param count The number of values to decode.
+     * @param width The size of one value in bytes, 4 or 8.
+     * @throws std::runtime_error If the width is not supported or the encoding is truncated or malformed.
+     */
+    static void decode(const uint8_t* data, size_t size, void* values, size_t count, size_t width);
+};
+
+#endif // XOR_CODEC_H
@@ -0,0 +1,660 @@
+/**
+ * @file integration.cpp
+ * @brief Integration and performance regression tests of the real client components.
+ * 
+ * Unlike `test.cpp`, which replaces `DataReader`, `DataWriter`, `Communicator` and `UserInterface`
+ * with mock classes, this program links the shipped sources. Jobs are read from real temporary
+ * files by `InputLoader`, run by `ClientJob` as the client runs them (authentication, negotiation
+ * of the extensions, vector count and exchange) against `LoopbackServer` over a socket pair, and
+ * written by `ResultWriter`; the results are checked against the local scalar reduction.
+ * 
+ * The performance tests fail when the job throughput drops below `MIN_VECTORS_PER_SECOND`, when a
+ * job allocates more than `MAX_ALLOCATIONS_PER_VECTOR` times per vector, or when streaming an
+ * input of more than twice `MAX_PEAK_RSS_BYTES` raises the peak resident set of the process above
+ * that limit. The limits leave a wide margin below what a development machine reaches, so only a
+ * real regression, not a noisy neighbour, trips them. A failing test prints its measurement, and
+ * `--verbose` prints all of them. The program is built with optimizations, like the client.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include <UnitTest++/UnitTest++.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "include/ClientJob.h"
+#include "include/Communicator.h"
+#include "include/DataReader.h"
+#include "include/DataWriter.h"
+#include "include/InputLoader.h"
+#include "include/LoopbackServer.h"
+#include "include/ReductionEngine.h"
+#include "include/ResultWriter.h"
+#include "include/UserInterface.h"
+#include "include/VectorSession.h"
+
+namespace {
+
+/// Fewest vectors of 16.5 values on average per second a job must exchange one by one
+constexpr double MIN_VECTORS_PER_SECOND = 10000;
+
+/// Fewest vectors of 16.5 values on average per second a job must exchange in batch frames
+constexpr double MIN_FRAMED_VECTORS_PER_SECOND = 500000;
+
+/// Most heap allocations per vector of a job, after the connection is set up
+constexpr double MAX_ALLOCATIONS_PER_VECTOR = 0.05;
+
+/// Largest peak resident set of a process streaming a job of more than twice this size
+constexpr size_t MAX_PEAK_RSS_BYTES = 32u << 20;
+
+/// Password the stand-in server expects
+const char* const PASSWORD = "P@ssW0rd";
+
+/// Set by `--verbose`: the performance tests print their measurements even when they pass
+bool verbose = false;
+
+/**
+ * @brief Number of heap allocations made by the process so far.
+ */
+std::atomic<uint64_t> allocations(0);
+
+/**
+ * @brief Number of heap allocations made by the current thread so far.
+ * 
+ * Unlike `allocations`, it leaves out the stand-in server serving on its own thread.
+ */
+thread_local uint64_t threadAllocations = 0;
+
+/**
+ * @brief Allocates memory and counts the allocation.
+ * 
+ * @param size The number of bytes.
+ * @return The allocated memory.
+ * @throws std::bad_alloc If the allocation fails.
+ */
+void* countedAlloc(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    ++threadAllocations;
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    return countedAlloc(size);
+}
+
+void* operator new[](std::size_t size) {
+    return countedAlloc(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+/**
+ * @brief Returns a path for a temporary file of this process.
+ * 
+ * @param name Distinguishes the files of one process.
+ * @return The path.
+ */
+std::string tempPath(const std::string& name) {
+    return "/tmp/client_integration_" + std::to_string(getpid()) + "_" + name;
+}
+
+/**
+ * @brief Writes an input file of `count` vectors with 1 to `maxSize` values.
+ * 
+ * Every `zeroEvery`-th value is nonzero, the others are zero, so inputs for sparse payloads can
+ * be written as well.
+ * 
+ * @param path The file to write.
+ * @param count The number of vectors.
+ * @param maxSize The largest number of values per vector.
+ * @param zeroEvery 1 for no zeros.
+ * @return The size of the file in bytes.
+ */
+size_t writeInput(const std::string& path, size_t count, size_t maxSize, size_t zeroEvery) {
+    std::ofstream file(path, std::ios::binary);
+    std::string line;
+    uint64_t state = 12345;
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const size_t size = 1 + i % maxSize;
+        line.clear();
+        for (size_t j = 0; j < size; ++j) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            if ((i * maxSize + j) % zeroEvery == 0) {
+                // Values from 0.000 to 99.999, formatted by hand as the stream formatting is slow
+                const unsigned value = static_cast<unsigned>((state >> 33) % 100000);
+                line += std::to_string(value / 1000);
+                line += '.';
+                line += static_cast<char>('0' + value / 100 % 10);
+                line += static_cast<char>('0' + value / 10 % 10);
+                line += static_cast<char>('0' + value % 10);
+            } else {
+                line += '0';
+            }
+            line += j + 1 < size ? ' ' : '\n';
+        }
+        file.write(line.data(), static_cast<std::streamsize>(line.size()));
+        bytes += line.size();
+    }
+    return bytes;
+}
+
+/**
+ * @brief Reads the results of a file written by `ResultWriter`.
+ * 
+ * @param path The file to read.
+ * @return The results.
+ */
+std::vector<double> readResults(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    uint32_t count = 0;
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    std::vector<double> results(count);
+    file.read(reinterpret_cast<char*>(results.data()), count * sizeof(double));
+    return results;
+}
+
+/**
+ * @brief A connection to the stand-in server, authenticated and ready for a job.
+ */
+struct Connection {
+    std::unique_ptr<Communicator> comm;     /**< The connection. */
+    std::unique_ptr<VectorSession> session; /**< The session on it, with the negotiated extensions. */
+};
+
+/**
+ * @brief Connects to a stand-in server and prepares a job, as a single-server job of the client does.
+ * 
+ * @param server A stand-in server with a handshake, over a socket pair.
+ * @param wanted The extensions to ask for; the stand-in accepts them all.
+ * @return The connection.
+ */
+Connection connectJob(LoopbackServer& server, const VectorSession::Extensions& wanted) {
+    Connection connection;
+    connection.comm = std::make_unique<Communicator>(server.clientSocket());
+    ClientJob::authenticate(*connection.comm, PASSWORD);
+    connection.session = ClientJob::negotiate(connection.comm, []() -> std::unique_ptr<Communicator> {
+        throw std::runtime_error("The stand-in server refused an extension");
+    }, wanted, nullptr);
+    return connection;
+}
+
+/**
+ * @brief Returns the extensions of a job with only batch frames.
+ * 
+ * @param batching Whether to ask for batch frames.
+ * @return The extensions.
+ */
+VectorSession::Extensions framesOnly(bool batching) {
+    VectorSession::Extensions wanted;
+    wanted.batching = batching;
+    return wanted;
+}
+
+/**
+ * @brief Prints a measurement of a performance test if it failed or `--verbose` was given.
+ * 
+ * @param measurement The measurement, with its limit.
+ * @param passed Whether the measurement is within its limit.
+ */
+void report(const std::string& measurement, bool passed) {
+    if (verbose || !passed) {
+        std::cout << measurement << std::endl;
+    }
+}
+
+/**
+ * @brief Returns the peak resident set size of the process from `/proc/self/status`.
+ * 
+ * @return The peak in bytes, 0 if it cannot be read.
+ */
+size_t peakResidentBytes() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return std::stoul(line.substr(6)) * 1024;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Streams a job from an input file to a stand-in server over batch frames.
+ * 
+ * Runs in a process of its own, started by `StreamingJob_PeakRss_BelowMaximum`, so the memory of
+ * the other tests does not count towards its peak.
+ * 
+ * @param inputPath The input file.
+ * @return 0 if every vector got a result within the memory limit, 1 otherwise.
+ */
+int runStreamingJob(const std::string& inputPath) {
+    try {
+        LoopbackServer server(LoopbackServer::Transport::Pair, PASSWORD);
+        Connection job = connectJob(server, framesOnly(true));
+        InputLoader input(inputPath);
+        const size_t count = input.count();
+        const size_t results = ClientJob::process(*job.session, input, nullptr, false, nullptr).size();
+        const size_t peak = peakResidentBytes();
+        const bool passed = results == count && peak > 0 && peak <= MAX_PEAK_RSS_BYTES;
+        report("Streaming " + std::to_string(results) + " of " + std::to_string(count) + " vectors: peak RSS " +
+               std::to_string(peak >> 20) + " MiB, limit " + std::to_string(MAX_PEAK_RSS_BYTES >> 20) + " MiB", passed);
+        return passed ? 0 : 1;
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Streaming job failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+} // namespace
+
+// Тесты для DataReader и DataWriter
+
+/**
+ * @test DataWriter_DataReader_RoundTrip
+ * @brief Tests that lines written by the real `DataWriter` are read back by the real `DataReader`.
+ */
+TEST(DataWriter_DataReader_RoundTrip) {
+    const std::string path = tempPath("lines.txt");
+    const std::vector<std::string> lines = {"1.5 2.5", "", "3 4 5", std::string(10000, '7')};
+    {
+        DataWriter writer(path);
+        for (const std::string& line : lines) {
+            writer.writeLine(line);
+        }
+    }
+    DataReader reader(path);
+    for (const std::string& line : lines) {
+        CHECK(!reader.eof());
+        CHECK_EQUAL(line, reader.readNextLine());
+    }
+    CHECK_EQUAL("", reader.readNextLine());
+    CHECK(reader.eof());
+    std::remove(path.c_str());
+}
+
+// Тесты для UserInterface
+
+/**
+ * @test UserInterface_Parse_ServerList
+ * @brief Tests that the real `UserInterface` splits server lists into endpoints.
+ * 
+ * Host names, IPv4 and bracketed IPv6 addresses with and without their own port and `unix:`
+ * paths are given in two `-a` options.
+ */
+TEST(UserInterface_Parse_ServerList) {
+    std::vector<std::string> arguments = {"client", "-a", "localhost,[::1]:40000,::1", "-a", "10.0.0.1:5,unix:/run/vs.sock",
+                                          "-p", "7", "-i", "in.txt", "-o", "out.bin", "--batch", "--standby", "2"};
+    std::vector<char*> argv;
+    for (std::string& argument : arguments) {
+        argv.push_back(&argument[0]);
+    }
+    UserInterface ui(static_cast<int>(argv.size()), argv.data());
+    CHECK_EQUAL(5u, ui.servers.size());
+    const std::pair<std::string, int> expected[] = {
+        {"localhost", 7}, {"::1", 40000}, {"::1", 7}, {"10.0.0.1", 5}, {"unix:/run/vs.sock", 7}
+    };
+    for (size_t i = 0; i < ui.servers.size(); ++i) {
+        CHECK_EQUAL(expected[i].first, ui.servers[i].address);
+        CHECK_EQUAL(expected[i].second, ui.servers[i].port);
+    }
+    CHECK_EQUAL("localhost", ui.serverAddress);
+    CHECK(ui.batch);
+    CHECK_EQUAL(2u, ui.standby);
+}
+
+// Тесты для VectorSession
+
+/**
+ * @test VectorSession_Job_MatchesLocalSums
+ * @brief Tests a whole job: an input file through `ClientJob` to an output file.
+ * 
+ * The job runs one vector at a time, in batch frames, with compressed payloads and with sparse
+ * payloads, each on a new authenticated connection, and every output file must hold exactly the
+ * sums the scalar kernel of `ReductionEngine` computes from the same input. The stand-in closes
+ * the connection after the announced number of vectors, so a wrong count fails the job.
+ */
+TEST(VectorSession_Job_MatchesLocalSums) {
+    const std::string inputPath = tempPath("job.txt");
+    const std::string outputPath = tempPath("job.bin");
+    const ReductionEngine engine(ReductionEngine::Operation::Sum, ReductionEngine::Kernel::Scalar);
+    for (int mode = 0; mode < 4; ++mode) {
+        writeInput(inputPath, 10000, mode >= 2 ? 300 : 40, mode == 3 ? 10 : 1);
+        std::vector<double> expected;
+        {
+            InputLoader all(inputPath);
+            const InputLoader::Batch vectors = all.readAll();
+            expected.resize(vectors.size());
+            engine.reduce(vectors, expected.data());
+        }
+
+        LoopbackServer server(LoopbackServer::Transport::Pair, PASSWORD);
+        {
+            VectorSession::Extensions wanted;
+            wanted.batching = mode == 1;
+            wanted.compression = mode == 2;
+            wanted.sparse = mode == 3;
+            Connection job = connectJob(server, wanted);
+            CHECK(job.session->extensions() == wanted);
+            InputLoader input(inputPath);
+            ResultWriter::write(outputPath, ClientJob::process(*job.session, input, nullptr, false, nullptr));
+            if (mode == 2) {
+                CHECK(job.session->compressionOutput() < job.session->compressionInput());
+            }
+            if (mode == 3) {
+                CHECK(job.session->sparsePayloads() > 0);
+            }
+        }
+        const std::vector<double> results = readResults(outputPath);
+        CHECK_EQUAL(expected.size(), results.size());
+        CHECK(results == expected);
+    }
+    std::remove(inputPath.c_str());
+    std::remove(outputPath.c_str());
+}
+
+/**
+ * @test VectorSession_OversizedVector_Throws
+ * @brief Tests that a vector whose size would reach the flag bits is not sent.
+ * 
+ * With sparse payloads accepted, a size of 2^30 values would read as a sparse payload, so the
+ * exchange must throw before sending anything; the next vector then still gets its own sum.
+ */
+TEST(VectorSession_OversizedVector_Throws) {
+    LoopbackServer server(LoopbackServer::Transport::Pair, PASSWORD);
+    VectorSession::Extensions wanted;
+    wanted.sparse = true;
+    Connection job = connectJob(server, wanted);
+    job.session->announce(1);
+    const double values[2] = {1.5, 2.0};
+    CHECK_THROW(job.session->exchange(values, size_t(VectorSession::MAX_FLAGGED_SIZE) + 1, 2), std::runtime_error);
+    CHECK_EQUAL(3.5, job.session->exchange(values, 2));
+}
+
+/**
+ * @test VectorSession_OversizedJob_Throws
+ * @brief Tests that a job with more vectors than the count word can carry is not announced.
+ * 
+ * A count above `MAX_COUNT` would be truncated or read as a probe, so announcing it must throw
+ * before sending anything; the job can then still be announced with a valid count.
+ */
+TEST(VectorSession_OversizedJob_Throws) {
+    LoopbackServer server(LoopbackServer::Transport::Pair, PASSWORD);
+    Connection job = connectJob(server, VectorSession::Extensions());
+    CHECK_THROW(job.session->announce(size_t(VectorSession::MAX_COUNT) + 1), std::runtime_error);
+    CHECK_THROW(job.session->announce(size_t(UINT32_MAX) + 2), std::runtime_error);
+    job.session->announce(1);
+    const double values[2] = {1.5, 2.0};
+    CHECK_EQUAL(3.5, job.session->exchange(values, 2));
+}
+
+/**
+ * @test VectorSession_HedgedJob_MatchesLocalSums
+ * @brief Tests that a hedged job with compressed or sparse payloads moves to its spare connection intact.
+ * 
+ * The stand-in of the job stalls part of the way through, so the job is hedged and carried on by
+ * a spare connection, prepared by `ClientJob::authenticateSpare` as the standby connections of the
+ * client are. Every spare reaches a stand-in of its own, which only decodes the payloads its
+ * connection negotiated, and the results must still be the local sums.
+ */
+TEST(VectorSession_HedgedJob_MatchesLocalSums) {
+    const std::string inputPath = tempPath("hedged.txt");
+    const ReductionEngine engine(ReductionEngine::Operation::Sum, ReductionEngine::Kernel::Scalar);
+    for (bool sparse : {false, true}) {
+        writeInput(inputPath, 2000, 300, sparse ? 10 : 1);
+        std::vector<double> expected;
+        {
+            InputLoader all(inputPath);
+            const InputLoader::Batch vectors = all.readAll();
+            expected.resize(vectors.size());
+            engine.reduce(vectors, expected.data());
+        }
+
+        VectorSession::Extensions wanted;
+        wanted.compression = !sparse;
+        wanted.sparse = sparse;
+        std::vector<std::unique_ptr<LoopbackServer>> spareServers;
+        LoopbackServer server(LoopbackServer::Transport::Pair, PASSWORD);
+        server.stall(500);
+        Connection job = connectJob(server, wanted);
+        job.comm->setTimeout(std::chrono::seconds(10));
+        const VectorSession::Extensions accepted = job.session->extensions();
+        job.session->hedge(99, [&spareServers, accepted] {
+            spareServers.push_back(std::make_unique<LoopbackServer>(LoopbackServer::Transport::Pair, PASSWORD));
+            auto spare = std::make_unique<Communicator>(spareServers.back()->clientSocket());
+            ClientJob::authenticateSpare(*spare, PASSWORD, accepted);
+            return spare;
+        });
+        InputLoader input(inputPath);
+        const std::vector<double> results = ClientJob::process(*job.session, input, nullptr, false, nullptr);
+        CHECK(!spareServers.empty());
+        if (sparse) {
+            CHECK(job.session->sparsePayloads() > 0);
+        } else {
+            CHECK(job.session->compressionOutput() < job.session->compressionInput());
+        }
+        CHECK(results == expected);
+    }
+    std::remove(inputPath.c_str());
+}
+
+/**
+ * @test VectorSession_UnnegotiatedPayloads_Rejected
+ * @brief Tests that the stand-in, like the server, rejects payload flags its connection did not negotiate.
+ * 
+ * The session is told that compression or sparse payloads were accepted although no probe was
+ * sent, as a spare connection without negotiation would be used; the flagged payload must end
+ * the connection instead of being decoded.
+ */
+TEST(VectorSession_UnnegotiatedPayloads_Rejected) {
+    std::vector<double> values(512, 0.0);
+    values[7] = 1.5;
+    for (bool sparse : {false, true}) {
+        LoopbackServer server(LoopbackServer::Transport::Pair, PASSWORD);
+        Connection job = connectJob(server, VectorSession::Extensions());
+        VectorSession::Extensions claimed;
+        claimed.compression = !sparse;
+        claimed.sparse = sparse;
+        job.session->resume(claimed);
+        job.session->announce(1);
+        CHECK_THROW(job.session->exchange(values.data(), values.size()), std::runtime_error);
+    }
+}
+
+
+// Тесты производительности
+
+/**
+ * @test Job_Throughput_AboveMinimum
+ * @brief Tests that a job exchanges at least the minimum number of vectors per second.
+ * 
+ * Jobs of vectors with 1 to 32 values are run one vector at a time and in batch frames, from
+ * opening the input to the last result, so parsing counts as well.
+ */
+TEST(Job_Throughput_AboveMinimum) {
+    const std::string inputPath = tempPath("throughput.txt");
+    for (bool framed : {false, true}) {
+        const size_t count = framed ? 200000 : 20000;
+        writeInput(inputPath, count, 32, 1);
+        LoopbackServer server(LoopbackServer::Transport::Pair, PASSWORD);
+        Connection job = connectJob(server, framesOnly(framed));
+        const auto start = std::chrono::steady_clock::now();
+        InputLoader input(inputPath);
+        const size_t results = ClientJob::process(*job.session, input, nullptr, false, nullptr).size();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double rate = static_cast<double>(results) / seconds;
+        const double minimum = framed ? MIN_FRAMED_VECTORS_PER_SECOND : MIN_VECTORS_PER_SECOND;
+        report(std::string(framed ? "Framed" : "Per-vector") + " job: " + std::to_string(static_cast<uint64_t>(rate)) +
+               " vectors/s, minimum " + std::to_string(static_cast<uint64_t>(minimum)), rate >= minimum);
+        CHECK_EQUAL(count, results);
+        CHECK(rate >= minimum);
+    }
+    std::remove(inputPath.c_str());
+}
+
+/**
+ * @test Job_Allocations_BelowMaximum
+ * @brief Tests that a job allocates at most the maximum number of times per vector.
+ * 
+ * All threads are counted: the parsing workers of `InputLoader`, the job and the stand-in server.
+ * The connection is authenticated and the batch frames negotiated before counting starts.
+ */
+TEST(Job_Allocations_BelowMaximum) {
+    const std::string inputPath = tempPath("allocations.txt");
+    const size_t count = 100000;
+    writeInput(inputPath, count, 32, 1);
+    for (bool framed : {false, true}) {
+        LoopbackServer server(LoopbackServer::Transport::Pair, PASSWORD);
+        Connection job = connectJob(server, framesOnly(framed));
+        const uint64_t before = allocations.load(std::memory_order_relaxed);
+        InputLoader input(inputPath);
+        const std::vector<double> results = ClientJob::process(*job.session, input, nullptr, false, nullptr);
+        const double perVector = static_cast<double>(allocations.load(std::memory_order_relaxed) - before) /
+                                 static_cast<double>(count);
+        report(std::string(framed ? "Framed" : "Per-vector") + " job: " + std::to_string(perVector) +
+               " allocations per vector, maximum " + std::to_string(MAX_ALLOCATIONS_PER_VECTOR),
+               perVector <= MAX_ALLOCATIONS_PER_VECTOR);
+        CHECK_EQUAL(count, results.size());
+        CHECK(perVector <= MAX_ALLOCATIONS_PER_VECTOR);
+    }
+    std::remove(inputPath.c_str());
+}
+
+/**
+ * @test BufferPool_SteadyStateExchange_NoAllocations
+ * @brief Tests that the send and receive loop of a job is free of heap allocations once warmed up.
+ * 
+ * Continues `BufferPool_SteadyStateLoop_NoAllocations` of `test.cpp`, whose mock `Communicator`
+ * cannot carry a real exchange. The same batch is exchanged round after round with the stand-in,
+ * one vector at a time and in batch frames, dense, compressed and sparse; after the first round
+ * has sized the buffers of the session, the exchanges must allocate nothing on the job's thread.
+ */
+TEST(BufferPool_SteadyStateExchange_NoAllocations) {
+    const size_t rounds = 20;
+    InputLoader::Batch batch;
+    std::vector<double> expected;
+    for (size_t i = 0; i < 64; ++i) {
+        std::vector<double> values(1 + i % 32);
+        double sum = 0;
+        for (size_t k = 0; k < values.size(); k += 2) {
+            values[k] = static_cast<double>(i + k) * 0.25;
+            sum += values[k];
+        }
+        batch.append(values.data(), values.size());
+        expected.push_back(sum);
+    }
+    std::vector<double> results(batch.size());
+    for (int mode = 0; mode < 4; ++mode) {
+        VectorSession::Extensions wanted;
+        wanted.batching = mode == 1;
+        wanted.compression = mode == 2;
+        wanted.sparse = mode == 3;
+        LoopbackServer server(LoopbackServer::Transport::Pair, PASSWORD);
+        Connection job = connectJob(server, wanted);
+        job.session->announce(static_cast<uint32_t>((rounds + 1) * batch.size()));
+        uint64_t before = 0;
+        for (size_t round = 0; round <= rounds; ++round) {
+            if (round == 1) {
+                before = threadAllocations;
+            }
+            if (job.session->batching()) {
+                job.session->exchange(batch, results.data());
+            } else {
+                for (size_t i = 0; i < batch.size(); ++i) {
+                    results[i] = job.session->exchange(batch[i].data(), batch[i].size(), batch.nonzeros(i));
+                }
+            }
+        }
+        const uint64_t made = threadAllocations - before;
+        report("Mode " + std::to_string(mode) + ": " + std::to_string(made) + " allocations after warm-up",
+               made == 0);
+        CHECK_EQUAL(0u, made);
+        CHECK(results == expected);
+    }
+}
+
+/**
+ * @test StreamingJob_PeakRss_BelowMaximum
+ * @brief Tests that a job larger than the memory limit streams through within that limit.
+ * 
+ * The job runs in a fresh process, this program started again with `--stream`, which checks its
+ * own peak resident set afterwards and fails unless it stayed within the limit.
+ */
+TEST(StreamingJob_PeakRss_BelowMaximum) {
+    const std::string inputPath = tempPath("large.txt");
+    const size_t bytes = writeInput(inputPath, 400000, 48, 1);
+    CHECK(bytes > 2 * MAX_PEAK_RSS_BYTES);
+
+    std::string self = "/proc/self/exe";
+    std::string mode = "--stream";
+    std::string argument = inputPath;
+    std::string flag = "--verbose";
+    char* argv[] = {&self[0], &mode[0], &argument[0], verbose ? &flag[0] : nullptr, nullptr};
+    pid_t child;
+    CHECK_EQUAL(0, posix_spawn(&child, self.c_str(), nullptr, nullptr, argv, environ));
+    int status = 0;
+    CHECK_EQUAL(child, waitpid(child, &status, 0));
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    std::remove(inputPath.c_str());
+}
+
+/**
+ * @brief Main function to run all integration tests.
+ * 
+ * `--verbose` prints the measurements of the performance tests. `--stream <input>` runs only the
+ * streaming job of `StreamingJob_PeakRss_BelowMaximum`.
+ * 
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return 0 if all tests pass, the number of failures otherwise.
+ */
+int main(int argc, char** argv) {
+    const char* stream = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--verbose") {
+            verbose = true;
+        } else if (argument == "--stream" && i + 1 < argc) {
+            stream = argv[++i];
+        }
+    }
+    if (stream) {
+        return runStreamingJob(stream);
+    }
+    return UnitTest::RunAllTests();
+}
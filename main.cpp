@@ -11,35 +11,119 @@
  */
 
 #include <stdexcept>
-#include <iterator>
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <cstring>
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <csignal>
+#include <cstdio>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <iomanip>
+#include <mutex>
+#include <exception>
+#include <random>
+#include <sys/stat.h>
 
-#include "include/SHA256Library.h"  ///< SHA256 hash utility
 #include "include/UserInterface.h"  ///< User interface management
 #include "include/Communicator.h"   ///< Communication with the server
 #include "include/DataReader.h"     ///< Data reading utilities
 #include "include/DataWriter.h"     ///< Data writing utilities
+#include "include/ResultCache.h"    ///< Persistent cache of server results
+#include "include/InputLoader.h"    ///< Background input parsing
+#include "include/Stats.h"          ///< Timing and counters for --stats
+#include "include/LatencyHistogram.h" ///< Per-connection latency percentiles
+#include "include/Trace.h"          ///< Timeline of spans for --trace
+#include "include/SessionPool.h"    ///< Pre-authenticated connections for --daemon
+#include "include/SpoolWatcher.h"   ///< Spool directory watching for --daemon
+#include "include/MetricsServer.h"  ///< Prometheus endpoint for --metrics
+#include "include/VectorGenerator.h" ///< Synthetic vectors for --generate
+#include "include/ResultWriter.h"   ///< Binary output files
+#include "include/VectorSession.h"  ///< Per-vector exchange with the server
+#include "include/ClientJob.h"      ///< Authentication, negotiation and the exchange of a job
+#include "include/ThreadPool.h"     ///< Shared worker threads for background tasks
+#include "include/LoadBalancer.h"   ///< Routing of jobs across several servers
+#include "include/IoUring.h"        ///< io_uring transport for --io-backend
+#include "include/ReductionEngine.h" ///< Local results for --offline and --verify-sample
 
-/** 
- * @brief Data type for vectors (double precision floating point).
+/**
+ * @brief Name of a vector element type, as given to `--type` and recorded in the cache identity.
+ * 
+ * @tparam T The element type; one of `float`, `double`, `int32_t` and `int64_t`.
  */
-const std::string dataType = "double";
+template <typename T>
+const char* const dataType = nullptr;
+template <>
+const char* const dataType<float> = "float";
+template <>
+const char* const dataType<double> = "double";
+template <>
+const char* const dataType<int32_t> = "int32";
+template <>
+const char* const dataType<int64_t> = "int64";
 
-/** 
+/**
  * @brief Hashing algorithm used for authentication (SHA256).
  */
 const std::string hashType = "SHA256";
 
-/** 
+/**
  * @brief Side of the salt (server-side for this implementation).
  */
 const std::string saltSide = "server";
 
+/**
+ * @brief Number of attempts made for one spool file in daemon mode before it is given up.
+ */
+const int MAX_JOB_ATTEMPTS = 3;
+
+/**
+ * @brief Smallest number of vectors in one shard of a job balanced across several servers.
+ * 
+ * Shards start at this size until the latencies of the servers and the setup time of their
+ * sessions are known.
+ */
+const size_t MIN_SHARD_SIZE = 256;
+
+/**
+ * @brief Largest number of vectors in one shard of a job balanced across several servers.
+ */
+const size_t MAX_SHARD_SIZE = 65536;
+
+/**
+ * @brief Number of shards each lane should get at least, so slow servers do not hold up the end of a job.
+ */
+const size_t MIN_SHARDS_PER_LANE = 4;
+
+/**
+ * @brief Number of attempts made for one shard of a job balanced across several servers.
+ */
+const int MAX_SHARD_ATTEMPTS = 4;
+
+/**
+ * @brief How long a shard waits for an authenticated session before its server counts as failed.
+ */
+const std::chrono::milliseconds SESSION_TIMEOUT(2000);
+
+/**
+ * @brief Set by SIGINT and SIGTERM in daemon mode to request a clean shutdown.
+ */
+volatile std::sig_atomic_t stopRequested = 0;
+
+/**
+ * @brief Signal handler that asks the daemon to stop after the current file.
+ * 
+ * @param signal The received signal.
+ */
+void requestStop(int signal) {
+    (void)signal;
+    stopRequested = 1;
+}
+
 /**
  * @brief Reads the login and password from a configuration file.
  * 
@@ -52,6 +136,7 @@ const std::string saltSide = "server";
  * @throws std::runtime_error If the file cannot be opened or credentials are invalid.
  */
 void readLoginPassword(const std::string& configFile, std::string& login, std::string& password) {
+    Stats::Timer timer(Stats::Phase::Config);
     std::ifstream config(configFile);
     if (!config) {
         throw std::runtime_error("Failed to open config file: " + configFile);
@@ -66,88 +151,784 @@ void readLoginPassword(const std::string& configFile, std::string& login, std::s
 }
 
 /**
- * @brief Authenticates the client with the server.
+ * @brief Opens and authenticates a new connection to a server.
  * 
- * This function sends the username to the server, receives the salt, combines it with the
- * password, computes the SHA256 hash of the combination, and sends the hash back to the server.
- * If the server responds with anything other than "OK", authentication fails.
+ * @param address The address of the server.
+ * @param port The port of the server.
+ * @param password The password to authenticate with.
+ * @return The authenticated connection.
+ * @throws std::runtime_error If connecting or authenticating fails.
+ */
+std::unique_ptr<Communicator> connectAuthenticated(const std::string& address, int port, const std::string& password) {
+    auto comm = std::make_unique<Communicator>(address, port);
+    {
+        Stats::Timer timer(Stats::Phase::Connect);
+        comm->connectToServer();
+    }
+    ClientJob::authenticate(*comm, password);
+    return comm;
+}
+
+/**
+ * @brief The protocol extensions used on the pooled sessions of one server.
  * 
- * @param comm The Communicator object used for communication with the server.
- * @param password The password to be hashed and sent.
- * @throws std::runtime_error If authentication fails.
+ * With several servers or in daemon mode, every pooled session negotiates the wanted extensions in
+ * `authenticatePooled`. Until the first session has accepted all of them, a refused extension is
+ * dropped for the server and the session is given up, since the server took the probe for a vector
+ * count; the pool then opens the next one. That first session settles the extensions, so every
+ * session handed out carries the same.
  */
-void authenticateAsClient(Communicator& comm, const std::string& password) {
-    std::string username = "user";
-    comm.sendMessage(username);
+struct PooledExtensions {
+    std::mutex mutex;                  /**< Guards the fields below. */
+    VectorSession::Extensions wanted;  /**< The extensions to negotiate, as accepted once settled. */
+    bool settled = false;              /**< Set once a session accepted all wanted extensions. */
+    bool renegotiating = false;        /**< Set while the pool replaces a session that refused one. */
+};
 
-    std::string salt(16, '\0');
-    comm.receiveMessage(salt.data(), 16);
+/**
+ * @brief Authenticates a pooled session and negotiates its extensions.
+ * 
+ * @param comm The freshly connected session.
+ * @param password The password to authenticate with.
+ * @param extensions The extensions of the server, updated as described for `PooledExtensions`.
+ * @param name The `address:port` name of the server, for warnings.
+ * @throws std::runtime_error If authentication fails or the server refuses an extension.
+ */
+void authenticatePooled(Communicator& comm, const std::string& password, PooledExtensions& extensions,
+                        const std::string& name) {
+    ClientJob::authenticate(comm, password);
+    VectorSession::Extensions wanted;
+    {
+        std::lock_guard<std::mutex> lock(extensions.mutex);
+        wanted = extensions.wanted;
+    }
 
-    std::string combined = salt + password;
+    VectorSession session(comm);
+    const char* refused = nullptr;
+    const char* fallback = nullptr;
+    if (wanted.batching && !session.negotiateBatching()) {
+        refused = "batch frames";
+        fallback = "sending vectors one by one";
+        wanted.batching = false;
+    } else if (wanted.compression && !session.negotiateCompression()) {
+        refused = "compressed payloads";
+        fallback = "sending them as they are";
+        wanted.compression = false;
+    } else if (wanted.sparse && !session.negotiateSparse()) {
+        refused = "sparse payloads";
+        fallback = "sending vectors dense";
+        wanted.sparse = false;
+    }
 
-    std::string calculatedHash = SHA256Library::hash(combined);
-    
-    for (char& c : calculatedHash) {
-        c = std::toupper(static_cast<unsigned char>(c));
+    std::lock_guard<std::mutex> lock(extensions.mutex);
+    if (refused) {
+        if (!extensions.settled) {
+            std::cerr << "Warning: server " << name << " does not accept " << refused << ", " << fallback << std::endl;
+            extensions.wanted = wanted;
+            extensions.renegotiating = true;
+        }
+        throw std::runtime_error(std::string("The server refused ") + refused);
+    }
+    if (!extensions.settled) {
+        extensions.wanted = session.extensions();
+        extensions.settled = true;
+    }
+    extensions.renegotiating = false;
+}
+
+/**
+ * @brief Sends a job to several servers at once and collects one result per vector.
+ * 
+ * Since a session carries exactly one job, every shard is a job of its own on a fresh session from
+ * the pool of the server the balancer chose. One lane per server takes shards until the input is
+ * exhausted, so all servers work in parallel while slow ones receive fewer shards. A shard whose
+ * server fails is retried on the best remaining server; the failing server is ejected for a while.
+ * 
+ * The lanes are threads of their own, not tasks of the shared `ThreadPool`. A lane blocks on its
+ * server for as long as a shard takes, up to the session timeout, and without a plan it waits for
+ * the batches `input` parses on that pool. With `--threads` no larger than the number of servers,
+ * lanes on the workers would leave none to parse the input, and the job would deadlock; the lanes
+ * themselves only wait on sockets, while the parsing stays on the pool.
+ * 
+ * Shards start at `MIN_SHARD_SIZE` vectors and grow so that sending one takes longer than the
+ * pools need to replace the sessions all lanes take meanwhile; otherwise lanes would wait for
+ * connections and authentications instead of sending vectors. They stay at most `MAX_SHARD_SIZE`
+ * and small enough for every lane to get `MIN_SHARDS_PER_LANE` of them.
+ * 
+ * With a result cache or `--dedup`, the vectors are chosen by `ClientJob::plan` first and only those are
+ * sharded, as in `ClientJob::process`. A shard goes out in batch frames, compressed or sparse when its
+ * session accepted that. Hedged vectors go to a ready session of another server that is not ejected and
+ * uses the same extensions.
+ * 
+ * @tparam T The element type of the vectors and results.
+ * @param pools One pool of authenticated sessions per server.
+ * @param extensions The extensions negotiated on the sessions of every pool.
+ * @param names The `address:port` name of every server, for statistics and the summary.
+ * @param balancer The routing state, with one endpoint per server.
+ * @param input The loader parsing the input file.
+ * @param cache An optional result cache, or `nullptr`.
+ * @param dedup Whether to send repeated vectors once even without a cache.
+ * @param hedgePercentile The latency percentile after which a vector is hedged, 0 to disable.
+ * @return The results in the order of the input vectors.
+ * @throws std::runtime_error If a shard fails on every attempt or reading the input fails.
+ */
+template <typename T>
+std::vector<T> processBalanced(std::vector<std::unique_ptr<SessionPool>>& pools,
+                               std::vector<std::unique_ptr<PooledExtensions>>& extensions,
+                               const std::vector<std::string>& names, LoadBalancer& balancer,
+                               BasicInputLoader<T>& input, ResultCache* cache, bool dedup,
+                               double hedgePercentile) {
+    // Without a cache or deduplication, shards are cut from the input as the loader parses it
+    const bool planned = cache || dedup;
+    typename BasicInputLoader<T>::Batch vectors;
+    std::vector<T> results;
+    std::vector<size_t> pending;
+    std::vector<ResultCache::Key> keys;
+    std::vector<size_t> origin;
+    if (planned) {
+        vectors = input.readAll();
+        results.resize(vectors.size());
+        pending = ClientJob::plan(vectors, cache, dedup, results, keys, origin);
+    }
+    const size_t total = planned ? pending.size() : input.count();
+    std::vector<T> sent(total);
+
+    std::vector<LatencyHistogram*> latencies(pools.size(), nullptr);
+    if (Stats::enabled()) {
+        for (size_t i = 0; i < pools.size(); ++i) {
+            latencies[i] = &Stats::connectionLatency(names[i]);
+        }
+    }
+
+    // Shards are numbered by the position of their first vector in `sent`; without a plan they are
+    // cut from the batch the loader handed out last
+    std::mutex shardMutex;
+    size_t nextFirst = 0;
+    typename BasicInputLoader<T>::Batch batch;
+    size_t offset = 0;
+    std::exception_ptr failure;
+    // In the worst case all lanes take their sessions from the same pool, which opens them one at a time
+    auto shardSize = [&] {
+        std::chrono::nanoseconds refill(0);
+        double perVector = 0;
+        for (size_t i = 0; i < pools.size(); ++i) {
+            refill = std::max(refill, pools[i]->setupTime());
+            const double latency = balancer.latency(i);
+            if (latency > 0 && (perVector == 0 || latency < perVector)) {
+                perVector = latency;
+            }
+        }
+        size_t size = MIN_SHARD_SIZE;
+        if (perVector > 0) {
+            size = std::max(size, static_cast<size_t>(static_cast<double>(pools.size() * refill.count()) / perVector));
+        }
+        return std::min({size, MAX_SHARD_SIZE, std::max(MIN_SHARD_SIZE, total / (pools.size() * MIN_SHARDS_PER_LANE))});
+    };
+    auto nextShard = [&](typename BasicInputLoader<T>::Batch& shard, size_t& first) {
+        const size_t limit = shardSize();
+        std::lock_guard<std::mutex> lock(shardMutex);
+        if (failure) {
+            return false;
+        }
+        shard.clear();
+        first = nextFirst;
+        if (planned) {
+            for (size_t k = first; k < pending.size() && k < first + limit; ++k) {
+                shard.append(vectors[pending[k]].data(), vectors[pending[k]].size());
+            }
+        } else {
+            while (offset == batch.size()) {
+                if (!input.nextBatch(batch)) {
+                    return false;
+                }
+                offset = 0;
+            }
+            for (size_t k = 0; k < limit && offset < batch.size(); ++k, ++offset) {
+                shard.append(batch[offset].data(), batch[offset].size());
+            }
+        }
+        nextFirst += shard.size();
+        return !shard.empty() && nextFirst <= total;
+    };
+
+    // Every session a pool hands out has negotiated the settled extensions of its server
+    auto accepted = [&extensions](size_t endpoint) {
+        std::lock_guard<std::mutex> lock(extensions[endpoint]->mutex);
+        return extensions[endpoint]->wanted;
+    };
+    auto renegotiating = [&extensions](size_t endpoint) {
+        std::lock_guard<std::mutex> lock(extensions[endpoint]->mutex);
+        return extensions[endpoint]->renegotiating;
+    };
+
+    std::vector<size_t> shardsDone(pools.size(), 0);
+    auto lane = [&] {
+        Trace::nameThread("lane");
+        typename BasicInputLoader<T>::Batch shard;
+        size_t first;
+        try {
+            while (nextShard(shard, first)) {
+                for (int attempt = 1;; ++attempt) {
+                    const size_t endpoint = balancer.acquire();
+                    bool failed = true;
+                    std::string error = "no session became ready";
+                    try {
+                        // A server the pool cannot connect to fails at once instead of after the timeout,
+                        // but not one whose session was given up after refusing an extension
+                        std::unique_ptr<Communicator> comm;
+                        const auto deadline = std::chrono::steady_clock::now() + SESSION_TIMEOUT;
+                        while (!(comm = pools[endpoint]->acquire(std::chrono::milliseconds(50))) &&
+                               (pools[endpoint]->lastError().empty() || renegotiating(endpoint)) &&
+                               std::chrono::steady_clock::now() < deadline) {
+                        }
+                        if (comm) {
+                            VectorSession session(*comm, latencies[endpoint]);
+                            const VectorSession::Extensions negotiated = accepted(endpoint);
+                            session.resume(negotiated);
+                            if (hedgePercentile > 0 && pools.size() > 1) {
+                                session.hedge(hedgePercentile, [&pools, &balancer, &accepted, negotiated, endpoint] {
+                                    std::unique_ptr<Communicator> spare;
+                                    for (size_t k = 1; k < pools.size() && !spare; ++k) {
+                                        const size_t other = (endpoint + k) % pools.size();
+                                        if (!balancer.ejected(other) && accepted(other) == negotiated) {
+                                            spare = pools[other]->acquire(std::chrono::milliseconds(0));
+                                        }
+                                    }
+                                    return spare;
+                                });
+                            }
+                            session.announce(shard.size());
+                            if (session.batching()) {
+                                // Frames carry many vectors per round trip, so the balancer gets their average
+                                const auto start = std::chrono::steady_clock::now();
+                                session.exchange(shard, sent.data() + first);
+                                balancer.record(endpoint, static_cast<uint64_t>(
+                                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        std::chrono::steady_clock::now() - start).count()) / shard.size());
+                            } else {
+                                for (size_t i = 0; i < shard.size(); ++i) {
+                                    const auto start = std::chrono::steady_clock::now();
+                                    sent[first + i] = session.exchange(shard[i].data(), shard[i].size(),
+                                                                       shard.nonzeros(i));
+                                    balancer.record(endpoint, static_cast<uint64_t>(
+                                        std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                            std::chrono::steady_clock::now() - start).count()));
+                                }
+                            }
+                            failed = false;
+                        } else if (!pools[endpoint]->lastError().empty()) {
+                            error = pools[endpoint]->lastError();
+                        }
+                    } catch (const std::exception& ex) {
+                        error = ex.what();
+                    }
+                    balancer.release(endpoint, failed);
+                    if (!failed) {
+                        std::lock_guard<std::mutex> lock(shardMutex);
+                        ++shardsDone[endpoint];
+                        break;
+                    }
+                    std::cerr << "Server " << names[endpoint] << " failed: " << error << std::endl;
+                    if (attempt >= MAX_SHARD_ATTEMPTS) {
+                        throw std::runtime_error("Shard failed on " + std::to_string(attempt) + " attempts: " + error);
+                    }
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(shardMutex);
+            if (!failure) {
+                failure = std::current_exception();
+            }
+        }
+    };
+
+    // Not pool tasks: a lane blocks on its server and on the batches the pool parses, see above
+    std::vector<std::thread> lanes;
+    for (size_t i = 0; i < pools.size(); ++i) {
+        lanes.emplace_back(lane);
+    }
+    for (std::thread& thread : lanes) {
+        thread.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    if (nextFirst != total) {
+        throw std::runtime_error("Input file changed while it was being read");
     }
 
-    comm.sendMessage(calculatedHash);
+    for (size_t i = 0; i < pools.size(); ++i) {
+        std::cout << "Server " << names[i] << ": " << shardsDone[i] << " shards, " << std::fixed
+                  << std::setprecision(3) << balancer.latency(i) / 1e6 << " ms average latency, "
+                  << balancer.failures(i) << " failures" << std::defaultfloat << std::endl;
+    }
 
-    char response[2];
-    comm.receiveMessage(response, sizeof(response));
-    if (std::string(response, 2) != "OK") {
-        throw std::runtime_error("Authentication failed");
+    if (!planned) {
+        return sent;
     }
+    for (size_t k = 0; k < pending.size(); ++k) {
+        results[pending[k]] = sent[k];
+        if (cache) {
+            cache->insert(keys[pending[k]], sent[k]);
+        }
+    }
+    ClientJob::fanOut(results, origin);
+    return results;
 }
 
 /**
- * @brief Reads a matrix of input data from a file.
+ * @brief Checks a random sample of the server's results against local results.
  * 
- * This function opens the specified input file, reads its contents line by line, and
- * stores the data as a vector of vectors of doubles. It throws an exception if the file
- * cannot be opened or read.
+ * The input is parsed a second time; every vector is picked with probability `ui.verifySample`
+ * and reduced with `ReductionEngine`. Disagreeing results are listed on the standard error stream.
  * 
- * @param inputFile The path to the input file.
- * @return A vector of vectors containing the input data.
- * @throws std::runtime_error If the file cannot be opened or read.
+ * @tparam T The element type of the vectors and results.
+ * @param ui The parsed command-line options.
+ * @param results The results of the server, in input order.
+ * @throws std::runtime_error If a sampled result disagrees or the input changed.
  */
-std::vector<std::vector<double>> readInputFile(const std::string& inputFile) {
-    std::ifstream file(inputFile);
-    if (!file) {
-        throw std::runtime_error("Failed to open input file: " + inputFile);
+template <typename T>
+void verifyResults(const UserInterface& ui, const std::vector<T>& results) {
+    const ReductionEngine engine(ReductionEngine::parseOperation(ui.operation));
+    std::mt19937_64 random(std::random_device{}());
+    std::bernoulli_distribution pick(ui.verifySample);
+    BasicInputLoader<T> input(ui.inputFile);
+    typename BasicInputLoader<T>::Batch batch;
+    size_t index = 0;
+    size_t checked = 0;
+    size_t mismatches = 0;
+    while (input.nextBatch(batch)) {
+        if (index + batch.size() > results.size()) {
+            throw std::runtime_error("Input file changed while it was being read");
+        }
+        Stats::Timer timer(Stats::Phase::Reduce);
+        for (size_t i = 0; i < batch.size(); ++i, ++index) {
+            if (!pick(random)) {
+                continue;
+            }
+            ++checked;
+            const T local = engine.reduce(batch[i].data(), batch[i].size());
+            if (!engine.agrees(batch[i].data(), batch[i].size(), local, results[index])) {
+                if (++mismatches <= 10) {
+                    std::cerr << "Result " << index << " differs: server " << results[index] << ", local "
+                              << local << std::endl;
+                }
+            }
+        }
+    }
+    std::cout << "Verification: " << checked << " of " << results.size() << " results checked with the "
+              << ReductionEngine::kernelName(engine.kernel()) << " kernel, " << mismatches << " mismatches"
+              << std::endl;
+    if (mismatches > 0) {
+        throw std::runtime_error("Server results differ from local results");
     }
+}
 
-    std::vector<std::vector<double>> vectors;
-    std::string line;
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        vectors.emplace_back((std::istream_iterator<double>(iss)), std::istream_iterator<double>());
+/**
+ * @brief Computes a job locally and writes the results, without a server.
+ * 
+ * The vectors are reduced batch by batch as the input loader parses them, with the fastest kernel
+ * of `ReductionEngine` the CPU supports. The output file has the same format as after a run
+ * against the server.
+ * 
+ * @tparam T The element type of the vectors and results, chosen with `--type`.
+ * @param ui The parsed command-line options.
+ * @throws std::runtime_error If reading the input or writing the output fails.
+ */
+template <typename T>
+void runOffline(const UserInterface& ui) {
+    const ReductionEngine engine(ReductionEngine::parseOperation(ui.operation));
+    BasicInputLoader<T> input(ui.inputFile);
+    std::vector<T> results;
+    results.reserve(input.count());
+    typename BasicInputLoader<T>::Batch batch;
+    while (input.nextBatch(batch)) {
+        Stats::Timer timer(Stats::Phase::Reduce);
+        const size_t first = results.size();
+        results.resize(first + batch.size());
+        engine.reduce(batch, results.data() + first);
     }
+    std::cout << "Offline: " << results.size() << " vectors reduced with the "
+              << ReductionEngine::kernelName(engine.kernel()) << " kernel" << std::endl;
+    ResultWriter::write(ui.outputFile, results);
+}
 
-    return vectors;
+/**
+ * @brief Runs one complete job: connects, authenticates, exchanges all vectors and writes the results.
+ * 
+ * With several servers, the job is balanced across them by `processBalanced`, and every pooled
+ * session asks for the batch frames of `--batch`, the compressed payloads of `--compress` and the
+ * sparse payloads of `--sparse` in `authenticatePooled`. With these options, a single server is
+ * asked for batch frames, compressed and sparse payloads first; after a refusal it is connected to
+ * again and asked only for what it has not refused yet. The standby connections of `--standby` and
+ * `--hedge` are opened once that is settled and ask for what the job's session accepted. With
+ * `--verify-sample`, a sample of the results is checked by `verifyResults` after they are written.
+ * 
+ * @tparam T The element type of the vectors and results, chosen with `--type`.
+ * @param ui The parsed command-line options.
+ * @throws std::runtime_error If any step of the job fails.
+ */
+template <typename T>
+void runClient(const UserInterface& ui) {
+    // Parsing the input, reading the credentials and the connect/authentication
+    // handshake proceed concurrently; the first vector waits only for the slowest of them.
+    BasicInputLoader<T> input(ui.inputFile);
+    auto credentials = ThreadPool::shared().submit([configFile = ui.configFile] {
+        std::pair<std::string, std::string> loginPassword;
+        readLoginPassword(configFile, loginPassword.first, loginPassword.second);
+        return loginPassword;
+    });
+
+    std::unique_ptr<ResultCache> cache;
+    if (!ui.cacheFile.empty()) {
+        std::string identity = ui.serverAddress + ":" + std::to_string(ui.serverPort) + "/" + dataType<T>;
+        cache = std::make_unique<ResultCache>(ui.cacheFile, identity, ui.cacheSize);
+    }
+
+    std::vector<T> results;
+    if (ui.servers.size() > 1) {
+        // The servers are interchangeable, so results cached from any of them are reused
+        std::string password = credentials.get().second;
+        // The pools negotiate into the extensions until they are destroyed, so these go first
+        std::vector<std::unique_ptr<PooledExtensions>> extensions;
+        std::vector<std::unique_ptr<SessionPool>> pools;
+        std::vector<std::string> names;
+        for (const UserInterface::Endpoint& server : ui.servers) {
+            const std::string name = server.address + ":" + std::to_string(server.port);
+            extensions.push_back(std::make_unique<PooledExtensions>());
+            extensions.back()->wanted.batching = ui.batch;
+            extensions.back()->wanted.compression = ui.compress;
+            extensions.back()->wanted.sparse = ui.sparse;
+            PooledExtensions& negotiated = *extensions.back();
+            pools.push_back(std::make_unique<SessionPool>(
+                server.address, server.port,
+                [password, &negotiated, name](Communicator& comm) {
+                    authenticatePooled(comm, password, negotiated, name);
+                }, ui.poolSize));
+            names.push_back(name);
+        }
+        LoadBalancer balancer(ui.servers.size());
+        results = processBalanced(pools, extensions, names, balancer, input, cache.get(), ui.dedup,
+                                  ui.hedgePercentile);
+    } else {
+        auto comm = std::make_unique<Communicator>(ui.serverAddress, ui.serverPort);
+        {
+            Stats::Timer timer(Stats::Phase::Connect);
+            comm->connectToServer();
+        }
+
+        std::string password = credentials.get().second;
+        ClientJob::authenticate(*comm, password);
+
+        LatencyHistogram* latency = nullptr;
+        if (Stats::enabled()) {
+            latency = &Stats::connectionLatency(ui.serverAddress + ":" + std::to_string(ui.serverPort));
+        }
+
+        VectorSession::Extensions wanted;
+        wanted.batching = ui.batch;
+        wanted.compression = ui.compress;
+        wanted.sparse = ui.sparse;
+        std::unique_ptr<VectorSession> session = ClientJob::negotiate(comm, [&] {
+            return connectAuthenticated(ui.serverAddress, ui.serverPort, password);
+        }, wanted, latency);
+
+        // Standby connections for hedging are set up in the background while the job starts. A hedged
+        // vector moves to one with the payloads of the job, so they negotiate what the job accepted.
+        std::unique_ptr<SessionPool> standby;
+        if (ui.standby > 0 || ui.hedgePercentile > 0) {
+            standby = std::make_unique<SessionPool>(
+                ui.serverAddress, ui.serverPort,
+                [password, accepted = session->extensions()](Communicator& spareComm) {
+                    ClientJob::authenticateSpare(spareComm, password, accepted);
+                }, std::max<size_t>(ui.standby, 1));
+        }
+        if (ui.hedgePercentile > 0) {
+            session->hedge(ui.hedgePercentile, [&standby] { return standby->acquire(std::chrono::milliseconds(0)); });
+        }
+
+        results = ClientJob::process(*session, input, cache.get(), ui.dedup, &std::cout);
+        if (session->compressing()) {
+            const uint64_t from = session->compressionInput();
+            const uint64_t to = session->compressionOutput();
+            std::cout << "Compression: " << from << " bytes sent as " << to << " bytes, ratio " << std::fixed
+                      << std::setprecision(2) << (to > 0 ? static_cast<double>(from) / static_cast<double>(to) : 1.0)
+                      << ", " << std::setprecision(3) << static_cast<double>(session->compressionTime()) / 1e6
+                      << " ms encoding" << std::defaultfloat << std::endl;
+        }
+        if (session->sparse()) {
+            std::cout << "Sparse: " << session->sparsePayloads() << " payloads, " << session->sparseInput()
+                      << " bytes sent as " << session->sparseOutput() << " bytes" << std::endl;
+        }
+    }
+
+    if (cache) {
+        std::cout << "Result cache: " << cache->hits() << " hits, " << cache->misses() << " misses, "
+                  << cache->evictions() << " evictions" << std::endl;
+    }
+
+    ResultWriter::write(ui.outputFile, results);
+    if (ui.verifySample > 0) {
+        verifyResults(ui, results);
+    }
+}
+
+/**
+ * @brief Runs the client as a load generator: sends synthetic vectors and reports throughput and latency.
+ * 
+ * Vectors are generated in memory and go through the same send path as vectors read from a file.
+ * With a target rate, vector i is scheduled at start + i / rate and its latency is measured from
+ * that scheduled time, so a stalled server shows up in the latency instead of silently lowering
+ * the offered load. Results are written to the output file if one was given. Compressed and sparse
+ * payloads are negotiated as for a job with `--compress` and `--sparse`.
+ * 
+ * @param ui The parsed command-line options.
+ * @throws std::runtime_error If the specification is invalid or any step of the run fails.
+ */
+void runGenerator(const UserInterface& ui) {
+    const VectorGenerator::Spec spec = VectorGenerator::parse(ui.generateSpec);
+    VectorGenerator generator(spec);
+
+    std::string login;
+    std::string password;
+    readLoginPassword(ui.configFile, login, password);
+
+    std::unique_ptr<Communicator> comm = connectAuthenticated(ui.serverAddress, ui.serverPort, password);
+
+    LatencyHistogram* connectionLatency = nullptr;
+    if (Stats::enabled()) {
+        connectionLatency = &Stats::connectionLatency(ui.serverAddress + ":" + std::to_string(ui.serverPort));
+    }
+
+    // Every vector is timed on its own, so batch frames are not asked for (`--batch` is rejected)
+    VectorSession::Extensions wanted;
+    wanted.compression = ui.compress;
+    wanted.sparse = ui.sparse;
+    std::unique_ptr<VectorSession> session = ClientJob::negotiate(comm, [&] {
+        return connectAuthenticated(ui.serverAddress, ui.serverPort, password);
+    }, wanted, connectionLatency);
+
+    const size_t numVectors = static_cast<size_t>(spec.count);
+    session->announce(numVectors);
+
+    LatencyHistogram latency;
+    std::vector<double> results;
+    if (!ui.outputFile.empty()) {
+        results.reserve(numVectors);
+    }
+    std::vector<double> vec;
+    uint64_t bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < spec.count; ++i) {
+        generator.next(vec);
+        auto sentAt = std::chrono::steady_clock::now();
+        if (spec.rate > 0) {
+            auto scheduled = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(static_cast<double>(i) / spec.rate));
+            std::this_thread::sleep_until(scheduled);
+            sentAt = scheduled;
+        }
+        double result = session->exchange(vec.data(), vec.size());
+        latency.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - sentAt).count()));
+        bytes += sizeof(uint32_t) + vec.size() * sizeof(double);
+        if (!ui.outputFile.empty()) {
+            results.push_back(result);
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "Generated " << spec.count << " vectors in " << seconds << " s: "
+              << (seconds > 0 ? static_cast<double>(spec.count) / seconds : 0.0) << " vectors/s, "
+              << (seconds > 0 ? static_cast<double>(bytes) / seconds / 1e6 : 0.0) << " MB/s sent\n"
+              << std::setprecision(3)
+              << "Latency (ms): p50 " << static_cast<double>(latency.valueAtPercentile(50)) / 1e6
+              << ", p90 " << static_cast<double>(latency.valueAtPercentile(90)) / 1e6
+              << ", p99 " << static_cast<double>(latency.valueAtPercentile(99)) / 1e6
+              << ", p99.9 " << static_cast<double>(latency.valueAtPercentile(99.9)) / 1e6
+              << ", max " << static_cast<double>(latency.max()) / 1e6 << std::endl;
+
+    if (!ui.outputFile.empty()) {
+        ResultWriter::write(ui.outputFile, results);
+    }
+}
+
+/**
+ * @brief Processes one spool file over a session from the pool.
+ * 
+ * Every attempt uses a fresh session, since a session carries exactly one job. When the server
+ * goes away in the middle of a file, the file is started again on a new session once the pool has
+ * reconnected.
+ * 
+ * @tparam T The element type of the vectors and results.
+ * @param pool The pool of authenticated sessions.
+ * @param extensions The extensions the sessions of the pool negotiated.
+ * @param inputFile The path of the spool file.
+ * @param outputFile The path of the output file.
+ * @param cache An optional result cache, or `nullptr`.
+ * @param dedup Whether to send repeated vectors once even without a cache.
+ * @param latency Latency histogram of the server, or `nullptr`.
+ * @param hedgePercentile The latency percentile after which a vector is hedged on another session
+ *                        of the pool, 0 to disable.
+ * @throws std::runtime_error If every attempt fails or a shutdown was requested.
+ */
+template <typename T>
+void processSpoolFile(SessionPool& pool, PooledExtensions& extensions, const std::string& inputFile,
+                      const std::string& outputFile, ResultCache* cache, bool dedup, LatencyHistogram* latency,
+                      double hedgePercentile) {
+    for (int attempt = 1;; ++attempt) {
+        BasicInputLoader<T> input(inputFile);
+        std::unique_ptr<Communicator> comm;
+        bool reported = false;
+        while (!(comm = pool.acquire(std::chrono::milliseconds(500)))) {
+            if (stopRequested) {
+                throw std::runtime_error("Interrupted while waiting for the server");
+            }
+            bool renegotiating;
+            {
+                std::lock_guard<std::mutex> lock(extensions.mutex);
+                renegotiating = extensions.renegotiating;
+            }
+            if (!reported && !renegotiating && !pool.lastError().empty()) {
+                std::cerr << "Waiting for the server: " << pool.lastError() << std::endl;
+                reported = true;
+            }
+        }
+
+        std::vector<T> results;
+        try {
+            // Every session the pool hands out has negotiated the settled extensions, and so has every spare
+            VectorSession session(*comm, latency);
+            {
+                std::lock_guard<std::mutex> lock(extensions.mutex);
+                session.resume(extensions.wanted);
+            }
+            if (hedgePercentile > 0) {
+                session.hedge(hedgePercentile, [&pool] { return pool.acquire(std::chrono::milliseconds(0)); });
+            }
+            results = ClientJob::process(session, input, cache, dedup, &std::cout);
+        } catch (const std::exception& ex) {
+            if (attempt >= MAX_JOB_ATTEMPTS || stopRequested) {
+                throw;
+            }
+            std::cerr << "Retrying " << inputFile << ": " << ex.what() << std::endl;
+            continue;
+        }
+        ResultWriter::writeAtomically(outputFile, results);
+        return;
+    }
 }
 
 /**
- * @brief Writes the results of processing to an output file.
+ * @brief Runs the client as a daemon that processes every file dropped into the spool directory.
  * 
- * This function writes the processed results (a vector of doubles) to a specified binary
- * output file. The number of results is written first, followed by each result value.
+ * The credentials are read once; connecting and authenticating happen ahead of time in the session
+ * pool. Each processed input is moved to the `done` or `failed` subdirectory of the spool
+ * directory. A file interrupted by a shutdown request stays in the spool and is processed on the
+ * next start.
  * 
- * @param outputFile The path to the output file.
- * @param results A vector containing the results to be written to the file.
- * @throws std::runtime_error If the file cannot be opened for writing.
+ * @tparam T The element type of the vectors and results, chosen with `--type`.
+ * @param ui The parsed command-line options.
+ * @throws std::runtime_error If the daemon cannot be set up.
  */
-void writeResults(const std::string& outputFile, const std::vector<double>& results) {
-    std::ofstream file(outputFile, std::ios::binary);
-    if (!file) {
-        throw std::runtime_error("Failed to open output file: " + outputFile);
+template <typename T>
+void runDaemon(const UserInterface& ui) {
+    std::string login;
+    std::string password;
+    readLoginPassword(ui.configFile, login, password);
+
+    for (const char* subdirectory : {"done", "failed"}) {
+        std::string path = ui.spoolDir + "/" + subdirectory;
+        if (mkdir(path.c_str(), 0755) == -1 && errno != EEXIST) {
+            throw std::runtime_error("Failed to create spool subdirectory: " + path);
+        }
+    }
+
+    struct sigaction action{};
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    SpoolWatcher spool(ui.spoolDir);
+    // The pool negotiates into the extensions until it is destroyed, so they go first
+    PooledExtensions extensions;
+    extensions.wanted.batching = ui.batch;
+    extensions.wanted.compression = ui.compress;
+    extensions.wanted.sparse = ui.sparse;
+    const std::string server = ui.serverAddress + ":" + std::to_string(ui.serverPort);
+    SessionPool pool(ui.serverAddress, ui.serverPort,
+                     [password, &extensions, server](Communicator& comm) {
+                         authenticatePooled(comm, password, extensions, server);
+                     }, ui.poolSize);
+
+    std::unique_ptr<ResultCache> cache;
+    if (!ui.cacheFile.empty()) {
+        std::string identity = ui.serverAddress + ":" + std::to_string(ui.serverPort) + "/" + dataType<T>;
+        cache = std::make_unique<ResultCache>(ui.cacheFile, identity, ui.cacheSize);
     }
 
-    uint32_t numResults = results.size();
-    file.write(reinterpret_cast<const char*>(&numResults), sizeof(numResults));
+    LatencyHistogram* latency = nullptr;
+    if (Stats::enabled()) {
+        latency = &Stats::connectionLatency(server);
+    }
+
+    size_t processed = 0;
+    size_t failed = 0;
+    std::string name;
+    while (!stopRequested) {
+        if (!spool.next(name, 500)) {
+            continue;
+        }
+
+        size_t dot = name.find_last_of('.');
+        std::string base = (dot == std::string::npos || dot == 0) ? name : name.substr(0, dot);
+        std::string inputFile = ui.spoolDir + "/" + name;
+        std::string destination = "done";
+        try {
+            processSpoolFile<T>(pool, extensions, inputFile, ui.outputFile + "/" + base + ".bin", cache.get(),
+                                ui.dedup, latency, ui.hedgePercentile);
+            ++processed;
+        } catch (const std::exception& ex) {
+            if (stopRequested) {
+                break;
+            }
+            std::cerr << "Error: " << name << ": " << ex.what() << std::endl;
+            destination = "failed";
+            ++failed;
+        }
+
+        std::string moved = ui.spoolDir + "/" + destination + "/" + name;
+        if (std::rename(inputFile.c_str(), moved.c_str()) != 0) {
+            std::cerr << "Error: failed to move " << inputFile << " to " << moved << std::endl;
+        }
+        spool.done(name);
+    }
+
+    std::cout << "Daemon stopped: " << processed << " files processed, " << failed << " failed, "
+              << pool.reconnects() << " reconnects" << std::endl;
+}
 
-    for (const auto& result : results) {
-        file.write(reinterpret_cast<const char*>(&result), sizeof(result));
+/**
+ * @brief Calls a job with a value of the element type named by `--type`.
+ * 
+ * The job is a generic lambda; it recovers the type with `decltype`, so every job path is compiled
+ * once per element type and the chosen one runs without any per-value dispatch.
+ * 
+ * @param name The element type: `float`, `double`, `int32` or `int64`.
+ * @param job The job to run.
+ */
+template <typename Job>
+void withElementType(const std::string& name, Job job) {
+    if (name == dataType<float>) {
+        job(float());
+    } else if (name == dataType<int32_t>) {
+        job(int32_t());
+    } else if (name == dataType<int64_t>) {
+        job(int64_t());
+    } else {
+        job(double());
     }
 }
 
@@ -171,33 +952,54 @@ int main(int argc, char** argv) {
         }
 
         UserInterface ui(argc, argv);
-        Communicator comm(ui.serverAddress, ui.serverPort);
-
-        comm.connectToServer();
-
-        std::string login, password;
-        readLoginPassword(ui.configFile, login, password);
-
-        authenticateAsClient(comm, password);
-
-        auto vectors = readInputFile(ui.inputFile);
-        std::vector<double> results;
-
-        uint32_t numVectors = vectors.size();
-        comm.sendMessage(reinterpret_cast<const char*>(&numVectors), sizeof(numVectors));
-
-        for (const auto& vec : vectors) {
-            uint32_t vectorSize = vec.size();
-            comm.sendMessage(reinterpret_cast<const char*>(&vectorSize), sizeof(vectorSize));
-            comm.sendMessage(reinterpret_cast<const char*>(vec.data()), vec.size() * sizeof(double));
-
-            double result;
-            comm.receiveMessage(reinterpret_cast<char*>(&result), sizeof(result));
-            results.push_back(result);
-            std::cout << "Received result: " << result << std::endl;
+        if (!ui.statsFile.empty() || !ui.histogramFile.empty() || !ui.metricsEndpoint.empty()) {
+            Stats::enable();
+        }
+        std::unique_ptr<MetricsServer> metrics;
+        if (!ui.metricsEndpoint.empty()) {
+            metrics = std::make_unique<MetricsServer>(ui.metricsEndpoint);
+        }
+        if (!ui.traceFile.empty()) {
+            Trace::enable();
+            Trace::nameThread("main");
+        }
+        ThreadPool::configure(ui.threads, ThreadPool::parsePlacement(ui.threadPlacement));
+        Communicator::Backend backend = Communicator::parseBackend(ui.ioBackend);
+        if (backend != Communicator::Backend::Socket && !IoUring::available()) {
+            std::cerr << "Warning: io_uring is not available, using socket calls" << std::endl;
+            backend = Communicator::Backend::Socket;
+        }
+        Communicator::setDefaultBackend(backend);
+        Communicator::setDefaultTimeout(std::chrono::milliseconds(ui.timeoutMs));
+        Communicator::setFastOpen(ui.fastOpen);
+
+        {
+            Stats::Timer timer(Stats::Phase::Total);
+            if (!ui.generateSpec.empty()) {
+                runGenerator(ui);
+            } else {
+                withElementType(ui.elementType, [&ui](auto zero) {
+                    using T = decltype(zero);
+                    if (ui.offline) {
+                        runOffline<T>(ui);
+                    } else if (!ui.spoolDir.empty()) {
+                        runDaemon<T>(ui);
+                    } else {
+                        runClient<T>(ui);
+                    }
+                });
+            }
         }
 
-        writeResults(ui.outputFile, results);
+        if (!ui.statsFile.empty()) {
+            Stats::writeJson(ui.statsFile);
+        }
+        if (!ui.histogramFile.empty()) {
+            Stats::writeHistogram(ui.histogramFile);
+        }
+        if (!ui.traceFile.empty()) {
+            Trace::writeJson(ui.traceFile);
+        }
 
     } catch (const std::exception& ex) {
         std::cerr << "Error: " << ex.what() << std::endl;
@@ -206,4 +1008,3 @@ int main(int argc, char** argv) {
 
     return 0;
 }
-
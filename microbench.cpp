@@ -0,0 +1,519 @@
+/**
+ * @file microbench.cpp
+ * @brief Microbenchmarks for the hot components of the client.
+ * 
+ * This program measures the individual building blocks in isolation: SHA256 hashing over several
+ * input sizes and with every available kernel, parsing of generated input text, writing of result
+ * files, the payload codec, sparse payloads, the local reduction kernels and the `Communicator` exchange with a stand-in server over TCP
+ * loopback, a Unix-domain socket and shared memory. For every benchmark it reports the median time per operation, the
+ * throughput and the number of heap allocations per operation.
+ * 
+ * Each benchmark is first warmed up while the number of iterations per repetition is calibrated so
+ * that one repetition takes about `--min-time` seconds; then it is repeated `--repetitions` times
+ * and the median is reported together with the spread between the fastest and the slowest run.
+ * 
+ * Usage: `microbench [filter] [--min-time seconds] [--repetitions n]`, where only benchmarks whose
+ * name contains `filter` are run.
+ * 
+ * @author Romanov D.E.
+ * @date 2024-12-19
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+#include "include/SHA256Library.h"
+#include "include/InputLoader.h"
+#include "include/ResultWriter.h"
+#include "include/DataWriter.h"
+#include "include/Communicator.h"
+#include "include/VectorSession.h"
+#include "include/VectorGenerator.h"
+#include "include/XorCodec.h"
+#include "include/ReductionEngine.h"
+#include "include/LoopbackServer.h"
+
+namespace {
+
+/**
+ * @brief Number of heap allocations made by the process so far.
+ */
+std::atomic<uint64_t> allocations(0);
+
+/**
+ * @brief Allocates memory and counts the allocation.
+ * 
+ * @param size The number of bytes.
+ * @return The allocated memory.
+ * @throws std::bad_alloc If the allocation fails.
+ */
+void* countedAlloc(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    return countedAlloc(size);
+}
+
+void* operator new[](std::size_t size) {
+    return countedAlloc(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+/**
+ * @struct Options
+ * @brief Command-line options of the benchmark runner.
+ */
+struct Options {
+    std::string filter;      /**< Substring selecting the benchmarks to run. */
+    double minTime = 0.2;    /**< Target duration of one repetition in seconds. */
+    int repetitions = 7;     /**< Number of measured repetitions. */
+};
+
+/**
+ * @brief Prevents the compiler from optimizing away a computed value.
+ * 
+ * @param value The value to keep.
+ */
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+/**
+ * @brief Runs an operation a number of times and returns the elapsed time.
+ * 
+ * @param op The operation.
+ * @param iterations How many times to run it.
+ * @return The elapsed time in seconds.
+ */
+template <typename Op>
+double timeBatch(Op& op, uint64_t iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        op();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Calibrates, runs and reports one benchmark.
+ * 
+ * @param options The runner options.
+ * @param name The benchmark name.
+ * @param bytesPerOp Bytes processed by one operation, 0 if throughput is not meaningful.
+ * @param op The operation to measure.
+ */
+template <typename Op>
+void run(const Options& options, const std::string& name, uint64_t bytesPerOp, Op op) {
+    if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+        return;
+    }
+
+    // Warm-up: double the batch until it takes a quarter of the target, then scale it up.
+    uint64_t iterations = 1;
+    while (true) {
+        double elapsed = timeBatch(op, iterations);
+        if (elapsed >= options.minTime / 4 || iterations >= (uint64_t(1) << 40)) {
+            double scaled = static_cast<double>(iterations) * options.minTime / std::max(elapsed, 1e-9);
+            iterations = std::max<uint64_t>(1, static_cast<uint64_t>(scaled));
+            break;
+        }
+        iterations *= 2;
+    }
+
+    std::vector<double> nsPerOp;
+    uint64_t allocated = 0;
+    for (int repetition = 0; repetition < options.repetitions; ++repetition) {
+        uint64_t before = allocations.load(std::memory_order_relaxed);
+        double elapsed = timeBatch(op, iterations);
+        allocated += allocations.load(std::memory_order_relaxed) - before;
+        nsPerOp.push_back(elapsed * 1e9 / static_cast<double>(iterations));
+    }
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+    const double median = nsPerOp[nsPerOp.size() / 2];
+    const double spread = (nsPerOp.back() - nsPerOp.front()) / median * 100.0;
+    const double allocsPerOp = static_cast<double>(allocated) / (static_cast<double>(iterations) * options.repetitions);
+
+    std::printf("%-44s %14.1f ", name.c_str(), median);
+    if (bytesPerOp > 0) {
+        std::printf("%12.1f ", static_cast<double>(bytesPerOp) / median * 1e3);
+    } else {
+        std::printf("%12s ", "-");
+    }
+    std::printf("%12.2f %8.1f%%\n", allocsPerOp, spread);
+    std::fflush(stdout);
+}
+
+/**
+ * @brief Benchmarks SHA256 over several input sizes and every supported kernel.
+ * 
+ * @param options The runner options.
+ */
+void benchSha256(const Options& options) {
+    for (size_t size : {64, 1024, 65536, 1048576}) {
+        std::vector<uint8_t> data(size, 0x5a);
+        run(options, "sha256/hash/" + std::to_string(size), size, [&data] {
+            std::string digest = SHA256Library::hash(data.data(), data.size());
+            keep(digest);
+        });
+    }
+
+    const SHA256Library::Kernel originalSingle = SHA256Library::kernel();
+    const SHA256Library::Kernel originalMulti = SHA256Library::multiBufferKernel();
+    std::vector<uint8_t> data(65536, 0xa5);
+    for (auto kernel : {SHA256Library::Kernel::Scalar, SHA256Library::Kernel::ShaNi,
+                        SHA256Library::Kernel::Sse2x4, SHA256Library::Kernel::Avx2x8}) {
+        if (!SHA256Library::kernelSupported(kernel)) {
+            continue;
+        }
+        SHA256Library::useKernel(kernel);
+        const size_t lanes = SHA256Library::kernelLanes(kernel);
+        if (lanes == 1) {
+            run(options, std::string("sha256/kernel/") + SHA256Library::kernelName(kernel) + "/65536",
+                data.size(), [&data] {
+                uint8_t digest[SHA256Library::DIGEST_SIZE];
+                SHA256Library::Context context;
+                SHA256Library::init(context);
+                SHA256Library::update(context, data.data(), data.size());
+                SHA256Library::final(context, digest);
+                keep(digest);
+            });
+        } else {
+            std::vector<const void*> buffers(lanes);
+            std::vector<size_t> sizes(lanes, 1024);
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                buffers[lane] = data.data() + lane * 1024;
+            }
+            std::vector<uint8_t> digests(lanes * SHA256Library::DIGEST_SIZE);
+            run(options, std::string("sha256/many/") + SHA256Library::kernelName(kernel) + "/" +
+                std::to_string(lanes) + "x1024", lanes * 1024, [&] {
+                SHA256Library::hashMany(buffers.data(), sizes.data(), lanes,
+                                        reinterpret_cast<uint8_t(*)[SHA256Library::DIGEST_SIZE]>(digests.data()));
+                keep(digests);
+            });
+        }
+    }
+    SHA256Library::useKernel(SHA256Library::Kernel::Scalar);
+    SHA256Library::useKernel(originalSingle);
+    SHA256Library::useKernel(originalMulti);
+}
+
+/**
+ * @brief Benchmarks parsing of a generated input file.
+ * 
+ * @param options The runner options.
+ */
+void benchParser(const Options& options) {
+    const std::string path = "/tmp/microbench_input_" + std::to_string(getpid()) + ".txt";
+    {
+        std::ofstream file(path);
+        VectorGenerator generator(VectorGenerator::parse("dim=16,dist=normal,seed=7"));
+        std::vector<double> vec;
+        for (int line = 0; line < 20000; ++line) {
+            generator.next(vec);
+            for (size_t i = 0; i < vec.size(); ++i) {
+                file << (i == 0 ? "" : " ") << vec[i];
+            }
+            file << '\n';
+        }
+    }
+    std::ifstream sized(path, std::ios::binary | std::ios::ate);
+    const uint64_t bytes = static_cast<uint64_t>(sized.tellg());
+
+    run(options, "parser/input_loader/20000x16", bytes, [&path] {
+        InputLoader loader(path);
+        InputLoader::Batch vectors = loader.readAll();
+        keep(vectors);
+    });
+    std::remove(path.c_str());
+}
+
+/**
+ * @brief Benchmarks writing result files and text lines.
+ * 
+ * @param options The runner options.
+ */
+void benchWriter(const Options& options) {
+    const std::string path = "/tmp/microbench_output_" + std::to_string(getpid()) + ".bin";
+    std::vector<double> results(100000);
+    for (size_t i = 0; i < results.size(); ++i) {
+        results[i] = static_cast<double>(i) * 0.5;
+    }
+    run(options, "writer/result_writer/100000", 4 + results.size() * sizeof(double), [&] {
+        ResultWriter::write(path, results);
+    });
+
+    const std::string line = "1.1 2.2 3.3 4.4 5.5 6.6 7.7 8.8";
+    run(options, "writer/data_writer/1000_lines", 1000 * (line.size() + 1), [&] {
+        DataWriter writer(path);
+        for (int i = 0; i < 1000; ++i) {
+            writer.writeLine(line);
+        }
+    });
+    std::remove(path.c_str());
+}
+
+/**
+ * @brief Benchmarks the `Communicator` against a local stand-in server.
+ * 
+ * One operation is one complete vector exchange. Every transport is measured with every
+ * backend available on the machine, so `communicator/exchange/tcp/16` against
+ * `communicator/exchange/shm/16` shows what a co-located server gains from shared memory.
+ * 
+ * @param options The runner options.
+ */
+void benchCommunicator(const Options& options) {
+    const std::pair<LoopbackServer::Transport, const char*> transports[] = {
+        {LoopbackServer::Transport::Tcp, "tcp/"},
+        {LoopbackServer::Transport::Unix, "unix/"},
+        {LoopbackServer::Transport::Shm, "shm/"}
+    };
+    const std::pair<Communicator::Backend, const char*> backends[] = {
+        {Communicator::Backend::Socket, ""},
+        {Communicator::Backend::IoUring, "io_uring/"},
+        {Communicator::Backend::IoUringSqpoll, "io_uring-sqpoll/"}
+    };
+    for (const auto& [transport, transportName] : transports) {
+        LoopbackServer server(transport);
+        Communicator comm(server.address(), server.port());
+        comm.connectToServer();
+        VectorSession session(comm);
+        for (const auto& [backend, backendName] : backends) {
+            if (comm.useBackend(backend) != backend) {
+                continue;
+            }
+            for (uint32_t dim : {16u, 1024u}) {
+                std::vector<double> vec(dim, 1.0);
+                run(options, "communicator/exchange/" + std::string(transportName) + backendName + std::to_string(dim),
+                    sizeof(uint32_t) + dim * sizeof(double), [&session, &vec] {
+                    keep(session.exchange(vec.data(), vec.size()));
+                });
+            }
+        }
+        comm.useBackend(Communicator::Backend::Socket);
+    }
+}
+
+/**
+ * @brief Benchmarks batch frames against exchanging the same vectors one by one.
+ * 
+ * One operation is a batch of 256 vectors, sent with `VectorSession::exchange` over a session
+ * that has negotiated batch frames (`framed`) and over one that has not (`per_vector`), so the
+ * two lines show what framing saves on every transport.
+ * 
+ * @param options The runner options.
+ */
+void benchBatch(const Options& options) {
+    const std::pair<LoopbackServer::Transport, const char*> transports[] = {
+        {LoopbackServer::Transport::Tcp, "tcp/"},
+        {LoopbackServer::Transport::Unix, "unix/"},
+        {LoopbackServer::Transport::Shm, "shm/"}
+    };
+    const size_t count = 256;
+    for (const auto& [transport, transportName] : transports) {
+        for (uint32_t dim : {16u, 1024u}) {
+            VectorBatch batch;
+            std::vector<double> vec(dim, 1.0);
+            for (size_t i = 0; i < count; ++i) {
+                batch.append(vec.data(), vec.size());
+            }
+            std::vector<double> results(count);
+            for (bool framed : {false, true}) {
+                LoopbackServer server(transport);
+                Communicator comm(server.address(), server.port());
+                comm.connectToServer();
+                VectorSession session(comm);
+                if (framed && !session.negotiateBatching()) {
+                    throw std::runtime_error("The loopback server did not accept batch frames");
+                }
+                run(options, "communicator/batch/" + std::string(transportName) + std::to_string(dim) + "x" +
+                    std::to_string(count) + (framed ? "/framed" : "/per_vector"),
+                    count * (sizeof(uint32_t) + dim * sizeof(double)), [&session, &batch, &results] {
+                    session.exchange(batch, results.data());
+                    keep(results[0]);
+                });
+            }
+        }
+    }
+}
+
+/**
+ * @brief Benchmarks the payload codec and compressed exchanges.
+ * 
+ * The codec runs on 65536 doubles of two kinds: small integers, which it shrinks to a fraction,
+ * and full-precision decimal fractions, which it cannot shrink, so the session sends those raw.
+ * The exchanges send one such vector over TCP loopback with and without negotiated compression;
+ * loopback bandwidth is high, so these lines show the CPU cost rather than the gain on slow links.
+ * 
+ * @param options The runner options.
+ */
+void benchCompression(const Options& options) {
+    const size_t count = 65536;
+    std::vector<double> integers(count);
+    std::vector<double> decimals(count);
+    for (size_t i = 0; i < count; ++i) {
+        integers[i] = static_cast<double>(1000 + (i * 7919) % 512);
+        decimals[i] = static_cast<double>((i * 7919) % 100000) / 1000.0;
+    }
+    std::vector<uint8_t> packed(XorCodec::maxEncodedSize(count, sizeof(double)));
+    std::vector<double> decoded(count);
+    for (const auto& [values, kind] : {std::make_pair(&integers, "integers/"), std::make_pair(&decimals, "decimals/")}) {
+        const size_t size = XorCodec::encode(values->data(), count, sizeof(double), packed.data());
+        run(options, "codec/xor/encode/" + std::string(kind) + std::to_string(count), count * sizeof(double),
+            [&packed, values] {
+            keep(XorCodec::encode(values->data(), values->size(), sizeof(double), packed.data()));
+        });
+        run(options, "codec/xor/decode/" + std::string(kind) + std::to_string(count), count * sizeof(double),
+            [&packed, &decoded, size] {
+            XorCodec::decode(packed.data(), size, decoded.data(), decoded.size(), sizeof(double));
+            keep(decoded[0]);
+        });
+    }
+    for (bool compressed : {false, true}) {
+        LoopbackServer server(LoopbackServer::Transport::Tcp);
+        Communicator comm(server.address(), server.port());
+        comm.connectToServer();
+        VectorSession session(comm);
+        if (compressed && !session.negotiateCompression()) {
+            throw std::runtime_error("The loopback server did not accept compressed payloads");
+        }
+        run(options, "communicator/compress/tcp/integers/" + std::to_string(count) + (compressed ? "/xor" : "/raw"),
+            sizeof(uint32_t) + count * sizeof(double), [&session, &integers] {
+            keep(session.exchange(integers.data(), integers.size()));
+        });
+    }
+}
+
+/**
+ * @brief Benchmarks dense against sparse payloads for a vector that is 95% zeros.
+ * 
+ * One operation exchanges the vector over TCP loopback with and without negotiated sparse
+ * payloads, with the nonzero count known as it is for parsed vectors; the bytes per operation are
+ * those of the dense vector. Loopback copies bytes about as fast as the encoder reads them, so
+ * these lines show the CPU cost rather than the gain on real links.
+ * 
+ * @param options The runner options.
+ */
+void benchSparse(const Options& options) {
+    const size_t count = 65536;
+    std::vector<double> values(count, 0.0);
+    size_t nonzeros = 0;
+    for (size_t i = 0; i < count; i += 20, ++nonzeros) {
+        values[i] = static_cast<double>(i % 1000) / 8.0 + 1.0;
+    }
+    for (bool sparse : {false, true}) {
+        LoopbackServer server(LoopbackServer::Transport::Tcp);
+        Communicator comm(server.address(), server.port());
+        comm.connectToServer();
+        VectorSession session(comm);
+        if (sparse && !session.negotiateSparse()) {
+            throw std::runtime_error("The loopback server did not accept sparse payloads");
+        }
+        run(options, "communicator/sparse/tcp/" + std::to_string(count) + (sparse ? "/pairs" : "/dense"),
+            sizeof(uint32_t) + count * sizeof(double), [&session, &values, nonzeros] {
+            keep(session.exchange(values.data(), values.size(), nonzeros));
+        });
+    }
+}
+
+/**
+ * @brief Benchmarks the local reduction with every supported kernel.
+ * 
+ * @param options The runner options.
+ */
+void benchReduction(const Options& options) {
+    const size_t count = 65536;
+    std::vector<double> doubles(count);
+    std::vector<float> floats(count);
+    for (size_t i = 0; i < count; ++i) {
+        doubles[i] = static_cast<double>((i * 7919) % 100000) / 1000.0;
+        floats[i] = static_cast<float>(doubles[i]);
+    }
+    for (auto kernel : {ReductionEngine::Kernel::Scalar, ReductionEngine::Kernel::Avx2,
+                        ReductionEngine::Kernel::Avx512}) {
+        if (!ReductionEngine::kernelSupported(kernel)) {
+            continue;
+        }
+        const ReductionEngine engine(ReductionEngine::Operation::Sum, kernel);
+        const std::string name = std::string("reduce/") + ReductionEngine::kernelName(kernel);
+        run(options, name + "/double/" + std::to_string(count), count * sizeof(double), [&engine, &doubles] {
+            keep(engine.reduce(doubles.data(), doubles.size()));
+        });
+        run(options, name + "/float/" + std::to_string(count), count * sizeof(float), [&engine, &floats] {
+            keep(engine.reduce(floats.data(), floats.size()));
+        });
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Entry point of the benchmark runner.
+ * 
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return 0 on success, 1 on invalid arguments.
+ */
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--min-time" && i + 1 < argc) {
+            options.minTime = std::atof(argv[++i]);
+        } else if (argument == "--repetitions" && i + 1 < argc) {
+            options.repetitions = std::max(1, std::atoi(argv[++i]));
+        } else if (!argument.empty() && argument[0] != '-') {
+            options.filter = argument;
+        } else {
+            std::fprintf(stderr, "Usage: %s [filter] [--min-time seconds] [--repetitions n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::printf("%-44s %14s %12s %12s %9s\n", "benchmark", "ns/op", "MB/s", "allocs/op", "spread");
+    benchSha256(options);
+    benchParser(options);
+    benchWriter(options);
+    benchCommunicator(options);
+    benchBatch(options);
+    benchCompression(options);
+    benchSparse(options);
+    benchReduction(options);
+    return 0;
+}
@@ -4,15 +4,101 @@
  * 
  * This file contains unit tests for the `DataReader`, `DataWriter`, `Communicator`, and `UserInterface`
  * classes. The tests ensure the correct functionality of these components by simulating their behavior
- * using mock implementations and verifying their output and behavior.
+ * using mock implementations and verifying their output and behavior. `SHA256Library` is tested directly
+ * against the NIST example vectors, `ResultCache` and `InputLoader` against temporary files.
  * 
  * @author Romanov D.E.
  * @date 2024-12-19
  */
 
 #include <UnitTest++/UnitTest++.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <cstring>
+#include <new>
+
+#include "include/AddressResolver.h"
+#include "include/BatchSizer.h"
+#include "include/BufferPool.h"
+#include "include/InputLoader.h"
+#include "include/IoUring.h"
+#include "include/LatencyHistogram.h"
+#include "include/LoadBalancer.h"
+#include "include/MetricsServer.h"
+#include "include/ReductionEngine.h"
+#include "include/ResultCache.h"
+#include "include/ResultWriter.h"
+#include "include/SHA256Library.h"
+#include "include/ShmRing.h"
+#include "include/SpoolWatcher.h"
+#include "include/Stats.h"
+#include "include/ThreadPool.h"
+#include "include/Trace.h"
+#include "include/VectorDeduplicator.h"
+#include "include/VectorGenerator.h"
+#include "include/XorCodec.h"
+
+// Счётчик выделений памяти
+
+/**
+ * @brief Number of heap allocations made by the current thread.
+ * 
+ * The counter is per thread so that a test can check its own loop while worker threads of the
+ * component under test are still filling their pools.
+ */
+thread_local uint64_t threadAllocations = 0;
+
+/**
+ * @brief Allocates memory and counts the allocation.
+ * 
+ * @param size The number of bytes.
+ * @return The allocated memory.
+ * @throws std::bad_alloc If the allocation fails.
+ */
+static void* countedAlloc(std::size_t size) {
+    ++threadAllocations;
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size) {
+    return countedAlloc(size);
+}
+
+void* operator new[](std::size_t size) {
+    return countedAlloc(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
 
 // Заглушки для классов
 
@@ -123,6 +209,1045 @@ public:
     }
 };
 
+// Тесты для SHA256Library
+
+/**
+ * @test SHA256Library_Hash_NistVectors
+ * @brief Tests the `hash` method of the `SHA256Library` class against the NIST example messages.
+ * 
+ * This test verifies the digests of the empty message, "abc" and the 448-bit two-block message.
+ */
+TEST(SHA256Library_Hash_NistVectors) {
+    CHECK_EQUAL("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", SHA256Library::hash(""));
+    CHECK_EQUAL("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", SHA256Library::hash("abc"));
+    CHECK_EQUAL("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+                SHA256Library::hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+}
+
+/**
+ * @test SHA256Library_Update_Incremental
+ * @brief Tests the incremental `init`/`update`/`final` interface of the `SHA256Library` class.
+ * 
+ * This test feeds one million 'a' characters in uneven pieces and verifies the NIST digest.
+ */
+TEST(SHA256Library_Update_Incremental) {
+    std::string chunk(997, 'a');
+    SHA256Library::Context ctx;
+    SHA256Library::init(ctx);
+    size_t remaining = 1000000;
+    while (remaining > 0) {
+        size_t size = std::min(remaining, chunk.size());
+        SHA256Library::update(ctx, chunk.data(), size);
+        remaining -= size;
+    }
+    uint8_t digest[SHA256Library::DIGEST_SIZE];
+    SHA256Library::final(ctx, digest);
+    char hex[SHA256Library::HEX_SIZE];
+    SHA256Library::toHex(digest, hex, true);
+    CHECK_EQUAL("CDC76E5C9914FB9281A1C7E284D73E67F1809A48A497200E046D39CCC7112CD0",
+                std::string(hex, sizeof(hex)));
+}
+
+/**
+ * @test SHA256Library_Kernels_MatchReference
+ * @brief Tests every SHA-256 kernel supported by the CPU against the scalar reference.
+ * 
+ * This test hashes messages of many lengths (covering the one- and two-block padding cases)
+ * with each available kernel, one by one and through `hashMany`, and compares the digests
+ * with the scalar implementation and the NIST "abc" vector.
+ */
+TEST(SHA256Library_Kernels_MatchReference) {
+    const SHA256Library::Kernel single = SHA256Library::kernel();
+    const SHA256Library::Kernel multi = SHA256Library::multiBufferKernel();
+
+    std::vector<std::string> messages;
+    for (size_t size = 0; size < 300; size += 7) {
+        std::string message(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            message[i] = static_cast<char>(i * 31 + size);
+        }
+        messages.push_back(message);
+    }
+    messages.push_back("abc");
+
+    SHA256Library::useKernel(SHA256Library::Kernel::Scalar);
+    std::vector<std::string> expected;
+    for (const auto& message : messages) {
+        expected.push_back(SHA256Library::hash(message));
+    }
+    CHECK_EQUAL("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", expected.back());
+
+    const SHA256Library::Kernel kernels[] = {
+        SHA256Library::Kernel::Scalar, SHA256Library::Kernel::ShaNi,
+        SHA256Library::Kernel::Sse2x4, SHA256Library::Kernel::Avx2x8
+    };
+    for (SHA256Library::Kernel kernel : kernels) {
+        if (!SHA256Library::kernelSupported(kernel)) {
+            continue;
+        }
+        SHA256Library::useKernel(kernel);
+
+        std::vector<const void*> data;
+        std::vector<size_t> sizes;
+        for (const auto& message : messages) {
+            data.push_back(message.data());
+            sizes.push_back(message.size());
+        }
+        std::vector<uint8_t> digests(messages.size() * SHA256Library::DIGEST_SIZE);
+        SHA256Library::hashMany(data.data(), sizes.data(), messages.size(),
+                                reinterpret_cast<uint8_t(*)[SHA256Library::DIGEST_SIZE]>(digests.data()));
+
+        for (size_t i = 0; i < messages.size(); ++i) {
+            CHECK_EQUAL(expected[i], SHA256Library::hash(messages[i]));
+            char hex[SHA256Library::HEX_SIZE];
+            SHA256Library::toHex(&digests[i * SHA256Library::DIGEST_SIZE], hex);
+            CHECK_EQUAL(expected[i], std::string(hex, sizeof(hex)));
+        }
+    }
+
+    SHA256Library::useKernel(single);
+    SHA256Library::useKernel(multi);
+}
+
+// Тесты для AddressResolver
+
+/**
+ * @test AddressResolver_Resolve_NumericAndNamedHosts
+ * @brief Tests that the `AddressResolver` class resolves IPv4 and IPv6 addresses and host names.
+ * 
+ * This test resolves numeric addresses of both families, checks their family, port and formatting,
+ * resolves `localhost` twice (the second time from the cache) and again after `forget`.
+ */
+TEST(AddressResolver_Resolve_NumericAndNamedHosts) {
+    std::vector<AddressResolver::Address> v4 = AddressResolver::resolve("127.0.0.1", 33333);
+    CHECK_EQUAL(1u, v4.size());
+    CHECK_EQUAL(AF_INET, v4[0].family());
+    CHECK_EQUAL("127.0.0.1:33333", AddressResolver::format(v4[0]));
+
+    std::vector<AddressResolver::Address> v6 = AddressResolver::resolve("::1", 8080);
+    CHECK_EQUAL(1u, v6.size());
+    CHECK_EQUAL(AF_INET6, v6[0].family());
+    CHECK_EQUAL("[::1]:8080", AddressResolver::format(v6[0]));
+
+    std::vector<AddressResolver::Address> named = AddressResolver::resolve("localhost", 33333);
+    CHECK(!named.empty());
+    CHECK_EQUAL(named.size(), AddressResolver::resolve("localhost", 33333).size());
+    AddressResolver::forget("localhost", 33333);
+    CHECK_EQUAL(named.size(), AddressResolver::resolve("localhost", 33333).size());
+}
+
+// Тесты для LoadBalancer
+
+/**
+ * @test LoadBalancer_Acquire_PrefersFastAndEjectsFailing
+ * @brief Tests that the `LoadBalancer` class routes by latency and load and ejects failing endpoints.
+ * 
+ * This test checks that unmeasured endpoints are spread by load, that the expected wait (latency
+ * times work in progress) decides once latencies are known, and that a failure ejects an endpoint
+ * for a time that doubles with consecutive failures.
+ */
+TEST(LoadBalancer_Acquire_PrefersFastAndEjectsFailing) {
+    LoadBalancer balancer(3);
+    const LoadBalancer::Clock::time_point now = LoadBalancer::Clock::now();
+    CHECK_EQUAL(0u, balancer.acquire(now));
+    CHECK_EQUAL(1u, balancer.acquire(now));
+    CHECK_EQUAL(2u, balancer.acquire(now));
+    balancer.record(0, 1000);
+    balancer.record(1, 5000);
+    balancer.record(2, 500);
+    for (size_t i = 0; i < 3; ++i) {
+        balancer.release(i, false, now);
+    }
+
+    CHECK_EQUAL(2u, balancer.acquire(now));
+    CHECK_EQUAL(0u, balancer.acquire(now));
+    CHECK_EQUAL(2u, balancer.acquire(now));
+    CHECK_EQUAL(2u, balancer.inFlight(2));
+    balancer.release(2, false, now);
+    balancer.release(0, false, now);
+
+    balancer.release(2, true, now);
+    CHECK(balancer.ejected(2, now));
+    CHECK(!balancer.ejected(2, now + LoadBalancer::MIN_EJECTION));
+    CHECK_EQUAL(0u, balancer.acquire(now));
+    balancer.release(0, false, now);
+    CHECK_EQUAL(2u, balancer.acquire(now + LoadBalancer::MIN_EJECTION));
+    balancer.release(2, true, now + LoadBalancer::MIN_EJECTION);
+    CHECK(balancer.ejected(2, now + LoadBalancer::MIN_EJECTION * 2));
+    CHECK_EQUAL(2u, balancer.failures(2));
+
+    CHECK_EQUAL(0u, balancer.acquire(now));
+    balancer.release(0, true, now);
+    CHECK_EQUAL(1u, balancer.acquire(now));
+    balancer.release(1, true, now - LoadBalancer::MIN_EJECTION / 2);
+    CHECK_EQUAL(1u, balancer.acquire(now));
+}
+
+// Тесты для MetricsServer
+
+/**
+ * @test MetricsServer_Scrape_ReturnsPrometheusText
+ * @brief Tests that the `MetricsServer` class answers a request on a Unix socket with the metrics.
+ * 
+ * This test records a vector and a gauge change, scrapes the server like Prometheus would and
+ * checks the HTTP status line and the exported series.
+ */
+TEST(MetricsServer_Scrape_ReturnsPrometheusText) {
+    Stats::enable();
+    Stats::add(Stats::Counter::Vectors);
+    Stats::adjust(Stats::Gauge::InFlight, 1);
+    Stats::adjust(Stats::Gauge::InFlight, -1);
+
+    const std::string path = "/tmp/metrics_test.sock";
+    MetricsServer server("unix:" + path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+    CHECK(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+    const std::string request = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    CHECK(send(fd, request.data(), request.size(), 0) == static_cast<ssize_t>(request.size()));
+
+    std::string response;
+    char buffer[4096];
+    ssize_t received;
+    while ((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, received);
+    }
+    close(fd);
+
+    CHECK(response.rfind("HTTP/1.1 200 OK", 0) == 0);
+    CHECK(response.find("# TYPE client_vectors_total counter") != std::string::npos);
+    CHECK(response.find("\nclient_in_flight 0\n") != std::string::npos);
+    CHECK(response.find("client_latency_seconds_count") != std::string::npos);
+    CHECK(response.find("client_results_per_second") != std::string::npos);
+}
+
+// Тесты для ResultCache
+
+/**
+ * @test ResultCache_InsertLookup_Persistent
+ * @brief Tests that the `ResultCache` class keeps results across instances and separates servers.
+ * 
+ * This test stores a result, reopens the cache file and looks the result up again, and verifies
+ * that the same vector does not match for a different server identity.
+ */
+TEST(ResultCache_InsertLookup_Persistent) {
+    const std::string path = "result_cache_test.bin";
+    std::remove(path.c_str());
+    const double vec[] = {1.1, 2.2, 3.3};
+    {
+        ResultCache cache(path, "127.0.0.1:33333/double", 64);
+        ResultCache::Key key = cache.makeKey(vec, sizeof(vec));
+        double result = 0;
+        CHECK(!cache.lookup(key, result));
+        cache.insert(key, 6.6);
+        CHECK_EQUAL(1u, cache.size());
+    }
+    {
+        ResultCache cache(path, "127.0.0.1:33333/double", 64);
+        double result = 0;
+        CHECK(cache.lookup(cache.makeKey(vec, sizeof(vec)), result));
+        CHECK_EQUAL(6.6, result);
+        CHECK_EQUAL(1u, cache.hits());
+    }
+    {
+        ResultCache cache(path, "10.0.0.1:33333/double", 64);
+        double result = 0;
+        CHECK(!cache.lookup(cache.makeKey(vec, sizeof(vec)), result));
+        CHECK_EQUAL(1u, cache.misses());
+    }
+    std::remove(path.c_str());
+}
+
+/**
+ * @test ResultCache_MakeKeys_MatchesMakeKey
+ * @brief Tests that keys hashed together are the keys of the vectors hashed one by one.
+ * 
+ * This test computes the keys of vectors of 0 to 99 values, more than one group and not a whole
+ * number of multi-buffer lanes, with `makeKeys` and compares every one with `makeKey`.
+ */
+TEST(ResultCache_MakeKeys_MatchesMakeKey) {
+    const std::string path = "result_cache_keys_test.bin";
+    std::remove(path.c_str());
+    ResultCache cache(path, "127.0.0.1:33333/double", 64);
+    std::vector<std::vector<double>> vectors(100);
+    std::vector<const void*> data;
+    std::vector<size_t> sizes;
+    for (size_t i = 0; i < vectors.size(); ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            vectors[i].push_back(static_cast<double>(i * j) * 0.5);
+        }
+        data.push_back(vectors[i].data());
+        sizes.push_back(vectors[i].size() * sizeof(double));
+    }
+    std::vector<ResultCache::Key> keys(vectors.size());
+    cache.makeKeys(data.data(), sizes.data(), vectors.size(), keys.data());
+    for (size_t i = 0; i < vectors.size(); ++i) {
+        CHECK(keys[i] == cache.makeKey(data[i], sizes[i]));
+    }
+    std::remove(path.c_str());
+}
+
+/**
+ * @test ResultCache_Capacity_RoundedAndReset
+ * @brief Tests that the capacity is rounded up to a power of two and that another one empties the file.
+ * 
+ * This test opens a cache for 1000 results, which must hold 1024, stores a result and reopens the
+ * file first with a size rounding to the same capacity, keeping the result, then with a different
+ * one, which starts the cache afresh.
+ */
+TEST(ResultCache_Capacity_RoundedAndReset) {
+    const std::string path = "result_cache_capacity_test.bin";
+    std::remove(path.c_str());
+    const double vec[] = {4.0, 5.0};
+    {
+        ResultCache cache(path, "127.0.0.1:33333/double", 1000);
+        CHECK_EQUAL(1024u, cache.capacity());
+        cache.insert(cache.makeKey(vec, sizeof(vec)), 9.0);
+    }
+    {
+        ResultCache cache(path, "127.0.0.1:33333/double", 1024);
+        CHECK_EQUAL(1u, cache.size());
+    }
+    {
+        ResultCache cache(path, "127.0.0.1:33333/double", 64);
+        CHECK_EQUAL(64u, cache.capacity());
+        CHECK_EQUAL(0u, cache.size());
+        double result = 0;
+        CHECK(!cache.lookup(cache.makeKey(vec, sizeof(vec)), result));
+    }
+    std::remove(path.c_str());
+}
+
+/**
+ * @test ResultCache_Insert_BoundedSize
+ * @brief Tests that the `ResultCache` class never grows beyond its capacity.
+ * 
+ * This test inserts many more results than the cache can hold and verifies that entries are
+ * evicted instead of the table growing, and that recently inserted results are still found.
+ */
+TEST(ResultCache_Insert_BoundedSize) {
+    const std::string path = "result_cache_test.bin";
+    std::remove(path.c_str());
+    ResultCache cache(path, "server", 32);
+    for (int i = 0; i < 1000; ++i) {
+        double value = i;
+        cache.insert(cache.makeKey(&value, sizeof(value)), value * 2);
+    }
+    CHECK(cache.size() <= cache.capacity());
+    CHECK(cache.evictions() > 0);
+
+    double last = 999, result = 0;
+    CHECK(cache.lookup(cache.makeKey(&last, sizeof(last)), result));
+    CHECK_EQUAL(1998.0, result);
+    std::remove(path.c_str());
+}
+
+// Тесты для InputLoader
+
+/**
+ * @test InputLoader_Batches_MatchLines
+ * @brief Tests that the `InputLoader` class reports one vector per line, including empty lines.
+ * 
+ * This test writes a file without a trailing newline, checks the announced count and verifies the
+ * parsed values, then checks that a missing file is reported to the caller.
+ */
+TEST(InputLoader_Batches_MatchLines) {
+    const std::string path = "input_loader_test.txt";
+    {
+        std::ofstream file(path);
+        file << "1.1 2.2 3.3\n\n4 5";
+    }
+    {
+        InputLoader loader(path);
+        CHECK_EQUAL(3u, loader.count());
+        InputLoader::Batch vectors = loader.readAll();
+        CHECK_EQUAL(3u, vectors.size());
+        CHECK_EQUAL(3u, vectors[0].size());
+        CHECK_EQUAL(0u, vectors[1].size());
+        CHECK_EQUAL(5.0, vectors[2][1]);
+    }
+    std::remove(path.c_str());
+
+    InputLoader missing("input_loader_missing.txt");
+    CHECK_THROW(missing.count(), std::runtime_error);
+}
+
+/**
+ * @test InputLoader_ElementTypes_ParseExactly
+ * @brief Tests that `BasicInputLoader` parses integers exactly and rounds floats once.
+ * 
+ * This test reads the same file as `int64_t`, `int32_t` and `float`: an integer beyond the
+ * precision of a double must survive, a token with a fraction or out of range ends the line for
+ * integer types, and a float must equal the correctly rounded literal.
+ */
+TEST(InputLoader_ElementTypes_ParseExactly) {
+    const std::string path = "input_loader_types_test.txt";
+    {
+        std::ofstream file(path);
+        file << "9007199254740993 -7\n1.5 2\n0.1 3000000000\n";
+    }
+    {
+        BasicInputLoader<int64_t> loader(path);
+        BasicInputLoader<int64_t>::Batch vectors = loader.readAll();
+        CHECK_EQUAL(3u, vectors.size());
+        CHECK_EQUAL(9007199254740993LL, static_cast<long long>(vectors[0][0]));
+        CHECK_EQUAL(-7LL, static_cast<long long>(vectors[0][1]));
+        CHECK_EQUAL(0u, vectors[1].size());
+        CHECK_EQUAL(0u, vectors[2].size());
+    }
+    {
+        BasicInputLoader<int32_t> loader(path);
+        BasicInputLoader<int32_t>::Batch vectors = loader.readAll();
+        CHECK_EQUAL(0u, vectors[0].size());
+    }
+    {
+        BasicInputLoader<float> loader(path);
+        BasicInputLoader<float>::Batch vectors = loader.readAll();
+        CHECK_EQUAL(2u, vectors[1].size());
+        CHECK_EQUAL(1.5f, vectors[1][0]);
+        CHECK_EQUAL(0.1f, vectors[2][0]);
+        CHECK_EQUAL(3e9f, vectors[2][1]);
+    }
+    std::remove(path.c_str());
+}
+
+/**
+ * @test InputLoader_Parse_CountsNonzeros
+ * @brief Tests that parsed batches know how many values of every vector are not zero.
+ * 
+ * This test parses mostly-zero lines, where `-0.0` must count as nonzero since the sparse encoding
+ * restores omitted values as positive zeros, and checks that the counts survive appending.
+ */
+TEST(InputLoader_Parse_CountsNonzeros) {
+    const std::string path = "input_loader_sparse_test.txt";
+    {
+        std::ofstream file(path);
+        file << "0 0 0 1.5 0 0\n\n0.0 -0.0 0 0\n7 8 9\n";
+    }
+    {
+        InputLoader loader(path);
+        InputLoader::Batch vectors = loader.readAll();
+        CHECK_EQUAL(4u, vectors.size());
+        CHECK_EQUAL(1u, vectors.nonzeros(0));
+        CHECK_EQUAL(0u, vectors.nonzeros(1));
+        CHECK_EQUAL(1u, vectors.nonzeros(2));
+        CHECK_EQUAL(3u, vectors.nonzeros(3));
+
+        InputLoader::Batch copy;
+        copy.append(vectors[3].data(), vectors[3].size());
+        copy.append(vectors);
+        CHECK_EQUAL(3u, copy.nonzeros(0));
+        CHECK_EQUAL(1u, copy.nonzeros(1));
+        CHECK_EQUAL(3u, copy.nonzeros(4));
+        copy.clear();
+        copy.append(vectors[0].data(), vectors[0].size());
+        CHECK_EQUAL(1u, copy.nonzeros(0));
+    }
+    std::remove(path.c_str());
+}
+
+// Тесты для BatchSizer
+
+/**
+ * @test BatchSizer_Next_FollowsRoundTripAndCost
+ * @brief Tests that the `BatchSizer` class sizes frames from the measured round trip and cost per vector.
+ * 
+ * This test checks the initial frame size, the size derived from a measured frame, the limit by
+ * payload bytes, a faster frame lowering the round trip, and the largest frames for a server
+ * whose work is too small to measure.
+ */
+TEST(BatchSizer_Next_FollowsRoundTripAndCost) {
+    BatchSizer sizer(10000);
+    CHECK_EQUAL(BatchSizer::INITIAL_VECTORS, sizer.next(100));
+
+    sizer.record(16, 10000 + 16 * 700);
+    CHECK_CLOSE(700.0, sizer.perVector(), 1e-9);
+    CHECK_EQUAL(129u, sizer.next(100));
+    CHECK_EQUAL(10u, sizer.next(BatchSizer::MAX_BYTES / 10));
+    CHECK_EQUAL(1u, sizer.next(BatchSizer::MAX_BYTES * 2));
+
+    sizer.record(1, 5000);
+    CHECK_CLOSE(5000.0, sizer.roundTrip(), 1e-9);
+    CHECK_CLOSE(560.0, sizer.perVector(), 1e-9);
+    CHECK_EQUAL(81u, sizer.next(100));
+
+    BatchSizer fast(1000);
+    fast.record(16, 1000);
+    CHECK_EQUAL(BatchSizer::MAX_VECTORS, fast.next(8));
+}
+
+// Тесты для XorCodec
+
+/**
+ * @test XorCodec_RoundTrip_IsBitExact
+ * @brief Tests that the `XorCodec` class restores every bit of 64- and 32-bit values.
+ * 
+ * This test encodes doubles with repeats, sign changes, extreme exponents and a slowly changing
+ * integer series, checks that they decode unchanged and that a constant series shrinks to about one bit
+ * per value, then does the same for floats and checks that a truncated encoding is rejected.
+ */
+TEST(XorCodec_RoundTrip_IsBitExact) {
+    std::vector<double> values = {0.08, 0.08, 1.5, -3.25, 1e300, -0.0, 5e-324, 0.08};
+    for (int i = 0; i < 1000; ++i) {
+        values.push_back(20000.0 + i / 4);
+    }
+    std::vector<uint8_t> encoded(XorCodec::maxEncodedSize(values.size(), sizeof(double)));
+    const size_t size = XorCodec::encode(values.data(), values.size(), sizeof(double), encoded.data());
+    CHECK(size < values.size() * sizeof(double));
+    std::vector<double> decoded(values.size());
+    XorCodec::decode(encoded.data(), size, decoded.data(), decoded.size(), sizeof(double));
+    CHECK(std::memcmp(values.data(), decoded.data(), values.size() * sizeof(double)) == 0);
+    CHECK_THROW(XorCodec::decode(encoded.data(), size / 2, decoded.data(), decoded.size(), sizeof(double)),
+                std::runtime_error);
+
+    const std::vector<double> constant(1000, 0.08);
+    CHECK(XorCodec::encode(constant.data(), constant.size(), sizeof(double), encoded.data()) <= 8 + 125);
+
+    std::vector<float> floats = {1.0f, -2.5f, 3.4e38f, 1.0f, 1.0f, 0.1f};
+    std::vector<uint8_t> packed(XorCodec::maxEncodedSize(floats.size(), sizeof(float)));
+    const size_t floatSize = XorCodec::encode(floats.data(), floats.size(), sizeof(float), packed.data());
+    std::vector<float> unpacked(floats.size());
+    XorCodec::decode(packed.data(), floatSize, unpacked.data(), unpacked.size(), sizeof(float));
+    CHECK(std::memcmp(floats.data(), unpacked.data(), floats.size() * sizeof(float)) == 0);
+    CHECK_THROW(XorCodec::encode(floats.data(), floats.size(), 2, packed.data()), std::runtime_error);
+}
+
+// Тесты для VectorDeduplicator
+
+/**
+ * @test VectorDeduplicator_Find_MapsRepeatsToFirst
+ * @brief Tests that the `VectorDeduplicator` class maps every repeated vector to its first occurrence.
+ * 
+ * This test builds a batch with repeated vectors, a vector that is a prefix of another, empty
+ * vectors and `0.0` next to `-0.0`, and checks the first occurrences and the number of distinct vectors.
+ */
+TEST(VectorDeduplicator_Find_MapsRepeatsToFirst) {
+    VectorBatch batch;
+    const double a[] = {1.0, 2.0, 3.0};
+    const double b[] = {1.0, 2.0};
+    const double zero[] = {0.0};
+    const double negativeZero[] = {-0.0};
+    batch.append(a, 3);
+    batch.append(b, 2);
+    batch.append(a, 3);
+    batch.append(nullptr, 0);
+    batch.append(zero, 1);
+    batch.append(negativeZero, 1);
+    batch.append(nullptr, 0);
+    batch.append(b, 2);
+
+    std::vector<size_t> first;
+    CHECK_EQUAL(5u, VectorDeduplicator::find(batch, first));
+    const std::vector<size_t> expected = {0, 1, 0, 3, 4, 5, 3, 1};
+    CHECK(first == expected);
+
+    VectorBatch many;
+    for (int i = 0; i < 10000; ++i) {
+        const double value = i % 1000;
+        many.append(&value, 1);
+    }
+    CHECK_EQUAL(1000u, VectorDeduplicator::find(many, first));
+    CHECK_EQUAL(999u, first[9999]);
+}
+
+// Тесты для ReductionEngine
+
+/**
+ * @test ReductionEngine_Kernels_AgreeWithScalar
+ * @brief Tests that every supported kernel of the `ReductionEngine` class agrees with the scalar loop.
+ * 
+ * This test reduces vectors of every length up to 100 (covering full registers and remainders)
+ * with every kernel and operation: integers, including wrapping 32-bit sums, must match exactly,
+ * doubles within the tolerance of `agrees`. It also checks the mean of an empty vector and that a
+ * clearly wrong result is rejected.
+ */
+TEST(ReductionEngine_Kernels_AgreeWithScalar) {
+    std::vector<double> doubles(100);
+    std::vector<int32_t> ints(100);
+    for (size_t i = 0; i < doubles.size(); ++i) {
+        doubles[i] = (static_cast<double>(i * 37 % 101) - 50.0) / 7.0;
+        ints[i] = static_cast<int32_t>(2000000000u + i * 123457u);
+    }
+    for (auto operation : {ReductionEngine::Operation::Sum, ReductionEngine::Operation::SumOfSquares,
+                           ReductionEngine::Operation::Mean}) {
+        const ReductionEngine scalar(operation, ReductionEngine::Kernel::Scalar);
+        for (auto kernel : {ReductionEngine::Kernel::Avx2, ReductionEngine::Kernel::Avx512}) {
+            if (!ReductionEngine::kernelSupported(kernel)) {
+                continue;
+            }
+            const ReductionEngine engine(operation, kernel);
+            for (size_t count = 0; count <= doubles.size(); ++count) {
+                const double expected = scalar.reduce(doubles.data(), count);
+                CHECK(engine.agrees(doubles.data(), count, engine.reduce(doubles.data(), count), expected));
+                CHECK_EQUAL(scalar.reduce(ints.data(), count), engine.reduce(ints.data(), count));
+            }
+            std::vector<int64_t> wide(ints.begin(), ints.end());
+            CHECK_EQUAL(scalar.reduce(wide.data(), wide.size()), engine.reduce(wide.data(), wide.size()));
+        }
+        CHECK(!scalar.agrees(doubles.data(), doubles.size(), scalar.reduce(doubles.data(), doubles.size()),
+                             scalar.reduce(doubles.data(), doubles.size()) + 1.0));
+    }
+    const ReductionEngine mean(ReductionEngine::parseOperation("mean"));
+    CHECK_EQUAL(0.0, mean.reduce(doubles.data(), 0));
+    CHECK_THROW(ReductionEngine::parseOperation("product"), std::runtime_error);
+}
+
+// Тесты для IoUring
+
+/**
+ * @test IoUring_Exchange_SpansBuffers
+ * @brief Tests that the `IoUring` class sends a large request and assembles a reply spanning several buffers.
+ * 
+ * This test talks to a peer thread over a socket pair: the peer checks the request and answers
+ * with more data than one provided buffer holds. It then checks that the connection is reported
+ * idle, and that receiving after the peer has closed it throws. Without io_uring it does nothing.
+ */
+TEST(IoUring_Exchange_SpansBuffers) {
+    if (!IoUring::available()) {
+        return;
+    }
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    const std::string header = "len";
+    const std::string payload(200000, 'x');
+    const std::string answer(3 * IoUring::BUFFER_SIZE + 100, 'y');
+    std::string request;
+    std::thread peer([&] {
+        char buffer[65536];
+        ssize_t received;
+        while (request.size() < header.size() + payload.size() &&
+               (received = recv(fds[1], buffer, sizeof(buffer), 0)) > 0) {
+            request.append(buffer, received);
+        }
+        send(fds[1], answer.data(), answer.size(), 0);
+    });
+    {
+        IoUring ring(fds[0], false);
+        iovec parts[2] = {{const_cast<char*>(header.data()), header.size()},
+                          {const_cast<char*>(payload.data()), payload.size()}};
+        std::string reply(answer.size(), '\0');
+        ring.exchange(parts, 2, reply.data(), reply.size());
+        peer.join();
+        CHECK(request == header + payload);
+        CHECK(reply == answer);
+        CHECK(ring.idle());
+
+        close(fds[1]);
+        char byte;
+        CHECK_THROW(ring.receive(&byte, 1), std::runtime_error);
+    }
+    close(fds[0]);
+}
+
+/**
+ * @test IoUring_Exchange_TimesOut
+ * @brief Tests that the `IoUring` class gives up on a reply that does not arrive in time.
+ * 
+ * This test sends a request to a peer that does not answer, checks that the exchange throws
+ * after the timeout, and that a reply sent afterwards is reported as readable.
+ */
+TEST(IoUring_Exchange_TimesOut) {
+    if (!IoUring::available()) {
+        return;
+    }
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    {
+        IoUring ring(fds[0], false);
+        ring.setTimeout(std::chrono::milliseconds(50));
+        CHECK(!ring.readable(std::chrono::microseconds(0)));
+        char request[] = "ping";
+        iovec part{request, 4};
+        char reply[4];
+        const auto start = std::chrono::steady_clock::now();
+        CHECK_THROW(ring.exchange(&part, 1, reply, sizeof(reply)), std::runtime_error);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        CHECK(elapsed >= std::chrono::milliseconds(50));
+        CHECK(elapsed < std::chrono::milliseconds(1000));
+
+        CHECK_EQUAL(4, send(fds[1], "pong", 4, 0));
+        CHECK(ring.readable(std::chrono::milliseconds(1000)));
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// Тесты для LatencyHistogram
+
+/**
+ * @test LatencyHistogram_Percentiles_WithinPrecision
+ * @brief Tests the bucket layout, percentiles and merging of the `LatencyHistogram` class.
+ * 
+ * This test checks that every bucket boundary maps back to its own bucket, that the percentiles of
+ * 1..100000 are within 1% of the exact values, and that two halves recorded on separate threads
+ * merge into the same distribution.
+ */
+TEST(LatencyHistogram_Percentiles_WithinPrecision) {
+    for (size_t i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+        CHECK_EQUAL(i, LatencyHistogram::indexOf(LatencyHistogram::lowestValueAt(i)));
+        CHECK_EQUAL(i, LatencyHistogram::indexOf(LatencyHistogram::highestValueAt(i)));
+    }
+
+    LatencyHistogram low;
+    LatencyHistogram high;
+    std::thread worker([&high] {
+        for (uint64_t value = 50001; value <= 100000; ++value) {
+            high.record(value);
+        }
+    });
+    for (uint64_t value = 1; value <= 50000; ++value) {
+        low.record(value);
+    }
+    worker.join();
+
+    LatencyHistogram merged;
+    merged.merge(low);
+    merged.merge(high);
+    CHECK_EQUAL(100000u, merged.count());
+    CHECK_EQUAL(1u, merged.min());
+    CHECK_EQUAL(100000u, merged.max());
+    CHECK_CLOSE(50000.5, merged.mean(), 1e-6);
+    CHECK_CLOSE(50000.0, static_cast<double>(merged.valueAtPercentile(50)), 500.0);
+    CHECK_CLOSE(99000.0, static_cast<double>(merged.valueAtPercentile(99)), 990.0);
+    CHECK_EQUAL(100000u, merged.valueAtPercentile(100));
+
+    std::ostringstream table;
+    merged.writePercentiles(table);
+    CHECK(table.str().find("Total count") != std::string::npos);
+}
+
+// Тесты для ShmRing
+
+/**
+ * @test ShmRing_Exchange_WrapsAround
+ * @brief Tests that the `ShmRing` class streams more data than a ring holds and detects a closed peer.
+ * 
+ * This test sets up the rings over a socket pair with a server thread that reads a request one and
+ * a half times the ring capacity, so the client has to wait for space and the data wraps around,
+ * and then replies. After the server side is destroyed, the client must fail to receive.
+ */
+TEST(ShmRing_Exchange_WrapsAround) {
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    std::string payload(ShmRing::CAPACITY * 3 / 2, '\0');
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<char>(i * 7);
+    }
+    std::string request;
+    std::thread server([&] {
+        ShmRing ring(fds[1], true);
+        std::vector<char> buffer(65536);
+        while (request.size() < payload.size()) {
+            size_t received = ring.receive(buffer.data(), std::min(buffer.size(), payload.size() - request.size()), 1);
+            request.append(buffer.data(), received);
+        }
+        iovec reply{const_cast<char*>("ok"), 2};
+        ring.send(&reply, 1);
+    });
+    {
+        ShmRing ring(fds[0], false);
+        iovec part{payload.data(), payload.size()};
+        ring.send(&part, 1);
+        char reply[2];
+        CHECK_EQUAL(2u, ring.receive(reply, sizeof(reply), sizeof(reply)));
+        server.join();
+        CHECK(request == payload);
+        CHECK(std::string(reply, 2) == "ok");
+        CHECK(!ring.idle());
+        CHECK_THROW(ring.receive(reply, 1, 1), std::runtime_error);
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/**
+ * @test ShmRing_Receive_TimesOut
+ * @brief Tests that the `ShmRing` class gives up on data that does not arrive in time.
+ * 
+ * This test waits for a reply the peer never sends, checks that the receive throws after the
+ * timeout, and that data sent afterwards is reported as readable.
+ */
+TEST(ShmRing_Receive_TimesOut) {
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    std::unique_ptr<ShmRing> server;
+    std::thread peer([&] { server = std::make_unique<ShmRing>(fds[1], true); });
+    {
+        ShmRing ring(fds[0], false);
+        peer.join();
+        ring.setTimeout(std::chrono::milliseconds(50));
+        CHECK(!ring.readable(std::chrono::microseconds(0)));
+        char reply[4];
+        const auto start = std::chrono::steady_clock::now();
+        CHECK_THROW(ring.receive(reply, sizeof(reply), sizeof(reply)), std::runtime_error);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        CHECK(elapsed >= std::chrono::milliseconds(50));
+        CHECK(elapsed < std::chrono::milliseconds(1000));
+
+        iovec part{const_cast<char*>("pong"), 4};
+        server->send(&part, 1);
+        CHECK(ring.readable(std::chrono::milliseconds(1000)));
+        server.reset();
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// Тесты для SpoolWatcher
+
+/**
+ * @test SpoolWatcher_Next_ReportsExistingAndNewFiles
+ * @brief Tests that the `SpoolWatcher` class reports files present at start and files moved in later.
+ * 
+ * This test checks that hidden files are ignored until they are renamed, and that every file is
+ * reported exactly once.
+ */
+TEST(SpoolWatcher_Next_ReportsExistingAndNewFiles) {
+    char directory[] = "/tmp/spool_test_XXXXXX";
+    CHECK(mkdtemp(directory) != nullptr);
+    const std::string spool = directory;
+    std::ofstream(spool + "/existing.txt") << "1 2\n";
+
+    SpoolWatcher watcher(spool);
+    std::string name;
+    CHECK(watcher.next(name, 0));
+    CHECK_EQUAL("existing.txt", name);
+
+    std::ofstream(spool + "/.incoming.tmp") << "3 4\n";
+    CHECK(!watcher.next(name, 50));
+    std::rename((spool + "/.incoming.tmp").c_str(), (spool + "/incoming.txt").c_str());
+    CHECK(watcher.next(name, 1000));
+    CHECK_EQUAL("incoming.txt", name);
+    CHECK(!watcher.next(name, 50));
+
+    std::remove((spool + "/existing.txt").c_str());
+    std::remove((spool + "/incoming.txt").c_str());
+    rmdir(directory);
+}
+
+// Тесты для Stats
+
+/**
+ * @test Stats_Counters_MergedAcrossThreads
+ * @brief Tests that the `Stats` class merges the counters recorded by different threads.
+ * 
+ * This test records bytes on the main thread and on a worker thread that exits before the totals
+ * are read, and verifies that the JSON report can be written.
+ */
+TEST(Stats_Counters_MergedAcrossThreads) {
+    Stats::enable();
+    uint64_t before = Stats::total(Stats::Counter::BytesSent);
+    Stats::add(Stats::Counter::BytesSent, 10);
+    std::thread worker([] {
+        Stats::add(Stats::Counter::BytesSent, 32);
+        Stats::recordLatency(1000);
+    });
+    worker.join();
+    CHECK_EQUAL(before + 42, Stats::total(Stats::Counter::BytesSent));
+
+    const std::string path = "stats_test.json";
+    Stats::writeJson(path);
+    std::ifstream report(path);
+    std::string firstLine;
+    std::getline(report, firstLine);
+    CHECK_EQUAL("{", firstLine);
+    std::remove(path.c_str());
+}
+
+// Тесты для ThreadPool
+
+/**
+ * @test ThreadPool_Tasks_RunAndParseInOrder
+ * @brief Tests the `ThreadPool` class and the input loader running on it.
+ * 
+ * This test checks that results and exceptions reach the futures, that tasks queued by a worker
+ * on itself all run, and that a file parsed by several workers in parallel still arrives in line
+ * order.
+ */
+TEST(ThreadPool_Tasks_RunAndParseInOrder) {
+    ThreadPool pool(3, ThreadPool::Placement::Cpu);
+    CHECK_EQUAL(3u, pool.size());
+    CHECK(pool.nodeOf(2) >= 0);
+    CHECK_EQUAL(42, pool.submit([] { return 42; }).get());
+    auto failing = pool.submit([]() -> int { throw std::runtime_error("task failed"); });
+    CHECK_THROW(failing.get(), std::runtime_error);
+    CHECK_THROW(ThreadPool::parsePlacement("sockets"), std::runtime_error);
+
+    std::atomic<int> done(0);
+    pool.submit([&pool, &done] {
+        for (int i = 0; i < 1000; ++i) {
+            pool.post([&done] { done.fetch_add(1); });
+        }
+    }).get();
+    while (done.load() < 1000) {
+        std::this_thread::yield();
+    }
+    CHECK_EQUAL(1000, done.load());
+
+    const std::string path = "thread_pool_test.txt";
+    const size_t lines = 5 * InputLoader::BATCH_SIZE + 7;
+    {
+        std::ofstream file(path);
+        for (size_t line = 0; line < lines; ++line) {
+            file << line << " 1\n";
+        }
+    }
+    {
+        InputLoader loader(path, pool);
+        CHECK_EQUAL(lines, loader.count());
+        InputLoader::Batch vectors = loader.readAll();
+        CHECK_EQUAL(lines, vectors.size());
+        bool ordered = true;
+        for (size_t line = 0; line < vectors.size(); ++line) {
+            ordered = ordered && vectors[line].size() == 2 && vectors[line][0] == static_cast<double>(line);
+        }
+        CHECK(ordered);
+    }
+    std::remove(path.c_str());
+}
+
+// Тесты для Trace
+
+/**
+ * @test Trace_WriteJson_KeepsLatestSpans
+ * @brief Tests that the `Trace` class writes spans of all threads and keeps only the latest ones.
+ * 
+ * This test records more spans than fit into a ring on a worker thread and checks that the trace
+ * contains the thread name, the newest span and not the oldest one.
+ */
+TEST(Trace_WriteJson_KeepsLatestSpans) {
+    Trace::enable();
+    std::thread worker([] {
+        Trace::nameThread("trace-test-worker");
+        Trace::span("trace-test-oldest", 1000, 10);
+        for (size_t i = 0; i < Trace::RING_SIZE - 1; ++i) {
+            Trace::span("trace-test-span", 2000 + i, 10);
+        }
+        Trace::span("trace-test-newest", 900000, 10);
+    });
+    worker.join();
+
+    const std::string path = "trace_test.json";
+    Trace::writeJson(path);
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::remove(path.c_str());
+
+    CHECK(contents.str().find("\"traceEvents\"") != std::string::npos);
+    CHECK(contents.str().find("trace-test-worker") != std::string::npos);
+    CHECK(contents.str().find("trace-test-newest") != std::string::npos);
+    CHECK(contents.str().find("trace-test-oldest") == std::string::npos);
+}
+
+// Тесты для VectorGenerator
+
+/**
+ * @test VectorGenerator_Spec_ReproducibleVectors
+ * @brief Tests the parsing of generator specifications and the vectors produced by `VectorGenerator`.
+ * 
+ * This test checks that dimensions stay within the requested range, that the same seed yields the
+ * same vectors and that invalid specifications are rejected.
+ */
+TEST(VectorGenerator_Spec_ReproducibleVectors) {
+    VectorGenerator::Spec spec = VectorGenerator::parse("count=50,dim=3-7,dist=uniform,seed=42,rate=100");
+    CHECK_EQUAL(50u, spec.count);
+    CHECK_EQUAL(3u, spec.minDim);
+    CHECK_EQUAL(7u, spec.maxDim);
+    CHECK_CLOSE(100.0, spec.rate, 1e-9);
+
+    VectorGenerator first(spec);
+    VectorGenerator second(spec);
+    std::vector<double> a;
+    std::vector<double> b;
+    for (uint64_t i = 0; i < spec.count; ++i) {
+        first.next(a);
+        second.next(b);
+        CHECK(a.size() >= 3 && a.size() <= 7);
+        CHECK(a == b);
+        for (double value : a) {
+            CHECK(value >= 0.0 && value < 1.0);
+        }
+    }
+
+    VectorGenerator constant(VectorGenerator::parse("dim=4,dist=constant"));
+    constant.next(a);
+    CHECK(a == std::vector<double>(4, 1.0));
+
+    CHECK_THROW(VectorGenerator::parse("dim=0"), std::runtime_error);
+    CHECK_THROW(VectorGenerator::parse("dist=poisson"), std::runtime_error);
+    CHECK_THROW(VectorGenerator::parse("count=ten"), std::runtime_error);
+    CHECK_THROW(VectorGenerator::parse("speed=5"), std::runtime_error);
+}
+
+// Тесты для BufferPool
+
+/**
+ * @test BufferPool_SteadyStateLoop_NoAllocations
+ * @brief Tests that recycled buffers make the per-vector loop free of heap allocations.
+ * 
+ * This test checks that a released buffer comes back with its storage, then consumes a file of
+ * several batches the way the client does and requires that, once the first batch has been
+ * recycled, fetching batches, reading the vectors and collecting the results allocate nothing on
+ * the consuming thread. Finally the results are written with the gathered single write. The
+ * exchange with the server is checked the same way by `BufferPool_SteadyStateExchange_NoAllocations`
+ * in `integration.cpp`, which links the real `Communicator`.
+ */
+TEST(BufferPool_SteadyStateLoop_NoAllocations) {
+    BufferPool<std::vector<char>> pool(1);
+    std::vector<char> buffer = pool.acquire();
+    buffer.resize(4096);
+    const char* storage = buffer.data();
+    pool.release(std::move(buffer));
+    std::vector<char> reused = pool.acquire();
+    CHECK(reused.empty());
+    CHECK(reused.capacity() >= 4096);
+    CHECK(reused.data() == storage);
+
+    const std::string path = "buffer_pool_test.txt";
+    const std::string output = "buffer_pool_test.bin";
+    {
+        std::ofstream file(path);
+        for (size_t line = 0; line < 4 * InputLoader::BATCH_SIZE; ++line) {
+            file << line << " 0.5 -2 3e1 +4 .25\n";
+        }
+    }
+    {
+        InputLoader loader(path);
+        std::vector<double> results;
+        results.reserve(loader.count());
+        InputLoader::Batch batch;
+        size_t batches = 0;
+        uint64_t before = 0;
+        while (loader.nextBatch(batch)) {
+            if (++batches == 2) {
+                before = threadAllocations;
+            }
+            for (const auto& vec : batch) {
+                double sum = 0;
+                for (double value : vec) {
+                    sum += value;
+                }
+                results.push_back(sum);
+            }
+        }
+        CHECK_EQUAL(0u, threadAllocations - before);
+        CHECK_EQUAL(4u, batches);
+        CHECK_EQUAL(4 * InputLoader::BATCH_SIZE, results.size());
+        CHECK_CLOSE(33.75, results[1], 1e-12);
+
+        ResultWriter::write(output, results);
+        std::ifstream written(output, std::ios::binary | std::ios::ate);
+        CHECK_EQUAL(static_cast<long>(sizeof(uint32_t) + results.size() * sizeof(double)),
+                    static_cast<long>(written.tellg()));
+    }
+    std::remove(path.c_str());
+    std::remove(output.c_str());
+}
+
 // Тесты для DataReader
 
 /**